@@ -0,0 +1,69 @@
+#ifndef ASM_ASSEMBLER_H
+#define ASM_ASSEMBLER_H
+
+#include "common/common.h"
+
+typedef enum AsmSectionKind {
+    ASM_SECTION_TEXT,
+    ASM_SECTION_DATA,
+    ASM_SECTION_RODATA,
+    ASM_SECTION_FINI_ARRAY,
+    ASM_SECTION_COUNT
+} AsmSectionKind;
+
+typedef enum AsmRelocationKind {
+    ASM_RELOCATION_ABS64,
+    ASM_RELOCATION_PC32,
+    ASM_RELOCATION_PLT32
+} AsmRelocationKind;
+
+typedef struct AsmBuffer {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} AsmBuffer;
+
+typedef struct AsmSection {
+    const char *name;
+    AsmBuffer contents;
+    size_t alignment;
+} AsmSection;
+
+/* A label, global or extern. Undefined symbols have section -1. */
+typedef struct AsmSymbol {
+    char *name;
+    int section;
+    size_t offset;
+    bool global;
+    bool referenced;
+} AsmSymbol;
+
+/* A reference the assembler could not resolve within its own section. */
+typedef struct AsmRelocation {
+    AsmSectionKind section;
+    size_t offset;
+    size_t symbol;
+    AsmRelocationKind kind;
+    int64_t addend;
+} AsmRelocation;
+
+/* Machine code and data for one translation unit, before any object file
+   format is applied. */
+typedef struct AsmObject {
+    AsmSection sections[ASM_SECTION_COUNT];
+    DynamicArray symbols;
+    DynamicArray relocations;
+    HashTable *symbol_index;
+    size_t instructions;
+} AsmObject;
+
+void asm_buffer_append(AsmBuffer *buffer, const void *bytes, size_t count);
+void asm_buffer_free(AsmBuffer *buffer);
+
+/* Encodes the NASM subset the assembly backend emits. Returns NULL and
+   fills in the message on failure. */
+AsmObject *asm_assemble(const char *source, char *message, size_t message_size);
+void asm_object_destroy(AsmObject *object);
+AsmSymbol *asm_object_symbol(const AsmObject *object, const char *name);
+
+#endif
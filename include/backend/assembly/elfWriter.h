@@ -0,0 +1,9 @@
+#ifndef ASM_ELF_WRITER_H
+#define ASM_ELF_WRITER_H
+
+#include "backend/assembly/assembler.h"
+
+/* Writes an x86-64 ELF relocatable object that the system linker accepts. */
+bool elf_write_object(const AsmObject *object, FILE *out);
+
+#endif
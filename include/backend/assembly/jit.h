@@ -0,0 +1,25 @@
+#ifndef ASM_JIT_H
+#define ASM_JIT_H
+
+#include "backend/assembly/assembler.h"
+
+/* An assembled program mapped into this process. Code and data get pages
+   of their own so the code can be made executable without staying
+   writable. */
+typedef struct JitImage {
+    unsigned char *memory;
+    size_t size;
+    size_t code_size;
+    unsigned char *sections[ASM_SECTION_COUNT];
+    unsigned char *entry;
+    size_t fini_array_size;
+} JitImage;
+
+/* Resolves the object's external symbols against the runtime helpers and C
+   library functions linked into the compiler. */
+bool jit_load(const AsmObject *object, JitImage *image, char *message, size_t message_size);
+/* Calls main, then the object's finalizers, and returns main's result. */
+int jit_run(JitImage *image);
+void jit_unload(JitImage *image);
+
+#endif
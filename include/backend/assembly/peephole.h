@@ -0,0 +1,190 @@
+#ifndef ASM_PEEPHOLE_H
+#define ASM_PEEPHOLE_H
+
+#include "common/common.h"
+#include "backend/assembly/regalloc.h"
+#include "backend/codegen/codegenBuffer.h"
+
+#define ASM_MAX_OPERANDS 3
+
+/* Memory operands without a base or an index register use this. */
+#define ASM_NO_REGISTER ASM_REGISTER_COUNT
+
+typedef enum AsmLineKind {
+    ASM_LINE_INSTRUCTION,
+    ASM_LINE_LABEL,
+    /* Comments and directives, written out as they are. */
+    ASM_LINE_DIRECTIVE
+} AsmLineKind;
+
+/* The instructions instruction selection emits. Each scalar double opcode
+   is followed by its single-precision form. */
+typedef enum AsmOpcode {
+    ASM_OP_MOV,
+    ASM_OP_MOVZX,
+    ASM_OP_LEA,
+    ASM_OP_PUSH,
+    ASM_OP_POP,
+    ASM_OP_ADD,
+    ASM_OP_SUB,
+    ASM_OP_AND,
+    ASM_OP_OR,
+    ASM_OP_XOR,
+    ASM_OP_IMUL,
+    ASM_OP_IDIV,
+    ASM_OP_CQO,
+    ASM_OP_NEG,
+    ASM_OP_INC,
+    ASM_OP_DEC,
+    ASM_OP_SAL,
+    ASM_OP_SAR,
+    ASM_OP_BTC,
+    ASM_OP_CMP,
+    ASM_OP_TEST,
+    ASM_OP_SET,
+    ASM_OP_JMP,
+    ASM_OP_J,
+    ASM_OP_CALL,
+    ASM_OP_RET,
+    ASM_OP_NOP,
+    ASM_OP_MOVQ,
+    ASM_OP_MOVDQU,
+    ASM_OP_MOVSD,
+    ASM_OP_MOVSS,
+    ASM_OP_CVTSI2SD,
+    ASM_OP_CVTSI2SS,
+    ASM_OP_CVTTSD2SI,
+    ASM_OP_CVTTSS2SI,
+    ASM_OP_CVTSD2SS,
+    ASM_OP_CVTSS2SD,
+    ASM_OP_ADDSD,
+    ASM_OP_ADDSS,
+    ASM_OP_SUBSD,
+    ASM_OP_SUBSS,
+    ASM_OP_MULSD,
+    ASM_OP_MULSS,
+    ASM_OP_DIVSD,
+    ASM_OP_DIVSS,
+    ASM_OP_UCOMISD,
+    ASM_OP_UCOMISS,
+    ASM_OP_PADDQ,
+    ASM_OP_PSUBQ,
+    ASM_OP_ADDPD,
+    ASM_OP_SUBPD,
+    ASM_OP_MULPD,
+    ASM_OP_PSLLQ,
+    ASM_OP_PSRLQ,
+    ASM_OP_PAND,
+    ASM_OP_PUNPCKLQDQ,
+    ASM_OP_PSHUFD,
+    ASM_OP_COUNT
+} AsmOpcode;
+
+/* Condition of a set or a j, each next to its negation. */
+typedef enum AsmCondition {
+    ASM_CC_E,
+    ASM_CC_NE,
+    ASM_CC_Z,
+    ASM_CC_NZ,
+    ASM_CC_L,
+    ASM_CC_GE,
+    ASM_CC_LE,
+    ASM_CC_G,
+    ASM_CC_B,
+    ASM_CC_AE,
+    ASM_CC_BE,
+    ASM_CC_A,
+    ASM_CC_P,
+    ASM_CC_NP
+} AsmCondition;
+
+typedef enum AsmOperandKind {
+    ASM_OPERAND_NONE,
+    ASM_OPERAND_REGISTER,
+    ASM_OPERAND_XMM,
+    ASM_OPERAND_IMMEDIATE,
+    ASM_OPERAND_MEMORY,
+    /* A label or function named by a jump or a call. */
+    ASM_OPERAND_SYMBOL
+} AsmOperandKind;
+
+/* Registers are 8, 4 or 1 bytes wide. Memory is
+   [base + index*scale + displacement], or [rel symbol + displacement]
+   when it has a symbol, and is written with qword when its size is 8;
+   otherwise the instruction implies the size. */
+typedef struct AsmOperand {
+    AsmOperandKind kind;
+    int size;
+    AsmRegister reg;
+    AsmRegister index;
+    int scale;
+    int xmm;
+    long long value;
+    bool hex;
+    const char *symbol;
+    /* Called through the procedure linkage table. */
+    bool plt;
+} AsmOperand;
+
+typedef struct AsmInstruction {
+    AsmOpcode opcode;
+    AsmCondition condition;
+    AsmOperand operands[ASM_MAX_OPERANDS];
+    int operand_count;
+} AsmInstruction;
+
+/* One line of a function's assembly: an instruction, or the text of a
+   label or a directive. */
+typedef struct AsmLine {
+    AsmLineKind kind;
+    bool deleted;
+    const char *text;
+    AsmInstruction instruction;
+} AsmLine;
+
+/* The lines own no strings; every label, directive and symbol is kept in
+   the code's string list. */
+typedef struct AsmCode {
+    AsmLine *lines;
+    size_t count;
+    size_t capacity;
+    DynamicArray strings;
+} AsmCode;
+
+typedef enum AsmPeepholeRule {
+    ASM_PEEPHOLE_REDUNDANT_LOAD,
+    ASM_PEEPHOLE_REDUNDANT_STORE,
+    ASM_PEEPHOLE_JUMP_TO_NEXT,
+    ASM_PEEPHOLE_XOR_ZERO,
+    ASM_PEEPHOLE_COMPARE_BRANCH,
+    ASM_PEEPHOLE_RULE_COUNT
+} AsmPeepholeRule;
+
+typedef struct AsmPeepholeStats {
+    size_t applied[ASM_PEEPHOLE_RULE_COUNT];
+} AsmPeepholeStats;
+
+AsmOperand asm_reg(AsmRegister reg);
+AsmOperand asm_reg32(AsmRegister reg);
+AsmOperand asm_reg8(AsmRegister reg);
+AsmOperand asm_xmm(int xmm);
+AsmOperand asm_imm(long long value);
+AsmOperand asm_hex(unsigned long long value);
+AsmOperand asm_mem(AsmRegister base, AsmRegister index, int scale, long long displacement);
+AsmOperand asm_rel(const char *symbol, long long displacement);
+AsmOperand asm_qword(AsmOperand memory);
+AsmOperand asm_symbol(const char *name);
+AsmOperand asm_plt(const char *name);
+
+AsmCode *asm_code_create(void);
+void asm_code_destroy(AsmCode *code);
+void asm_code_add_text(AsmCode *code, AsmLineKind kind, const char *text);
+void asm_code_add_instruction(AsmCode *code, const AsmInstruction *instruction);
+void asm_code_write(const AsmCode *code, CodeBuffer *out);
+
+/* Rewrites the function's instructions in place and counts each rule's
+   rewrites into the stats. */
+void asm_peephole_optimize(AsmCode *code, AsmPeepholeStats *stats);
+const char *asm_peephole_rule_name(AsmPeepholeRule rule);
+
+#endif
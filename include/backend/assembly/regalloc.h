@@ -0,0 +1,76 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "backend/ir/irTypes.h"
+#include "optimizations/cfg.h"
+
+/* Numbered as in the x86-64 instruction encoding. */
+typedef enum AsmRegister {
+    ASM_RAX,
+    ASM_RCX,
+    ASM_RDX,
+    ASM_RBX,
+    ASM_RSP,
+    ASM_RBP,
+    ASM_RSI,
+    ASM_RDI,
+    ASM_R8,
+    ASM_R9,
+    ASM_R10,
+    ASM_R11,
+    ASM_R12,
+    ASM_R13,
+    ASM_R14,
+    ASM_R15,
+    ASM_REGISTER_COUNT
+} AsmRegister;
+
+/* Vectors are one SSE register wide. */
+#define ASM_VECTOR_QWORDS 2
+
+typedef enum AsmLocationKind {
+    ASM_LOCATION_NONE,
+    ASM_LOCATION_REGISTER,
+    ASM_LOCATION_STACK
+} AsmLocationKind;
+
+typedef struct AsmLocation {
+    AsmLocationKind kind;
+    AsmRegister reg;
+    int slot;
+} AsmLocation;
+
+/* Registers the allocator may hand out. Caller-saved registers only go to
+   values that are not live across a call; callee-saved ones are preserved
+   by the function's prologue once they are used. */
+typedef struct AsmRegisterSet {
+    const AsmRegister *caller_saved;
+    size_t caller_saved_count;
+    const AsmRegister *callee_saved;
+    size_t callee_saved_count;
+} AsmRegisterSet;
+
+typedef struct RegisterAllocation {
+    IRValueIndex *values;
+    AsmLocation *locations;
+    /* Number of operands naming each value, definitions included. */
+    int *references;
+    bool used[ASM_REGISTER_COUNT];
+    /* Stack slots in qwords; a vector takes ASM_VECTOR_QWORDS of them. */
+    int spill_slots;
+    size_t intervals;
+    size_t spilled;
+} RegisterAllocation;
+
+const char *asm_register_name(AsmRegister reg);
+const char *asm_register_name_32(AsmRegister reg);
+const char *asm_register_name_8(AsmRegister reg);
+
+RegisterAllocation *asm_allocate_registers(IRFunction *func, const AsmRegisterSet *registers);
+void asm_register_allocation_destroy(RegisterAllocation *allocation);
+const AsmLocation *asm_location_of(const RegisterAllocation *allocation, const IROperand *operand);
+bool asm_operand_is_allocatable(const IROperand *operand);
+bool asm_operand_is_vector(const IROperand *operand);
+int asm_reference_count(const RegisterAllocation *allocation, const IROperand *operand);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef ASM_TARGET_H
+#define ASM_TARGET_H
+
+#include "backend/assembly/regalloc.h"
+
+typedef enum AsmAbi {
+    ASM_ABI_WIN64,
+    ASM_ABI_SYSV
+} AsmAbi;
+
+/* Calling convention details the assembly backend needs for a target. */
+typedef struct AsmTarget {
+    const char *name;
+    const char *description;
+    AsmAbi abi;
+    const AsmRegister *argument_registers;
+    int argument_register_count;
+    /* Bytes the caller reserves below the stack arguments. */
+    int shadow_space;
+    /* Bytes below rsp a leaf function may use without moving rsp. */
+    int red_zone;
+    AsmRegisterSet registers;
+} AsmTarget;
+
+const AsmTarget *asm_target_win64(void);
+const AsmTarget *asm_target_sysv(void);
+const AsmTarget *asm_target_find(const char *name);
+const AsmTarget *asm_target_host(void);
+
+#endif
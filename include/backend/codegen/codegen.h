@@ -4,6 +4,8 @@
 #include "common/common.h"
 #include "backend/ir/ir.h"
 #include "frontend/ast/ast.h"
+#include "backend/assembly/jit.h"
+#include "backend/assembly/peephole.h"
 
 #define MAX_PARAMS 16
 
@@ -41,21 +43,30 @@ void codegen_write_main_function(CodeGenerator *generator);
 CodeGenerator *codegenasm_create(IRProgram *ir_program, FILE *output_file, Error *error);
 void codegenasm_destroy(CodeGenerator *generator);
 bool codegenasm_generate(CodeGenerator *generator);
+bool codegenasm_generate_object(CodeGenerator *generator);
+bool codegenasm_generate_image(CodeGenerator *generator, JitImage *image);
 
 void codegenasm_generate_program(CodeGenerator *generator);
 void codegenasm_generate_function(CodeGenerator *generator, IRFunction *func);
 void codegenasm_generate_instruction(CodeGenerator *generator, IRInstruction *instr);
 
 void codegenasm_move(CodeGenerator *generator, IROperand *dest, IROperand *src);
-void codegenasm_binary_op(CodeGenerator *generator, const char *op, IROperand *result, IROperand *arg1, IROperand *arg2);
-void codegenasm_unary_op(CodeGenerator *generator, const char *op, IROperand *result, IROperand *arg);
+void codegenasm_conditional_jump(CodeGenerator *generator, bool jump_if_true, IROperand *condition, const char *label);
+void codegenasm_binary_op(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg1, IROperand *arg2);
+void codegenasm_shift(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg1, IROperand *arg2);
+void codegenasm_unary_op(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg);
 void codegenasm_mul(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2);
 void codegenasm_div(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2);
 void codegenasm_mod(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2);
 void codegenasm_not(CodeGenerator *generator, IROperand *result, IROperand *arg);
-void codegenasm_compare(CodeGenerator *generator, const char *set_op, IROperand *result, IROperand *arg1, IROperand *arg2);
+void codegenasm_compare(CodeGenerator *generator, AsmCondition condition, IROperand *result, IROperand *arg1, IROperand *arg2);
+void codegenasm_float_binary(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg1, IROperand *arg2);
+void codegenasm_float_negate(CodeGenerator *generator, IROperand *result, IROperand *arg);
+void codegenasm_float_compare(CodeGenerator *generator, IROpcode opcode, IROperand *result, IROperand *arg1, IROperand *arg2);
 void codegenasm_call(CodeGenerator *generator, IROperand *result, const char *func_name);
-void codegenasm_print(CodeGenerator *generator, IROperand *value);
+void codegenasm_tail_call(CodeGenerator *generator, const char *func_name);
+void codegenasm_return(CodeGenerator *generator, IROperand *value);
+void codegenasm_print(CodeGenerator *generator, IRInstruction *instr);
 char *codegenasm_get_operand_name(CodeGenerator *generator, IROperand *operand);
 char *codegenasm_get_temp_name(CodeGenerator *generator, IROperand *operand);
 char *codegenasm_get_const_name(CodeGenerator *generator, IROperand *operand);
@@ -72,5 +83,11 @@ void codegenasm_error(CodeGenerator *generator, const char *message);
 void codegenasm_array_load(CodeGenerator *generator, IROperand *result, IROperand *array, IROperand *index);
 void codegenasm_array_store(CodeGenerator *generator, IROperand *array, IROperand *index, IROperand *value);
 void codegenasm_bounds_check(CodeGenerator *generator, IROperand *index, IROperand *size, const char *error_label);
+void codegenasm_vector_binary(CodeGenerator *generator, IRInstruction *instr);
+void codegenasm_vector_memory(CodeGenerator *generator, IRInstruction *instr);
+void codegenasm_vector_build(CodeGenerator *generator, IRInstruction *instr);
+void codegenasm_vector_reduce(CodeGenerator *generator, IRInstruction *instr);
+void codegenasm_profile(CodeGenerator *generator, IRInstruction *instr);
+void codegenasm_write_profile_dump(CodeGenerator *generator);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef CODEGEN_BUFFER_H
+#define CODEGEN_BUFFER_H
+
+#include "common/common.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+/* Growable in-memory output for the code generators. Everything is
+   appended here and written out with a single fwrite at the end. */
+typedef struct CodeBuffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+    size_t flushed;
+} CodeBuffer;
+
+CodeBuffer *code_buffer_create(void);
+void code_buffer_destroy(CodeBuffer *buffer);
+
+void code_buffer_append(CodeBuffer *buffer, const char *text, size_t length);
+void code_buffer_puts(CodeBuffer *buffer, const char *text);
+void code_buffer_putc(CodeBuffer *buffer, char c);
+void code_buffer_int(CodeBuffer *buffer, long long value);
+void code_buffer_indent(CodeBuffer *buffer, int level);
+void code_buffer_printf(CodeBuffer *buffer, const char *format, ...);
+void code_buffer_vprintf(CodeBuffer *buffer, const char *format, va_list args);
+
+/* Null-terminated view of the pending text. */
+const char *code_buffer_text(CodeBuffer *buffer);
+/* Writes the pending text and empties the buffer. */
+bool code_buffer_flush(CodeBuffer *buffer, FILE *out);
+/* Bytes produced so far, flushed or not. */
+size_t code_buffer_total(const CodeBuffer *buffer);
+/* Drops what was produced after the first `total` bytes, as long as it
+   has not been flushed yet. */
+void code_buffer_truncate(CodeBuffer *buffer, size_t total);
+
+#endif
@@ -4,6 +4,7 @@
 #include "common/common.h"
 #include "backend/ir/ir.h"
 #include "frontend/ast/ast.h"
+#include "backend/codegen/codegenBuffer.h"
 #include <stdio.h>
 
 #define MAX_PARAMS 16
@@ -15,6 +16,7 @@ struct CodeGenerator {
     IRProgram *ir_program;
     Program *program;
     FILE *output_file;
+    CodeBuffer *output;
     Error *error;
     int indent_level;
     int temp_counter;
@@ -29,6 +31,17 @@ struct CodeGenerator {
     DataType current_function_return_type;
     char epilogue_label[64];
     HashTable *declared_temps;
+    bool in_cold_block;
+    struct RegisterAllocation *register_allocation;
+    HashTable *string_labels;
+    HashTable *float_labels;
+    HashTable *local_offsets;
+    int saved_registers;
+    size_t emitted_instructions;
+    /* The code being selected, kept as instruction records until it is
+       written out. */
+    struct AsmCode *function_code;
+    struct AsmPeepholeStats *peephole_stats;
 };
 
 CodeGenerator *codegen_core_create(IRProgram *ir_program, Program *program, FILE *output_file, Error *error);
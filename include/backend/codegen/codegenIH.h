@@ -28,6 +28,9 @@ void codegen_handle_array_decl(CodeGenerator *generator, IRInstruction *instr);
 void codegen_handle_array_init(CodeGenerator *generator, IRInstruction *instr);
 void codegen_handle_var_decl(CodeGenerator *generator, IRInstruction *instr);
 void codegen_handle_inline_asm(CodeGenerator *generator, IRInstruction *instr);
+void codegen_handle_vector_build(CodeGenerator *generator, IRInstruction *instr);
+void codegen_handle_vector_reduce(CodeGenerator *generator, IRInstruction *instr);
+void codegen_handle_profile(CodeGenerator *generator, IRInstruction *instr);
 
 void codegen_instruction_handlers_generate_instruction(CodeGenerator *generator, IRInstruction *instr);
 
@@ -7,6 +7,8 @@
 #include "backend/codegen/codegenCore.h"
 #include <stdio.h>
 
+struct AsmTarget;
+
 typedef struct CodeGenStrategy {
     void (*generate_header)(CodeGenerator *generator);
     void (*generate_program)(CodeGenerator *generator);
@@ -19,6 +21,9 @@ typedef struct CodeGenStrategy {
     void (*write_runtime_functions)(CodeGenerator *generator);
     
     void (*destroy)(struct CodeGenStrategy *strategy);
+
+    /* Set for assembly strategies only. */
+    const struct AsmTarget *target;
 } CodeGenStrategy;
 
 CodeGenStrategy *codegen_strategy_factory(const char *target_language);
@@ -26,5 +31,6 @@ CodeGenStrategy *codegen_strategy_factory(const char *target_language);
 CodeGenStrategy *c_codegen_strategy_create(void);
 
 CodeGenStrategy *asm_codegen_strategy_create(void);
+CodeGenStrategy *asm_codegen_strategy_create_for_target(const struct AsmTarget *target);
 
 #endif 
\ No newline at end of file
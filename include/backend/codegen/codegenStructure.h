@@ -0,0 +1,14 @@
+#ifndef CODEGEN_STRUCTURE_H
+#define CODEGEN_STRUCTURE_H
+
+#include "common/common.h"
+#include "backend/ir/ir.h"
+#include "backend/codegen/codegenCore.h"
+
+/* Writes the function body with while, if/else, break and continue in
+   place of the IR's jumps. Edges that do not fit the nesting become
+   gotos. Returns false without writing anything when the control flow
+   is irreducible, leaving the caller to emit the plain goto form. */
+bool codegen_structure_write_function(CodeGenerator *generator, IRFunction *func);
+
+#endif
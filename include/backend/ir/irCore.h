@@ -18,6 +18,7 @@ void ir_program_destroy(IRProgram *program);
 
 void ir_function_add_instruction(IRFunction *func, IRInstruction *instr);
 void ir_function_add_param(IRFunction *func, IROperand *param);
+void ir_function_unshare_operands(IRFunction *func);
 void ir_program_add_function(IRProgram *program, IRFunction *func);
 
 void ir_function_print(const IRFunction *func);
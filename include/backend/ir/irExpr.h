@@ -5,5 +5,7 @@
 #include "backend/ir/irCore.h"
 
 IROperand *ir_generate_expression_impl(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer, DataType expected_type);
+IROperand *ir_generate_logical_expression(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer);
+void ir_generate_branch(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer, const char *label, bool jump_if_true);
 
 #endif
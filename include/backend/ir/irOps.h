@@ -13,6 +13,7 @@ IROperand *ir_operand_string_const(const char *value);
 IROperand *ir_operand_null(void);
 IROperand *ir_operand_null_with_type(DataType data_type);
 IROperand *ir_operand_label(const char *label_name);
+IROperand *ir_operand_copy(const IROperand *operand);
 
 void ir_operand_destroy(IROperand *operand);
 void ir_operand_print(const IROperand *operand);
@@ -18,6 +18,7 @@ typedef struct IROperand {
     IROperandType type;
     DataType data_type;
     int array_size;
+    int vector_width;
     bool is_float_const;
     union {
         int temp_id;
@@ -46,6 +47,9 @@ typedef enum {
     IR_GE,
     IR_AND,
     IR_OR,
+    IR_SHL,
+    IR_SHR,
+    IR_BAND,
     IR_NOT,
     IR_NEG,
     IR_JUMP,
@@ -62,7 +66,11 @@ typedef enum {
     IR_ARRAY_DECL,
     IR_ARRAY_INIT,
     IR_VAR_DECL,
-    IR_INLINE_ASM
+    IR_INLINE_ASM,
+    IR_VECTOR_SPLAT,
+    IR_VECTOR_INDEX,
+    IR_VECTOR_REDUCE,
+    IR_PROFILE
 } IROpcode;
 
 typedef struct IRInstruction {
@@ -81,6 +89,12 @@ typedef struct IRInstruction {
     DynamicArray *asm_inputs;   
     DynamicArray *asm_clobbers; 
     bool asm_volatile;
+    bool is_tail_call;
+    bool has_profile;
+    uint64_t profile_count;
+    uint64_t profile_taken;
+    bool is_cold;
+    bool is_epilogue;
 } IRInstruction;
 
 typedef struct LoopContext {
@@ -98,10 +112,16 @@ typedef struct IRFunction {
     int temp_counter;
     int label_counter;
     char *oob_error_label;
+    char *specialized_from;
+    bool memoize;
+    bool has_profile;
+    uint64_t profile_count;
 } IRFunction;
 
 typedef struct IRProgram {
     DynamicArray functions;
+    DynamicArray profile_counters;
+    char *profile_path;
 } IRProgram;
 
 #endif
@@ -24,8 +24,11 @@ IRInstruction *ir_instruction_array_decl(const char *array_name, int size, DataT
 IRInstruction *ir_instruction_array_init(const char *array_name, int size, DataType element_type, IROperand *value);
 IRInstruction *ir_instruction_var_decl(const char *var_name, DataType type);
 IRInstruction *ir_instruction_inline_asm(const char *asm_code, bool is_volatile, DynamicArray *outputs, DynamicArray *inputs, DynamicArray *clobbers);
+IRInstruction *ir_instruction_profile(int counter, IROperand *condition);
 
+IRInstruction *ir_instruction_clone(const IRInstruction *instr);
 void ir_instruction_destroy(IRInstruction *instr);
 void ir_instruction_print(const IRInstruction *instr);
+int ir_instruction_branch_bias(const IRInstruction *instr);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+#ifndef VM_BYTECODE_H
+#define VM_BYTECODE_H
+
+#include "common/common.h"
+#include "backend/ir/ir.h"
+#include "runtime/runtime.h"
+
+/* Opcodes are typed: _I works on 64-bit integers, _F on floats and _D on
+   doubles. Unless noted, a is the destination register and b and c are
+   source registers. */
+typedef enum BytecodeOpcode {
+    BC_MOVE,
+    BC_ADD_I,
+    BC_SUB_I,
+    BC_MUL_I,
+    BC_DIV_I,
+    BC_MOD_I,
+    BC_SHL_I,
+    BC_SHR_I,
+    BC_BAND_I,
+    BC_NEG_I,
+    BC_ADD_F,
+    BC_SUB_F,
+    BC_MUL_F,
+    BC_DIV_F,
+    BC_NEG_F,
+    BC_ADD_D,
+    BC_SUB_D,
+    BC_MUL_D,
+    BC_DIV_D,
+    BC_NEG_D,
+    BC_EQ_I,
+    BC_NE_I,
+    BC_LT_I,
+    BC_LE_I,
+    BC_GT_I,
+    BC_GE_I,
+    BC_EQ_F,
+    BC_NE_F,
+    BC_LT_F,
+    BC_LE_F,
+    BC_GT_F,
+    BC_GE_F,
+    BC_EQ_D,
+    BC_NE_D,
+    BC_LT_D,
+    BC_LE_D,
+    BC_GT_D,
+    BC_GE_D,
+    BC_NOT,
+    BC_AND,
+    BC_OR,
+    BC_I2F,
+    BC_I2D,
+    BC_F2I,
+    BC_D2I,
+    BC_F2D,
+    BC_D2F,
+    /* a is the target instruction. */
+    BC_JUMP,
+    BC_JUMP_IF,
+    BC_JUMP_IF_NOT,
+    /* Jump to a when b compares true with c. */
+    BC_BR_EQ_I,
+    BC_BR_NE_I,
+    BC_BR_LT_I,
+    BC_BR_LE_I,
+    BC_BR_GT_I,
+    BC_BR_GE_I,
+    /* b is the array's first register and c the index; stores take the
+       value in a. */
+    BC_LOAD_ELEMENT,
+    BC_STORE_ELEMENT,
+    /* Fills c registers from a with the value in b. */
+    BC_FILL,
+    /* Jump to a when index b is not below size c. */
+    BC_BOUNDS_CHECK,
+    /* b is the callee or builtin, c an argument list in the operand pool. */
+    BC_CALL,
+    BC_TAIL_CALL,
+    BC_CALL_BUILTIN,
+    BC_RETURN,
+    /* a is a list of register and BytecodePrintKind pairs. */
+    BC_PRINT,
+    /* Adds one to counter a, or adds b != 0 when b is a register. */
+    BC_PROFILE,
+    BC_PROFILE_IF,
+    /* Lane-wise operations over `width` consecutive registers. */
+    BC_VADD_I,
+    BC_VSUB_I,
+    BC_VMUL_I,
+    BC_VSHL_I,
+    BC_VSHR_I,
+    BC_VBAND_I,
+    BC_VADD_D,
+    BC_VSUB_D,
+    BC_VMUL_D,
+    BC_VLOAD,
+    BC_VSTORE,
+    BC_VSPLAT,
+    BC_VINDEX_I,
+    BC_VINDEX_D,
+    BC_VREDUCE_I,
+    BC_VREDUCE_D,
+    BC_OPCODE_COUNT
+} BytecodeOpcode;
+
+typedef enum BytecodeBuiltin {
+    BUILTIN_CONCAT,
+    BUILTIN_SUBSTR,
+    BUILTIN_STRLEN,
+    BUILTIN_STRCMP,
+    BUILTIN_CHAR_AT
+} BytecodeBuiltin;
+
+typedef enum BytecodePrintKind {
+    PRINT_INT,
+    PRINT_FLOAT,
+    PRINT_DOUBLE,
+    PRINT_STRING
+} BytecodePrintKind;
+
+/* One register: every value fits in 64 bits. Floats keep their bits in
+   the low half and the high half clear. */
+typedef union BytecodeValue {
+    int64_t i;
+    double d;
+    float f;
+    const char *s;
+} BytecodeValue;
+
+typedef struct BytecodeInstruction {
+    uint8_t opcode;
+    uint8_t width;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+} BytecodeInstruction;
+
+/* A function's frame holds its parameters first, then its variables and
+   temporaries, then a copy of its constant pool. */
+typedef struct BytecodeFunction {
+    char *name;
+    BytecodeInstruction *code;
+    size_t code_size;
+    size_t code_capacity;
+    /* Argument and print lists referenced by calls and prints. */
+    int32_t *operands;
+    size_t operand_count;
+    size_t operand_capacity;
+    BytecodeValue *constants;
+    size_t constant_count;
+    size_t constant_capacity;
+    int param_count;
+    /* Registers below the constant pool. */
+    int value_count;
+    int frame_size;
+    /* Caches results for the calls of functions the optimizer memoized. */
+    TLMemoTable *memo;
+} BytecodeFunction;
+
+typedef struct BytecodeProgram {
+    BytecodeFunction *functions;
+    size_t function_count;
+    int main_function;
+    /* String constants, owned by the program. */
+    DynamicArray strings;
+    uint64_t *profile_counters;
+    DynamicArray profile_names;
+    char *profile_path;
+} BytecodeProgram;
+
+BytecodeProgram *bytecode_compile(IRProgram *ir_program, Error *error);
+void bytecode_program_destroy(BytecodeProgram *program);
+const char *bytecode_opcode_name(BytecodeOpcode opcode);
+void bytecode_program_print(const BytecodeProgram *program, FILE *out);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef VM_INTERPRETER_H
+#define VM_INTERPRETER_H
+
+#include "backend/vm/bytecode.h"
+
+/* Runs the program's main function and returns its result. Appends the
+   profile counters to the program's profile path when it has any. */
+int interpreter_run(BytecodeProgram *program);
+
+#endif
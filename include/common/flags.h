@@ -5,6 +5,8 @@
 
 extern bool debug_enabled;
 extern bool suppress_warnings;
+extern const char *assembly_target;
+extern bool structured_c_output;
 
 typedef void (*CommandHandler)(int *i, int argc, char *argv[], void *context);
 
@@ -25,6 +27,8 @@ typedef struct
     bool dump_ast_flag;
     bool verbose_flag;
     bool assembly_output;
+    bool run_flag;
+    bool interpret_flag;
     bool suppress_warnings;
     bool memory_stats_flag;
     bool module_mode;
@@ -47,8 +51,20 @@ void handle_module_mode(int *i, int argc, char *argv[], void *context);
 void handle_module_include_path(int *i, int argc, char *argv[], void *context);
 void handle_output(int *i, int argc, char *argv[], void *context);
 void handle_asm(int *i, int argc, char *argv[], void *context);
+void handle_run(int *i, int argc, char *argv[], void *context);
+void handle_interpret(int *i, int argc, char *argv[], void *context);
+void handle_c_gotos(int *i, int argc, char *argv[], void *context);
+void handle_target(int *i, int argc, char *argv[], void *context);
 void handle_input_file(int *i, int argc, char *argv[], void *context);
 void handle_debug(int *i, int argc, char *argv[], void *context);
+void handle_unroll(int *i, int argc, char *argv[], void *context);
+void handle_clone_budget(int *i, int argc, char *argv[], void *context);
+void handle_profile_generate(int *i, int argc, char *argv[], void *context);
+void handle_profile_use(int *i, int argc, char *argv[], void *context);
+void handle_max_comptime_steps(int *i, int argc, char *argv[], void *context);
+void handle_jobs(int *i, int argc, char *argv[], void *context);
+void handle_optimization_level(int *i, int argc, char *argv[], void *context);
+void handle_time_passes(int *i, int argc, char *argv[], void *context);
 void process_argument(int *i, int argc, char *argv[], CompilerContext *context);
 void print_usage(const char *program_name);
 
@@ -60,5 +76,6 @@ const char *get_dynamic_linker(void);
 bool has_tl_extension(const char *filename);
 bool has_c_extension(const char *filename);
 bool has_asm_extension(const char *filename);
+bool has_object_extension(const char *filename);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include "backend/ir/irTypes.h"
+
+#define IR_MAX_INSTRUCTION_USES 8
+
+typedef struct IRBasicBlock {
+    size_t id;
+    size_t start;
+    size_t end;
+    const char *label;
+    DynamicArray succs;
+    DynamicArray preds;
+} IRBasicBlock;
+
+typedef struct IRControlFlowGraph {
+    IRFunction *function;
+    DynamicArray blocks;
+    HashTable *label_blocks;
+} IRControlFlowGraph;
+
+typedef struct IRValueIndex {
+    HashTable *vars;
+    DynamicArray var_names;
+    size_t var_count;
+    size_t temp_count;
+} IRValueIndex;
+
+IRControlFlowGraph *ir_cfg_build(IRFunction *func);
+void ir_cfg_destroy(IRControlFlowGraph *cfg);
+IRBasicBlock *ir_cfg_block(IRControlFlowGraph *cfg, size_t index);
+IRBasicBlock *ir_cfg_block_for_label(IRControlFlowGraph *cfg, const char *label);
+IRInstruction *ir_cfg_terminator(IRControlFlowGraph *cfg, IRBasicBlock *block);
+
+bool ir_instruction_is_branch(const IRInstruction *instr);
+bool ir_instruction_is_conditional_branch(const IRInstruction *instr);
+bool ir_instruction_references_label(const IRInstruction *instr);
+bool ir_instruction_falls_through(const IRInstruction *instr);
+bool ir_instruction_has_side_effects(const IRInstruction *instr);
+IROperand *ir_instruction_def(IRInstruction *instr);
+size_t ir_instruction_uses(IRInstruction *instr, IROperand ***uses, size_t max_uses);
+IRInstruction *ir_function_instr_at(IRFunction *func, size_t index);
+bool ir_operand_same(const IROperand *a, const IROperand *b);
+void ir_function_replace_instructions(IRFunction *func, DynamicArray *instructions);
+size_t ir_call_collect_params(IRFunction *func, size_t call_index, size_t *param_indices, size_t max_params);
+
+IRValueIndex *ir_value_index_create(IRFunction *func);
+void ir_value_index_destroy(IRValueIndex *index);
+size_t ir_value_index_size(const IRValueIndex *index);
+int ir_value_index_of(const IRValueIndex *index, const IROperand *operand);
+int ir_value_index_of_var(const IRValueIndex *index, const char *name);
+
+#endif
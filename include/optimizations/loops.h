@@ -0,0 +1,23 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include "backend/ir/irTypes.h"
+
+typedef struct CountedLoop {
+    size_t header;
+    size_t latch;
+    size_t body_start;
+    size_t update_start;
+    size_t update_end;
+    IROpcode compare;
+    IROperand *iv;
+    IROperand *bound;
+    int64_t step;
+    const char *exit_label;
+} CountedLoop;
+
+bool ir_operand_is_int_const(const IROperand *operand);
+bool ir_loop_match_counted(IRFunction *func, size_t header, CountedLoop *loop);
+bool ir_loop_initial_value(IRFunction *func, const CountedLoop *loop, int64_t *value);
+
+#endif
@@ -2,10 +2,13 @@
 #define OPTIMIZER_H
 
 #include "backend/ir/irTypes.h"
+#include <stdio.h>
 
 typedef struct OptimizationPass {
     const char *name;
     bool (*run)(IRProgram *program);
+    double seconds;
+    int runs;
 } OptimizationPass;
 
 typedef struct OptimizationPipeline {
@@ -13,15 +16,71 @@ typedef struct OptimizationPipeline {
     bool enabled;
 } OptimizationPipeline;
 
+typedef struct OptimizationOptions {
+    int level;
+    int unroll_factor;
+    int clone_budget;
+    int max_comptime_steps;
+    bool time_passes;
+    bool vectorize_floats;
+    int jobs;
+    const char *profile_generate;
+    const char *profile_use;
+} OptimizationOptions;
+
+typedef struct OptimizationStat {
+    const char *name;
+    size_t count;
+} OptimizationStat;
+
+typedef struct OptimizationStatsBuffer {
+    OptimizationStat *stats;
+    size_t count;
+    size_t capacity;
+} OptimizationStatsBuffer;
+
+typedef bool (*OptimizationFunctionPass)(IRFunction *func);
+
+extern OptimizationOptions optimization_options;
+
 OptimizationPipeline *optimization_pipeline_create(void);
 void optimization_pipeline_destroy(OptimizationPipeline *pipeline);
 void optimization_pipeline_add_pass(OptimizationPipeline *pipeline, OptimizationPass *pass);
 
 bool optimization_pipeline_run(OptimizationPipeline *pipeline, IRProgram *program);
+bool optimization_run_per_function(IRProgram *program, OptimizationFunctionPass run);
+void optimization_worker_pool_shutdown(void);
+int optimization_job_count(void);
+double optimization_clock_seconds(void);
 bool optimization_constant_folding(IRProgram *program);
 bool optimization_dead_code_elimination(IRProgram *program);
 bool optimization_copy_propagation(IRProgram *program);
+bool optimization_tail_call_elimination(IRProgram *program);
+bool optimization_sccp(IRProgram *program);
+bool optimization_loop_unrolling(IRProgram *program);
+bool optimization_vectorize(IRProgram *program);
+bool optimization_interprocedural_constants(IRProgram *program);
+bool optimization_comptime_evaluation(IRProgram *program);
+HashTable *optimization_infer_pure_functions(IRProgram *program);
+bool optimization_memoize(IRProgram *program);
+bool optimization_algebraic_simplification(IRProgram *program);
+bool optimization_cfg_simplification(IRProgram *program);
+bool optimization_block_layout(IRProgram *program);
+void optimization_profile_instrument(IRProgram *program, const char *path);
+void optimization_profile_annotate(IRProgram *program, const char *path);
+IROperand *ir_fold_binary_constant(IROpcode opcode, IROperand *arg1, IROperand *arg2);
+IROperand *ir_fold_unary_constant(IROpcode opcode, IROperand *arg);
 OptimizationPipeline *optimization_pipeline_create_default(void);
+OptimizationPipeline *optimization_pipeline_create_loop(void);
+OptimizationPipeline *optimization_pipeline_create_cleanup(void);
 bool optimization_optimize_program(IRProgram *program);
 
+void optimization_stats_reset(void);
+void optimization_stats_add(const char *name, size_t count);
+size_t optimization_stats_get(const char *name);
+void optimization_stats_print(FILE *out);
+OptimizationStatsBuffer *optimization_stats_redirect(OptimizationStatsBuffer *buffer);
+void optimization_stats_merge(OptimizationStatsBuffer *buffer);
+void optimization_pipeline_print_timings(OptimizationPipeline *pipeline, FILE *out);
+
 #endif 
\ No newline at end of file
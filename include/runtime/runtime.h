@@ -2,6 +2,7 @@
 #define RUNTIME_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 char* __tl_concat(const char* a, const char* b);
 int64_t __tl_strlen(const char* str);
@@ -9,4 +10,46 @@ char* __tl_substr(const char* str, int64_t start, int64_t len);
 int64_t __tl_strcmp(const char* a, const char* b);
 char* __tl_char_at(const char* str, int64_t index);
 
+#define TL_MEMO_MAX_ARGS 4
+#define TL_MEMO_DIRECT_SIZE 4096
+/* Results kept per memoized function beyond the direct table. Past this,
+   a new result takes over the slot its arguments hash to. */
+#define TL_MEMO_MAX_ENTRIES 65536
+
+typedef struct TLMemoTable {
+    int arity;
+    size_t capacity;
+    size_t count;
+    int64_t* keys;
+    int64_t* values;
+    unsigned char* used;
+} TLMemoTable;
+
+int __tl_memo_lookup(TLMemoTable* table, const int64_t* args, int64_t* value);
+void __tl_memo_store(TLMemoTable* table, const int64_t* args, int64_t value);
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TL_LIKELY(x) __builtin_expect(!!(x), 1)
+#define TL_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define TL_COLD __attribute__((cold, noinline))
+#define TL_NORETURN __attribute__((noreturn))
+#else
+#define TL_LIKELY(x) (x)
+#define TL_UNLIKELY(x) (x)
+#define TL_COLD
+#define TL_NORETURN
+#endif
+
+/* Placed after a label, marks the code that follows as unlikely to run. */
+#if defined(__GNUC__) && !defined(__clang__)
+#define TL_COLD_LABEL __attribute__((cold))
+#else
+#define TL_COLD_LABEL
+#endif
+
+TL_COLD void __tl_cold_print(const char* text);
+TL_COLD TL_NORETURN void __tl_bounds_error(void);
+
+void __tl_profile_register(const char* path, const char* const* names, uint64_t* counters, size_t count);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,1432 @@
+#include "backend/assembly/assembler.h"
+#include <ctype.h>
+#include <stdarg.h>
+
+extern bool debug_enabled;
+
+#define MAX_OPERANDS 3
+#define SYMBOL_LENGTH 128
+
+typedef enum OperandKind {
+    OPERAND_NONE,
+    OPERAND_REGISTER,
+    OPERAND_XMM,
+    OPERAND_IMMEDIATE,
+    OPERAND_MEMORY,
+    OPERAND_SYMBOL
+} OperandKind;
+
+typedef struct Operand {
+    OperandKind kind;
+    /* Width in bytes of a register, or of memory given a size keyword. */
+    int size;
+    int reg;
+    /* The immediate, or the displacement of a memory operand. */
+    int64_t value;
+    int base;
+    int index;
+    int scale;
+    bool rip;
+    bool plt;
+    char symbol[SYMBOL_LENGTH];
+} Operand;
+
+typedef struct Fixup {
+    AsmSectionKind section;
+    size_t offset;
+    char *symbol;
+    AsmRelocationKind kind;
+    int64_t addend;
+    int line;
+} Fixup;
+
+typedef struct Assembler {
+    AsmObject *object;
+    int section;
+    DynamicArray fixups;
+    char scope[SYMBOL_LENGTH];
+    int line;
+    char *message;
+    size_t message_size;
+    bool failed;
+} Assembler;
+
+/* Everything after the opcode: the ModRM reg field (or opcode extension),
+   the r/m operand and a trailing immediate. */
+typedef struct Encoding {
+    int prefix;
+    bool wide;
+    bool byte_registers;
+    unsigned char opcode[3];
+    int opcode_size;
+    int reg;
+    const Operand *rm;
+    int immediate_size;
+    int64_t immediate;
+} Encoding;
+
+static const char *section_names[ASM_SECTION_COUNT] = {".text", ".data", ".rodata", ".fini_array"};
+
+static const char *registers_64[16] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+                                       "r8",  "r9",  "r10", "r11", "r12", "r13", "r14", "r15"};
+static const char *registers_32[16] = {"eax", "ecx", "edx",  "ebx",  "esp",  "ebp",  "esi",  "edi",
+                                       "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"};
+static const char *registers_8[16] = {"al",  "cl",  "dl",   "bl",   "spl",  "bpl",  "sil",  "dil",
+                                      "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"};
+
+static const struct {
+    const char *name;
+    int code;
+} condition_codes[] = {{"o", 0},   {"no", 1},  {"b", 2},   {"c", 2},   {"nae", 2}, {"ae", 3},  {"nb", 3},
+                       {"nc", 3},  {"e", 4},   {"z", 4},   {"ne", 5},  {"nz", 5},  {"be", 6},  {"na", 6},
+                       {"a", 7},   {"nbe", 7}, {"s", 8},   {"ns", 9},  {"p", 10},  {"pe", 10}, {"np", 11},
+                       {"po", 11}, {"l", 12},  {"nge", 12}, {"ge", 13}, {"nl", 13}, {"le", 14}, {"ng", 14},
+                       {"g", 15},  {"nle", 15}};
+
+/* Opcode extensions of the classic two-operand integer instructions. */
+static const char *arithmetic_names[] = {"add", "or", "adc", "sbb", "and", "sub", "xor", "cmp"};
+
+typedef enum SseForm {
+    SSE_XMM_XMM,
+    SSE_XMM_GENERAL,
+    SSE_GENERAL_XMM
+} SseForm;
+
+typedef struct SseOpcode {
+    const char *name;
+    int prefix;
+    int opcode;
+    SseForm form;
+} SseOpcode;
+
+static const SseOpcode sse_opcodes[] = {
+    {"addsd", 0xF2, 0x58, SSE_XMM_XMM},         {"subsd", 0xF2, 0x5C, SSE_XMM_XMM},
+    {"mulsd", 0xF2, 0x59, SSE_XMM_XMM},         {"divsd", 0xF2, 0x5E, SSE_XMM_XMM},
+    {"sqrtsd", 0xF2, 0x51, SSE_XMM_XMM},        {"addss", 0xF3, 0x58, SSE_XMM_XMM},
+    {"subss", 0xF3, 0x5C, SSE_XMM_XMM},         {"mulss", 0xF3, 0x59, SSE_XMM_XMM},
+    {"divss", 0xF3, 0x5E, SSE_XMM_XMM},         {"sqrtss", 0xF3, 0x51, SSE_XMM_XMM},
+    {"ucomisd", 0x66, 0x2E, SSE_XMM_XMM},       {"ucomiss", 0, 0x2E, SSE_XMM_XMM},
+    {"cvtss2sd", 0xF3, 0x5A, SSE_XMM_XMM},      {"cvtsd2ss", 0xF2, 0x5A, SSE_XMM_XMM},
+    {"addpd", 0x66, 0x58, SSE_XMM_XMM},         {"subpd", 0x66, 0x5C, SSE_XMM_XMM},
+    {"mulpd", 0x66, 0x59, SSE_XMM_XMM},         {"xorpd", 0x66, 0x57, SSE_XMM_XMM},
+    {"paddq", 0x66, 0xD4, SSE_XMM_XMM},         {"psubq", 0x66, 0xFB, SSE_XMM_XMM},
+    {"pand", 0x66, 0xDB, SSE_XMM_XMM},          {"pxor", 0x66, 0xEF, SSE_XMM_XMM},
+    {"punpcklqdq", 0x66, 0x6C, SSE_XMM_XMM},    {"cvtsi2sd", 0xF2, 0x2A, SSE_XMM_GENERAL},
+    {"cvtsi2ss", 0xF3, 0x2A, SSE_XMM_GENERAL},  {"cvttsd2si", 0xF2, 0x2C, SSE_GENERAL_XMM},
+    {"cvttss2si", 0xF3, 0x2C, SSE_GENERAL_XMM}};
+
+/* Shifts by a register count; the immediate forms share opcode 0x73. */
+static const struct {
+    const char *name;
+    int opcode;
+    int extension;
+} sse_shifts[] = {{"psllq", 0xF3, 6}, {"psrlq", 0xD3, 2}};
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+void asm_buffer_append(AsmBuffer *buffer, const void *bytes, size_t count)
+{
+    if (buffer->size + count > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        while (capacity < buffer->size + count)
+            capacity *= 2;
+        buffer->data = safe_realloc(buffer->data, capacity);
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, bytes, count);
+    buffer->size += count;
+}
+
+void asm_buffer_free(AsmBuffer *buffer)
+{
+    safe_free(buffer->data);
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+}
+
+static bool fail(Assembler *as, const char *format, ...)
+{
+    if (!as->failed)
+    {
+        int length = snprintf(as->message, as->message_size, "Assembler: line %d: ", as->line);
+        if (length >= 0 && (size_t)length < as->message_size)
+        {
+            va_list args;
+            va_start(args, format);
+            vsnprintf(as->message + length, as->message_size - length, format, args);
+            va_end(args);
+        }
+        as->failed = true;
+    }
+    return false;
+}
+
+static char *trim(char *text)
+{
+    while (isspace((unsigned char)*text))
+        text++;
+    size_t length = strlen(text);
+    while (length > 0 && isspace((unsigned char)text[length - 1]))
+        text[--length] = '\0';
+    return text;
+}
+
+static bool starts_with_word(const char *text, const char *word)
+{
+    size_t length = strlen(word);
+    return strncmp(text, word, length) == 0 && (text[length] == '\0' || isspace((unsigned char)text[length]));
+}
+
+static bool is_symbol_char(char c)
+{
+    return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '$' || c == '@' || c == '?';
+}
+
+static bool parse_integer(const char *text, int64_t *value)
+{
+    bool negative = false;
+    if (*text == '-' || *text == '+')
+    {
+        negative = *text == '-';
+        text++;
+    }
+    if (!isdigit((unsigned char)*text))
+        return false;
+
+    char *end = NULL;
+    uint64_t magnitude;
+    if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+        magnitude = strtoull(text + 2, &end, 16);
+    else
+        magnitude = strtoull(text, &end, 10);
+    if (*end != '\0')
+        return false;
+    *value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+    return true;
+}
+
+static bool fits_int8(int64_t value)
+{
+    return value >= -128 && value <= 127;
+}
+
+static bool fits_int32(int64_t value)
+{
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+static OperandKind parse_register(const char *text, int *reg, int *size)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        if (strcmp(text, registers_64[i]) == 0)
+        {
+            *reg = i;
+            *size = 8;
+            return OPERAND_REGISTER;
+        }
+        if (strcmp(text, registers_32[i]) == 0)
+        {
+            *reg = i;
+            *size = 4;
+            return OPERAND_REGISTER;
+        }
+        if (strcmp(text, registers_8[i]) == 0)
+        {
+            *reg = i;
+            *size = 1;
+            return OPERAND_REGISTER;
+        }
+    }
+    if (strncmp(text, "xmm", 3) == 0 && isdigit((unsigned char)text[3]))
+    {
+        char *end = NULL;
+        long number = strtol(text + 3, &end, 10);
+        if (*end == '\0' && number < 16)
+        {
+            *reg = (int)number;
+            *size = 16;
+            return OPERAND_XMM;
+        }
+    }
+    return OPERAND_NONE;
+}
+
+/* NASM scopes labels that start with a dot to the last ordinary label. */
+static bool qualify_symbol(Assembler *as, const char *name, char *buffer)
+{
+    int length = name[0] == '.' ? snprintf(buffer, SYMBOL_LENGTH, "%s%s", as->scope, name)
+                                : snprintf(buffer, SYMBOL_LENGTH, "%s", name);
+    if (length < 0 || length >= SYMBOL_LENGTH)
+        return fail(as, "symbol name too long: %s", name);
+    return true;
+}
+
+static bool parse_symbol(Assembler *as, const char *text, char *buffer)
+{
+    if (!*text || isdigit((unsigned char)*text))
+        return fail(as, "invalid operand '%s'", text);
+    for (const char *c = text; *c; c++)
+    {
+        if (!is_symbol_char(*c))
+            return fail(as, "invalid operand '%s'", text);
+    }
+    return qualify_symbol(as, text, buffer);
+}
+
+static bool parse_memory(Assembler *as, char *text, Operand *op)
+{
+    op->kind = OPERAND_MEMORY;
+    text = trim(text);
+    if (starts_with_word(text, "rel"))
+    {
+        op->rip = true;
+        text = trim(text + 3);
+    }
+
+    int sign = 1;
+    char *p = text;
+    while (*p)
+    {
+        if (isspace((unsigned char)*p))
+        {
+            p++;
+            continue;
+        }
+        if (*p == '+' || *p == '-')
+        {
+            sign = *p == '-' ? -sign : sign;
+            p++;
+            continue;
+        }
+
+        char term[SYMBOL_LENGTH];
+        size_t length = 0;
+        while (*p && !isspace((unsigned char)*p) && *p != '+' && *p != '-')
+        {
+            if (length + 1 >= sizeof(term))
+                return fail(as, "memory operand too long");
+            term[length++] = *p++;
+        }
+        term[length] = '\0';
+
+        int reg;
+        int size;
+        int64_t number;
+        char *star = strchr(term, '*');
+        if (star)
+        {
+            *star = '\0';
+            const char *reg_text = term;
+            const char *scale_text = star + 1;
+            if (isdigit((unsigned char)*reg_text))
+            {
+                reg_text = star + 1;
+                scale_text = term;
+            }
+            if (sign < 0 || op->index >= 0 || parse_register(reg_text, &reg, &size) != OPERAND_REGISTER ||
+                size != 8 || !parse_integer(scale_text, &number) ||
+                (number != 1 && number != 2 && number != 4 && number != 8))
+                return fail(as, "invalid index in memory operand");
+            op->index = reg;
+            op->scale = (int)number;
+        }
+        else if (parse_register(term, &reg, &size) == OPERAND_REGISTER)
+        {
+            if (sign < 0 || size != 8)
+                return fail(as, "invalid register in memory operand");
+            if (op->base < 0)
+                op->base = reg;
+            else if (op->index < 0)
+            {
+                op->index = reg;
+                op->scale = 1;
+            }
+            else
+                return fail(as, "too many registers in memory operand");
+        }
+        else if (parse_integer(term, &number))
+        {
+            op->value += sign * number;
+        }
+        else
+        {
+            if (sign < 0 || op->symbol[0])
+                return fail(as, "invalid symbol reference in memory operand");
+            if (!parse_symbol(as, term, op->symbol))
+                return false;
+        }
+        sign = 1;
+    }
+
+    if (op->index == 4)
+        return fail(as, "rsp cannot be an index register");
+    if (op->symbol[0])
+    {
+        if (op->base >= 0 || op->index >= 0)
+            return fail(as, "symbol addresses must be rip-relative");
+        op->rip = true;
+    }
+    if (!fits_int32(op->value))
+        return fail(as, "displacement out of range");
+    return true;
+}
+
+static bool parse_operand(Assembler *as, char *text, Operand *op)
+{
+    memset(op, 0, sizeof(*op));
+    op->base = -1;
+    op->index = -1;
+    op->scale = 1;
+    text = trim(text);
+
+    static const struct {
+        const char *keyword;
+        int size;
+    } sizes[] = {{"byte", 1}, {"word", 2}, {"dword", 4}, {"qword", 8}, {"oword", 16}};
+    for (size_t i = 0; i < COUNT(sizes); i++)
+    {
+        if (starts_with_word(text, sizes[i].keyword))
+        {
+            op->size = sizes[i].size;
+            text = trim(text + strlen(sizes[i].keyword));
+            break;
+        }
+    }
+
+    size_t length = strlen(text);
+    if (length == 0)
+        return fail(as, "missing operand");
+    if (text[0] == '[')
+    {
+        if (text[length - 1] != ']')
+            return fail(as, "unterminated memory operand");
+        text[length - 1] = '\0';
+        return parse_memory(as, text + 1, op);
+    }
+
+    op->kind = parse_register(text, &op->reg, &op->size);
+    if (op->kind != OPERAND_NONE)
+        return true;
+    if (parse_integer(text, &op->value))
+    {
+        op->kind = OPERAND_IMMEDIATE;
+        return true;
+    }
+
+    char *wrt = strstr(text, " wrt ");
+    if (wrt)
+    {
+        if (strcmp(trim(wrt + 5), "..plt") != 0)
+            return fail(as, "unsupported wrt suffix");
+        *wrt = '\0';
+        op->plt = true;
+        text = trim(text);
+    }
+    op->kind = OPERAND_SYMBOL;
+    return parse_symbol(as, text, op->symbol);
+}
+
+static AsmBuffer *current_section(Assembler *as)
+{
+    if (as->section < 0)
+    {
+        fail(as, "code or data outside a section");
+        return NULL;
+    }
+    return &as->object->sections[as->section].contents;
+}
+
+static void put_byte(Assembler *as, int byte)
+{
+    AsmBuffer *buffer = current_section(as);
+    unsigned char value = (unsigned char)byte;
+    if (buffer)
+        asm_buffer_append(buffer, &value, 1);
+}
+
+static void put_le(Assembler *as, uint64_t value, int size)
+{
+    AsmBuffer *buffer = current_section(as);
+    unsigned char bytes[8];
+    for (int i = 0; i < size; i++)
+    {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    if (buffer)
+        asm_buffer_append(buffer, bytes, (size_t)size);
+}
+
+static AsmSymbol *find_symbol(const AsmObject *object, const char *name, size_t *index)
+{
+    size_t position = (size_t)(intptr_t)hashtable_get(object->symbol_index, name);
+    if (position == 0)
+        return NULL;
+    if (index)
+        *index = position - 1;
+    return (AsmSymbol *)array_get(&object->symbols, position - 1);
+}
+
+AsmSymbol *asm_object_symbol(const AsmObject *object, const char *name)
+{
+    return find_symbol(object, name, NULL);
+}
+
+static AsmSymbol *intern_symbol(Assembler *as, const char *name)
+{
+    AsmSymbol *symbol = find_symbol(as->object, name, NULL);
+    if (symbol)
+        return symbol;
+    symbol = safe_malloc(sizeof(AsmSymbol));
+    symbol->name = string_copy(name);
+    symbol->section = -1;
+    symbol->offset = 0;
+    symbol->global = false;
+    symbol->referenced = false;
+    array_push(&as->object->symbols, symbol);
+    hashtable_put(as->object->symbol_index, name, (void *)(intptr_t)as->object->symbols.size);
+    return symbol;
+}
+
+/* Leaves a zero field of the given width to be patched or relocated once
+   every label is known. */
+static void put_fixup(Assembler *as, const char *symbol, AsmRelocationKind kind, int64_t addend, int size)
+{
+    if (as->section < 0)
+    {
+        fail(as, "code or data outside a section");
+        return;
+    }
+    Fixup *fixup = safe_malloc(sizeof(Fixup));
+    fixup->section = (AsmSectionKind)as->section;
+    fixup->offset = as->object->sections[as->section].contents.size;
+    fixup->symbol = string_copy(symbol);
+    fixup->kind = kind;
+    fixup->addend = addend;
+    fixup->line = as->line;
+    array_push(&as->fixups, fixup);
+    put_le(as, 0, size);
+}
+
+static int scale_bits(int scale)
+{
+    return scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+}
+
+static void put_modrm(Assembler *as, int reg, const Operand *rm, int immediate_size)
+{
+    reg &= 7;
+    if (rm->kind == OPERAND_REGISTER || rm->kind == OPERAND_XMM)
+    {
+        put_byte(as, 0xC0 | reg << 3 | (rm->reg & 7));
+        return;
+    }
+
+    if (rm->rip)
+    {
+        put_byte(as, 0x05 | reg << 3);
+        if (rm->symbol[0])
+            put_fixup(as, rm->symbol, ASM_RELOCATION_PC32, rm->value - 4 - immediate_size, 4);
+        else
+            put_le(as, (uint64_t)rm->value, 4);
+        return;
+    }
+
+    if (rm->base < 0)
+    {
+        int index = rm->index >= 0 ? rm->index & 7 : 4;
+        put_byte(as, 0x04 | reg << 3);
+        put_byte(as, scale_bits(rm->scale) << 6 | index << 3 | 5);
+        put_le(as, (uint64_t)rm->value, 4);
+        return;
+    }
+
+    int mod = rm->value == 0 && (rm->base & 7) != 5 ? 0 : fits_int8(rm->value) ? 1 : 2;
+    if (rm->index >= 0 || (rm->base & 7) == 4)
+    {
+        int index = rm->index >= 0 ? rm->index & 7 : 4;
+        put_byte(as, mod << 6 | reg << 3 | 4);
+        put_byte(as, scale_bits(rm->scale) << 6 | index << 3 | (rm->base & 7));
+    }
+    else
+    {
+        put_byte(as, mod << 6 | reg << 3 | (rm->base & 7));
+    }
+    if (mod == 1)
+        put_le(as, (uint64_t)rm->value, 1);
+    else if (mod == 2)
+        put_le(as, (uint64_t)rm->value, 4);
+}
+
+static bool is_byte_register(const Operand *op)
+{
+    return op && op->kind == OPERAND_REGISTER && op->size == 1 && op->reg >= 4 && op->reg < 8;
+}
+
+static void encode(Assembler *as, const Encoding *e)
+{
+    int rex = e->wide ? 0x48 : 0;
+    if (e->reg >= 8)
+        rex |= 0x44;
+    if (e->rm->kind == OPERAND_MEMORY)
+    {
+        if (e->rm->base >= 8)
+            rex |= 0x41;
+        if (e->rm->index >= 8)
+            rex |= 0x42;
+    }
+    else if (e->rm->reg >= 8)
+    {
+        rex |= 0x41;
+    }
+    if (e->byte_registers || is_byte_register(e->rm))
+        rex |= 0x40;
+
+    if (e->prefix)
+        put_byte(as, e->prefix);
+    if (rex)
+        put_byte(as, rex);
+    for (int i = 0; i < e->opcode_size; i++)
+    {
+        put_byte(as, e->opcode[i]);
+    }
+    put_modrm(as, e->reg, e->rm, e->immediate_size);
+    if (e->immediate_size)
+        put_le(as, (uint64_t)e->immediate, e->immediate_size);
+}
+
+static Encoding encoding(int opcode, int reg, const Operand *rm)
+{
+    Encoding e;
+    memset(&e, 0, sizeof(e));
+    if (opcode > 0xFF)
+    {
+        e.opcode[0] = 0x0F;
+        e.opcode[1] = (unsigned char)opcode;
+        e.opcode_size = 2;
+    }
+    else
+    {
+        e.opcode[0] = (unsigned char)opcode;
+        e.opcode_size = 1;
+    }
+    e.reg = reg;
+    e.rm = rm;
+    return e;
+}
+
+/* Two-byte opcodes are written as 0x0Fxx. */
+static void encode_sized(Assembler *as, int opcode, int reg, const Operand *rm, int size)
+{
+    Encoding e = encoding(opcode, reg, rm);
+    e.wide = size == 8;
+    encode(as, &e);
+}
+
+static void encode_immediate(Assembler *as, int opcode, int reg, const Operand *rm, int size, int immediate_size,
+                             int64_t immediate)
+{
+    Encoding e = encoding(opcode, reg, rm);
+    e.wide = size == 8;
+    e.immediate_size = immediate_size;
+    e.immediate = immediate;
+    encode(as, &e);
+}
+
+static int operand_size(const Operand *a, const Operand *b)
+{
+    if (a->kind == OPERAND_REGISTER)
+        return a->size;
+    if (b && b->kind == OPERAND_REGISTER)
+        return b->size;
+    return a->size ? a->size : 8;
+}
+
+static bool is_general(const Operand *op)
+{
+    return op->kind == OPERAND_REGISTER || op->kind == OPERAND_MEMORY;
+}
+
+static int condition_code(const char *suffix)
+{
+    for (size_t i = 0; i < COUNT(condition_codes); i++)
+    {
+        if (strcmp(suffix, condition_codes[i].name) == 0)
+            return condition_codes[i].code;
+    }
+    return -1;
+}
+
+static bool check_count(Assembler *as, const char *mnemonic, int count, int expected)
+{
+    if (count != expected)
+        return fail(as, "%s expects %d operand%s", mnemonic, expected, expected == 1 ? "" : "s");
+    return true;
+}
+
+static bool check_immediate(Assembler *as, const Operand *op)
+{
+    if (!fits_int32(op->value))
+        return fail(as, "immediate out of range");
+    return true;
+}
+
+static bool assemble_branch(Assembler *as, const char *mnemonic, const Operand *target, int opcode, int extension)
+{
+    if (target->kind == OPERAND_SYMBOL)
+    {
+        if (opcode > 0xFF)
+            put_byte(as, 0x0F);
+        put_byte(as, opcode & 0xFF);
+        put_fixup(as, target->symbol, ASM_RELOCATION_PLT32, -4, 4);
+        return true;
+    }
+    if (extension < 0 || !is_general(target) || (target->kind == OPERAND_REGISTER && target->size != 8))
+        return fail(as, "invalid %s target", mnemonic);
+    encode_sized(as, 0xFF, extension, target, 4);
+    return true;
+}
+
+static bool assemble_arithmetic(Assembler *as, int extension, Operand *ops)
+{
+    int size = operand_size(&ops[0], &ops[1]);
+    int byte = size == 1 ? 0 : 1;
+    if (ops[1].kind == OPERAND_IMMEDIATE)
+    {
+        if (!is_general(&ops[0]) || !check_immediate(as, &ops[1]))
+            return fail(as, "invalid arithmetic operands");
+        if (size == 1)
+            encode_immediate(as, 0x80, extension, &ops[0], size, 1, ops[1].value);
+        else if (fits_int8(ops[1].value))
+            encode_immediate(as, 0x83, extension, &ops[0], size, 1, ops[1].value);
+        else
+            encode_immediate(as, 0x81, extension, &ops[0], size, 4, ops[1].value);
+        return true;
+    }
+    if (ops[1].kind == OPERAND_REGISTER && is_general(&ops[0]))
+    {
+        Encoding e = encoding(extension * 8 + byte, ops[1].reg, &ops[0]);
+        e.wide = size == 8;
+        e.byte_registers = is_byte_register(&ops[1]);
+        encode(as, &e);
+        return true;
+    }
+    if (ops[0].kind == OPERAND_REGISTER && ops[1].kind == OPERAND_MEMORY)
+    {
+        Encoding e = encoding(extension * 8 + 2 + byte, ops[0].reg, &ops[1]);
+        e.wide = size == 8;
+        e.byte_registers = is_byte_register(&ops[0]);
+        encode(as, &e);
+        return true;
+    }
+    return fail(as, "invalid arithmetic operands");
+}
+
+static bool assemble_mov(Assembler *as, Operand *ops)
+{
+    int size = operand_size(&ops[0], &ops[1]);
+    if (ops[1].kind == OPERAND_IMMEDIATE)
+    {
+        if (ops[0].kind == OPERAND_REGISTER && size == 8 && !fits_int32(ops[1].value))
+        {
+            put_byte(as, 0x48 | (ops[0].reg >= 8 ? 1 : 0));
+            put_byte(as, 0xB8 + (ops[0].reg & 7));
+            put_le(as, (uint64_t)ops[1].value, 8);
+            return true;
+        }
+        /* Writing the low half zeroes the upper one, so small values
+           need no REX.W or sign-extended immediate. */
+        if (ops[0].kind == OPERAND_REGISTER && (size == 4 || (ops[1].value >= 0 && ops[1].value <= UINT32_MAX)))
+        {
+            if (ops[0].reg >= 8)
+                put_byte(as, 0x41);
+            put_byte(as, 0xB8 + (ops[0].reg & 7));
+            put_le(as, (uint64_t)ops[1].value, 4);
+            return true;
+        }
+        if (!is_general(&ops[0]))
+            return fail(as, "invalid mov operands");
+        if (!check_immediate(as, &ops[1]))
+            return false;
+        if (size == 1)
+            encode_immediate(as, 0xC6, 0, &ops[0], size, 1, ops[1].value);
+        else
+            encode_immediate(as, 0xC7, 0, &ops[0], size, 4, ops[1].value);
+        return true;
+    }
+    int byte = size == 1 ? 0 : 1;
+    if (ops[1].kind == OPERAND_REGISTER && is_general(&ops[0]))
+    {
+        Encoding e = encoding(0x88 + byte, ops[1].reg, &ops[0]);
+        e.wide = size == 8;
+        e.byte_registers = is_byte_register(&ops[1]);
+        encode(as, &e);
+        return true;
+    }
+    if (ops[0].kind == OPERAND_REGISTER && ops[1].kind == OPERAND_MEMORY)
+    {
+        Encoding e = encoding(0x8A + byte, ops[0].reg, &ops[1]);
+        e.wide = size == 8;
+        e.byte_registers = is_byte_register(&ops[0]);
+        encode(as, &e);
+        return true;
+    }
+    return fail(as, "invalid mov operands");
+}
+
+static bool assemble_shift(Assembler *as, int extension, Operand *ops)
+{
+    int size = operand_size(&ops[0], NULL);
+    if (!is_general(&ops[0]) || size == 1)
+        return fail(as, "invalid shift operand");
+    if (ops[1].kind == OPERAND_REGISTER && ops[1].reg == 1 && ops[1].size == 1)
+        encode_sized(as, 0xD3, extension, &ops[0], size);
+    else if (ops[1].kind == OPERAND_IMMEDIATE && ops[1].value == 1)
+        encode_sized(as, 0xD1, extension, &ops[0], size);
+    else if (ops[1].kind == OPERAND_IMMEDIATE && ops[1].value >= 0 && ops[1].value < 64)
+        encode_immediate(as, 0xC1, extension, &ops[0], size, 1, ops[1].value);
+    else
+        return fail(as, "invalid shift count");
+    return true;
+}
+
+static void encode_sse(Assembler *as, int prefix, bool wide, int opcode, int reg, const Operand *rm)
+{
+    Encoding e = encoding(0x0F00 | opcode, reg, rm);
+    e.prefix = prefix;
+    e.wide = wide;
+    encode(as, &e);
+}
+
+static bool assemble_sse_move(Assembler *as, const char *mnemonic, Operand *ops)
+{
+    bool load = ops[0].kind == OPERAND_XMM;
+    Operand *xmm = load ? &ops[0] : &ops[1];
+    Operand *other = load ? &ops[1] : &ops[0];
+    if (xmm->kind != OPERAND_XMM)
+        return fail(as, "%s needs an xmm operand", mnemonic);
+
+    if (strcmp(mnemonic, "movq") == 0)
+    {
+        if (other->kind == OPERAND_REGISTER && other->size == 8)
+            encode_sse(as, 0x66, true, load ? 0x6E : 0x7E, xmm->reg, other);
+        else if (load && (other->kind == OPERAND_XMM || other->kind == OPERAND_MEMORY))
+            encode_sse(as, 0xF3, false, 0x7E, xmm->reg, other);
+        else if (other->kind == OPERAND_MEMORY)
+            encode_sse(as, 0x66, false, 0xD6, xmm->reg, other);
+        else
+            return fail(as, "invalid movq operands");
+        return true;
+    }
+    if (other->kind != OPERAND_XMM && other->kind != OPERAND_MEMORY)
+        return fail(as, "invalid %s operands", mnemonic);
+    if (strcmp(mnemonic, "movdqu") == 0)
+        encode_sse(as, 0xF3, false, load ? 0x6F : 0x7F, xmm->reg, other);
+    else
+        encode_sse(as, strcmp(mnemonic, "movsd") == 0 ? 0xF2 : 0xF3, false, load ? 0x10 : 0x11, xmm->reg, other);
+    return true;
+}
+
+static bool assemble_sse(Assembler *as, const char *mnemonic, Operand *ops, int count, bool *handled)
+{
+    *handled = true;
+    if (strcmp(mnemonic, "movq") == 0 || strcmp(mnemonic, "movsd") == 0 || strcmp(mnemonic, "movss") == 0 ||
+        strcmp(mnemonic, "movdqu") == 0)
+        return check_count(as, mnemonic, count, 2) && assemble_sse_move(as, mnemonic, ops);
+
+    if (strcmp(mnemonic, "pshufd") == 0)
+    {
+        if (!check_count(as, mnemonic, count, 3) || ops[0].kind != OPERAND_XMM ||
+            ops[2].kind != OPERAND_IMMEDIATE)
+            return fail(as, "invalid pshufd operands");
+        Encoding e = encoding(0x0F70, ops[0].reg, &ops[1]);
+        e.prefix = 0x66;
+        e.immediate_size = 1;
+        e.immediate = ops[2].value;
+        encode(as, &e);
+        return true;
+    }
+
+    for (size_t i = 0; i < COUNT(sse_shifts); i++)
+    {
+        if (strcmp(mnemonic, sse_shifts[i].name) != 0)
+            continue;
+        if (!check_count(as, mnemonic, count, 2) || ops[0].kind != OPERAND_XMM)
+            return fail(as, "invalid %s operands", mnemonic);
+        if (ops[1].kind == OPERAND_IMMEDIATE)
+        {
+            Encoding e = encoding(0x0F73, sse_shifts[i].extension, &ops[0]);
+            e.prefix = 0x66;
+            e.immediate_size = 1;
+            e.immediate = ops[1].value;
+            encode(as, &e);
+        }
+        else
+        {
+            encode_sse(as, 0x66, false, sse_shifts[i].opcode, ops[0].reg, &ops[1]);
+        }
+        return true;
+    }
+
+    for (size_t i = 0; i < COUNT(sse_opcodes); i++)
+    {
+        const SseOpcode *sse = &sse_opcodes[i];
+        if (strcmp(mnemonic, sse->name) != 0)
+            continue;
+        if (!check_count(as, mnemonic, count, 2))
+            return false;
+        switch (sse->form)
+        {
+        case SSE_XMM_XMM:
+            if (ops[0].kind != OPERAND_XMM || (ops[1].kind != OPERAND_XMM && ops[1].kind != OPERAND_MEMORY))
+                return fail(as, "invalid %s operands", mnemonic);
+            encode_sse(as, sse->prefix, false, sse->opcode, ops[0].reg, &ops[1]);
+            return true;
+        case SSE_XMM_GENERAL:
+            if (ops[0].kind != OPERAND_XMM || !is_general(&ops[1]))
+                return fail(as, "invalid %s operands", mnemonic);
+            encode_sse(as, sse->prefix, operand_size(&ops[1], NULL) == 8, sse->opcode, ops[0].reg, &ops[1]);
+            return true;
+        case SSE_GENERAL_XMM:
+            if (ops[0].kind != OPERAND_REGISTER || (ops[1].kind != OPERAND_XMM && ops[1].kind != OPERAND_MEMORY))
+                return fail(as, "invalid %s operands", mnemonic);
+            encode_sse(as, sse->prefix, ops[0].size == 8, sse->opcode, ops[0].reg, &ops[1]);
+            return true;
+        }
+    }
+    *handled = false;
+    return false;
+}
+
+static bool assemble_instruction(Assembler *as, const char *mnemonic, Operand *ops, int count)
+{
+    if (count == 0)
+    {
+        if (strcmp(mnemonic, "ret") == 0)
+            put_byte(as, 0xC3);
+        else if (strcmp(mnemonic, "nop") == 0)
+            put_byte(as, 0x90);
+        else if (strcmp(mnemonic, "cqo") == 0)
+        {
+            put_byte(as, 0x48);
+            put_byte(as, 0x99);
+        }
+        else if (strcmp(mnemonic, "cdq") == 0)
+            put_byte(as, 0x99);
+        else if (strcmp(mnemonic, "leave") == 0)
+            put_byte(as, 0xC9);
+        else
+            return fail(as, "unknown instruction '%s'", mnemonic);
+        return true;
+    }
+
+    if (strcmp(mnemonic, "push") == 0 || strcmp(mnemonic, "pop") == 0)
+    {
+        if (!check_count(as, mnemonic, count, 1) || ops[0].kind != OPERAND_REGISTER || ops[0].size != 8)
+            return fail(as, "%s expects a 64-bit register", mnemonic);
+        if (ops[0].reg >= 8)
+            put_byte(as, 0x41);
+        put_byte(as, (mnemonic[1] == 'u' ? 0x50 : 0x58) + (ops[0].reg & 7));
+        return true;
+    }
+    if (strcmp(mnemonic, "call") == 0)
+        return check_count(as, mnemonic, count, 1) && assemble_branch(as, mnemonic, &ops[0], 0xE8, 2);
+    if (strcmp(mnemonic, "jmp") == 0)
+        return check_count(as, mnemonic, count, 1) && assemble_branch(as, mnemonic, &ops[0], 0xE9, 4);
+    if (mnemonic[0] == 'j' && condition_code(mnemonic + 1) >= 0)
+    {
+        if (!check_count(as, mnemonic, count, 1) || ops[0].kind != OPERAND_SYMBOL)
+            return fail(as, "%s expects a label", mnemonic);
+        return assemble_branch(as, mnemonic, &ops[0], 0x0F80 + condition_code(mnemonic + 1), -1);
+    }
+    if (strncmp(mnemonic, "set", 3) == 0 && condition_code(mnemonic + 3) >= 0)
+    {
+        if (!check_count(as, mnemonic, count, 1) || !is_general(&ops[0]) || operand_size(&ops[0], NULL) != 1)
+            return fail(as, "%s expects a byte operand", mnemonic);
+        encode_sized(as, 0x0F90 + condition_code(mnemonic + 3), 0, &ops[0], 1);
+        return true;
+    }
+
+    for (size_t i = 0; i < COUNT(arithmetic_names); i++)
+    {
+        if (strcmp(mnemonic, arithmetic_names[i]) == 0)
+            return check_count(as, mnemonic, count, 2) && assemble_arithmetic(as, (int)i, ops);
+    }
+
+    if (strcmp(mnemonic, "mov") == 0)
+        return check_count(as, mnemonic, count, 2) && assemble_mov(as, ops);
+    if (strcmp(mnemonic, "movzx") == 0)
+    {
+        if (!check_count(as, mnemonic, count, 2) || ops[0].kind != OPERAND_REGISTER || !is_general(&ops[1]) ||
+            operand_size(&ops[1], NULL) != 1)
+            return fail(as, "invalid movzx operands");
+        Encoding e = encoding(0x0FB6, ops[0].reg, &ops[1]);
+        e.wide = ops[0].size == 8;
+        encode(as, &e);
+        return true;
+    }
+    if (strcmp(mnemonic, "lea") == 0)
+    {
+        if (!check_count(as, mnemonic, count, 2) || ops[0].kind != OPERAND_REGISTER || ops[1].kind != OPERAND_MEMORY)
+            return fail(as, "invalid lea operands");
+        encode_sized(as, 0x8D, ops[0].reg, &ops[1], ops[0].size);
+        return true;
+    }
+    if (strcmp(mnemonic, "test") == 0)
+    {
+        if (!check_count(as, mnemonic, count, 2) || !is_general(&ops[0]))
+            return fail(as, "invalid test operands");
+        int size = operand_size(&ops[0], &ops[1]);
+        if (ops[1].kind == OPERAND_IMMEDIATE)
+        {
+            if (!check_immediate(as, &ops[1]))
+                return false;
+            encode_immediate(as, size == 1 ? 0xF6 : 0xF7, 0, &ops[0], size, size == 1 ? 1 : 4, ops[1].value);
+            return true;
+        }
+        if (ops[1].kind != OPERAND_REGISTER)
+            return fail(as, "invalid test operands");
+        Encoding e = encoding(size == 1 ? 0x84 : 0x85, ops[1].reg, &ops[0]);
+        e.wide = size == 8;
+        e.byte_registers = is_byte_register(&ops[1]);
+        encode(as, &e);
+        return true;
+    }
+    if (strcmp(mnemonic, "imul") == 0 && count >= 2)
+    {
+        if (ops[0].kind != OPERAND_REGISTER || !is_general(&ops[1]))
+            return fail(as, "invalid imul operands");
+        if (count == 2)
+        {
+            encode_sized(as, 0x0FAF, ops[0].reg, &ops[1], ops[0].size);
+            return true;
+        }
+        if (ops[2].kind != OPERAND_IMMEDIATE || !check_immediate(as, &ops[2]))
+            return fail(as, "invalid imul operands");
+        if (fits_int8(ops[2].value))
+            encode_immediate(as, 0x6B, ops[0].reg, &ops[1], ops[0].size, 1, ops[2].value);
+        else
+            encode_immediate(as, 0x69, ops[0].reg, &ops[1], ops[0].size, 4, ops[2].value);
+        return true;
+    }
+
+    static const struct {
+        const char *name;
+        int opcode;
+        int extension;
+    } unary[] = {{"not", 0xF7, 2}, {"neg", 0xF7, 3}, {"mul", 0xF7, 4}, {"imul", 0xF7, 5},
+                 {"div", 0xF7, 6}, {"idiv", 0xF7, 7}, {"inc", 0xFF, 0}, {"dec", 0xFF, 1}};
+    for (size_t i = 0; i < COUNT(unary); i++)
+    {
+        if (strcmp(mnemonic, unary[i].name) != 0)
+            continue;
+        if (!check_count(as, mnemonic, count, 1) || !is_general(&ops[0]))
+            return fail(as, "invalid %s operand", mnemonic);
+        int size = operand_size(&ops[0], NULL);
+        encode_sized(as, size == 1 ? unary[i].opcode - 1 : unary[i].opcode, unary[i].extension, &ops[0], size);
+        return true;
+    }
+
+    static const struct {
+        const char *name;
+        int extension;
+    } shifts[] = {{"shl", 4}, {"sal", 4}, {"shr", 5}, {"sar", 7}};
+    for (size_t i = 0; i < COUNT(shifts); i++)
+    {
+        if (strcmp(mnemonic, shifts[i].name) == 0)
+            return check_count(as, mnemonic, count, 2) && assemble_shift(as, shifts[i].extension, ops);
+    }
+
+    static const struct {
+        const char *name;
+        int extension;
+    } bit_tests[] = {{"bt", 4}, {"bts", 5}, {"btr", 6}, {"btc", 7}};
+    for (size_t i = 0; i < COUNT(bit_tests); i++)
+    {
+        if (strcmp(mnemonic, bit_tests[i].name) != 0)
+            continue;
+        if (!check_count(as, mnemonic, count, 2) || !is_general(&ops[0]) || ops[1].kind != OPERAND_IMMEDIATE)
+            return fail(as, "invalid %s operands", mnemonic);
+        encode_immediate(as, 0x0FBA, bit_tests[i].extension, &ops[0], operand_size(&ops[0], NULL), 1,
+                         ops[1].value);
+        return true;
+    }
+
+    bool handled;
+    bool result = assemble_sse(as, mnemonic, ops, count, &handled);
+    if (handled)
+        return result;
+    return fail(as, "unknown instruction '%s'", mnemonic);
+}
+
+/* Splits at commas that are not inside a string or a memory operand. */
+static int split_operands(char *text, char **parts, int max_parts)
+{
+    int count = 0;
+    bool quoted = false;
+    int depth = 0;
+    char *start = text;
+    for (char *c = text;; c++)
+    {
+        if (*c == '"')
+            quoted = !quoted;
+        else if (!quoted && *c == '[')
+            depth++;
+        else if (!quoted && *c == ']')
+            depth--;
+        if (*c == '\0' || (*c == ',' && !quoted && depth == 0))
+        {
+            bool end = *c == '\0';
+            *c = '\0';
+            if (count == max_parts)
+                return -1;
+            parts[count++] = trim(start);
+            if (end)
+                break;
+            start = c + 1;
+        }
+    }
+    return count;
+}
+
+static bool assemble_data(Assembler *as, const char *directive, char *text)
+{
+    int size = directive[1] == 'b' ? 1 : directive[1] == 'w' ? 2 : directive[1] == 'd' ? 4 : 8;
+    char *items[256];
+    int count = split_operands(text, items, (int)COUNT(items));
+    if (count < 0)
+        return fail(as, "too many items in %s", directive);
+
+    for (int i = 0; i < count; i++)
+    {
+        const char *item = items[i];
+        size_t length = strlen(item);
+        int64_t value;
+        if (item[0] == '"' && length >= 2 && item[length - 1] == '"')
+        {
+            if (size != 1)
+                return fail(as, "strings are only supported in db");
+            for (size_t j = 1; j + 1 < length; j++)
+            {
+                put_byte(as, (unsigned char)item[j]);
+            }
+        }
+        else if (parse_integer(item, &value))
+        {
+            put_le(as, (uint64_t)value, size);
+        }
+        else
+        {
+            char symbol[SYMBOL_LENGTH];
+            if (size != 8 || !parse_symbol(as, item, symbol))
+                return fail(as, "invalid %s item '%s'", directive, item);
+            put_fixup(as, symbol, ASM_RELOCATION_ABS64, 0, 8);
+        }
+    }
+    return !as->failed;
+}
+
+static bool assemble_align(Assembler *as, const char *text)
+{
+    int64_t alignment;
+    if (!parse_integer(text, &alignment) || alignment <= 0 || (alignment & (alignment - 1)) != 0)
+        return fail(as, "invalid alignment");
+    AsmBuffer *buffer = current_section(as);
+    if (!buffer)
+        return false;
+    AsmSection *section = &as->object->sections[as->section];
+    if ((size_t)alignment > section->alignment)
+        section->alignment = (size_t)alignment;
+    while (buffer->size % (size_t)alignment != 0)
+    {
+        put_byte(as, as->section == ASM_SECTION_TEXT ? 0x90 : 0);
+    }
+    return true;
+}
+
+static bool assemble_section(Assembler *as, const char *text)
+{
+    char name[64];
+    size_t length = 0;
+    while (text[length] && !isspace((unsigned char)text[length]) && length + 1 < sizeof(name))
+    {
+        name[length] = text[length];
+        length++;
+    }
+    name[length] = '\0';
+
+    /* The object writer always marks the stack non-executable. */
+    if (strcmp(name, ".note.GNU-stack") == 0)
+    {
+        as->section = -1;
+        return true;
+    }
+    if (strcmp(name, ".rdata") == 0)
+        strcpy(name, ".rodata");
+    for (int i = 0; i < ASM_SECTION_COUNT; i++)
+    {
+        if (strcmp(name, section_names[i]) == 0)
+        {
+            as->section = i;
+            return true;
+        }
+    }
+    return fail(as, "unsupported section '%s'", name);
+}
+
+static bool define_label(Assembler *as, const char *label)
+{
+    char name[SYMBOL_LENGTH];
+    if (!parse_symbol(as, label, name))
+        return false;
+    if (as->section < 0)
+        return fail(as, "label '%s' outside a section", name);
+    AsmSymbol *symbol = intern_symbol(as, name);
+    if (symbol->section >= 0)
+        return fail(as, "symbol '%s' redefined", name);
+    symbol->section = as->section;
+    symbol->offset = as->object->sections[as->section].contents.size;
+    if (label[0] != '.')
+        snprintf(as->scope, sizeof(as->scope), "%s", name);
+    return true;
+}
+
+static bool declare_symbol(Assembler *as, const char *text)
+{
+    char name[SYMBOL_LENGTH];
+    if (!parse_symbol(as, text, name))
+        return false;
+    intern_symbol(as, name)->global = true;
+    return true;
+}
+
+static bool assemble_statement(Assembler *as, char *text)
+{
+    char *mnemonic = text;
+    char *rest = text;
+    while (*rest && !isspace((unsigned char)*rest))
+        rest++;
+    if (*rest)
+        *rest++ = '\0';
+    rest = trim(rest);
+
+    if (strcmp(mnemonic, "default") == 0)
+        return strcmp(rest, "rel") == 0 ? true : fail(as, "only 'default rel' is supported");
+    if (strcmp(mnemonic, "extern") == 0 || strcmp(mnemonic, "global") == 0)
+        return declare_symbol(as, rest);
+    if (strcmp(mnemonic, "section") == 0)
+        return assemble_section(as, rest);
+    if (strcmp(mnemonic, "align") == 0)
+        return assemble_align(as, rest);
+    if (strcmp(mnemonic, "db") == 0 || strcmp(mnemonic, "dw") == 0 || strcmp(mnemonic, "dd") == 0 ||
+        strcmp(mnemonic, "dq") == 0)
+        return assemble_data(as, mnemonic, rest);
+    if (strcmp(mnemonic, "resb") == 0 || strcmp(mnemonic, "resq") == 0)
+    {
+        int64_t count;
+        if (!parse_integer(rest, &count) || count < 0)
+            return fail(as, "invalid reservation size");
+        for (int64_t i = 0; i < count * (mnemonic[3] == 'q' ? 8 : 1); i++)
+        {
+            put_byte(as, 0);
+        }
+        return true;
+    }
+    if (strcmp(mnemonic, "times") == 0)
+    {
+        char *repeated = rest;
+        while (*repeated && !isspace((unsigned char)*repeated))
+            repeated++;
+        if (*repeated)
+            *repeated++ = '\0';
+        int64_t count;
+        if (!parse_integer(rest, &count) || count < 0)
+            return fail(as, "invalid repeat count");
+        size_t length = strlen(repeated);
+        char *copy = safe_malloc(length + 1);
+        for (int64_t i = 0; i < count && !as->failed; i++)
+        {
+            memcpy(copy, repeated, length + 1);
+            assemble_statement(as, trim(copy));
+        }
+        safe_free(copy);
+        return !as->failed;
+    }
+
+    Operand ops[MAX_OPERANDS];
+    char *parts[MAX_OPERANDS];
+    int count = *rest ? split_operands(rest, parts, MAX_OPERANDS) : 0;
+    if (count < 0)
+        return fail(as, "too many operands");
+    for (int i = 0; i < count; i++)
+    {
+        if (!parse_operand(as, parts[i], &ops[i]))
+            return false;
+    }
+    as->object->instructions++;
+    return assemble_instruction(as, mnemonic, ops, count);
+}
+
+static bool assemble_line(Assembler *as, char *line)
+{
+    bool quoted = false;
+    for (char *c = line; *c; c++)
+    {
+        if (*c == '"')
+            quoted = !quoted;
+        else if (*c == ';' && !quoted)
+        {
+            *c = '\0';
+            break;
+        }
+    }
+    char *text = trim(line);
+    if (!*text)
+        return true;
+
+    char *colon = text;
+    while (*colon && is_symbol_char(*colon))
+        colon++;
+    if (*colon == ':' && colon != text)
+    {
+        *colon = '\0';
+        if (!define_label(as, text))
+            return false;
+        text = trim(colon + 1);
+        if (!*text)
+            return true;
+    }
+    return assemble_statement(as, text);
+}
+
+/* Jumps and calls within a section are patched in place; everything else
+   becomes a relocation for the object writer or loader. */
+static bool resolve_fixups(Assembler *as)
+{
+    AsmObject *object = as->object;
+    for (size_t i = 0; i < as->fixups.size && !as->failed; i++)
+    {
+        Fixup *fixup = (Fixup *)array_get(&as->fixups, i);
+        as->line = fixup->line;
+        size_t index;
+        AsmSymbol *symbol = find_symbol(object, fixup->symbol, &index);
+        if (!symbol || (symbol->section < 0 && !symbol->global))
+            return fail(as, "undefined symbol '%s'", fixup->symbol);
+
+        if (symbol->section == (int)fixup->section && fixup->kind != ASM_RELOCATION_ABS64)
+        {
+            int64_t displacement = (int64_t)symbol->offset + fixup->addend - (int64_t)fixup->offset;
+            unsigned char *field = object->sections[fixup->section].contents.data + fixup->offset;
+            for (int j = 0; j < 4; j++)
+            {
+                field[j] = (unsigned char)((uint64_t)displacement >> (8 * j));
+            }
+            continue;
+        }
+
+        AsmRelocation *relocation = safe_malloc(sizeof(AsmRelocation));
+        relocation->section = fixup->section;
+        relocation->offset = fixup->offset;
+        relocation->symbol = index;
+        relocation->kind = fixup->kind;
+        relocation->addend = fixup->addend;
+        array_push(&object->relocations, relocation);
+        symbol->referenced = true;
+    }
+    return !as->failed;
+}
+
+static AsmObject *asm_object_create(size_t source_length)
+{
+    AsmObject *object = safe_malloc(sizeof(AsmObject));
+    memset(object, 0, sizeof(*object));
+    for (int i = 0; i < ASM_SECTION_COUNT; i++)
+    {
+        object->sections[i].name = section_names[i];
+        object->sections[i].alignment = i == ASM_SECTION_TEXT ? 16 : i == ASM_SECTION_RODATA ? 1 : 8;
+    }
+    array_init(&object->symbols, 64);
+    array_init(&object->relocations, 64);
+    /* The table never grows, so size it from the amount of source. */
+    object->symbol_index = hashtable_create(source_length / 256 + 64);
+    return object;
+}
+
+void asm_object_destroy(AsmObject *object)
+{
+    if (!object)
+        return;
+    for (int i = 0; i < ASM_SECTION_COUNT; i++)
+    {
+        asm_buffer_free(&object->sections[i].contents);
+    }
+    for (size_t i = 0; i < object->symbols.size; i++)
+    {
+        AsmSymbol *symbol = (AsmSymbol *)array_get(&object->symbols, i);
+        safe_free(symbol->name);
+        safe_free(symbol);
+    }
+    for (size_t i = 0; i < object->relocations.size; i++)
+    {
+        safe_free(array_get(&object->relocations, i));
+    }
+    array_free(&object->symbols);
+    array_free(&object->relocations);
+    hashtable_destroy(object->symbol_index);
+    safe_free(object);
+}
+
+AsmObject *asm_assemble(const char *source, char *message, size_t message_size)
+{
+    Assembler as;
+    memset(&as, 0, sizeof(as));
+    as.object = asm_object_create(strlen(source));
+    as.section = ASM_SECTION_TEXT;
+    as.message = message;
+    as.message_size = message_size;
+    array_init(&as.fixups, 256);
+
+    char *line = NULL;
+    size_t line_capacity = 0;
+    for (const char *start = source; *start && !as.failed;)
+    {
+        const char *end = strchr(start, '\n');
+        size_t length = end ? (size_t)(end - start) : strlen(start);
+        if (length + 1 > line_capacity)
+        {
+            line_capacity = (length + 1) * 2;
+            line = safe_realloc(line, line_capacity);
+        }
+        memcpy(line, start, length);
+        line[length] = '\0';
+        as.line++;
+        assemble_line(&as, line);
+        start = end ? end + 1 : start + length;
+    }
+    safe_free(line);
+
+    if (!as.failed)
+        resolve_fixups(&as);
+    for (size_t i = 0; i < as.fixups.size; i++)
+    {
+        Fixup *fixup = (Fixup *)array_get(&as.fixups, i);
+        safe_free(fixup->symbol);
+        safe_free(fixup);
+    }
+    array_free(&as.fixups);
+
+    if (as.failed)
+    {
+        asm_object_destroy(as.object);
+        return NULL;
+    }
+    if (debug_enabled)
+    {
+        printf("[DEBUG] Assembler: %zu instructions, %zu bytes of code, %zu relocations\n",
+               as.object->instructions, as.object->sections[ASM_SECTION_TEXT].contents.size,
+               as.object->relocations.size);
+    }
+    return as.object;
+}
@@ -1,60 +1,171 @@
 #include "backend/codegen/codegen.h"
+#include "backend/assembly/assembler.h"
+#include "backend/assembly/elfWriter.h"
+#include "backend/assembly/jit.h"
+#include "backend/assembly/peephole.h"
+#include "backend/assembly/regalloc.h"
+#include "backend/assembly/target.h"
+#include "backend/codegen/codegenStrategy.h"
 #include "backend/ir/irOps.h"
+#include "common/flags.h"
+#include "optimizations/optimizer.h"
 #include <stdarg.h>
 extern bool debug_enabled;
 
 void codegenasm_write_text_section(CodeGenerator *generator);
 void codegenasm_write_data_section(CodeGenerator *generator);
 
-static bool is_param_register(const char *name)
+static const AsmTarget *target_of(CodeGenerator *generator)
 {
-    return strcmp(name, "rcx") == 0 || strcmp(name, "rdx") == 0 || strcmp(name, "r8") == 0 || strcmp(name, "r9") == 0;
+    return generator->strategy->target;
 }
 
-void codegenasm_call_import(CodeGenerator *generator, const char *func_name, IROperand *value)
+static bool is_sysv(CodeGenerator *generator)
 {
-    fprintf(generator->output_file, "    lea rcx, [rel format_int]\n");
-    fprintf(generator->output_file, "    mov rdx, qword [rel %s]\n",
-            codegenasm_get_operand_name(generator, value));
-    fprintf(generator->output_file, "    mov rax, qword [rel __imp_%s]\n", func_name);
-    fprintf(generator->output_file, "    call rax\n");
+    return target_of(generator)->abi == ASM_ABI_SYSV;
 }
 
-typedef struct
+/* Instructions are collected as records, which the peephole pass works
+   on inside functions, and only become text when the code is written. */
+static void begin_code(CodeGenerator *generator)
 {
-    IROperand *operand;
-    const char *register_name;
-    bool is_live;
-} RegisterAllocation;
+    generator->function_code = asm_code_create();
+}
+
+static void end_code(CodeGenerator *generator)
+{
+    asm_code_write(generator->function_code, generator->output);
+    asm_code_destroy(generator->function_code);
+    generator->function_code = NULL;
+}
+
+static void emit_instruction(CodeGenerator *generator, AsmOpcode opcode, AsmCondition condition, int count,
+                             const AsmOperand *operands)
+{
+    AsmInstruction instruction;
+    instruction.opcode = opcode;
+    instruction.condition = condition;
+    instruction.operand_count = count;
+    for (int i = 0; i < count; i++)
+    {
+        instruction.operands[i] = operands[i];
+    }
+    asm_code_add_instruction(generator->function_code, &instruction);
+    generator->emitted_instructions++;
+}
+
+static void emit0(CodeGenerator *generator, AsmOpcode opcode)
+{
+    emit_instruction(generator, opcode, ASM_CC_E, 0, NULL);
+}
+
+static void emit1(CodeGenerator *generator, AsmOpcode opcode, AsmOperand operand)
+{
+    emit_instruction(generator, opcode, ASM_CC_E, 1, &operand);
+}
+
+static void emit2(CodeGenerator *generator, AsmOpcode opcode, AsmOperand dest, AsmOperand source)
+{
+    AsmOperand operands[2] = {dest, source};
+    emit_instruction(generator, opcode, ASM_CC_E, 2, operands);
+}
+
+static void emit3(CodeGenerator *generator, AsmOpcode opcode, AsmOperand dest, AsmOperand source,
+                  AsmOperand extra)
+{
+    AsmOperand operands[3] = {dest, source, extra};
+    emit_instruction(generator, opcode, ASM_CC_E, 3, operands);
+}
+
+static void emit_jump(CodeGenerator *generator, AsmCondition condition, AsmOperand target)
+{
+    emit_instruction(generator, ASM_OP_J, condition, 1, &target);
+}
+
+static void emit_set(CodeGenerator *generator, AsmCondition condition, AsmOperand dest)
+{
+    emit_instruction(generator, ASM_OP_SET, condition, 1, &dest);
+}
+
+static void emit_text(CodeGenerator *generator, AsmLineKind kind, const char *format, va_list args)
+{
+    char text[512];
+    vsnprintf(text, sizeof(text), format, args);
+    asm_code_add_text(generator->function_code, kind, text);
+}
+
+static void emit_label(CodeGenerator *generator, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    emit_text(generator, ASM_LINE_LABEL, format, args);
+    va_end(args);
+}
+
+static void emit_directive(CodeGenerator *generator, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    emit_text(generator, ASM_LINE_DIRECTIVE, format, args);
+    va_end(args);
+}
 
-#define MAX_REGISTERS 6
-// static const char* available_registers[] = {"rax", "rcx", "rdx", "r8", "r9", "r10"};
+/* Jump or call target formatted into the caller's buffer. */
+static AsmOperand format_symbol(char *buffer, size_t size, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, size, format, args);
+    va_end(args);
+    return asm_symbol(buffer);
+}
+
+/* A label of the function being generated. */
+static AsmOperand block_label(CodeGenerator *generator, const char *label, char *buffer, size_t size)
+{
+    return format_symbol(buffer, size, "%s_%s", generator->current_function_name, label);
+}
 
-// Remove unused function or add proper implementation
-/*
-RegisterAllocation* find_register_for_operand(CodeGenerator* generator, IROperand* operand) {
-    // For now, we'll use a simple approach - just use rax for most operations
-    // In a full implementation, you'd track register usage and allocate optimally - fix this alan
-    static RegisterAllocation rax_allocation = {NULL, "rax", false};
-    rax_allocation.operand = operand;
-    rax_allocation.is_live = true;
-    return &rax_allocation;
+static AsmOperand frame_slot(int offset)
+{
+    return asm_qword(asm_mem(ASM_RBP, ASM_NO_REGISTER, 1, -offset));
 }
-*/
 
 CodeGenerator *codegenasm_create(IRProgram *ir_program, FILE *output_file, Error *error)
 {
     CodeGenerator *generator = safe_malloc(sizeof(CodeGenerator));
     generator->ir_program = ir_program;
+    generator->program = NULL;
     generator->output_file = output_file;
+    generator->output = code_buffer_create();
     generator->error = error;
     generator->indent_level = 0;
     generator->temp_counter = 0;
     generator->temp_map = hashtable_create(16);
     generator->var_set = hashtable_create(16);
+    generator->array_info = NULL;
+    generator->variable_types = NULL;
+    generator->strategy = NULL;
     generator->declared_temps = hashtable_create(16);
+    generator->in_cold_block = false;
     generator->param_count = 0;
     generator->current_function_name = NULL;
+    generator->register_allocation = NULL;
+    generator->string_labels = hashtable_create(16);
+    generator->float_labels = hashtable_create(16);
+    generator->local_offsets = NULL;
+    generator->saved_registers = 0;
+    generator->emitted_instructions = 0;
+    generator->function_code = NULL;
+    generator->peephole_stats = safe_malloc(sizeof(AsmPeepholeStats));
+    memset(generator->peephole_stats, 0, sizeof(AsmPeepholeStats));
+
+    char strategy[32] = "asm";
+    if (assembly_target)
+        snprintf(strategy, sizeof(strategy), "asm-%s", assembly_target);
+    generator->strategy = codegen_strategy_factory(strategy);
+    if (!generator->strategy)
+        error_set(error, ERROR_CODEGEN, "Unknown assembly target", 0, 0);
     return generator;
 }
 
@@ -63,19 +174,24 @@ void codegenasm_destroy(CodeGenerator *generator)
     if (!generator)
         return;
 
+    if (generator->strategy)
+        generator->strategy->destroy(generator->strategy);
+    asm_register_allocation_destroy(generator->register_allocation);
     hashtable_destroy(generator->temp_map);
     hashtable_destroy(generator->var_set);
     hashtable_destroy(generator->declared_temps);
+    hashtable_destroy(generator->string_labels);
+    hashtable_destroy(generator->float_labels);
+    hashtable_destroy(generator->variable_types);
+    hashtable_destroy(generator->local_offsets);
+    asm_code_destroy(generator->function_code);
+    safe_free(generator->peephole_stats);
+    code_buffer_destroy(generator->output);
     safe_free(generator);
 }
 
-bool codegenasm_generate(CodeGenerator *generator)
+static void generate_text(CodeGenerator *generator)
 {
-    if (debug_enabled)
-    {
-        printf("[DEBUG] Entered codegenasm_generate\n");
-        fflush(stdout);
-    }
     codegenasm_write_header(generator);
     if (debug_enabled)
     {
@@ -88,9 +204,110 @@ bool codegenasm_generate(CodeGenerator *generator)
         printf("[DEBUG] Generated program\n");
         fflush(stdout);
     }
+}
+
+bool codegenasm_generate(CodeGenerator *generator)
+{
+    if (debug_enabled)
+    {
+        printf("[DEBUG] Entered codegenasm_generate\n");
+        fflush(stdout);
+    }
+    generate_text(generator);
+    if (!code_buffer_flush(generator->output, generator->output_file))
+    {
+        error_set(generator->error, ERROR_CODEGEN, "Cannot write the assembly output", 0, 0);
+        return false;
+    }
     return true;
 }
 
+/* Assembles the generated text in process, so machine code can be produced
+   without an external assembler. */
+static AsmObject *assemble_program(CodeGenerator *generator)
+{
+    if (!is_sysv(generator))
+    {
+        error_set(generator->error, ERROR_CODEGEN, "Machine code output requires the sysv target", 0, 0);
+        return NULL;
+    }
+
+    generate_text(generator);
+    char message[256];
+    AsmObject *object = asm_assemble(code_buffer_text(generator->output), message, sizeof(message));
+    code_buffer_flush(generator->output, NULL);
+    if (!object)
+        error_set(generator->error, ERROR_CODEGEN, message, 0, 0);
+    return object;
+}
+
+bool codegenasm_generate_object(CodeGenerator *generator)
+{
+    AsmObject *object = assemble_program(generator);
+    if (!object)
+        return false;
+    bool success = elf_write_object(object, generator->output_file);
+    asm_object_destroy(object);
+    return success;
+}
+
+bool codegenasm_generate_image(CodeGenerator *generator, JitImage *image)
+{
+    AsmObject *object = assemble_program(generator);
+    if (!object)
+        return false;
+    char message[256];
+    bool success = jit_load(object, image, message, sizeof(message));
+    if (!success)
+        error_set(generator->error, ERROR_CODEGEN, message, 0, 0);
+    asm_object_destroy(object);
+    return success;
+}
+
+static IRFunction *find_function(CodeGenerator *generator, const char *name)
+{
+    for (size_t i = 0; i < generator->ir_program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&generator->ir_program->functions, i);
+        if (string_equal(func->name, name))
+            return func;
+    }
+    return NULL;
+}
+
+static bool program_has_function(CodeGenerator *generator, const char *name)
+{
+    return find_function(generator, name) != NULL;
+}
+
+static const char *read_only_section(CodeGenerator *generator)
+{
+    return is_sysv(generator) ? ".rodata" : ".rdata";
+}
+
+/* The float pool, in the order the constants were first used. */
+static void write_float_constants(CodeGenerator *generator)
+{
+    HashTable *labels = generator->float_labels;
+    if (labels->size == 0)
+        return;
+    const char **entries = safe_malloc(labels->size * sizeof(char *));
+    for (size_t i = 0; i < labels->capacity; i++)
+    {
+        for (HashTableEntry *entry = labels->buckets[i]; entry; entry = entry->next)
+        {
+            entries[(intptr_t)entry->value - 1] = entry->key;
+        }
+    }
+    code_buffer_printf(generator->output, "\nsection %s\n", read_only_section(generator));
+    code_buffer_puts(generator->output, "align 8\n");
+    for (size_t i = 0; i < labels->size; i++)
+    {
+        code_buffer_printf(generator->output, "flt_%zu: %s\n", i, entries[i]);
+    }
+    safe_free(entries);
+}
+
 void codegenasm_generate_program(CodeGenerator *generator)
 {
     if (debug_enabled)
@@ -129,25 +346,25 @@ void codegenasm_generate_program(CodeGenerator *generator)
         codegenasm_generate_function(generator, func);
     }
 
-    bool has_main = false;
-    for (size_t i = 0; i < generator->ir_program->functions.size; i++)
+    if (!program_has_function(generator, "main"))
     {
-        IRFunction *func = (IRFunction *)array_get(&generator->ir_program->functions, i);
-        if (string_equal(func->name, "main"))
+        if (debug_enabled)
         {
-            has_main = true;
-            break;
+            printf("[DEBUG] Adding main function\n");
+            fflush(stdout);
         }
+        codegenasm_write_main_function(generator);
     }
+    write_float_constants(generator);
 
-    if (!has_main)
+    if (debug_enabled || optimization_options.time_passes)
     {
-        if (debug_enabled)
+        printf("Peephole statistics:\n");
+        for (int rule = 0; rule < ASM_PEEPHOLE_RULE_COUNT; rule++)
         {
-            printf("[DEBUG] Adding main function\n");
-            fflush(stdout);
+            printf("  %-32s %zu\n", asm_peephole_rule_name((AsmPeepholeRule)rule),
+                   generator->peephole_stats->applied[rule]);
         }
-        codegenasm_write_main_function(generator);
     }
 
     if (debug_enabled)
@@ -157,6 +374,9 @@ void codegenasm_generate_program(CodeGenerator *generator)
     }
 }
 
+static bool select_pair(CodeGenerator *generator, IRInstruction *instr, IRInstruction *next);
+static void write_memo_wrapper(CodeGenerator *generator, IRFunction *func);
+
 void codegenasm_generate_function(CodeGenerator *generator, IRFunction *func)
 {
     if (debug_enabled)
@@ -170,10 +390,23 @@ void codegenasm_generate_function(CodeGenerator *generator, IRFunction *func)
         fflush(stdout);
     }
 
+    /* A memoized function's body becomes func__impl behind a wrapper that
+       keeps the function's own name. */
+    char impl_name[128];
     generator->current_function_name = func->name;
-    snprintf(generator->epilogue_label, sizeof(generator->epilogue_label), "%s_epilogue", func->name);
+    if (func->memoize)
+    {
+        snprintf(impl_name, sizeof(impl_name), "%s__impl", func->name);
+        generator->current_function_name = impl_name;
+    }
+    generator->current_function_return_type = func->return_type;
+    generator->param_count = 0;
+    snprintf(generator->epilogue_label, sizeof(generator->epilogue_label), "%s_epilogue",
+             generator->current_function_name);
 
+    begin_code(generator);
     codegenasm_write_function_header(generator, func);
+    size_t emitted_before = generator->emitted_instructions;
 
     for (size_t i = 0; i < func->instructions.size; i++)
     {
@@ -183,31 +416,56 @@ void codegenasm_generate_function(CodeGenerator *generator, IRFunction *func)
             printf("[DEBUG] Generating instruction %zu: %s\n", i, ir_opcode_to_string(instr->opcode));
             fflush(stdout);
         }
+        IRInstruction *next = i + 1 < func->instructions.size
+                                  ? (IRInstruction *)array_get(&func->instructions, i + 1)
+                                  : NULL;
+        if (select_pair(generator, instr, next))
+        {
+            i++;
+            continue;
+        }
         codegenasm_generate_instruction(generator, instr);
     }
 
-    fprintf(generator->output_file, "%s:\n", generator->epilogue_label);
+    emit_label(generator, "%s", generator->epilogue_label);
     codegenasm_write_function_footer(generator);
+    if (func->memoize)
+        write_memo_wrapper(generator, func);
+    if (optimization_options.level > 0)
+        asm_peephole_optimize(generator->function_code, generator->peephole_stats);
+    end_code(generator);
     if (debug_enabled)
     {
+        printf("[DEBUG] Instruction selection: %s: %zu instructions\n", func->name,
+               generator->emitted_instructions - emitted_before);
         printf("[DEBUG] Exiting codegenasm_generate_function for %s\n", func->name);
         fflush(stdout);
     }
 }
 
+static void codegenasm_array_init(CodeGenerator *generator, IRInstruction *instr);
+static bool is_float_type(DataType type);
+static DataType arithmetic_type(const IROperand *arg1, const IROperand *arg2);
+static bool is_float_scalar(const IROperand *operand);
+static bool is_float_comparison(const IRInstruction *instr);
+static AsmCondition condition_code(IROpcode opcode, bool negate);
+static void codegenasm_logical(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg1,
+                               IROperand *arg2);
+
 void codegenasm_generate_instruction(CodeGenerator *generator, IRInstruction *instr)
 {
     if (!instr)
         return;
+    char label[160];
 
     switch (instr->opcode)
     {
     case IR_NOP:
-        fprintf(generator->output_file, "    nop\n");
+        emit0(generator, ASM_OP_NOP);
         break;
 
     case IR_LABEL:
-        fprintf(generator->output_file, "%s_%s:\n", generator->current_function_name, instr->label);
+        emit_label(generator, "%s_%s", generator->current_function_name, instr->label);
         break;
 
     case IR_MOVE:
@@ -215,18 +473,53 @@ void codegenasm_generate_instruction(CodeGenerator *generator, IRInstruction *in
         break;
 
     case IR_ADD:
-        codegenasm_binary_op(generator, "add", instr->result, instr->arg1, instr->arg2);
+        if (instr->result->vector_width > 0)
+        {
+            codegenasm_vector_binary(generator, instr);
+            break;
+        }
+        if (is_float_type(arithmetic_type(instr->arg1, instr->arg2)))
+        {
+            codegenasm_float_binary(generator, ASM_OP_ADDSD, instr->result, instr->arg1, instr->arg2);
+            break;
+        }
+        codegenasm_binary_op(generator, ASM_OP_ADD, instr->result, instr->arg1, instr->arg2);
         break;
 
     case IR_SUB:
-        codegenasm_binary_op(generator, "sub", instr->result, instr->arg1, instr->arg2);
+        if (instr->result->vector_width > 0)
+        {
+            codegenasm_vector_binary(generator, instr);
+            break;
+        }
+        if (is_float_type(arithmetic_type(instr->arg1, instr->arg2)))
+        {
+            codegenasm_float_binary(generator, ASM_OP_SUBSD, instr->result, instr->arg1, instr->arg2);
+            break;
+        }
+        codegenasm_binary_op(generator, ASM_OP_SUB, instr->result, instr->arg1, instr->arg2);
         break;
 
     case IR_MUL:
+        if (instr->result->vector_width > 0)
+        {
+            codegenasm_vector_binary(generator, instr);
+            break;
+        }
+        if (is_float_type(arithmetic_type(instr->arg1, instr->arg2)))
+        {
+            codegenasm_float_binary(generator, ASM_OP_MULSD, instr->result, instr->arg1, instr->arg2);
+            break;
+        }
         codegenasm_mul(generator, instr->result, instr->arg1, instr->arg2);
         break;
 
     case IR_DIV:
+        if (is_float_type(arithmetic_type(instr->arg1, instr->arg2)))
+        {
+            codegenasm_float_binary(generator, ASM_OP_DIVSD, instr->result, instr->arg1, instr->arg2);
+            break;
+        }
         codegenasm_div(generator, instr->result, instr->arg1, instr->arg2);
         break;
 
@@ -235,7 +528,12 @@ void codegenasm_generate_instruction(CodeGenerator *generator, IRInstruction *in
         break;
 
     case IR_NEG:
-        codegenasm_unary_op(generator, "neg", instr->result, instr->arg1);
+        if (is_float_scalar(instr->arg1))
+        {
+            codegenasm_float_negate(generator, instr->result, instr->arg1);
+            break;
+        }
+        codegenasm_unary_op(generator, ASM_OP_NEG, instr->result, instr->arg1);
         break;
 
     case IR_NOT:
@@ -243,51 +541,56 @@ void codegenasm_generate_instruction(CodeGenerator *generator, IRInstruction *in
         break;
 
     case IR_EQ:
-        codegenasm_compare(generator, "sete", instr->result, instr->arg1, instr->arg2);
-        break;
-
     case IR_NE:
-        codegenasm_compare(generator, "setne", instr->result, instr->arg1, instr->arg2);
-        break;
-
     case IR_LT:
-        codegenasm_compare(generator, "setl", instr->result, instr->arg1, instr->arg2);
-        break;
-
     case IR_LE:
-        codegenasm_compare(generator, "setle", instr->result, instr->arg1, instr->arg2);
-        break;
-
     case IR_GT:
-        codegenasm_compare(generator, "setg", instr->result, instr->arg1, instr->arg2);
-        break;
-
     case IR_GE:
-        codegenasm_compare(generator, "setge", instr->result, instr->arg1, instr->arg2);
+        if (is_float_comparison(instr))
+        {
+            codegenasm_float_compare(generator, instr->opcode, instr->result, instr->arg1, instr->arg2);
+            break;
+        }
+        codegenasm_compare(generator, condition_code(instr->opcode, false), instr->result, instr->arg1, instr->arg2);
         break;
 
     case IR_AND:
-        codegenasm_binary_op(generator, "and", instr->result, instr->arg1, instr->arg2);
+        codegenasm_logical(generator, ASM_OP_AND, instr->result, instr->arg1, instr->arg2);
         break;
 
     case IR_OR:
-        codegenasm_binary_op(generator, "or", instr->result, instr->arg1, instr->arg2);
+        codegenasm_logical(generator, ASM_OP_OR, instr->result, instr->arg1, instr->arg2);
+        break;
+
+    case IR_SHL:
+    case IR_SHR:
+        if (instr->result->vector_width > 0)
+        {
+            codegenasm_vector_binary(generator, instr);
+            break;
+        }
+        codegenasm_shift(generator, instr->opcode == IR_SHL ? ASM_OP_SAL : ASM_OP_SAR, instr->result, instr->arg1, instr->arg2);
+        break;
+
+    case IR_BAND:
+        if (instr->result->vector_width > 0)
+        {
+            codegenasm_vector_binary(generator, instr);
+            break;
+        }
+        codegenasm_binary_op(generator, ASM_OP_AND, instr->result, instr->arg1, instr->arg2);
         break;
 
     case IR_JUMP:
-        fprintf(generator->output_file, "    jmp %s_%s\n", generator->current_function_name, instr->label);
+        emit1(generator, ASM_OP_JMP, block_label(generator, instr->label, label, sizeof(label)));
         break;
 
     case IR_JUMP_IF:
-        fprintf(generator->output_file, "    cmp qword [rel %s], 0\n",
-                codegenasm_get_operand_name(generator, instr->arg1));
-        fprintf(generator->output_file, "    jnz %s_%s\n", generator->current_function_name, instr->label);
+        codegenasm_conditional_jump(generator, true, instr->arg1, instr->label);
         break;
 
     case IR_JUMP_IF_FALSE:
-        fprintf(generator->output_file, "    cmp qword [rel %s], 0\n",
-                codegenasm_get_operand_name(generator, instr->arg1));
-        fprintf(generator->output_file, "    jz %s_%s\n", generator->current_function_name, instr->label);
+        codegenasm_conditional_jump(generator, false, instr->arg1, instr->label);
         break;
 
     case IR_PARAM:
@@ -298,29 +601,36 @@ void codegenasm_generate_instruction(CodeGenerator *generator, IRInstruction *in
         break;
 
     case IR_CALL:
+        if (instr->is_tail_call && generator->param_count <= target_of(generator)->argument_register_count)
+        {
+            codegenasm_tail_call(generator, instr->label);
+            break;
+        }
         codegenasm_call(generator, instr->result, instr->label);
         break;
 
     case IR_RETURN:
-        if (instr->arg1)
-        {
-            fprintf(generator->output_file, "    mov rax, qword [rel %s]\n",
-                    codegenasm_get_operand_name(generator, instr->arg1));
-        }
-        else
-        {
-            fprintf(generator->output_file, "    mov rax, 0\n");
-        }
-        fprintf(generator->output_file, "    jmp %s\n", generator->epilogue_label);
+        codegenasm_return(generator, instr->arg1);
         break;
 
     case IR_PRINT:
-        codegenasm_print(generator, instr->arg1);
+    case IR_PRINT_MULTIPLE:
+        codegenasm_print(generator, instr);
         break;
     case IR_ARRAY_LOAD:
+        if (instr->result->vector_width > 0)
+        {
+            codegenasm_vector_memory(generator, instr);
+            break;
+        }
         codegenasm_array_load(generator, instr->result, instr->arg1, instr->arg2);
         break;
     case IR_ARRAY_STORE:
+        if (instr->result->vector_width > 0)
+        {
+            codegenasm_vector_memory(generator, instr);
+            break;
+        }
         codegenasm_array_store(generator, instr->arg1, instr->arg2, instr->result);
         break;
     case IR_BOUNDS_CHECK:
@@ -329,255 +639,1649 @@ void codegenasm_generate_instruction(CodeGenerator *generator, IRInstruction *in
     case IR_ARRAY_DECL:
         break;
     case IR_ARRAY_INIT:
+        codegenasm_array_init(generator, instr);
         break;
     case IR_VAR_DECL:
         break;
+    case IR_INLINE_ASM:
+        break;
+    case IR_VECTOR_SPLAT:
+    case IR_VECTOR_INDEX:
+        codegenasm_vector_build(generator, instr);
+        break;
+    case IR_VECTOR_REDUCE:
+        codegenasm_vector_reduce(generator, instr);
+        break;
+    case IR_PROFILE:
+        codegenasm_profile(generator, instr);
+        break;
     }
 }
 
-void codegenasm_move(CodeGenerator *generator, IROperand *dest, IROperand *src)
+static const char *storage_name(const IROperand *operand, char *buffer, size_t size)
 {
-    char *src_name = codegenasm_get_operand_name(generator, src);
-    char *dest_name = codegenasm_get_operand_name(generator, dest);
-    if ((strcmp(src_name, "rcx") == 0 || strcmp(src_name, "rdx") == 0 || strcmp(src_name, "r8") == 0 || strcmp(src_name, "r9") == 0) &&
-        (strcmp(dest_name, "rcx") == 0 || strcmp(dest_name, "rdx") == 0 || strcmp(dest_name, "r8") == 0 || strcmp(dest_name, "r9") == 0))
-    {
-        fprintf(generator->output_file, "    mov %s, %s\n", dest_name, src_name);
-    }
-    else if (strcmp(dest_name, "rcx") == 0 || strcmp(dest_name, "rdx") == 0 || strcmp(dest_name, "r8") == 0 || strcmp(dest_name, "r9") == 0)
-    {
-        fprintf(generator->output_file, "    mov %s, qword [rel %s]\n", dest_name, src_name);
-    }
-    else if (strcmp(src_name, "rcx") == 0 || strcmp(src_name, "rdx") == 0 || strcmp(src_name, "r8") == 0 || strcmp(src_name, "r9") == 0)
-    {
-        fprintf(generator->output_file, "    mov qword [rel %s], %s\n", dest_name, src_name);
-    }
+    if (operand->type == IR_OP_TEMP)
+        snprintf(buffer, size, "t%d", operand->data.temp_id);
     else
-    {
-        fprintf(generator->output_file, "    mov rax, qword [rel %s]\n", src_name);
-        fprintf(generator->output_file, "    mov qword [rel %s], rax\n", dest_name);
-    }
+        snprintf(buffer, size, "%s", operand->data.var_name);
+    return buffer;
 }
 
-void codegenasm_binary_op(CodeGenerator *generator, const char *op, IROperand *result, IROperand *arg1, IROperand *arg2)
+/* Distance in bytes below rbp of the operand's first qword. Spilled
+   scalars and vectors sit in their stack slots below the saved registers;
+   arrays and anything else the allocator leaves alone live in the frame
+   under the spill slots. */
+static int local_offset(CodeGenerator *generator, const IROperand *operand)
 {
-    char *arg1_name = codegenasm_get_operand_name(generator, arg1);
-    char *arg2_name = codegenasm_get_operand_name(generator, arg2);
-    char *result_name = codegenasm_get_operand_name(generator, result);
-    if (strcmp(arg1_name, "rcx") == 0 || strcmp(arg1_name, "rdx") == 0 || strcmp(arg1_name, "r8") == 0 || strcmp(arg1_name, "r9") == 0)
-    {
-        fprintf(generator->output_file, "    mov rax, %s\n", arg1_name);
-    }
-    else
-    {
-        fprintf(generator->output_file, "    mov rax, qword [rel %s]\n", arg1_name);
-    }
-    if (strcmp(arg2_name, "rcx") == 0 || strcmp(arg2_name, "rdx") == 0 || strcmp(arg2_name, "r8") == 0 || strcmp(arg2_name, "r9") == 0)
-    {
-        fprintf(generator->output_file, "    %s rax, %s\n", op, arg2_name);
-    }
-    else
+    const AsmLocation *place = asm_location_of(generator->register_allocation, operand);
+    if (place && place->kind == ASM_LOCATION_STACK)
     {
-        fprintf(generator->output_file, "    %s rax, qword [rel %s]\n", op, arg2_name);
+        int qwords = asm_operand_is_vector(operand) ? ASM_VECTOR_QWORDS : 1;
+        return 8 * (generator->saved_registers + place->slot + qwords);
     }
-    fprintf(generator->output_file, "    mov qword [rel %s], rax\n", result_name);
+
+    char name[256];
+    intptr_t end = (intptr_t)hashtable_get(generator->local_offsets, storage_name(operand, name, sizeof(name)));
+    return 8 * (generator->saved_registers + generator->register_allocation->spill_slots + (int)end);
 }
 
-void codegenasm_unary_op(CodeGenerator *generator, const char *op, IROperand *result, IROperand *arg)
+static AsmOperand local_address(CodeGenerator *generator, const IROperand *operand, int byte_offset)
 {
-    fprintf(generator->output_file, "    mov rax, qword [rel %s]\n",
-            codegenasm_get_operand_name(generator, arg));
-    fprintf(generator->output_file, "    %s rax\n", op);
-    fprintf(generator->output_file, "    mov qword [rel %s], rax\n",
-            codegenasm_get_operand_name(generator, result));
+    return asm_mem(ASM_RBP, ASM_NO_REGISTER, 1, byte_offset - local_offset(generator, operand));
 }
 
-void codegenasm_mul(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2)
+static bool operand_register(CodeGenerator *generator, const IROperand *operand, AsmRegister *reg)
 {
-    char *arg1_name = codegenasm_get_operand_name(generator, arg1);
-    char *arg2_name = codegenasm_get_operand_name(generator, arg2);
-    char *result_name = codegenasm_get_operand_name(generator, result);
+    const AsmLocation *location = asm_location_of(generator->register_allocation, operand);
+    if (!location || location->kind != ASM_LOCATION_REGISTER)
+        return false;
+    *reg = location->reg;
+    return true;
+}
 
-    if (arg1->type == IR_OP_VAR && generator->current_function_name)
-    {
-        IRFunction *func = NULL;
-        for (size_t i = 0; i < generator->ir_program->functions.size; i++)
-        {
-            IRFunction *f = (IRFunction *)array_get(&generator->ir_program->functions, i);
-            if (string_equal(f->name, generator->current_function_name))
-            {
-                func = f;
-                break;
-            }
-        }
-        if (func)
-        {
-            for (size_t i = 0; i < func->params.size; i++)
-            {
-                IROperand *param = (IROperand *)array_get(&func->params, i);
-                if (string_equal(param->data.var_name, arg1->data.var_name))
-                {
-                    fprintf(generator->output_file, "    mov rax, qword [rel %s_param]\n", generator->current_function_name);
-                    goto arg2_handling;
-                }
-            }
-        }
-    }
+static bool is_value(const IROperand *operand)
+{
+    return operand && (operand->type == IR_OP_TEMP || operand->type == IR_OP_VAR);
+}
 
-    if (is_param_register(arg1_name))
-    {
-        fprintf(generator->output_file, "    mov rax, %s\n", arg1_name);
-    }
-    else
-    {
-        fprintf(generator->output_file, "    mov rax, qword [rel %s]\n", arg1_name);
-    }
+static bool is_imm32(const IROperand *operand)
+{
+    return operand && operand->type == IR_OP_CONST && !operand->is_float_const &&
+           operand->data.const_value >= INT32_MIN && operand->data.const_value <= INT32_MAX;
+}
 
-arg2_handling:
-    if (is_param_register(arg2_name))
-    {
-        fprintf(generator->output_file, "    imul rax, %s\n", arg2_name);
-    }
-    else
-    {
-        fprintf(generator->output_file, "    imul rax, qword [rel %s]\n", arg2_name);
-    }
-    fprintf(generator->output_file, "    mov qword [rel %s], rax\n", result_name);
+static bool is_zero(const IROperand *operand)
+{
+    return !operand || operand->type == IR_OP_NULL || operand->type == IR_OP_LABEL;
 }
 
-void codegenasm_div(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2)
+static bool is_float_type(DataType type)
 {
-    char *arg1_name = codegenasm_get_operand_name(generator, arg1);
-    char *arg2_name = codegenasm_get_operand_name(generator, arg2);
-    char *result_name = codegenasm_get_operand_name(generator, result);
-    if (is_param_register(arg1_name))
-    {
-        fprintf(generator->output_file, "    mov rax, %s\n", arg1_name);
-    }
-    else
-    {
-        fprintf(generator->output_file, "    mov rax, qword [rel %s]\n", arg1_name);
-    }
-    fprintf(generator->output_file, "    cqo\n");
-    if (is_param_register(arg2_name))
-    {
-        fprintf(generator->output_file, "    idiv %s\n", arg2_name);
-    }
-    else
-    {
-        fprintf(generator->output_file, "    idiv qword [rel %s]\n", arg2_name);
-    }
-    fprintf(generator->output_file, "    mov qword [rel %s], rax\n", result_name);
+    return type == TYPE_FLOAT || type == TYPE_DOUBLE;
 }
 
-void codegenasm_mod(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2)
+/* How a scalar is represented: float and double keep their IEEE bits in
+   the low end of a qword, everything else is a 64-bit integer. Float
+   literals are doubles, as in C. */
+static DataType scalar_type(const IROperand *operand)
 {
-    char *arg1_name = codegenasm_get_operand_name(generator, arg1);
-    char *arg2_name = codegenasm_get_operand_name(generator, arg2);
-    char *result_name = codegenasm_get_operand_name(generator, result);
-    if (is_param_register(arg1_name))
-    {
-        fprintf(generator->output_file, "    mov rax, %s\n", arg1_name);
-    }
-    else
-    {
-        fprintf(generator->output_file, "    mov rax, qword [rel %s]\n", arg1_name);
-    }
-    fprintf(generator->output_file, "    cqo\n");
-    if (is_param_register(arg2_name))
-    {
-        fprintf(generator->output_file, "    idiv %s\n", arg2_name);
-    }
-    else
-    {
-        fprintf(generator->output_file, "    idiv qword [rel %s]\n", arg2_name);
-    }
-    fprintf(generator->output_file, "    mov qword [rel %s], rdx\n", result_name);
+    if (!operand || operand->type == IR_OP_STRING_CONST)
+        return TYPE_INT;
+    if (operand->is_float_const || operand->data_type == TYPE_DOUBLE)
+        return TYPE_DOUBLE;
+    return operand->data_type == TYPE_FLOAT ? TYPE_FLOAT : TYPE_INT;
 }
 
-void codegenasm_not(CodeGenerator *generator, IROperand *result, IROperand *arg)
+/* The type a binary operation is computed in, by C's usual conversions. */
+static DataType arithmetic_type(const IROperand *arg1, const IROperand *arg2)
 {
-    fprintf(generator->output_file, "    mov rax, qword [rel %s]\n",
-            codegenasm_get_operand_name(generator, arg));
-    fprintf(generator->output_file, "    not rax\n");
-    fprintf(generator->output_file, "    mov qword [rel %s], rax\n",
-            codegenasm_get_operand_name(generator, result));
+    DataType left = scalar_type(arg1), right = scalar_type(arg2);
+    if (left == TYPE_DOUBLE || right == TYPE_DOUBLE)
+        return TYPE_DOUBLE;
+    return left == TYPE_FLOAT || right == TYPE_FLOAT ? TYPE_FLOAT : TYPE_INT;
 }
 
-void codegenasm_compare(CodeGenerator *generator, const char *set_op, IROperand *result, IROperand *arg1, IROperand *arg2)
+static bool is_float_scalar(const IROperand *operand)
 {
-    char *arg1_name = codegenasm_get_operand_name(generator, arg1);
-    char *arg2_name = codegenasm_get_operand_name(generator, arg2);
-    char *result_name = codegenasm_get_operand_name(generator, result);
-    if (is_param_register(arg1_name))
-    {
-        fprintf(generator->output_file, "    mov rax, %s\n", arg1_name);
-    }
-    else
-    {
-        fprintf(generator->output_file, "    mov rax, qword [rel %s]\n", arg1_name);
-    }
-    if (is_param_register(arg2_name))
-    {
-        fprintf(generator->output_file, "    cmp rax, %s\n", arg2_name);
+    return is_float_type(scalar_type(operand));
+}
+
+/* Where a value lives: its register, its spill slot below the saved
+   registers, or its place among the frame's locals. */
+static AsmOperand location_of(CodeGenerator *generator, const IROperand *operand)
+{
+    const AsmLocation *place = asm_location_of(generator->register_allocation, operand);
+    if (place && place->kind == ASM_LOCATION_REGISTER)
+        return asm_reg(place->reg);
+    return frame_slot(local_offset(generator, operand));
+}
+
+static AsmOperand string_address(CodeGenerator *generator, const char *text, char *buffer, size_t size)
+{
+    intptr_t index = (intptr_t)hashtable_get(generator->string_labels, text);
+    snprintf(buffer, size, "str_%ld", (long)index - 1);
+    return asm_rel(buffer, 0);
+}
+
+static void load(CodeGenerator *generator, AsmRegister reg, IROperand *operand)
+{
+    char buffer[32];
+    AsmRegister held;
+
+    if (is_zero(operand))
+    {
+        emit2(generator, ASM_OP_MOV, asm_reg(reg), asm_imm(0));
+        return;
+    }
+    switch (operand->type)
+    {
+    case IR_OP_CONST:
+        if (operand->is_float_const)
+        {
+            uint64_t bits;
+            memcpy(&bits, &operand->data.float_const_value, sizeof(bits));
+            emit2(generator, ASM_OP_MOV, asm_reg(reg), asm_hex(bits));
+        }
+        else
+        {
+            emit2(generator, ASM_OP_MOV, asm_reg(reg), asm_imm(operand->data.const_value));
+        }
+        break;
+    case IR_OP_STRING_CONST:
+        emit2(generator, ASM_OP_LEA, asm_reg(reg),
+              string_address(generator, operand->data.string_const_value, buffer, sizeof(buffer)));
+        break;
+    default:
+        if (operand_register(generator, operand, &held) && held == reg)
+            break;
+        emit2(generator, ASM_OP_MOV, asm_reg(reg), location_of(generator, operand));
+        break;
+    }
+}
+
+/* An operand that an instruction can take directly: a register, memory
+   or a 32-bit immediate. Anything else is first loaded into the scratch
+   register. */
+static AsmOperand operand_source(CodeGenerator *generator, IROperand *operand, AsmRegister scratch)
+{
+    if (is_zero(operand))
+        return asm_imm(0);
+    if (is_imm32(operand))
+        return asm_imm(operand->data.const_value);
+    if (is_value(operand))
+        return location_of(generator, operand);
+    load(generator, scratch, operand);
+    return asm_reg(scratch);
+}
+
+static void store(CodeGenerator *generator, IROperand *dest, AsmRegister reg)
+{
+    AsmRegister held;
+    if (!dest || (operand_register(generator, dest, &held) && held == reg))
+        return;
+    emit2(generator, ASM_OP_MOV, location_of(generator, dest), asm_reg(reg));
+}
+
+/* Computes straight into the result's register when it has one. */
+static AsmRegister target_register(CodeGenerator *generator, IROperand *result)
+{
+    AsmRegister reg;
+    return operand_register(generator, result, &reg) ? reg : ASM_RAX;
+}
+
+static bool is_constant(const IROperand *operand)
+{
+    return is_zero(operand) || operand->type == IR_OP_CONST;
+}
+
+/* Bits of a constant converted to a float or double. */
+static uint64_t float_bits(const IROperand *constant, DataType type)
+{
+    double value = 0;
+    if (!is_zero(constant))
+        value = constant->is_float_const ? constant->data.float_const_value : (double)constant->data.const_value;
+    if (type == TYPE_FLOAT)
+    {
+        float narrow = (float)value;
+        uint32_t bits;
+        memcpy(&bits, &narrow, sizeof(bits));
+        return bits;
+    }
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/* Memory operand for a constant in the read-only float pool. Each entry
+   is a qword, so floats are padded and every entry stays aligned. */
+static AsmOperand float_constant(CodeGenerator *generator, const IROperand *constant, DataType type, char *buffer,
+                                 size_t size)
+{
+    char key[32];
+    snprintf(key, sizeof(key), "dq 0x%016llx", (unsigned long long)float_bits(constant, type));
+    intptr_t index = (intptr_t)hashtable_get(generator->float_labels, key);
+    if (index == 0)
+    {
+        index = (intptr_t)generator->float_labels->size + 1;
+        hashtable_put(generator->float_labels, key, (void *)index);
+    }
+    snprintf(buffer, size, "flt_%ld", (long)index - 1);
+    return asm_rel(buffer, 0);
+}
+
+/* The single-precision form of a scalar double opcode for floats. */
+static AsmOpcode float_form(AsmOpcode double_opcode, DataType type)
+{
+    return type == TYPE_FLOAT ? (AsmOpcode)(double_opcode + 1) : double_opcode;
+}
+
+static AsmOpcode float_conversion(DataType from)
+{
+    return from == TYPE_FLOAT ? ASM_OP_CVTSS2SD : ASM_OP_CVTSD2SS;
+}
+
+/* Loads a scalar into xmm register `xmm` as a float or a double. Only
+   that register is written. */
+static void load_float(CodeGenerator *generator, int xmm, IROperand *operand, DataType type)
+{
+    char buffer[32];
+    DataType from = scalar_type(operand);
+    AsmRegister reg;
+
+    if (is_constant(operand))
+    {
+        emit2(generator, float_form(ASM_OP_MOVSD, type), asm_xmm(xmm),
+              float_constant(generator, operand, type, buffer, sizeof(buffer)));
+        return;
+    }
+    AsmOperand source = location_of(generator, operand);
+    if (!is_float_type(from))
+    {
+        emit2(generator, float_form(ASM_OP_CVTSI2SD, type), asm_xmm(xmm), source);
+        return;
+    }
+    emit2(generator, operand_register(generator, operand, &reg) ? ASM_OP_MOVQ : ASM_OP_MOVSD, asm_xmm(xmm), source);
+    if (from != type)
+        emit2(generator, float_conversion(from), asm_xmm(xmm), asm_xmm(xmm));
+}
+
+/* Stores a float or double held in xmm register `xmm`, converting it to
+   the result's type; integers are truncated toward zero. */
+static void store_float(CodeGenerator *generator, IROperand *result, int xmm, DataType type)
+{
+    DataType to = scalar_type(result);
+    AsmRegister reg;
+
+    if (!result)
+        return;
+    if (!is_float_type(to))
+    {
+        AsmRegister target = target_register(generator, result);
+        emit2(generator, float_form(ASM_OP_CVTTSD2SI, type), asm_reg(target), asm_xmm(xmm));
+        store(generator, result, target);
+        return;
+    }
+    if (to != type)
+        emit2(generator, float_conversion(type), asm_xmm(xmm), asm_xmm(xmm));
+    emit2(generator, operand_register(generator, result, &reg) ? ASM_OP_MOVQ : ASM_OP_MOVSD,
+          location_of(generator, result), asm_xmm(xmm));
+}
+
+/* Loads a scalar into a general register in the representation of
+   `type`, converting between integers, floats and doubles. May use
+   xmm0. */
+static void load_as(CodeGenerator *generator, AsmRegister reg, IROperand *operand, DataType type)
+{
+    DataType from = scalar_type(operand);
+    if (is_float_type(type) && is_constant(operand))
+    {
+        emit2(generator, ASM_OP_MOV, asm_reg(reg), asm_hex(float_bits(operand, type)));
+    }
+    else if (from == type || (!is_float_type(from) && !is_float_type(type)))
+    {
+        load(generator, reg, operand);
+    }
+    else if (is_float_type(type))
+    {
+        load_float(generator, 0, operand, type);
+        emit2(generator, ASM_OP_MOVQ, asm_reg(reg), asm_xmm(0));
+    }
+    else
+    {
+        load_float(generator, 0, operand, from);
+        emit2(generator, float_form(ASM_OP_CVTTSD2SI, from), asm_reg(reg), asm_xmm(0));
+    }
+}
+
+/* Whether copying between the two operands changes the representation. */
+static bool needs_conversion(const IROperand *dest, const IROperand *src)
+{
+    DataType to = scalar_type(dest), from = scalar_type(src);
+    if (is_float_type(to) && is_constant(src))
+        return !(to == TYPE_DOUBLE && src->type == IR_OP_CONST && src->is_float_const);
+    return to != from && (is_float_type(to) || is_float_type(from));
+}
+
+/* Sets the flags for a comparison of the operand against zero. */
+static void test_operand(CodeGenerator *generator, IROperand *operand)
+{
+    AsmRegister reg;
+    if (operand_register(generator, operand, &reg))
+    {
+        emit2(generator, ASM_OP_TEST, asm_reg(reg), asm_reg(reg));
+    }
+    else if (is_value(operand))
+    {
+        emit2(generator, ASM_OP_CMP, location_of(generator, operand), asm_imm(0));
+    }
+    else
+    {
+        load(generator, ASM_RAX, operand);
+        emit2(generator, ASM_OP_TEST, asm_reg(ASM_RAX), asm_reg(ASM_RAX));
+    }
+}
+
+static void set_result(CodeGenerator *generator, AsmCondition condition, IROperand *result)
+{
+    AsmRegister target = target_register(generator, result);
+    emit_set(generator, condition, asm_reg8(target));
+    emit2(generator, ASM_OP_MOVZX, asm_reg(target), asm_reg8(target));
+    store(generator, result, target);
+}
+
+/* The packed opcode for a vector operation, or false when there is none. */
+static bool vector_opcode(IROpcode opcode, DataType type, AsmOpcode *op)
+{
+    bool is_double = type == TYPE_DOUBLE;
+    switch (opcode)
+    {
+    case IR_ADD:
+        *op = is_double ? ASM_OP_ADDPD : ASM_OP_PADDQ;
+        return true;
+    case IR_SUB:
+        *op = is_double ? ASM_OP_SUBPD : ASM_OP_PSUBQ;
+        return true;
+    case IR_MUL:
+        *op = ASM_OP_MULPD;
+        return is_double;
+    case IR_SHL:
+        *op = ASM_OP_PSLLQ;
+        return true;
+    case IR_SHR:
+        *op = ASM_OP_PSRLQ;
+        return true;
+    case IR_BAND:
+        *op = ASM_OP_PAND;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void codegenasm_vector_binary(CodeGenerator *generator, IRInstruction *instr)
+{
+    AsmOpcode op;
+    if (vector_opcode(instr->opcode, instr->result->data_type, &op))
+    {
+        emit2(generator, ASM_OP_MOVDQU, asm_xmm(0), local_address(generator, instr->arg1, 0));
+        emit2(generator, ASM_OP_MOVDQU, asm_xmm(1), local_address(generator, instr->arg2, 0));
+        emit2(generator, op, asm_xmm(0), asm_xmm(1));
+        emit2(generator, ASM_OP_MOVDQU, local_address(generator, instr->result, 0), asm_xmm(0));
+    }
+    else
+    {
+        /* SSE2 has no packed 64-bit multiply, so integer lanes are multiplied one at a time. */
+        for (int lane = 0; lane < instr->result->vector_width; lane++)
+        {
+            emit2(generator, ASM_OP_MOV, asm_reg(ASM_RAX), asm_qword(local_address(generator, instr->arg1, lane * 8)));
+            emit2(generator, ASM_OP_IMUL, asm_reg(ASM_RAX),
+                  asm_qword(local_address(generator, instr->arg2, lane * 8)));
+            emit2(generator, ASM_OP_MOV, asm_qword(local_address(generator, instr->result, lane * 8)),
+                  asm_reg(ASM_RAX));
+        }
+    }
+}
+
+void codegenasm_vector_memory(CodeGenerator *generator, IRInstruction *instr)
+{
+    AsmOperand vector = local_address(generator, instr->result, 0);
+    AsmOperand element = asm_mem(ASM_RBP, ASM_RCX, 8, -local_offset(generator, instr->arg1));
+    load(generator, ASM_RCX, instr->arg2);
+    if (instr->opcode == IR_ARRAY_LOAD)
+    {
+        emit2(generator, ASM_OP_MOVDQU, asm_xmm(0), element);
+        emit2(generator, ASM_OP_MOVDQU, vector, asm_xmm(0));
+    }
+    else
+    {
+        emit2(generator, ASM_OP_MOVDQU, asm_xmm(0), vector);
+        emit2(generator, ASM_OP_MOVDQU, element, asm_xmm(0));
+    }
+}
+
+void codegenasm_vector_build(CodeGenerator *generator, IRInstruction *instr)
+{
+    bool to_double = instr->result->data_type == TYPE_DOUBLE;
+
+    if (instr->opcode == IR_VECTOR_SPLAT)
+    {
+        if (to_double)
+        {
+            load_float(generator, 0, instr->arg1, TYPE_DOUBLE);
+        }
+        else
+        {
+            load(generator, ASM_RAX, instr->arg1);
+            emit2(generator, ASM_OP_MOVQ, asm_xmm(0), asm_reg(ASM_RAX));
+        }
+        emit2(generator, ASM_OP_PUNPCKLQDQ, asm_xmm(0), asm_xmm(0));
+        emit2(generator, ASM_OP_MOVDQU, local_address(generator, instr->result, 0), asm_xmm(0));
+    }
+    else
+    {
+        load(generator, ASM_RAX, instr->arg1);
+        for (int lane = 0; lane < instr->result->vector_width; lane++)
+        {
+            AsmOperand element = asm_qword(local_address(generator, instr->result, lane * 8));
+            if (lane > 0)
+            {
+                emit2(generator, ASM_OP_ADD, asm_reg(ASM_RAX), asm_imm(1));
+            }
+            if (to_double)
+            {
+                emit2(generator, ASM_OP_CVTSI2SD, asm_xmm(0), asm_reg(ASM_RAX));
+                emit2(generator, ASM_OP_MOVSD, element, asm_xmm(0));
+            }
+            else
+            {
+                emit2(generator, ASM_OP_MOV, element, asm_reg(ASM_RAX));
+            }
+        }
+    }
+}
+
+void codegenasm_vector_reduce(CodeGenerator *generator, IRInstruction *instr)
+{
+    AsmRegister target = target_register(generator, instr->result);
+    emit2(generator, ASM_OP_MOVDQU, asm_xmm(0), local_address(generator, instr->arg1, 0));
+    emit3(generator, ASM_OP_PSHUFD, asm_xmm(1), asm_xmm(0), asm_hex(0xEE));
+    emit2(generator, instr->result->data_type == TYPE_DOUBLE ? ASM_OP_ADDSD : ASM_OP_PADDQ, asm_xmm(0), asm_xmm(1));
+    emit2(generator, ASM_OP_MOVQ, asm_reg(target), asm_xmm(0));
+    store(generator, instr->result, target);
+}
+
+void codegenasm_profile(CodeGenerator *generator, IRInstruction *instr)
+{
+    AsmOperand counter = asm_qword(asm_rel("__tl_profile_counters", 8 * instr->arg2->data.const_value));
+    if (!instr->arg1)
+    {
+        emit1(generator, ASM_OP_INC, counter);
+        return;
+    }
+    if (instr->arg1->type == IR_OP_CONST)
+    {
+        if (instr->arg1->data.const_value != 0)
+            emit1(generator, ASM_OP_INC, counter);
+        return;
+    }
+    test_operand(generator, instr->arg1);
+    emit_set(generator, ASM_CC_NZ, asm_reg8(ASM_RAX));
+    emit2(generator, ASM_OP_MOVZX, asm_reg32(ASM_RAX), asm_reg8(ASM_RAX));
+    emit2(generator, ASM_OP_ADD, counter, asm_reg(ASM_RAX));
+}
+
+void codegenasm_move(CodeGenerator *generator, IROperand *dest, IROperand *src)
+{
+    AsmRegister reg;
+    if (needs_conversion(dest, src))
+    {
+        reg = target_register(generator, dest);
+        load_as(generator, reg, src, scalar_type(dest));
+        store(generator, dest, reg);
+    }
+    else if (operand_register(generator, dest, &reg))
+    {
+        load(generator, reg, src);
+    }
+    else if (is_zero(src) || is_imm32(src) || operand_register(generator, src, &reg))
+    {
+        emit2(generator, ASM_OP_MOV, location_of(generator, dest), operand_source(generator, src, ASM_RAX));
+    }
+    else
+    {
+        load(generator, ASM_RAX, src);
+        store(generator, dest, ASM_RAX);
+    }
+}
+
+void codegenasm_conditional_jump(CodeGenerator *generator, bool jump_if_true, IROperand *condition, const char *label)
+{
+    char buffer[160];
+    AsmOperand target = block_label(generator, label, buffer, sizeof(buffer));
+    if (condition && condition->type == IR_OP_CONST)
+    {
+        if ((condition->data.const_value != 0) == jump_if_true)
+        {
+            emit1(generator, ASM_OP_JMP, target);
+        }
+        return;
+    }
+
+    test_operand(generator, condition);
+    emit_jump(generator, jump_if_true ? ASM_CC_NZ : ASM_CC_Z, target);
+}
+
+static bool is_commutative(AsmOpcode op)
+{
+    return op == ASM_OP_ADD || op == ASM_OP_IMUL || op == ASM_OP_AND || op == ASM_OP_OR;
+}
+
+/* Adds a register and a constant or a second register into a third
+   register with lea, which saves the copy add would need. */
+static bool select_lea(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg1, IROperand *arg2)
+{
+    bool is_add = op == ASM_OP_ADD;
+    if (!is_add && op != ASM_OP_SUB)
+        return false;
+    if (is_add && is_imm32(arg1))
+    {
+        IROperand *swap = arg1;
+        arg1 = arg2;
+        arg2 = swap;
+    }
+
+    AsmRegister target = target_register(generator, result);
+    AsmRegister base, index;
+    if (!operand_register(generator, arg1, &base) || base == target)
+        return false;
+    if (is_imm32(arg2) && arg2->data.const_value != INT32_MIN)
+    {
+        long long displacement = is_add ? arg2->data.const_value : -arg2->data.const_value;
+        emit2(generator, ASM_OP_LEA, asm_reg(target), asm_mem(base, ASM_NO_REGISTER, 1, displacement));
+    }
+    else if (is_add && operand_register(generator, arg2, &index))
+    {
+        emit2(generator, ASM_OP_LEA, asm_reg(target), asm_mem(base, index, 1, 0));
+    }
+    else
+    {
+        return false;
+    }
+    store(generator, result, target);
+    return true;
+}
+
+void codegenasm_binary_op(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg1, IROperand *arg2)
+{
+    AsmRegister target = target_register(generator, result);
+    AsmRegister held;
+
+    if (select_lea(generator, op, result, arg1, arg2))
+        return;
+
+    /* Loading arg1 into the result's register must not clobber arg2. */
+    if (target != ASM_RAX && operand_register(generator, arg2, &held) && held == target)
+    {
+        if (is_commutative(op))
+        {
+            IROperand *swap = arg1;
+            arg1 = arg2;
+            arg2 = swap;
+        }
+        else
+        {
+            target = ASM_RAX;
+        }
+    }
+
+    load(generator, target, arg1);
+    emit2(generator, op, asm_reg(target), operand_source(generator, arg2, ASM_RCX));
+    store(generator, result, target);
+}
+
+void codegenasm_shift(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg1, IROperand *arg2)
+{
+    AsmRegister target = target_register(generator, result);
+    AsmRegister held;
+    if (operand_register(generator, arg2, &held) && held == target)
+        target = ASM_RAX;
+
+    load(generator, target, arg1);
+    if (arg2 && arg2->type == IR_OP_CONST)
+    {
+        emit2(generator, op, asm_reg(target), asm_imm(arg2->data.const_value & 63));
+    }
+    else
+    {
+        load(generator, ASM_RCX, arg2);
+        emit2(generator, op, asm_reg(target), asm_reg8(ASM_RCX));
+    }
+    store(generator, result, target);
+}
+
+void codegenasm_unary_op(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg)
+{
+    AsmRegister target = target_register(generator, result);
+    load(generator, target, arg);
+    emit1(generator, op, asm_reg(target));
+    store(generator, result, target);
+}
+
+/* Multiplies by a constant with lea for 2, 3, 4, 5, 8 and 9, and with the
+   three-operand imul otherwise. */
+void codegenasm_mul(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2)
+{
+    if (is_imm32(arg1))
+    {
+        IROperand *swap = arg1;
+        arg1 = arg2;
+        arg2 = swap;
+    }
+    if (!is_imm32(arg2))
+    {
+        codegenasm_binary_op(generator, ASM_OP_IMUL, result, arg1, arg2);
+        return;
+    }
+
+    long long factor = arg2->data.const_value;
+    AsmRegister target = target_register(generator, result);
+    AsmRegister source;
+    if (operand_register(generator, arg1, &source) && (factor == 2 || factor == 3 || factor == 5 || factor == 9))
+    {
+        emit2(generator, ASM_OP_LEA, asm_reg(target), asm_mem(source, source, (int)factor - 1, 0));
+    }
+    else if (operand_register(generator, arg1, &source) && (factor == 4 || factor == 8))
+    {
+        emit2(generator, ASM_OP_LEA, asm_reg(target), asm_mem(ASM_NO_REGISTER, source, (int)factor, 0));
+    }
+    else if (is_value(arg1))
+    {
+        emit3(generator, ASM_OP_IMUL, asm_reg(target), location_of(generator, arg1), asm_imm(factor));
+    }
+    else
+    {
+        load(generator, target, arg1);
+        emit3(generator, ASM_OP_IMUL, asm_reg(target), asm_reg(target), asm_imm(factor));
+    }
+    store(generator, result, target);
+}
+
+static void codegenasm_divide(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2,
+                              AsmRegister part)
+{
+    load(generator, ASM_RAX, arg1);
+    emit0(generator, ASM_OP_CQO);
+    if (is_value(arg2))
+    {
+        emit1(generator, ASM_OP_IDIV, location_of(generator, arg2));
+    }
+    else
+    {
+        load(generator, ASM_RCX, arg2);
+        emit1(generator, ASM_OP_IDIV, asm_reg(ASM_RCX));
+    }
+    store(generator, result, part);
+}
+
+void codegenasm_div(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2)
+{
+    codegenasm_divide(generator, result, arg1, arg2, ASM_RAX);
+}
+
+void codegenasm_mod(CodeGenerator *generator, IROperand *result, IROperand *arg1, IROperand *arg2)
+{
+    codegenasm_divide(generator, result, arg1, arg2, ASM_RDX);
+}
+
+/* Computes arg1 op arg2 into xmm0, reading constants from the float pool
+   and double operands straight from memory. arg1 may already be in xmm0. */
+static DataType compute_float(CodeGenerator *generator, AsmOpcode op, IROperand *arg1, IROperand *arg2,
+                              bool arg1_loaded)
+{
+    char buffer[32];
+    DataType type = arithmetic_type(arg1, arg2);
+    AsmRegister reg;
+    AsmOperand source = asm_xmm(1);
+
+    if (!arg1_loaded)
+        load_float(generator, 0, arg1, type);
+    if (is_constant(arg2))
+        source = float_constant(generator, arg2, type, buffer, sizeof(buffer));
+    else if (type == TYPE_DOUBLE && scalar_type(arg2) == TYPE_DOUBLE && !operand_register(generator, arg2, &reg))
+        source = location_of(generator, arg2);
+    else
+        load_float(generator, 1, arg2, type);
+    emit2(generator, float_form(op, type), asm_xmm(0), source);
+    return type;
+}
+
+void codegenasm_float_binary(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg1,
+                             IROperand *arg2)
+{
+    store_float(generator, result, 0, compute_float(generator, op, arg1, arg2, false));
+}
+
+/* Flips the sign bit, which also negates zeros and NaNs. */
+void codegenasm_float_negate(CodeGenerator *generator, IROperand *result, IROperand *arg)
+{
+    DataType type = scalar_type(arg);
+    load_float(generator, 0, arg, type);
+    emit2(generator, ASM_OP_MOVQ, asm_reg(ASM_RAX), asm_xmm(0));
+    emit2(generator, ASM_OP_BTC, asm_reg(ASM_RAX), asm_imm(type == TYPE_FLOAT ? 31 : 63));
+    emit2(generator, ASM_OP_MOVQ, asm_xmm(0), asm_reg(ASM_RAX));
+    store_float(generator, result, 0, type);
+}
+
+void codegenasm_not(CodeGenerator *generator, IROperand *result, IROperand *arg)
+{
+    test_operand(generator, arg);
+    set_result(generator, ASM_CC_E, result);
+}
+
+/* && and || on values that are already evaluated: both sides are reduced
+   to 0 or 1 and combined. */
+static void codegenasm_logical(CodeGenerator *generator, AsmOpcode op, IROperand *result, IROperand *arg1,
+                               IROperand *arg2)
+{
+    test_operand(generator, arg1);
+    emit_set(generator, ASM_CC_NE, asm_reg8(ASM_RDX));
+    test_operand(generator, arg2);
+    emit_set(generator, ASM_CC_NE, asm_reg8(ASM_RAX));
+    emit2(generator, op, asm_reg8(ASM_RAX), asm_reg8(ASM_RDX));
+    emit2(generator, ASM_OP_MOVZX, asm_reg32(ASM_RAX), asm_reg8(ASM_RAX));
+    store(generator, result, ASM_RAX);
+}
+
+static bool is_const_zero(const IROperand *operand)
+{
+    return is_zero(operand) ||
+           (operand->type == IR_OP_CONST && !operand->is_float_const && operand->data.const_value == 0);
+}
+
+/* Sets the flags for arg1 compared with arg2. A register compared against
+   zero is tested against itself. */
+static void compare_operands(CodeGenerator *generator, IROperand *arg1, IROperand *arg2)
+{
+    AsmRegister left, right;
+    AsmOperand left_operand;
+
+    if (operand_register(generator, arg1, &left))
+    {
+        if (is_const_zero(arg2))
+        {
+            emit2(generator, ASM_OP_TEST, asm_reg(left), asm_reg(left));
+            return;
+        }
+        left_operand = asm_reg(left);
+    }
+    else if (is_value(arg1) && (is_imm32(arg2) || is_zero(arg2) || operand_register(generator, arg2, &right)))
+    {
+        left_operand = location_of(generator, arg1);
+    }
+    else
+    {
+        load(generator, ASM_RAX, arg1);
+        left_operand = asm_reg(ASM_RAX);
+    }
+    emit2(generator, ASM_OP_CMP, left_operand, operand_source(generator, arg2, ASM_RCX));
+}
+
+void codegenasm_compare(CodeGenerator *generator, AsmCondition condition, IROperand *result, IROperand *arg1,
+                        IROperand *arg2)
+{
+    compare_operands(generator, arg1, arg2);
+    set_result(generator, condition, result);
+}
+
+static bool is_float_comparison(const IRInstruction *instr)
+{
+    return is_float_type(arithmetic_type(instr->arg1, instr->arg2));
+}
+
+/* ucomisd sets the flags like an unsigned compare and raises all of ZF,
+   PF and CF for NaN. Less-than is tested as greater-than with the
+   operands swapped so that every ordered test reads CF, and an unordered
+   result fails it. Returns the condition code for the comparison. */
+static AsmCondition compare_floats(CodeGenerator *generator, IROpcode opcode, IROperand *arg1, IROperand *arg2)
+{
+    char buffer[32];
+    DataType type = arithmetic_type(arg1, arg2);
+    if (opcode == IR_LT || opcode == IR_LE)
+    {
+        IROperand *swap = arg1;
+        arg1 = arg2;
+        arg2 = swap;
+    }
+    load_float(generator, 0, arg1, type);
+    if (is_constant(arg2))
+    {
+        emit2(generator, float_form(ASM_OP_UCOMISD, type), asm_xmm(0),
+              float_constant(generator, arg2, type, buffer, sizeof(buffer)));
+    }
+    else
+    {
+        load_float(generator, 1, arg2, type);
+        emit2(generator, float_form(ASM_OP_UCOMISD, type), asm_xmm(0), asm_xmm(1));
+    }
+    switch (opcode)
+    {
+    case IR_EQ:
+        return ASM_CC_E;
+    case IR_NE:
+        return ASM_CC_NE;
+    case IR_LT:
+    case IR_GT:
+        return ASM_CC_A;
+    default:
+        return ASM_CC_AE;
+    }
+}
+
+/* Equality also needs PF: NaN compares unequal to everything. */
+void codegenasm_float_compare(CodeGenerator *generator, IROpcode opcode, IROperand *result, IROperand *arg1,
+                              IROperand *arg2)
+{
+    AsmRegister target = target_register(generator, result);
+    AsmCondition condition = compare_floats(generator, opcode, arg1, arg2);
+    emit_set(generator, condition, asm_reg8(target));
+    if (opcode == IR_EQ || opcode == IR_NE)
+    {
+        emit_set(generator, opcode == IR_EQ ? ASM_CC_NP : ASM_CC_P, asm_reg8(ASM_RCX));
+        emit2(generator, opcode == IR_EQ ? ASM_OP_AND : ASM_OP_OR, asm_reg8(target), asm_reg8(ASM_RCX));
+    }
+    emit2(generator, ASM_OP_MOVZX, asm_reg(target), asm_reg8(target));
+    store(generator, result, target);
+}
+
+/* Branches on a float comparison. The negated ordered tests (be, b) hold
+   for NaN, as the negated comparison does. */
+static void branch_on_float_compare(CodeGenerator *generator, IRInstruction *compare, bool jump_if_true,
+                                    const char *label)
+{
+    const char *function = generator->current_function_name;
+    char buffer[160], skip_buffer[160];
+    AsmOperand target = block_label(generator, label, buffer, sizeof(buffer));
+    AsmCondition condition = compare_floats(generator, compare->opcode, compare->arg1, compare->arg2);
+    bool equal = compare->opcode == IR_EQ || compare->opcode == IR_NE;
+    if (!equal)
+    {
+        AsmCondition negated = condition == ASM_CC_A ? ASM_CC_BE : ASM_CC_B;
+        emit_jump(generator, jump_if_true ? condition : negated, target);
+        return;
+    }
+    /* Jumps when the operands are equal and ordered, or when they are not. */
+    if ((compare->opcode == IR_EQ) == jump_if_true)
+    {
+        int skip = generator->temp_counter++;
+        emit_jump(generator, ASM_CC_P, format_symbol(skip_buffer, sizeof(skip_buffer), "%s.ordered%d", function, skip));
+        emit_jump(generator, ASM_CC_E, target);
+        emit_label(generator, "%s.ordered%d", function, skip);
+    }
+    else
+    {
+        emit_jump(generator, ASM_CC_NE, target);
+        emit_jump(generator, ASM_CC_P, target);
+    }
+}
+
+static bool is_comparison(IROpcode opcode)
+{
+    return opcode == IR_EQ || opcode == IR_NE || opcode == IR_LT || opcode == IR_LE || opcode == IR_GT ||
+           opcode == IR_GE;
+}
+
+/* Condition code suffix for a comparison, or for its negation. */
+static AsmCondition condition_code(IROpcode opcode, bool negate)
+{
+    switch (opcode)
+    {
+    case IR_EQ:
+        return negate ? ASM_CC_NE : ASM_CC_E;
+    case IR_NE:
+        return negate ? ASM_CC_E : ASM_CC_NE;
+    case IR_LT:
+        return negate ? ASM_CC_GE : ASM_CC_L;
+    case IR_LE:
+        return negate ? ASM_CC_G : ASM_CC_LE;
+    case IR_GT:
+        return negate ? ASM_CC_LE : ASM_CC_G;
+    default:
+        return negate ? ASM_CC_L : ASM_CC_GE;
+    }
+}
+
+/* Opcodes whose scalar result can be written straight to any location. */
+static bool computes_scalar(const IRInstruction *instr)
+{
+    switch (instr->opcode)
+    {
+    case IR_MOVE:
+    case IR_SUB:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_NEG:
+    case IR_NOT:
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+    case IR_AND:
+    case IR_OR:
+        return true;
+    case IR_ADD:
+    case IR_MUL:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
+    case IR_ARRAY_LOAD:
+        return instr->result->vector_width <= 0;
+    case IR_CALL:
+        return !instr->is_tail_call;
+    default:
+        return false;
+    }
+}
+
+static bool is_float_arithmetic(const IRInstruction *instr)
+{
+    bool arithmetic = instr->opcode == IR_ADD || instr->opcode == IR_SUB || instr->opcode == IR_MUL ||
+                      instr->opcode == IR_DIV;
+    return arithmetic && instr->result && instr->result->vector_width <= 0 &&
+           is_float_type(arithmetic_type(instr->arg1, instr->arg2));
+}
+
+static AsmOpcode float_opcode(IROpcode opcode)
+{
+    switch (opcode)
+    {
+    case IR_ADD:
+        return ASM_OP_ADDSD;
+    case IR_SUB:
+        return ASM_OP_SUBSD;
+    case IR_MUL:
+        return ASM_OP_MULSD;
+    default:
+        return ASM_OP_DIVSD;
+    }
+}
+
+/* A temporary defined by one instruction and read only by the next. */
+static bool feeds_next(CodeGenerator *generator, const IROperand *value, const IROperand *use)
+{
+    return value && use && value->type == IR_OP_TEMP && use->type == IR_OP_TEMP &&
+           value->data.temp_id == use->data.temp_id &&
+           asm_reference_count(generator->register_allocation, value) == 2;
+}
+
+/* Instruction selection over two-instruction trees. A comparison that
+   only feeds a branch becomes cmp and jcc without materializing the
+   boolean, float arithmetic whose result only feeds the next operation
+   stays in xmm0, and a value that is only copied into a variable is
+   computed straight into that variable's location. */
+static bool select_pair(CodeGenerator *generator, IRInstruction *instr, IRInstruction *next)
+{
+    if (!next || !instr->result)
+        return false;
+
+    if (is_comparison(instr->opcode) && (next->opcode == IR_JUMP_IF || next->opcode == IR_JUMP_IF_FALSE) &&
+        feeds_next(generator, instr->result, next->arg1))
+    {
+        if (is_float_comparison(instr))
+        {
+            branch_on_float_compare(generator, instr, next->opcode == IR_JUMP_IF, next->label);
+            return true;
+        }
+        char buffer[160];
+        compare_operands(generator, instr->arg1, instr->arg2);
+        emit_jump(generator, condition_code(instr->opcode, next->opcode == IR_JUMP_IF_FALSE),
+                  block_label(generator, next->label, buffer, sizeof(buffer)));
+        return true;
+    }
+
+    if (is_float_arithmetic(instr) && is_float_arithmetic(next) && feeds_next(generator, instr->result, next->arg1) &&
+        scalar_type(instr->result) == arithmetic_type(instr->arg1, instr->arg2) &&
+        scalar_type(instr->result) == arithmetic_type(next->arg1, next->arg2))
+    {
+        compute_float(generator, float_opcode(instr->opcode), instr->arg1, instr->arg2, false);
+        DataType type = compute_float(generator, float_opcode(next->opcode), next->arg1, next->arg2, true);
+        store_float(generator, next->result, 0, type);
+        return true;
+    }
+
+    if (next->opcode == IR_MOVE && computes_scalar(instr) && asm_operand_is_allocatable(next->result) &&
+        scalar_type(instr->result) == scalar_type(next->result) && feeds_next(generator, instr->result, next->arg1))
+    {
+        IROperand *result = instr->result;
+        instr->result = next->result;
+        codegenasm_generate_instruction(generator, instr);
+        instr->result = result;
+        return true;
+    }
+    return false;
+}
+
+static const char *call_target(const char *func_name, char *buffer, size_t size)
+{
+    if (strcmp(func_name, "concat") == 0 || strcmp(func_name, "substr") == 0 || strcmp(func_name, "strlen") == 0 ||
+        strcmp(func_name, "strcmp") == 0 || strcmp(func_name, "char_at") == 0)
+    {
+        snprintf(buffer, size, "__tl_%s", func_name);
+        return buffer;
+    }
+    return func_name;
+}
+
+/* Operand of a call or tail jump. On System V, functions the program does
+   not define are reached through the PLT so the output links as PIE. */
+static AsmOperand callee(CodeGenerator *generator, const char *func_name, char *buffer, size_t size)
+{
+    const char *name = call_target(func_name, buffer, size);
+    if (is_sysv(generator) && !program_has_function(generator, func_name))
+        return asm_plt(name);
+    return asm_symbol(name);
+}
+
+/* Calls a C library function: through the import table on Windows, through
+   the PLT on System V. */
+static void call_library(CodeGenerator *generator, const char *name)
+{
+    char buffer[64];
+    if (is_sysv(generator))
+    {
+        emit1(generator, ASM_OP_CALL, asm_plt(name));
+        return;
+    }
+    snprintf(buffer, sizeof(buffer), "__imp_%s", name);
+    emit1(generator, ASM_OP_CALL, asm_qword(asm_rel(buffer, 0)));
+}
+
+typedef enum ArgumentKind {
+    ARGUMENT_REGISTER,
+    ARGUMENT_XMM,
+    ARGUMENT_STACK
+} ArgumentKind;
+
+typedef struct ArgumentPlace {
+    ArgumentKind kind;
+    int index;
+} ArgumentPlace;
+
+#define XMM_ARGUMENT_COUNT 8
+
+/* Where each argument of the given types travels. Win64 assigns
+   registers by position, integers to rcx..r9 and floats to xmm0..xmm3;
+   variadic floats go in the integer register and are duplicated into the
+   xmm register by the caller. System V fills the integer and xmm
+   registers independently. Everything else goes on the stack above the
+   shadow space. Returns the number of xmm registers used. */
+static int place_arguments(const AsmTarget *target, const DataType *types, int count, bool variadic,
+                           ArgumentPlace *places)
+{
+    int registers = 0, xmm = 0, stack = 0;
+    for (int i = 0; i < count; i++)
+    {
+        bool is_float = is_float_type(types[i]);
+        if (target->abi == ASM_ABI_WIN64 && i < target->argument_register_count)
+        {
+            places[i].kind = is_float && !variadic ? ARGUMENT_XMM : ARGUMENT_REGISTER;
+            places[i].index = i;
+        }
+        else if (target->abi == ASM_ABI_SYSV && is_float && xmm < XMM_ARGUMENT_COUNT)
+        {
+            places[i].kind = ARGUMENT_XMM;
+            places[i].index = xmm++;
+        }
+        else if (target->abi == ASM_ABI_SYSV && !is_float && registers < target->argument_register_count)
+        {
+            places[i].kind = ARGUMENT_REGISTER;
+            places[i].index = registers++;
+        }
+        else
+        {
+            places[i].kind = ARGUMENT_STACK;
+            places[i].index = stack++;
+        }
+    }
+    return target->abi == ASM_ABI_SYSV ? xmm : 0;
+}
+
+/* The types the callee expects: its parameter types when the program
+   defines it, the arguments' own types otherwise. Variadic arguments are
+   promoted as in C, float to double. */
+static DataType *argument_types(CodeGenerator *generator, IROperand **args, int count, const char *func_name)
+{
+    DataType *types = safe_malloc((count > 0 ? count : 1) * sizeof(DataType));
+    IRFunction *func = func_name ? find_function(generator, func_name) : NULL;
+    for (int i = 0; i < count; i++)
+    {
+        types[i] = scalar_type(args[i]);
+        if (func && i < (int)func->params.size)
+            types[i] = scalar_type((IROperand *)array_get(&func->params, i));
+        else if (!func_name && types[i] == TYPE_FLOAT)
+            types[i] = TYPE_DOUBLE;
+    }
+    return types;
+}
+
+/* Loads the arguments of a call to `func_name`, or of a printf call when
+   it is NULL. Stack arguments go first while every register is free,
+   then the integer registers, whose conversions may use xmm0, and the
+   xmm registers last. Returns the number of xmm registers used. */
+static int pass_arguments(CodeGenerator *generator, IROperand **args, int count, const char *func_name)
+{
+    const AsmTarget *target = target_of(generator);
+    bool variadic = func_name == NULL;
+    DataType *types = argument_types(generator, args, count, func_name);
+    ArgumentPlace *places = safe_malloc((count > 0 ? count : 1) * sizeof(ArgumentPlace));
+    int xmm = place_arguments(target, types, count, variadic, places);
+
+    for (int i = 0; i < count; i++)
+    {
+        AsmRegister reg;
+        if (places[i].kind != ARGUMENT_STACK)
+            continue;
+        AsmOperand slot = asm_qword(asm_mem(ASM_RSP, ASM_NO_REGISTER, 1, target->shadow_space + 8 * places[i].index));
+        if (types[i] == scalar_type(args[i]) &&
+            (is_zero(args[i]) || is_imm32(args[i]) || operand_register(generator, args[i], &reg)))
+        {
+            emit2(generator, ASM_OP_MOV, slot, operand_source(generator, args[i], ASM_RAX));
+        }
+        else
+        {
+            load_as(generator, ASM_RAX, args[i], types[i]);
+            emit2(generator, ASM_OP_MOV, slot, asm_reg(ASM_RAX));
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (places[i].kind != ARGUMENT_REGISTER)
+            continue;
+        AsmRegister reg = target->argument_registers[places[i].index];
+        load_as(generator, reg, args[i], types[i]);
+        if (variadic && is_float_type(types[i]))
+            emit2(generator, ASM_OP_MOVQ, asm_xmm(places[i].index), asm_reg(reg));
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (places[i].kind == ARGUMENT_XMM)
+            load_float(generator, places[i].index, args[i], types[i]);
+    }
+    safe_free(places);
+    safe_free(types);
+    return xmm;
+}
+
+/* Float and double results come back in xmm0, everything else in rax. */
+static DataType return_type(CodeGenerator *generator, IROperand *result, const char *func_name)
+{
+    IRFunction *func = find_function(generator, func_name);
+    if (func)
+        return is_float_type(func->return_type) ? func->return_type : TYPE_INT;
+    return scalar_type(result);
+}
+
+void codegenasm_call(CodeGenerator *generator, IROperand *result, const char *func_name)
+{
+    char buffer[160];
+    pass_arguments(generator, generator->params, generator->param_count, func_name);
+    emit1(generator, ASM_OP_CALL, callee(generator, func_name, buffer, sizeof(buffer)));
+    DataType type = return_type(generator, result, func_name);
+    if (result && is_float_type(type))
+        store_float(generator, result, 0, type);
+    else
+        store(generator, result, ASM_RAX);
+    generator->param_count = 0;
+}
+
+static void write_epilogue(CodeGenerator *generator)
+{
+    RegisterAllocation *allocation = generator->register_allocation;
+    const AsmRegisterSet *registers = &target_of(generator)->registers;
+    if (generator->saved_registers > 0)
+        emit2(generator, ASM_OP_LEA, asm_reg(ASM_RSP),
+              asm_mem(ASM_RBP, ASM_NO_REGISTER, 1, -8 * generator->saved_registers));
+    else
+        emit2(generator, ASM_OP_MOV, asm_reg(ASM_RSP), asm_reg(ASM_RBP));
+    for (size_t i = registers->callee_saved_count; i-- > 0;)
+    {
+        AsmRegister reg = registers->callee_saved[i];
+        if (allocation->used[reg])
+            emit1(generator, ASM_OP_POP, asm_reg(reg));
+    }
+    emit1(generator, ASM_OP_POP, asm_reg(ASM_RBP));
+}
+
+/* Entry point of a memoized function, the counterpart of the C backend's
+   memo wrapper: looks the arguments up in the runtime's table and only
+   runs the body on a miss. The key and the result live in the frame, the
+   key at rbp - 40 and the result at rbp - 8. */
+static void write_memo_wrapper(CodeGenerator *generator, IRFunction *func)
+{
+    const AsmTarget *target = target_of(generator);
+    const char *name = func->name;
+    AsmOperand arg[3];
+    char buffer[160], table[160];
+    int count = (int)func->params.size;
+    for (int i = 0; i < 3; i++)
+    {
+        arg[i] = asm_reg(target->argument_registers[i]);
+    }
+    snprintf(table, sizeof(table), "%s__memo", name);
+    AsmOperand key = asm_mem(ASM_RBP, ASM_NO_REGISTER, 1, -40);
+    AsmOperand value = asm_mem(ASM_RBP, ASM_NO_REGISTER, 1, -8);
+
+    emit_directive(generator, "\n; Memoized entry point of %s", name);
+    emit_directive(generator, "global %s", name);
+    emit_label(generator, "%s", name);
+    emit1(generator, ASM_OP_PUSH, asm_reg(ASM_RBP));
+    emit2(generator, ASM_OP_MOV, asm_reg(ASM_RBP), asm_reg(ASM_RSP));
+    emit2(generator, ASM_OP_SUB, asm_reg(ASM_RSP), asm_imm(48 + target->shadow_space));
+    for (int i = 0; i < count; i++)
+    {
+        emit2(generator, ASM_OP_MOV, frame_slot(40 - 8 * i), asm_reg(target->argument_registers[i]));
+    }
+    emit2(generator, ASM_OP_LEA, arg[0], asm_rel(table, 0));
+    emit2(generator, ASM_OP_LEA, arg[1], key);
+    emit2(generator, ASM_OP_LEA, arg[2], value);
+    emit1(generator, ASM_OP_CALL, callee(generator, "__tl_memo_lookup", buffer, sizeof(buffer)));
+    emit2(generator, ASM_OP_TEST, asm_reg32(ASM_RAX), asm_reg32(ASM_RAX));
+    emit_jump(generator, ASM_CC_Z, format_symbol(buffer, sizeof(buffer), "%s.memo_miss", name));
+    emit2(generator, ASM_OP_MOV, asm_reg(ASM_RAX), asm_qword(value));
+    emit2(generator, ASM_OP_MOV, asm_reg(ASM_RSP), asm_reg(ASM_RBP));
+    emit1(generator, ASM_OP_POP, asm_reg(ASM_RBP));
+    emit0(generator, ASM_OP_RET);
+
+    emit_label(generator, "%s.memo_miss", name);
+    for (int i = 0; i < count; i++)
+    {
+        emit2(generator, ASM_OP_MOV, asm_reg(target->argument_registers[i]), frame_slot(40 - 8 * i));
+    }
+    emit1(generator, ASM_OP_CALL, format_symbol(buffer, sizeof(buffer), "%s__impl", name));
+    emit2(generator, ASM_OP_MOV, asm_qword(value), asm_reg(ASM_RAX));
+    emit2(generator, ASM_OP_LEA, arg[0], asm_rel(table, 0));
+    emit2(generator, ASM_OP_LEA, arg[1], key);
+    emit2(generator, ASM_OP_MOV, arg[2], asm_reg(ASM_RAX));
+    emit1(generator, ASM_OP_CALL, callee(generator, "__tl_memo_store", buffer, sizeof(buffer)));
+    emit2(generator, ASM_OP_MOV, asm_reg(ASM_RAX), asm_qword(value));
+    emit2(generator, ASM_OP_MOV, asm_reg(ASM_RSP), asm_reg(ASM_RBP));
+    emit1(generator, ASM_OP_POP, asm_reg(ASM_RBP));
+    emit0(generator, ASM_OP_RET);
+}
+
+/* The arguments all travel in registers, so the frame can be torn down
+   before jumping to the callee, which returns straight to our caller. */
+void codegenasm_tail_call(CodeGenerator *generator, const char *func_name)
+{
+    char buffer[160];
+    pass_arguments(generator, generator->params, generator->param_count, func_name);
+    write_epilogue(generator);
+    emit1(generator, ASM_OP_JMP, callee(generator, func_name, buffer, sizeof(buffer)));
+    generator->param_count = 0;
+}
+
+void codegenasm_return(CodeGenerator *generator, IROperand *value)
+{
+    DataType type = generator->current_function_return_type;
+    if (value && is_float_type(type))
+        load_float(generator, 0, value, type);
+    else
+        load_as(generator, ASM_RAX, value, TYPE_INT);
+    emit1(generator, ASM_OP_JMP, asm_symbol(generator->epilogue_label));
+}
+
+static size_t print_value_count(IRInstruction *instr)
+{
+    if (instr->args)
+        return instr->args->size;
+    return instr->arg1 ? 1 : 0;
+}
+
+static IROperand *print_value(IRInstruction *instr, size_t index)
+{
+    return instr->args ? (IROperand *)array_get(instr->args, index) : instr->arg1;
+}
+
+/* The printf format for a print instruction, one conversion per value. */
+static char *print_format(IRInstruction *instr)
+{
+    size_t count = print_value_count(instr);
+    char *format = safe_malloc(count * 4 + 2);
+    format[0] = '\0';
+    for (size_t i = 0; i < count; i++)
+    {
+        IROperand *value = print_value(instr, i);
+        if (value->data_type == TYPE_STRING || value->type == IR_OP_STRING_CONST)
+            strcat(format, "%s");
+        else if (is_float_scalar(value))
+            strcat(format, "%f");
+        else
+            strcat(format, "%lld");
+    }
+    strcat(format, "\n");
+    return format;
+}
+
+void codegenasm_print(CodeGenerator *generator, IRInstruction *instr)
+{
+    size_t count = print_value_count(instr);
+    IROperand format = {0};
+    format.type = IR_OP_STRING_CONST;
+    format.data.string_const_value = print_format(instr);
+
+    IROperand **args = safe_malloc((count + 1) * sizeof(IROperand *));
+    args[0] = &format;
+    for (size_t i = 0; i < count; i++)
+    {
+        args[i + 1] = print_value(instr, i);
+    }
+    int xmm = pass_arguments(generator, args, (int)count + 1, NULL);
+    /* System V variadic calls take the number of xmm arguments in al. */
+    if (is_sysv(generator))
+        emit2(generator, ASM_OP_MOV, asm_reg32(ASM_RAX), asm_imm(xmm));
+    call_library(generator, "printf");
+
+    safe_free(args);
+    safe_free(format.data.string_const_value);
+}
+
+static bool has_memoized_function(CodeGenerator *generator)
+{
+    for (size_t i = 0; i < generator->ir_program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&generator->ir_program->functions, i);
+        if (func->memoize)
+            return true;
+    }
+    return false;
+}
+
+static void declare_extern(CodeGenerator *generator, const char *name)
+{
+    if (hashtable_contains(generator->declared_temps, name))
+        return;
+    hashtable_put(generator->declared_temps, name, (void *)1);
+    code_buffer_printf(generator->output, "extern %s\n", name);
+}
+
+void codegenasm_write_header(CodeGenerator *generator)
+{
+    if (debug_enabled)
+    {
+        printf("[DEBUG] Wrote header\n");
+        fflush(stdout);
+    }
+    CodeBuffer *out = generator->output;
+    bool profiling = generator->ir_program->profile_counters.size > 0;
+    code_buffer_puts(out, "; Generated assembly code for .tl language\n");
+    code_buffer_printf(out, "; Target: %s\n\n", target_of(generator)->description);
+    if (is_sysv(generator))
+    {
+        code_buffer_puts(out, "default rel\n");
+        code_buffer_puts(out, "extern printf\n");
+        if (profiling)
+        {
+            code_buffer_puts(out, "extern fopen\n");
+            code_buffer_puts(out, "extern fprintf\n");
+            code_buffer_puts(out, "extern fclose\n");
+        }
     }
     else
     {
-        fprintf(generator->output_file, "    cmp rax, qword [rel %s]\n", arg2_name);
+        code_buffer_puts(out, "extern __imp_printf\n");
+        if (profiling)
+        {
+            code_buffer_puts(out, "extern __imp_fopen\n");
+            code_buffer_puts(out, "extern __imp_fprintf\n");
+            code_buffer_puts(out, "extern __imp_fclose\n");
+        }
+        code_buffer_puts(out, "extern __imp_ExitProcess\n");
+    }
+
+    if (has_memoized_function(generator))
+    {
+        declare_extern(generator, "__tl_memo_lookup");
+        declare_extern(generator, "__tl_memo_store");
+    }
+
+    char buffer[128];
+    for (size_t i = 0; i < generator->ir_program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&generator->ir_program->functions, i);
+        for (size_t j = 0; j < func->instructions.size; j++)
+        {
+            IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, j);
+            if (instr->opcode == IR_CALL && instr->label && !program_has_function(generator, instr->label))
+                declare_extern(generator, call_target(instr->label, buffer, sizeof(buffer)));
+        }
+    }
+    if (is_sysv(generator))
+        code_buffer_puts(out, "section .note.GNU-stack noalloc noexec nowrite progbits\n");
+    code_buffer_putc(out, '\n');
+}
+
+static void write_asm_string(CodeBuffer *out, const char *label, const char *text)
+{
+    code_buffer_printf(out, "%s: db ", label);
+    for (const char *c = text; *c; c++)
+    {
+        code_buffer_printf(out, "%d, ", (unsigned char)*c);
     }
-    fprintf(generator->output_file, "    %s al\n", set_op);
-    fprintf(generator->output_file, "    movzx rax, al\n");
-    fprintf(generator->output_file, "    mov qword [rel %s], rax\n", result_name);
+    code_buffer_puts(out, "0\n");
 }
 
-void codegenasm_call(CodeGenerator *generator, IROperand *result, const char *func_name)
+static void intern_string(CodeGenerator *generator, const char *text)
+{
+    if (hashtable_contains(generator->string_labels, text))
+        return;
+    size_t index = generator->string_labels->size;
+    hashtable_put(generator->string_labels, text, (void *)(intptr_t)(index + 1));
+
+    char label[32];
+    snprintf(label, sizeof(label), "str_%zu", index);
+    write_asm_string(generator->output, label, text);
+}
+
+static void intern_operand(CodeGenerator *generator, const IROperand *operand)
+{
+    if (operand && operand->type == IR_OP_STRING_CONST)
+        intern_string(generator, operand->data.string_const_value);
+}
+
+/* One zeroed TLMemoTable per memoized function; the runtime allocates
+   the entries on the first store. */
+static void write_memo_tables(CodeGenerator *generator)
+{
+    for (size_t i = 0; i < generator->ir_program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&generator->ir_program->functions, i);
+        if (func->memoize)
+            code_buffer_printf(generator->output, "%s__memo: dq %zu, 0, 0, 0, 0, 0\n", func->name, func->params.size);
+    }
+}
+
+static void write_profile_data(CodeGenerator *generator)
 {
-    fprintf(generator->output_file, "    sub rsp, 40\n");
-    const char *regs[] = {"rcx", "rdx", "r8", "r9"};
-    for (int i = 0; i < generator->param_count && i < 4; i++)
+    DynamicArray *counters = &generator->ir_program->profile_counters;
+    CodeBuffer *out = generator->output;
+    char label[64];
+
+    code_buffer_printf(out, "__tl_profile_counters: times %zu dq 0\n", counters->size);
+    code_buffer_puts(out, "__tl_profile_names:\n");
+    for (size_t i = 0; i < counters->size; i++)
     {
-        fprintf(generator->output_file, "    mov %s, qword [rel %s]\n",
-                regs[i], codegenasm_get_operand_name(generator, generator->params[i]));
+        code_buffer_printf(out, "    dq __tl_profile_name_%zu\n", i);
     }
-    fprintf(generator->output_file, "    call %s\n", func_name);
-    fprintf(generator->output_file, "    add rsp, 40\n");
-    if (result)
+    for (size_t i = 0; i < counters->size; i++)
     {
-        fprintf(generator->output_file, "    mov qword [rel %s], rax\n",
-                codegenasm_get_operand_name(generator, result));
+        snprintf(label, sizeof(label), "__tl_profile_name_%zu", i);
+        write_asm_string(out, label, (const char *)array_get(counters, i));
     }
-    generator->param_count = 0;
+    write_asm_string(out, "__tl_profile_path", generator->ir_program->profile_path);
+    code_buffer_puts(out, "__tl_profile_mode: db \"a\", 0\n");
+    code_buffer_puts(out, "__tl_profile_header: db \"# tlprof 1\", 10, 0\n");
+    code_buffer_puts(out, "__tl_profile_format: db \"%llu %s\", 10, 0\n");
 }
 
-void codegenasm_print(CodeGenerator *generator, IROperand *value)
+/* Appends every counter to the profile file once main has returned; the
+   compiler adds up repeated entries when reading it. */
+void codegenasm_write_profile_dump(CodeGenerator *generator)
 {
-    fprintf(generator->output_file, "    sub rsp, 40\n");
-    fprintf(generator->output_file, "    lea rcx, [rel format_int]\n");
-    char *value_name = codegenasm_get_operand_name(generator, value);
-    if (is_param_register(value_name))
+    const AsmTarget *target = target_of(generator);
+    AsmOperand arg[4];
+    for (int i = 0; i < 4; i++)
     {
-        fprintf(generator->output_file, "    mov rdx, %s\n", value_name);
+        arg[i] = asm_reg(target->argument_registers[i]);
     }
-    else
+    AsmOperand counter = asm_qword(asm_mem(ASM_RAX, ASM_RBX, 8, 0));
+
+    begin_code(generator);
+    emit_label(generator, "__tl_profile_dump");
+    emit1(generator, ASM_OP_PUSH, asm_reg(ASM_RBX));
+    emit1(generator, ASM_OP_PUSH, asm_reg(ASM_R12));
+    emit2(generator, ASM_OP_SUB, asm_reg(ASM_RSP), asm_imm(target->shadow_space + 8));
+    emit2(generator, ASM_OP_LEA, arg[0], asm_rel("__tl_profile_path", 0));
+    emit2(generator, ASM_OP_LEA, arg[1], asm_rel("__tl_profile_mode", 0));
+    call_library(generator, "fopen");
+    emit2(generator, ASM_OP_TEST, asm_reg(ASM_RAX), asm_reg(ASM_RAX));
+    emit_jump(generator, ASM_CC_Z, asm_symbol("__tl_profile_dump_done"));
+    emit2(generator, ASM_OP_MOV, asm_reg(ASM_R12), asm_reg(ASM_RAX));
+    emit2(generator, ASM_OP_MOV, arg[0], asm_reg(ASM_R12));
+    emit2(generator, ASM_OP_LEA, arg[1], asm_rel("__tl_profile_header", 0));
+    if (is_sysv(generator))
+        emit2(generator, ASM_OP_XOR, asm_reg32(ASM_RAX), asm_reg32(ASM_RAX));
+    call_library(generator, "fprintf");
+    emit2(generator, ASM_OP_XOR, asm_reg32(ASM_RBX), asm_reg32(ASM_RBX));
+    emit_label(generator, "__tl_profile_dump_loop");
+    emit2(generator, ASM_OP_CMP, asm_reg(ASM_RBX), asm_imm((long long)generator->ir_program->profile_counters.size));
+    emit_jump(generator, ASM_CC_AE, asm_symbol("__tl_profile_dump_close"));
+    emit2(generator, ASM_OP_MOV, arg[0], asm_reg(ASM_R12));
+    emit2(generator, ASM_OP_LEA, arg[1], asm_rel("__tl_profile_format", 0));
+    emit2(generator, ASM_OP_LEA, asm_reg(ASM_RAX), asm_rel("__tl_profile_counters", 0));
+    emit2(generator, ASM_OP_MOV, arg[2], counter);
+    emit2(generator, ASM_OP_LEA, asm_reg(ASM_RAX), asm_rel("__tl_profile_names", 0));
+    emit2(generator, ASM_OP_MOV, arg[3], counter);
+    if (is_sysv(generator))
+        emit2(generator, ASM_OP_XOR, asm_reg32(ASM_RAX), asm_reg32(ASM_RAX));
+    call_library(generator, "fprintf");
+    emit1(generator, ASM_OP_INC, asm_reg(ASM_RBX));
+    emit1(generator, ASM_OP_JMP, asm_symbol("__tl_profile_dump_loop"));
+    emit_label(generator, "__tl_profile_dump_close");
+    emit2(generator, ASM_OP_MOV, arg[0], asm_reg(ASM_R12));
+    call_library(generator, "fclose");
+    emit_label(generator, "__tl_profile_dump_done");
+    emit2(generator, ASM_OP_ADD, asm_reg(ASM_RSP), asm_imm(target->shadow_space + 8));
+    emit1(generator, ASM_OP_POP, asm_reg(ASM_R12));
+    emit1(generator, ASM_OP_POP, asm_reg(ASM_RBX));
+    emit0(generator, ASM_OP_RET);
+    emit_directive(generator, "");
+    end_code(generator);
+}
+
+static bool needs_storage(const IRInstruction *instr, const IROperand *operand)
+{
+    if (!is_value(operand) || asm_operand_is_vector(operand))
+        return false;
+    if (!asm_operand_is_allocatable(operand))
+        return true;
+    if ((instr->opcode == IR_ARRAY_LOAD || instr->opcode == IR_ARRAY_STORE) && operand == instr->arg1)
+        return true;
+    return (instr->opcode == IR_ARRAY_DECL || instr->opcode == IR_ARRAY_INIT) && operand == instr->result;
+}
+
+static int storage_qwords(const IROperand *operand)
+{
+    return operand->array_size > 0 ? operand->array_size : 1;
+}
+
+static void record_type(HashTable *types, const IROperand *variable)
+{
+    if (variable && variable->type == IR_OP_VAR)
+        hashtable_put(types, variable->data.var_name, (void *)(intptr_t)(variable->data_type + 1));
+}
+
+static void apply_type(HashTable *types, IROperand *operand)
+{
+    if (!operand || operand->type != IR_OP_VAR || operand->vector_width > 0)
+        return;
+    intptr_t type = (intptr_t)hashtable_get(types, operand->data.var_name);
+    if (type)
+        operand->data_type = (DataType)(type - 1);
+}
+
+/* Gives every use of a variable the type it was declared with. Operands
+   that name an array carry no element type of their own, and a
+   variable's uses may have been typed from another scope's symbol of the
+   same name; the representation of floats depends on getting it right. */
+static void resolve_variable_types(CodeGenerator *generator, IRFunction *func)
+{
+    hashtable_destroy(generator->variable_types);
+    generator->variable_types = hashtable_create(16);
+    HashTable *types = generator->variable_types;
+    for (size_t i = 0; i < func->params.size; i++)
+    {
+        record_type(types, (IROperand *)array_get(&func->params, i));
+    }
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (instr->opcode == IR_VAR_DECL || instr->opcode == IR_ARRAY_DECL || instr->opcode == IR_ARRAY_INIT)
+            record_type(types, instr->result);
+    }
+    for (size_t i = 0; i < func->instructions.size; i++)
     {
-        fprintf(generator->output_file, "    mov rdx, qword [rel %s]\n", value_name);
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        apply_type(types, instr->result);
+        apply_type(types, instr->arg1);
+        apply_type(types, instr->arg2);
+        for (size_t k = 0; instr->args && k < instr->args->size; k++)
+        {
+            apply_type(types, (IROperand *)array_get(instr->args, k));
+        }
     }
-    fprintf(generator->output_file, "    mov rax, qword [rel __imp_printf]\n");
-    fprintf(generator->output_file, "    call rax\n");
-    fprintf(generator->output_file, "    add rsp, 40\n");
 }
 
-void codegenasm_write_header(CodeGenerator *generator)
+/* Places the values of a function that stay in memory one after another,
+   each sized for its largest use. Records where each one ends, counted in
+   qwords from the top of the locals area, and returns the area's size. */
+static int layout_locals(CodeGenerator *generator, IRFunction *func)
 {
-    if (debug_enabled)
+    HashTable *sizes = hashtable_create(16);
+    DynamicArray names;
+    array_init(&names, 8);
+    char name[256];
+
+    for (size_t j = 0; j < func->instructions.size; j++)
     {
-        printf("[DEBUG] Wrote header\n");
-        fflush(stdout);
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, j);
+        IROperand *operands[3] = {instr->result, instr->arg1, instr->arg2};
+        for (int k = 0; k < 3; k++)
+        {
+            if (!needs_storage(instr, operands[k]))
+                continue;
+            storage_name(operands[k], name, sizeof(name));
+            intptr_t size = (intptr_t)hashtable_get(sizes, name);
+            if (size == 0)
+                array_push(&names, string_copy(name));
+            if (storage_qwords(operands[k]) > size)
+                hashtable_put(sizes, name, (void *)(intptr_t)storage_qwords(operands[k]));
+        }
+    }
+
+    hashtable_destroy(generator->local_offsets);
+    generator->local_offsets = hashtable_create(16);
+    int used = 0;
+    for (size_t i = 0; i < names.size; i++)
+    {
+        char *local = (char *)array_get(&names, i);
+        used += (int)(intptr_t)hashtable_get(sizes, local);
+        hashtable_put(generator->local_offsets, local, (void *)(intptr_t)used);
+        safe_free(local);
     }
-    fprintf(generator->output_file, "; Generated assembly code for .tl language\n");
-    fprintf(generator->output_file, "; Target: x86-64 Windows\n\n");
-    fprintf(generator->output_file, "extern __imp_printf\n");
-    fprintf(generator->output_file, "extern __imp_ExitProcess\n\n");
+    array_free(&names);
+    hashtable_destroy(sizes);
+    return used;
 }
 
 void codegenasm_write_data_section(CodeGenerator *generator)
@@ -587,216 +2291,39 @@ void codegenasm_write_data_section(CodeGenerator *generator)
         printf("[DEBUG] Entered codegenasm_write_data_section\n");
         fflush(stdout);
     }
-    fprintf(generator->output_file, "section .data\n");
-    fprintf(generator->output_file, "format_int: db \"%%ld\", 10, 0\n");
-
-    fprintf(generator->output_file, "const_0: dq 0\n");
-    fprintf(generator->output_file, "const_1: dq 1\n");
-    fprintf(generator->output_file, "const_2: dq 2\n");
-    fprintf(generator->output_file, "const_4: dq 4\n");
-    fprintf(generator->output_file, "const_5: dq 5\n");
-    fprintf(generator->output_file, "const_6: dq 6\n");
-    fprintf(generator->output_file, "const_10: dq 10\n");
-    fprintf(generator->output_file, "const_15: dq 15\n");
-    fprintf(generator->output_file, "const_17: dq 17\n");
-    fprintf(generator->output_file, "const_18: dq 18\n");
-    fprintf(generator->output_file, "const_42: dq 42\n");
-    fprintf(generator->output_file, "const_48: dq 48\n");
-
-    if (debug_enabled)
+    bool memoizing = has_memoized_function(generator);
+    if (generator->ir_program->profile_counters.size > 0 || memoizing)
     {
-        printf("[DEBUG] Wrote format_int\n");
-        fflush(stdout);
+        code_buffer_puts(generator->output, "section .data\n");
+        if (memoizing)
+            write_memo_tables(generator);
+        if (generator->ir_program->profile_counters.size > 0)
+            write_profile_data(generator);
     }
+    code_buffer_printf(generator->output, "section %s\n", read_only_section(generator));
 
     for (size_t i = 0; i < generator->ir_program->functions.size; i++)
     {
         IRFunction *func = (IRFunction *)array_get(&generator->ir_program->functions, i);
-        if (debug_enabled)
-        {
-            printf("[DEBUG] Processing function %s for data section\n", func->name);
-            fflush(stdout);
-        }
-        if (debug_enabled)
-        {
-            printf("[DEBUG] Function %s has %zu instructions\n", func->name, func->instructions.size);
-            fflush(stdout);
-        }
-        generator->current_function_name = func->name;
-        fprintf(generator->output_file, "%s_param: dq 0\n", func->name);
         for (size_t j = 0; j < func->instructions.size; j++)
         {
-            if (debug_enabled)
-            {
-                printf("[DEBUG] Processing instruction %zu in function %s\n", j, func->name);
-                fflush(stdout);
-            }
             IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, j);
-            if (debug_enabled)
-            {
-                printf("[DEBUG] Instruction opcode: %s\n", ir_opcode_to_string(instr->opcode));
-                fflush(stdout);
-            }
-            if (instr->result && instr->result->type == IR_OP_TEMP)
-            {
-                if (debug_enabled)
-                {
-                    printf("[DEBUG] Processing result temp\n");
-                    fflush(stdout);
-                }
-                char *temp_name = codegenasm_get_temp_name(generator, instr->result);
-                if (!hashtable_get(generator->declared_temps, temp_name))
-                {
-                    fprintf(generator->output_file, "%s: dq 0\n", temp_name);
-                    hashtable_put(generator->declared_temps, temp_name, (void *)1);
-                    if (debug_enabled)
-                    {
-                        printf("[DEBUG] Declared temp: %s\n", temp_name);
-                        fflush(stdout);
-                    }
-                }
-                else
-                {
-                    if (debug_enabled)
-                    {
-                        printf("[DEBUG] Temp already declared: %s\n", temp_name);
-                        fflush(stdout);
-                    }
-                }
-            }
-            if (instr->result && instr->result->type == IR_OP_VAR)
-            {
-                char *var_name = instr->result->data.var_name;
-                bool is_param = false;
-                for (size_t k = 0; k < func->params.size; k++)
-                {
-                    IROperand *param = (IROperand *)array_get(&func->params, k);
-                    if (string_equal(var_name, param->data.var_name))
-                    {
-                        is_param = true;
-                        break;
-                    }
-                }
-                if (!is_param && !hashtable_get(generator->declared_temps, var_name))
-                {
-                    fprintf(generator->output_file, "%s: dq 0\n", var_name);
-                    hashtable_put(generator->declared_temps, var_name, (void *)1);
-                    if (debug_enabled)
-                    {
-                        printf("[DEBUG] Declared var: %s\n", var_name);
-                        fflush(stdout);
-                    }
-                }
-            }
-            if (instr->arg1 && instr->arg1->type == IR_OP_TEMP)
-            {
-                if (debug_enabled)
-                {
-                    printf("[DEBUG] Processing arg1 temp\n");
-                    fflush(stdout);
-                }
-                char *temp_name = codegenasm_get_temp_name(generator, instr->arg1);
-                if (!hashtable_get(generator->declared_temps, temp_name))
-                {
-                    fprintf(generator->output_file, "%s: dq 0\n", temp_name);
-                    hashtable_put(generator->declared_temps, temp_name, (void *)1);
-                    if (debug_enabled)
-                    {
-                        printf("[DEBUG] Declared temp: %s\n", temp_name);
-                        fflush(stdout);
-                    }
-                }
-                else
-                {
-                    if (debug_enabled)
-                    {
-                        printf("[DEBUG] Temp already declared: %s\n", temp_name);
-                        fflush(stdout);
-                    }
-                }
-            }
-            if (instr->arg1 && instr->arg1->type == IR_OP_VAR)
-            {
-                char *var_name = instr->arg1->data.var_name;
-                bool is_param = false;
-                for (size_t k = 0; k < func->params.size; k++)
-                {
-                    IROperand *param = (IROperand *)array_get(&func->params, k);
-                    if (string_equal(var_name, param->data.var_name))
-                    {
-                        is_param = true;
-                        break;
-                    }
-                }
-                if (!is_param && !hashtable_get(generator->declared_temps, var_name))
-                {
-                    fprintf(generator->output_file, "%s: dq 0\n", var_name);
-                    hashtable_put(generator->declared_temps, var_name, (void *)1);
-                    if (debug_enabled)
-                    {
-                        printf("[DEBUG] Declared var: %s\n", var_name);
-                        fflush(stdout);
-                    }
-                }
-            }
-            if (instr->arg2 && instr->arg2->type == IR_OP_TEMP)
-            {
-                if (debug_enabled)
-                {
-                    printf("[DEBUG] Processing arg2 temp\n");
-                    fflush(stdout);
-                }
-                char *temp_name = codegenasm_get_temp_name(generator, instr->arg2);
-                if (!hashtable_get(generator->declared_temps, temp_name))
-                {
-                    fprintf(generator->output_file, "%s: dq 0\n", temp_name);
-                    hashtable_put(generator->declared_temps, temp_name, (void *)1);
-                    if (debug_enabled)
-                    {
-                        printf("[DEBUG] Declared temp: %s\n", temp_name);
-                        fflush(stdout);
-                    }
-                }
-                else
-                {
-                    if (debug_enabled)
-                    {
-                        printf("[DEBUG] Temp already declared: %s\n", temp_name);
-                        fflush(stdout);
-                    }
-                }
-            }
-            if (instr->arg2 && instr->arg2->type == IR_OP_VAR)
+            intern_operand(generator, instr->result);
+            intern_operand(generator, instr->arg1);
+            intern_operand(generator, instr->arg2);
+            if (instr->opcode == IR_PRINT || instr->opcode == IR_PRINT_MULTIPLE)
             {
-                char *var_name = instr->arg2->data.var_name;
-                bool is_param = false;
-                for (size_t k = 0; k < func->params.size; k++)
-                {
-                    IROperand *param = (IROperand *)array_get(&func->params, k);
-                    if (string_equal(var_name, param->data.var_name))
-                    {
-                        is_param = true;
-                        break;
-                    }
-                }
-                if (!is_param && !hashtable_get(generator->declared_temps, var_name))
+                for (size_t k = 0; instr->args && k < instr->args->size; k++)
                 {
-                    fprintf(generator->output_file, "%s: dq 0\n", var_name);
-                    hashtable_put(generator->declared_temps, var_name, (void *)1);
-                    if (debug_enabled)
-                    {
-                        printf("[DEBUG] Declared var: %s\n", var_name);
-                        fflush(stdout);
-                    }
+                    intern_operand(generator, (IROperand *)array_get(instr->args, k));
                 }
+                char *format = print_format(instr);
+                intern_string(generator, format);
+                safe_free(format);
             }
         }
-        if (debug_enabled)
-        {
-            printf("[DEBUG] Finished processing function %s\n", func->name);
-            fflush(stdout);
-        }
     }
+
     if (debug_enabled)
     {
         printf("[DEBUG] Exiting codegenasm_write_data_section\n");
@@ -811,145 +2338,275 @@ void codegenasm_write_text_section(CodeGenerator *generator)
         printf("[DEBUG] Wrote data section\n");
         fflush(stdout);
     }
-    fprintf(generator->output_file, "\nsection .text\n");
-    fprintf(generator->output_file, "global _start\n\n");
+    CodeBuffer *out = generator->output;
+    bool profiling = generator->ir_program->profile_counters.size > 0;
+    if (is_sysv(generator))
+    {
+        /* The C runtime calls main; the profile is written from the
+           program's finalizers. */
+        if (profiling)
+        {
+            code_buffer_puts(out, "\nsection .fini_array\n");
+            code_buffer_puts(out, "    dq __tl_profile_dump\n");
+        }
+        code_buffer_puts(out, "\nsection .text\n\n");
+    }
+    else
+    {
+        code_buffer_puts(out, "\nsection .text\n");
+        code_buffer_puts(out, "global _start\n\n");
+
+        /* The entry point is reached with the stack 8 bytes off alignment;
+           reserving shadow space plus 8 realigns it for the calls below. */
+        begin_code(generator);
+        emit_label(generator, "_start");
+        emit2(generator, ASM_OP_SUB, asm_reg(ASM_RSP), asm_imm(40));
+        emit1(generator, ASM_OP_CALL, asm_symbol("main"));
+        if (profiling)
+        {
+            emit2(generator, ASM_OP_MOV, asm_reg(ASM_RBX), asm_reg(ASM_RAX));
+            emit1(generator, ASM_OP_CALL, asm_symbol("__tl_profile_dump"));
+            emit2(generator, ASM_OP_MOV, asm_reg(ASM_RAX), asm_reg(ASM_RBX));
+        }
+        emit2(generator, ASM_OP_MOV, asm_reg(ASM_RCX), asm_reg(ASM_RAX));
+        call_library(generator, "ExitProcess");
+        emit_directive(generator, "");
+        end_code(generator);
+    }
 
-    fprintf(generator->output_file, "_start:\n");
-    fprintf(generator->output_file, "    call main\n");
-    fprintf(generator->output_file, "    mov rcx, rax\n");
-    fprintf(generator->output_file, "    mov rax, qword [rel __imp_ExitProcess]\n");
-    fprintf(generator->output_file, "    jmp rax\n\n");
+    if (profiling)
+    {
+        codegenasm_write_profile_dump(generator);
+    }
 }
 
-void codegenasm_write_function_header(CodeGenerator *generator, IRFunction *func)
+static bool is_call(const IRInstruction *instr)
 {
-    fprintf(generator->output_file, "\n; Function: %s\n", func->name);
-    fprintf(generator->output_file, "%s:\n", func->name);
-
-    // Stack alignment for x64 Windows calling convention
-    // Reserve 32 bytes of shadow space + align stack to 16-byte boundary
-    fprintf(generator->output_file, "    sub rsp, 40\n");
-
-    fprintf(generator->output_file, "    push rbx\n");
-    fprintf(generator->output_file, "    push rsi\n");
-    fprintf(generator->output_file, "    push rdi\n");
-    fprintf(generator->output_file, "    push r12\n");
-    fprintf(generator->output_file, "    push r13\n");
-    fprintf(generator->output_file, "    push r14\n");
-    fprintf(generator->output_file, "    push r15\n");
-    fprintf(generator->output_file, "    mov rbx, qword [rel %s_param]\n", func->name);
-    fprintf(generator->output_file, "    mov qword [rel %s_param], rcx\n", func->name);
+    return instr->opcode == IR_CALL || instr->opcode == IR_PRINT || instr->opcode == IR_PRINT_MULTIPLE;
 }
 
-void codegenasm_write_function_footer(CodeGenerator *generator)
+/* Bytes needed at the bottom of the frame for outgoing calls: the shadow
+   space plus any arguments that do not fit in registers. */
+static int outgoing_area_size(const AsmTarget *target, IRFunction *func)
 {
-    fprintf(generator->output_file, "    mov qword [rel %s_param], rbx\n", generator->current_function_name);
-    fprintf(generator->output_file, "    pop r15\n");
-    fprintf(generator->output_file, "    pop r14\n");
-    fprintf(generator->output_file, "    pop r13\n");
-    fprintf(generator->output_file, "    pop r12\n");
-    fprintf(generator->output_file, "    pop rdi\n");
-    fprintf(generator->output_file, "    pop rsi\n");
-    fprintf(generator->output_file, "    pop rbx\n");
-
-    fprintf(generator->output_file, "    add rsp, 40\n");
-    fprintf(generator->output_file, "    ret\n");
+    int size = 0;
+    int params = 0;
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (instr->opcode == IR_PARAM)
+            params++;
+        if (!is_call(instr))
+            continue;
+        int args = instr->opcode == IR_CALL ? params : (int)print_value_count(instr) + 1;
+        int stack_args = args > target->argument_register_count ? args - target->argument_register_count : 0;
+        if (target->shadow_space + 8 * stack_args > size)
+            size = target->shadow_space + 8 * stack_args;
+        if (instr->opcode == IR_CALL)
+            params = 0;
+    }
+    return size;
 }
 
-void codegenasm_write_main_function(CodeGenerator *generator)
+static bool is_leaf(IRFunction *func)
 {
-    fprintf(generator->output_file, "\n; Main function\n");
-    fprintf(generator->output_file, "_start:\n");
-    fprintf(generator->output_file, "    call main\n");
-    fprintf(generator->output_file, "    mov rcx, rax\n");
-    fprintf(generator->output_file, "    mov rax, qword [rel __imp_ExitProcess]\n");
-    fprintf(generator->output_file, "    jmp rax\n");
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        if (is_call((IRInstruction *)array_get(&func->instructions, i)))
+            return false;
+    }
+    return true;
 }
 
-void codegenasm_error(CodeGenerator *generator, const char *message)
+/* Windows commits the stack one guard page at a time, so a frame larger
+   than a page is touched from the top down as it is allocated. */
+static void allocate_frame(CodeGenerator *generator, int frame_size)
 {
-    if (generator->error)
+    const int page = 4096;
+    char buffer[160];
+    if (is_sysv(generator) || frame_size <= page)
     {
-        error_set(generator->error, ERROR_CODEGEN, message, 0, 0);
+        emit2(generator, ASM_OP_SUB, asm_reg(ASM_RSP), asm_imm(frame_size));
+        return;
     }
+    emit2(generator, ASM_OP_MOV, asm_reg(ASM_RAX), asm_imm(frame_size / page));
+    emit_label(generator, "%s.probe", generator->current_function_name);
+    emit2(generator, ASM_OP_SUB, asm_reg(ASM_RSP), asm_imm(page));
+    emit2(generator, ASM_OP_TEST, asm_qword(asm_mem(ASM_RSP, ASM_NO_REGISTER, 1, 0)), asm_reg(ASM_RSP));
+    emit1(generator, ASM_OP_DEC, asm_reg(ASM_RAX));
+    emit_jump(generator, ASM_CC_NZ,
+              format_symbol(buffer, sizeof(buffer), "%s.probe", generator->current_function_name));
+    if (frame_size % page != 0)
+        emit2(generator, ASM_OP_SUB, asm_reg(ASM_RSP), asm_imm(frame_size % page));
 }
 
-void codegenasm_array_load(CodeGenerator *generator, IROperand *result, IROperand *array, IROperand *index)
+/* Frame layout, from rbp down: the callee-saved registers the allocator
+   used, the spill slots for scalars and then vectors, the arrays, then the
+   outgoing argument area at rsp. Leaf functions keep small frames in the red zone
+   without moving rsp. */
+void codegenasm_write_function_header(CodeGenerator *generator, IRFunction *func)
 {
-    char *array_name = codegenasm_get_operand_name(generator, array);
-    char *index_name = codegenasm_get_operand_name(generator, index);
-    char *result_name = codegenasm_get_operand_name(generator, result);
+    const AsmTarget *target = target_of(generator);
+    resolve_variable_types(generator, func);
+    RegisterAllocation *allocation = asm_allocate_registers(func, &target->registers);
+    generator->register_allocation = allocation;
+    generator->saved_registers = 0;
+
+    const char *name = generator->current_function_name;
+    emit_directive(generator, "\n; Function: %s", name);
+    if (!func->memoize)
+        emit_directive(generator, "global %s", name);
+    emit_label(generator, "%s", name);
+    emit1(generator, ASM_OP_PUSH, asm_reg(ASM_RBP));
+    emit2(generator, ASM_OP_MOV, asm_reg(ASM_RBP), asm_reg(ASM_RSP));
+    for (size_t i = 0; i < target->registers.callee_saved_count; i++)
+    {
+        AsmRegister reg = target->registers.callee_saved[i];
+        if (allocation->used[reg])
+        {
+            emit1(generator, ASM_OP_PUSH, asm_reg(reg));
+            generator->saved_registers++;
+        }
+    }
 
-    fprintf(generator->output_file, "    lea rax, [rel %s]\n", array_name);
-    if (is_param_register(index_name))
+    int locals_size = 8 * (allocation->spill_slots + layout_locals(generator, func));
+    int frame_size = locals_size + outgoing_area_size(target, func);
+    if ((frame_size + 8 * generator->saved_registers) % 16 != 0)
+        frame_size += 8;
+    if (frame_size > 0 && !(is_leaf(func) && locals_size <= target->red_zone))
+        allocate_frame(generator, frame_size);
+
+    int count = (int)func->params.size;
+    DataType *types = safe_malloc((count > 0 ? count : 1) * sizeof(DataType));
+    ArgumentPlace *places = safe_malloc((count > 0 ? count : 1) * sizeof(ArgumentPlace));
+    for (int i = 0; i < count; i++)
     {
-        fprintf(generator->output_file, "    mov rcx, %s\n", index_name);
+        types[i] = scalar_type((IROperand *)array_get(&func->params, i));
     }
-    else
+    place_arguments(target, types, count, false, places);
+    for (int i = 0; i < count; i++)
     {
-        fprintf(generator->output_file, "    mov rcx, qword [rel %s]\n", index_name);
+        IROperand *param = (IROperand *)array_get(&func->params, i);
+        const AsmLocation *location = asm_location_of(allocation, param);
+        if (!location)
+            continue;
+        AsmOperand dest = location_of(generator, param);
+        /* Stack arguments sit above the return address and the caller's
+           shadow space. */
+        AsmOperand incoming = frame_slot(-(16 + target->shadow_space + 8 * places[i].index));
+        if (places[i].kind == ARGUMENT_REGISTER)
+        {
+            emit2(generator, ASM_OP_MOV, dest, asm_reg(target->argument_registers[places[i].index]));
+        }
+        else if (places[i].kind == ARGUMENT_XMM)
+        {
+            emit2(generator, location->kind == ASM_LOCATION_REGISTER ? ASM_OP_MOVQ : ASM_OP_MOVSD, dest,
+                  asm_xmm(places[i].index));
+        }
+        else if (location->kind == ASM_LOCATION_REGISTER)
+        {
+            emit2(generator, ASM_OP_MOV, dest, incoming);
+        }
+        else
+        {
+            emit2(generator, ASM_OP_MOV, asm_reg(ASM_RAX), incoming);
+            emit2(generator, ASM_OP_MOV, dest, asm_reg(ASM_RAX));
+        }
     }
+    safe_free(places);
+    safe_free(types);
+}
 
-    fprintf(generator->output_file, "    imul rcx, 8\n");
-    fprintf(generator->output_file, "    add rax, rcx\n");
-    fprintf(generator->output_file, "    mov rax, qword [rax]\n");
-    fprintf(generator->output_file, "    mov qword [rel %s], rax\n", result_name);
+void codegenasm_write_function_footer(CodeGenerator *generator)
+{
+    write_epilogue(generator);
+    emit0(generator, ASM_OP_RET);
+    asm_register_allocation_destroy(generator->register_allocation);
+    generator->register_allocation = NULL;
 }
 
-void codegenasm_array_store(CodeGenerator *generator, IROperand *array, IROperand *index, IROperand *value)
+void codegenasm_write_main_function(CodeGenerator *generator)
 {
-    char *array_name = codegenasm_get_operand_name(generator, array);
-    char *index_name = codegenasm_get_operand_name(generator, index);
-    char *value_name = codegenasm_get_operand_name(generator, value);
+    code_buffer_puts(generator->output, "\n; Main function\n");
+    code_buffer_puts(generator->output, "global main\n");
+    code_buffer_puts(generator->output, "main:\n");
+    code_buffer_puts(generator->output, "    xor eax, eax\n");
+    code_buffer_puts(generator->output, "    ret\n");
+}
 
-    fprintf(generator->output_file, "    lea rax, [rel %s]\n", array_name);
-    if (is_param_register(index_name))
-    {
-        fprintf(generator->output_file, "    mov rcx, %s\n", index_name);
-    }
-    else
+void codegenasm_error(CodeGenerator *generator, const char *message)
+{
+    if (generator->error)
     {
-        fprintf(generator->output_file, "    mov rcx, qword [rel %s]\n", index_name);
+        error_set(generator->error, ERROR_CODEGEN, message, 0, 0);
     }
+}
 
-    fprintf(generator->output_file, "    imul rcx, 8\n");
-    fprintf(generator->output_file, "    add rax, rcx\n");
+/* Memory operand for array[index]; may use rcx. */
+static AsmOperand element_address(CodeGenerator *generator, IROperand *array, IROperand *index)
+{
+    int offset = local_offset(generator, array);
+    if (is_imm32(index) && index->data.const_value >= 0 && index->data.const_value < offset / 8)
+        return frame_slot(offset - (int)index->data.const_value * 8);
 
-    if (is_param_register(value_name))
-    {
-        fprintf(generator->output_file, "    mov rcx, %s\n", value_name);
-    }
-    else
+    AsmRegister reg;
+    if (!operand_register(generator, index, &reg))
     {
-        fprintf(generator->output_file, "    mov rcx, qword [rel %s]\n", value_name);
+        load(generator, ASM_RCX, index);
+        reg = ASM_RCX;
     }
-
-    fprintf(generator->output_file, "    mov qword [rax], rcx\n");
+    return asm_qword(asm_mem(ASM_RBP, reg, 8, -offset));
 }
 
-void codegenasm_bounds_check(CodeGenerator *generator, IROperand *index, IROperand *size, const char *error_label)
+void codegenasm_array_load(CodeGenerator *generator, IROperand *result, IROperand *array, IROperand *index)
 {
-    char *index_name = codegenasm_get_operand_name(generator, index);
-    char *size_name = codegenasm_get_operand_name(generator, size);
+    AsmRegister target = target_register(generator, result);
+    emit2(generator, ASM_OP_MOV, asm_reg(target), element_address(generator, array, index));
+    store(generator, result, target);
+}
 
-    if (is_param_register(index_name))
-    {
-        fprintf(generator->output_file, "    mov rax, %s\n", index_name);
-    }
+void codegenasm_array_store(CodeGenerator *generator, IROperand *array, IROperand *index, IROperand *value)
+{
+    AsmOperand source = asm_reg(ASM_RDX);
+    AsmRegister reg;
+    if (needs_conversion(array, value))
+        load_as(generator, ASM_RDX, value, scalar_type(array));
+    else if (is_zero(value) || is_imm32(value) || operand_register(generator, value, &reg))
+        source = operand_source(generator, value, ASM_RDX);
     else
-    {
-        fprintf(generator->output_file, "    mov rax, qword [rel %s]\n", index_name);
-    }
+        load(generator, ASM_RDX, value);
+    emit2(generator, ASM_OP_MOV, element_address(generator, array, index), source);
+}
 
-    if (is_param_register(size_name))
-    {
-        fprintf(generator->output_file, "    mov rcx, %s\n", size_name);
-    }
+static void codegenasm_array_init(CodeGenerator *generator, IRInstruction *instr)
+{
+    char buffer[160];
+    int count = instr->result->array_size;
+    if (count <= 0)
+        return;
+
+    int loop = generator->temp_counter++;
+    load_as(generator, ASM_RAX, instr->arg1, scalar_type(instr->result));
+    emit2(generator, ASM_OP_LEA, asm_reg(ASM_RCX), local_address(generator, instr->result, 0));
+    emit2(generator, ASM_OP_MOV, asm_reg(ASM_RDX), asm_imm(count));
+    emit_label(generator, "%s.fill%d", generator->current_function_name, loop);
+    emit2(generator, ASM_OP_MOV, asm_qword(asm_mem(ASM_RCX, ASM_NO_REGISTER, 1, 0)), asm_reg(ASM_RAX));
+    emit2(generator, ASM_OP_ADD, asm_reg(ASM_RCX), asm_imm(8));
+    emit1(generator, ASM_OP_DEC, asm_reg(ASM_RDX));
+    emit_jump(generator, ASM_CC_NZ,
+              format_symbol(buffer, sizeof(buffer), "%s.fill%d", generator->current_function_name, loop));
+}
+
+void codegenasm_bounds_check(CodeGenerator *generator, IROperand *index, IROperand *size, const char *error_label)
+{
+    char buffer[160];
+    AsmRegister reg;
+    AsmOperand index_operand = asm_reg(ASM_RAX);
+    if (operand_register(generator, index, &reg))
+        index_operand = asm_reg(reg);
     else
-    {
-        fprintf(generator->output_file, "    mov rcx, qword [rel %s]\n", size_name);
-    }
+        load(generator, ASM_RAX, index);
 
-    fprintf(generator->output_file, "    cmp rax, rcx\n");
-    fprintf(generator->output_file, "    jge %s_%s\n", generator->current_function_name, error_label);
-}
\ No newline at end of file
+    emit2(generator, ASM_OP_CMP, index_operand, operand_source(generator, size, ASM_RCX));
+    emit_jump(generator, ASM_CC_GE, block_label(generator, error_label, buffer, sizeof(buffer)));
+}
@@ -0,0 +1,273 @@
+#include "backend/assembly/elfWriter.h"
+
+#define ELF_HEADER_SIZE 64
+#define SECTION_HEADER_SIZE 64
+#define SYMBOL_SIZE 24
+#define RELOCATION_SIZE 24
+#define MAX_SECTIONS 16
+
+enum {
+    SHT_PROGBITS = 1,
+    SHT_SYMTAB = 2,
+    SHT_STRTAB = 3,
+    SHT_RELA = 4,
+    SHT_FINI_ARRAY = 15
+};
+
+enum {
+    SHF_WRITE = 0x1,
+    SHF_ALLOC = 0x2,
+    SHF_EXECINSTR = 0x4,
+    SHF_INFO_LINK = 0x40
+};
+
+enum {
+    R_X86_64_64 = 1,
+    R_X86_64_PC32 = 2,
+    R_X86_64_PLT32 = 4
+};
+
+static const unsigned char zeroes[ELF_HEADER_SIZE] = {0};
+
+typedef struct ElfSection {
+    uint32_t name;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t alignment;
+    uint64_t entry_size;
+} ElfSection;
+
+static void put(AsmBuffer *buffer, uint64_t value, int size)
+{
+    unsigned char bytes[8];
+    for (int i = 0; i < size; i++)
+    {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    asm_buffer_append(buffer, bytes, (size_t)size);
+}
+
+static void pad(AsmBuffer *buffer, size_t alignment)
+{
+    while (buffer->size % alignment != 0)
+        put(buffer, 0, 1);
+}
+
+static uint32_t add_string(AsmBuffer *table, const char *text)
+{
+    uint32_t offset = (uint32_t)table->size;
+    asm_buffer_append(table, text, strlen(text) + 1);
+    return offset;
+}
+
+static size_t add_section(ElfSection *sections, size_t *count, AsmBuffer *names, const char *name, uint32_t type,
+                          uint64_t flags)
+{
+    ElfSection *section = &sections[*count];
+    memset(section, 0, sizeof(*section));
+    section->name = add_string(names, name);
+    section->type = type;
+    section->flags = flags;
+    section->alignment = 1;
+    return (*count)++;
+}
+
+/* Appends a section's contents to the file and records where they went. */
+static void place(AsmBuffer *file, ElfSection *section, const void *bytes, size_t size, size_t alignment)
+{
+    pad(file, alignment);
+    section->offset = file->size;
+    section->size = size;
+    section->alignment = alignment;
+    if (size)
+        asm_buffer_append(file, bytes, size);
+}
+
+static uint32_t relocation_type(AsmRelocationKind kind)
+{
+    switch (kind)
+    {
+    case ASM_RELOCATION_ABS64:
+        return R_X86_64_64;
+    case ASM_RELOCATION_PC32:
+        return R_X86_64_PC32;
+    case ASM_RELOCATION_PLT32:
+        return R_X86_64_PLT32;
+    }
+    return 0;
+}
+
+static bool is_emitted(const AsmSymbol *symbol)
+{
+    return symbol->section >= 0 || symbol->referenced;
+}
+
+static void write_symbol(AsmBuffer *symtab, AsmBuffer *strtab, const AsmSymbol *symbol, const size_t *section_index)
+{
+    int binding = symbol->global ? 1 : 0;
+    int type = symbol->global && symbol->section == ASM_SECTION_TEXT ? 2 : 0;
+    put(symtab, add_string(strtab, symbol->name), 4);
+    put(symtab, (uint64_t)(binding << 4 | type), 1);
+    put(symtab, 0, 1);
+    put(symtab, symbol->section >= 0 ? section_index[symbol->section] : 0, 2);
+    put(symtab, symbol->offset, 8);
+    put(symtab, 0, 8);
+}
+
+bool elf_write_object(const AsmObject *object, FILE *out)
+{
+    ElfSection sections[MAX_SECTIONS];
+    size_t count = 0;
+    AsmBuffer file = {0};
+    AsmBuffer names = {0};
+    AsmBuffer symtab = {0};
+    AsmBuffer strtab = {0};
+    AsmBuffer rela[ASM_SECTION_COUNT];
+    size_t section_index[ASM_SECTION_COUNT] = {0};
+    memset(rela, 0, sizeof(rela));
+
+    put(&names, 0, 1);
+    put(&strtab, 0, 1);
+    add_section(sections, &count, &names, "", 0, 0);
+    bool used[ASM_SECTION_COUNT] = {true};
+    for (size_t i = 0; i < object->symbols.size; i++)
+    {
+        const AsmSymbol *symbol = (const AsmSymbol *)array_get(&object->symbols, i);
+        if (symbol->section >= 0)
+            used[symbol->section] = true;
+    }
+    for (int i = 0; i < ASM_SECTION_COUNT; i++)
+    {
+        const AsmSection *section = &object->sections[i];
+        if (!used[i] && section->contents.size == 0)
+            continue;
+        uint64_t flags = i == ASM_SECTION_TEXT     ? SHF_ALLOC | SHF_EXECINSTR
+                         : i == ASM_SECTION_RODATA ? SHF_ALLOC
+                                                   : SHF_ALLOC | SHF_WRITE;
+        section_index[i] = add_section(sections, &count, &names, section->name,
+                                       i == ASM_SECTION_FINI_ARRAY ? SHT_FINI_ARRAY : SHT_PROGBITS, flags);
+        if (i == ASM_SECTION_FINI_ARRAY)
+            sections[section_index[i]].entry_size = 8;
+    }
+
+    /* Locals must precede globals in the symbol table. */
+    size_t *symbol_index = safe_malloc((object->symbols.size + 1) * sizeof(size_t));
+    size_t symbols = 1;
+    size_t first_global = 1;
+    asm_buffer_append(&symtab, zeroes, SYMBOL_SIZE);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < object->symbols.size; i++)
+        {
+            const AsmSymbol *symbol = (const AsmSymbol *)array_get(&object->symbols, i);
+            if (!is_emitted(symbol) || symbol->global != (pass == 1))
+                continue;
+            symbol_index[i] = symbols++;
+            write_symbol(&symtab, &strtab, symbol, section_index);
+        }
+        if (pass == 0)
+            first_global = symbols;
+    }
+
+    for (size_t i = 0; i < object->relocations.size; i++)
+    {
+        const AsmRelocation *relocation = (const AsmRelocation *)array_get(&object->relocations, i);
+        AsmBuffer *entries = &rela[relocation->section];
+        put(entries, relocation->offset, 8);
+        put(entries, (uint64_t)symbol_index[relocation->symbol] << 32 | relocation_type(relocation->kind), 8);
+        put(entries, (uint64_t)relocation->addend, 8);
+    }
+    safe_free(symbol_index);
+
+    size_t rela_index[ASM_SECTION_COUNT] = {0};
+    for (int i = 0; i < ASM_SECTION_COUNT; i++)
+    {
+        if (rela[i].size == 0)
+            continue;
+        char name[32];
+        snprintf(name, sizeof(name), ".rela%s", object->sections[i].name);
+        rela_index[i] = add_section(sections, &count, &names, name, SHT_RELA, SHF_INFO_LINK);
+    }
+    size_t note = add_section(sections, &count, &names, ".note.GNU-stack", SHT_PROGBITS, 0);
+    size_t symtab_index = add_section(sections, &count, &names, ".symtab", SHT_SYMTAB, 0);
+    size_t strtab_index = add_section(sections, &count, &names, ".strtab", SHT_STRTAB, 0);
+    size_t names_index = add_section(sections, &count, &names, ".shstrtab", SHT_STRTAB, 0);
+
+    asm_buffer_append(&file, zeroes, ELF_HEADER_SIZE);
+    for (int i = 0; i < ASM_SECTION_COUNT; i++)
+    {
+        if (!section_index[i])
+            continue;
+        const AsmSection *section = &object->sections[i];
+        place(&file, &sections[section_index[i]], section->contents.data, section->contents.size,
+              section->alignment);
+        if (rela_index[i])
+        {
+            ElfSection *entries = &sections[rela_index[i]];
+            place(&file, entries, rela[i].data, rela[i].size, 8);
+            entries->link = (uint32_t)symtab_index;
+            entries->info = (uint32_t)section_index[i];
+            entries->entry_size = RELOCATION_SIZE;
+        }
+    }
+    place(&file, &sections[note], NULL, 0, 1);
+    place(&file, &sections[symtab_index], symtab.data, symtab.size, 8);
+    sections[symtab_index].link = (uint32_t)strtab_index;
+    sections[symtab_index].info = (uint32_t)first_global;
+    sections[symtab_index].entry_size = SYMBOL_SIZE;
+    place(&file, &sections[strtab_index], strtab.data, strtab.size, 1);
+    place(&file, &sections[names_index], names.data, names.size, 1);
+
+    pad(&file, 8);
+    uint64_t section_headers = file.size;
+    for (size_t i = 0; i < count; i++)
+    {
+        const ElfSection *section = &sections[i];
+        put(&file, section->name, 4);
+        put(&file, section->type, 4);
+        put(&file, section->flags, 8);
+        put(&file, 0, 8);
+        put(&file, i ? section->offset : 0, 8);
+        put(&file, section->size, 8);
+        put(&file, section->link, 4);
+        put(&file, section->info, 4);
+        put(&file, i ? section->alignment : 0, 8);
+        put(&file, section->entry_size, 8);
+    }
+
+    /* The header goes in last, once the section table's position is known. */
+    AsmBuffer header = {0};
+    static const unsigned char identification[16] = {0x7F, 'E', 'L', 'F', 2, 1, 1, 0};
+    asm_buffer_append(&header, identification, sizeof(identification));
+    put(&header, 1, 2);
+    put(&header, 62, 2);
+    put(&header, 1, 4);
+    put(&header, 0, 8);
+    put(&header, 0, 8);
+    put(&header, section_headers, 8);
+    put(&header, 0, 4);
+    put(&header, ELF_HEADER_SIZE, 2);
+    put(&header, 0, 2);
+    put(&header, 0, 2);
+    put(&header, SECTION_HEADER_SIZE, 2);
+    put(&header, count, 2);
+    put(&header, names_index, 2);
+    memcpy(file.data, header.data, ELF_HEADER_SIZE);
+
+    bool written = fwrite(file.data, 1, file.size, out) == file.size;
+
+    asm_buffer_free(&header);
+    asm_buffer_free(&file);
+    asm_buffer_free(&names);
+    asm_buffer_free(&symtab);
+    asm_buffer_free(&strtab);
+    for (int i = 0; i < ASM_SECTION_COUNT; i++)
+    {
+        asm_buffer_free(&rela[i]);
+    }
+    return written;
+}
@@ -0,0 +1,263 @@
+#ifndef _WIN32
+#define _DEFAULT_SOURCE
+#endif
+
+#include "backend/assembly/jit.h"
+#include "runtime/runtime.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+/* jmp [rip + 0] followed by the target address. */
+#define STUB_SIZE 16
+
+typedef void (*JitFunction)(void);
+typedef int64_t (*JitMain)(void);
+
+typedef struct JitSymbol {
+    const char *name;
+    JitFunction address;
+} JitSymbol;
+
+static const JitSymbol host_symbols[] = {
+    {"printf", (JitFunction)printf},
+    {"fopen", (JitFunction)fopen},
+    {"fprintf", (JitFunction)fprintf},
+    {"fclose", (JitFunction)fclose},
+    {"puts", (JitFunction)puts},
+    {"malloc", (JitFunction)malloc},
+    {"free", (JitFunction)free},
+    {"exit", (JitFunction)exit},
+    {"__tl_concat", (JitFunction)__tl_concat},
+    {"__tl_strlen", (JitFunction)__tl_strlen},
+    {"__tl_substr", (JitFunction)__tl_substr},
+    {"__tl_strcmp", (JitFunction)__tl_strcmp},
+    {"__tl_char_at", (JitFunction)__tl_char_at},
+    {"__tl_memo_lookup", (JitFunction)__tl_memo_lookup},
+    {"__tl_memo_store", (JitFunction)__tl_memo_store},
+    {"__tl_cold_print", (JitFunction)__tl_cold_print},
+    {"__tl_bounds_error", (JitFunction)__tl_bounds_error},
+    {"__tl_profile_register", (JitFunction)__tl_profile_register}};
+
+static bool host_symbol(const char *name, uint64_t *address)
+{
+    for (size_t i = 0; i < sizeof(host_symbols) / sizeof(host_symbols[0]); i++)
+    {
+        if (strcmp(name, host_symbols[i].name) == 0)
+        {
+            *address = (uint64_t)(uintptr_t)host_symbols[i].address;
+            return true;
+        }
+    }
+    return false;
+}
+
+static size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static void write_le(unsigned char *field, uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        field[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+#ifdef _WIN32
+
+bool jit_load(const AsmObject *object, JitImage *image, char *message, size_t message_size)
+{
+    (void)object;
+    memset(image, 0, sizeof(*image));
+    snprintf(message, message_size, "Running in memory is not supported on this platform");
+    return false;
+}
+
+void jit_unload(JitImage *image)
+{
+    (void)image;
+}
+
+#else
+
+/* External functions are reached through a stub next to the code, since
+   the C library may be mapped further away than a rel32 can reach. */
+static size_t stub_count(const AsmObject *object)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < object->symbols.size; i++)
+    {
+        const AsmSymbol *symbol = (const AsmSymbol *)array_get(&object->symbols, i);
+        if (symbol->section < 0 && symbol->referenced)
+            count++;
+    }
+    return count;
+}
+
+typedef struct JitLinker {
+    const AsmObject *object;
+    JitImage *image;
+    /* Offset of each external symbol's stub plus one, or zero. */
+    size_t *stubs;
+    unsigned char *stub_area;
+    size_t stubs_used;
+    char *message;
+    size_t message_size;
+} JitLinker;
+
+static bool resolve(JitLinker *linker, const AsmRelocation *relocation, uint64_t *address)
+{
+    const AsmSymbol *symbol = (const AsmSymbol *)array_get(&linker->object->symbols, relocation->symbol);
+    if (symbol->section >= 0)
+    {
+        *address = (uint64_t)(uintptr_t)(linker->image->sections[symbol->section] + symbol->offset);
+        return true;
+    }
+
+    uint64_t target;
+    if (!host_symbol(symbol->name, &target))
+    {
+        snprintf(linker->message, linker->message_size, "Undefined symbol '%s'", symbol->name);
+        return false;
+    }
+    if (relocation->kind == ASM_RELOCATION_ABS64)
+    {
+        *address = target;
+        return true;
+    }
+
+    size_t *stub = &linker->stubs[relocation->symbol];
+    if (*stub == 0)
+    {
+        static const unsigned char jump[6] = {0xFF, 0x25, 0, 0, 0, 0};
+        unsigned char *code = linker->stub_area + linker->stubs_used++ * STUB_SIZE;
+        memcpy(code, jump, sizeof(jump));
+        write_le(code + sizeof(jump), target, 8);
+        *stub = (size_t)(code - linker->image->memory) + 1;
+    }
+    *address = (uint64_t)(uintptr_t)(linker->image->memory + *stub - 1);
+    return true;
+}
+
+static bool relocate(JitLinker *linker)
+{
+    const AsmObject *object = linker->object;
+    for (size_t i = 0; i < object->relocations.size; i++)
+    {
+        const AsmRelocation *relocation = (const AsmRelocation *)array_get(&object->relocations, i);
+        unsigned char *field = linker->image->sections[relocation->section] + relocation->offset;
+        uint64_t address;
+        if (!resolve(linker, relocation, &address))
+            return false;
+
+        if (relocation->kind == ASM_RELOCATION_ABS64)
+        {
+            write_le(field, address + (uint64_t)relocation->addend, 8);
+            continue;
+        }
+        int64_t displacement = (int64_t)(address - (uint64_t)(uintptr_t)field) + relocation->addend;
+        if (displacement < INT32_MIN || displacement > INT32_MAX)
+        {
+            snprintf(linker->message, linker->message_size, "Relocation out of range");
+            return false;
+        }
+        write_le(field, (uint64_t)displacement, 4);
+    }
+    return true;
+}
+
+bool jit_load(const AsmObject *object, JitImage *image, char *message, size_t message_size)
+{
+    memset(image, 0, sizeof(*image));
+    const AsmSymbol *main_symbol = asm_object_symbol(object, "main");
+    if (!main_symbol || main_symbol->section != ASM_SECTION_TEXT)
+    {
+        snprintf(message, message_size, "Program has no main function");
+        return false;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t text_size = object->sections[ASM_SECTION_TEXT].contents.size;
+    size_t stub_offset = align_up(text_size, STUB_SIZE);
+    size_t code_size = align_up(stub_offset + stub_count(object) * STUB_SIZE, page);
+
+    size_t offsets[ASM_SECTION_COUNT] = {0};
+    size_t size = code_size;
+    for (int i = ASM_SECTION_TEXT + 1; i < ASM_SECTION_COUNT; i++)
+    {
+        size = align_up(size, object->sections[i].alignment);
+        offsets[i] = size;
+        size += object->sections[i].contents.size;
+    }
+    size = align_up(size, page);
+
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        snprintf(message, message_size, "Cannot map memory for the program");
+        return false;
+    }
+    image->memory = (unsigned char *)memory;
+    image->size = size;
+    image->code_size = code_size;
+    for (int i = 0; i < ASM_SECTION_COUNT; i++)
+    {
+        const AsmBuffer *contents = &object->sections[i].contents;
+        image->sections[i] = image->memory + offsets[i];
+        if (contents->size)
+            memcpy(image->sections[i], contents->data, contents->size);
+    }
+
+    JitLinker linker = {object, image, NULL, image->memory + stub_offset, 0, message, message_size};
+    linker.stubs = safe_malloc((object->symbols.size + 1) * sizeof(size_t));
+    memset(linker.stubs, 0, (object->symbols.size + 1) * sizeof(size_t));
+    bool linked = relocate(&linker);
+    safe_free(linker.stubs);
+    if (!linked)
+    {
+        jit_unload(image);
+        return false;
+    }
+    if (mprotect(image->memory, code_size, PROT_READ | PROT_EXEC) != 0)
+    {
+        snprintf(message, message_size, "Cannot make the program's code executable");
+        jit_unload(image);
+        return false;
+    }
+    image->entry = image->sections[ASM_SECTION_TEXT] + main_symbol->offset;
+    image->fini_array_size = object->sections[ASM_SECTION_FINI_ARRAY].contents.size;
+    return true;
+}
+
+void jit_unload(JitImage *image)
+{
+    if (image->memory)
+        munmap(image->memory, image->size);
+    memset(image, 0, sizeof(*image));
+}
+
+#endif
+
+int jit_run(JitImage *image)
+{
+    JitMain entry = (JitMain)(uintptr_t)image->entry;
+    int result = (int)entry();
+
+    /* Finalizers run in reverse order, as the C runtime would. */
+    size_t count = image->fini_array_size / 8;
+    for (size_t i = count; i > 0; i--)
+    {
+        uint64_t address;
+        memcpy(&address, image->sections[ASM_SECTION_FINI_ARRAY] + (i - 1) * 8, 8);
+        ((JitFunction)(uintptr_t)address)();
+    }
+    fflush(stdout);
+    return result;
+}
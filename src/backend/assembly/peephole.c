@@ -0,0 +1,618 @@
+#include "backend/assembly/peephole.h"
+
+typedef struct PeepholeRule {
+    const char *name;
+    bool (*apply)(AsmCode *code, size_t index);
+} PeepholeRule;
+
+static const struct {
+    const char *mnemonic;
+    bool writes_flags;
+} opcodes[ASM_OP_COUNT] = {
+    [ASM_OP_MOV] = {"mov", false},
+    [ASM_OP_MOVZX] = {"movzx", false},
+    [ASM_OP_LEA] = {"lea", false},
+    [ASM_OP_PUSH] = {"push", false},
+    [ASM_OP_POP] = {"pop", false},
+    [ASM_OP_ADD] = {"add", true},
+    [ASM_OP_SUB] = {"sub", true},
+    [ASM_OP_AND] = {"and", true},
+    [ASM_OP_OR] = {"or", true},
+    [ASM_OP_XOR] = {"xor", true},
+    [ASM_OP_IMUL] = {"imul", true},
+    [ASM_OP_IDIV] = {"idiv", true},
+    [ASM_OP_CQO] = {"cqo", false},
+    [ASM_OP_NEG] = {"neg", true},
+    /* inc and dec keep CF, and a shift by zero keeps every flag. */
+    [ASM_OP_INC] = {"inc", false},
+    [ASM_OP_DEC] = {"dec", false},
+    [ASM_OP_SAL] = {"sal", false},
+    [ASM_OP_SAR] = {"sar", false},
+    [ASM_OP_BTC] = {"btc", false},
+    [ASM_OP_CMP] = {"cmp", true},
+    [ASM_OP_TEST] = {"test", true},
+    [ASM_OP_SET] = {"set", false},
+    [ASM_OP_JMP] = {"jmp", false},
+    [ASM_OP_J] = {"j", false},
+    [ASM_OP_CALL] = {"call", false},
+    [ASM_OP_RET] = {"ret", false},
+    [ASM_OP_NOP] = {"nop", false},
+    [ASM_OP_MOVQ] = {"movq", false},
+    [ASM_OP_MOVDQU] = {"movdqu", false},
+    [ASM_OP_MOVSD] = {"movsd", false},
+    [ASM_OP_MOVSS] = {"movss", false},
+    [ASM_OP_CVTSI2SD] = {"cvtsi2sd", false},
+    [ASM_OP_CVTSI2SS] = {"cvtsi2ss", false},
+    [ASM_OP_CVTTSD2SI] = {"cvttsd2si", false},
+    [ASM_OP_CVTTSS2SI] = {"cvttss2si", false},
+    [ASM_OP_CVTSD2SS] = {"cvtsd2ss", false},
+    [ASM_OP_CVTSS2SD] = {"cvtss2sd", false},
+    [ASM_OP_ADDSD] = {"addsd", false},
+    [ASM_OP_ADDSS] = {"addss", false},
+    [ASM_OP_SUBSD] = {"subsd", false},
+    [ASM_OP_SUBSS] = {"subss", false},
+    [ASM_OP_MULSD] = {"mulsd", false},
+    [ASM_OP_MULSS] = {"mulss", false},
+    [ASM_OP_DIVSD] = {"divsd", false},
+    [ASM_OP_DIVSS] = {"divss", false},
+    [ASM_OP_UCOMISD] = {"ucomisd", true},
+    [ASM_OP_UCOMISS] = {"ucomiss", true},
+    [ASM_OP_PADDQ] = {"paddq", false},
+    [ASM_OP_PSUBQ] = {"psubq", false},
+    [ASM_OP_ADDPD] = {"addpd", false},
+    [ASM_OP_SUBPD] = {"subpd", false},
+    [ASM_OP_MULPD] = {"mulpd", false},
+    [ASM_OP_PSLLQ] = {"psllq", false},
+    [ASM_OP_PSRLQ] = {"psrlq", false},
+    [ASM_OP_PAND] = {"pand", false},
+    [ASM_OP_PUNPCKLQDQ] = {"punpcklqdq", false},
+    [ASM_OP_PSHUFD] = {"pshufd", false},
+};
+
+static const char *const condition_names[] = {"e", "ne", "z", "nz", "l", "ge", "le", "g",
+                                              "b", "ae", "be", "a", "p", "np"};
+
+static AsmOperand operand_of(AsmOperandKind kind)
+{
+    AsmOperand operand;
+    memset(&operand, 0, sizeof(operand));
+    operand.kind = kind;
+    operand.reg = ASM_NO_REGISTER;
+    operand.index = ASM_NO_REGISTER;
+    operand.scale = 1;
+    return operand;
+}
+
+static AsmOperand register_of(AsmRegister reg, int size)
+{
+    AsmOperand operand = operand_of(ASM_OPERAND_REGISTER);
+    operand.reg = reg;
+    operand.size = size;
+    return operand;
+}
+
+AsmOperand asm_reg(AsmRegister reg)
+{
+    return register_of(reg, 8);
+}
+
+AsmOperand asm_reg32(AsmRegister reg)
+{
+    return register_of(reg, 4);
+}
+
+AsmOperand asm_reg8(AsmRegister reg)
+{
+    return register_of(reg, 1);
+}
+
+AsmOperand asm_xmm(int xmm)
+{
+    AsmOperand operand = operand_of(ASM_OPERAND_XMM);
+    operand.xmm = xmm;
+    return operand;
+}
+
+AsmOperand asm_imm(long long value)
+{
+    AsmOperand operand = operand_of(ASM_OPERAND_IMMEDIATE);
+    operand.value = value;
+    return operand;
+}
+
+AsmOperand asm_hex(unsigned long long value)
+{
+    AsmOperand operand = asm_imm((long long)value);
+    operand.hex = true;
+    return operand;
+}
+
+AsmOperand asm_mem(AsmRegister base, AsmRegister index, int scale, long long displacement)
+{
+    AsmOperand operand = operand_of(ASM_OPERAND_MEMORY);
+    operand.reg = base;
+    operand.index = index;
+    operand.scale = scale;
+    operand.value = displacement;
+    return operand;
+}
+
+AsmOperand asm_rel(const char *symbol, long long displacement)
+{
+    AsmOperand operand = asm_mem(ASM_NO_REGISTER, ASM_NO_REGISTER, 1, displacement);
+    operand.symbol = symbol;
+    return operand;
+}
+
+AsmOperand asm_qword(AsmOperand memory)
+{
+    memory.size = 8;
+    return memory;
+}
+
+AsmOperand asm_symbol(const char *name)
+{
+    AsmOperand operand = operand_of(ASM_OPERAND_SYMBOL);
+    operand.symbol = name;
+    return operand;
+}
+
+AsmOperand asm_plt(const char *name)
+{
+    AsmOperand operand = asm_symbol(name);
+    operand.plt = true;
+    return operand;
+}
+
+AsmCode *asm_code_create(void)
+{
+    AsmCode *code = safe_malloc(sizeof(AsmCode));
+    code->lines = NULL;
+    code->count = 0;
+    code->capacity = 0;
+    array_init(&code->strings, 16);
+    return code;
+}
+
+void asm_code_destroy(AsmCode *code)
+{
+    if (!code)
+        return;
+    for (size_t i = 0; i < code->strings.size; i++)
+    {
+        safe_free(array_get(&code->strings, i));
+    }
+    array_free(&code->strings);
+    safe_free(code->lines);
+    safe_free(code);
+}
+
+static const char *keep_string(AsmCode *code, const char *text)
+{
+    char *copy = string_copy(text);
+    array_push(&code->strings, copy);
+    return copy;
+}
+
+static AsmLine *add_line(AsmCode *code, AsmLineKind kind)
+{
+    if (code->count == code->capacity)
+    {
+        code->capacity = code->capacity ? code->capacity * 2 : 64;
+        code->lines = safe_realloc(code->lines, code->capacity * sizeof(AsmLine));
+    }
+    AsmLine *line = &code->lines[code->count++];
+    memset(line, 0, sizeof(AsmLine));
+    line->kind = kind;
+    return line;
+}
+
+void asm_code_add_text(AsmCode *code, AsmLineKind kind, const char *text)
+{
+    AsmLine *line = add_line(code, kind);
+    line->text = keep_string(code, text);
+}
+
+void asm_code_add_instruction(AsmCode *code, const AsmInstruction *instruction)
+{
+    AsmLine *line = add_line(code, ASM_LINE_INSTRUCTION);
+    line->instruction = *instruction;
+    for (int i = 0; i < instruction->operand_count; i++)
+    {
+        AsmOperand *operand = &line->instruction.operands[i];
+        if (operand->symbol)
+            operand->symbol = keep_string(code, operand->symbol);
+    }
+}
+
+static const char *register_name(AsmRegister reg, int size)
+{
+    if (size == 4)
+        return asm_register_name_32(reg);
+    return size == 1 ? asm_register_name_8(reg) : asm_register_name(reg);
+}
+
+static void write_memory(const AsmOperand *operand, CodeBuffer *out)
+{
+    bool empty = true;
+    if (operand->size == 8)
+        code_buffer_puts(out, "qword ");
+    code_buffer_putc(out, '[');
+    if (operand->symbol)
+    {
+        code_buffer_printf(out, "rel %s", operand->symbol);
+        empty = false;
+    }
+    if (operand->reg != ASM_NO_REGISTER)
+    {
+        code_buffer_puts(out, asm_register_name(operand->reg));
+        empty = false;
+    }
+    if (operand->index != ASM_NO_REGISTER)
+    {
+        if (!empty)
+            code_buffer_puts(out, " + ");
+        code_buffer_puts(out, asm_register_name(operand->index));
+        if (operand->scale > 1)
+            code_buffer_printf(out, "*%d", operand->scale);
+        empty = false;
+    }
+    if (empty)
+        code_buffer_printf(out, "%lld", operand->value);
+    else if (operand->value != 0)
+        code_buffer_printf(out, " %c %lld", operand->value < 0 ? '-' : '+',
+                           operand->value < 0 ? -operand->value : operand->value);
+    code_buffer_putc(out, ']');
+}
+
+static void write_operand(const AsmOperand *operand, CodeBuffer *out)
+{
+    switch (operand->kind)
+    {
+    case ASM_OPERAND_REGISTER:
+        code_buffer_puts(out, register_name(operand->reg, operand->size));
+        break;
+    case ASM_OPERAND_XMM:
+        code_buffer_printf(out, "xmm%d", operand->xmm);
+        break;
+    case ASM_OPERAND_IMMEDIATE:
+        if (operand->hex)
+            code_buffer_printf(out, "0x%llx", (unsigned long long)operand->value);
+        else
+            code_buffer_int(out, operand->value);
+        break;
+    case ASM_OPERAND_MEMORY:
+        write_memory(operand, out);
+        break;
+    case ASM_OPERAND_SYMBOL:
+        code_buffer_puts(out, operand->symbol);
+        if (operand->plt)
+            code_buffer_puts(out, " wrt ..plt");
+        break;
+    case ASM_OPERAND_NONE:
+        break;
+    }
+}
+
+static void write_instruction(const AsmInstruction *instruction, CodeBuffer *out)
+{
+    code_buffer_indent(out, 1);
+    code_buffer_puts(out, opcodes[instruction->opcode].mnemonic);
+    if (instruction->opcode == ASM_OP_SET || instruction->opcode == ASM_OP_J)
+        code_buffer_puts(out, condition_names[instruction->condition]);
+    for (int i = 0; i < instruction->operand_count; i++)
+    {
+        code_buffer_puts(out, i == 0 ? " " : ", ");
+        write_operand(&instruction->operands[i], out);
+    }
+}
+
+void asm_code_write(const AsmCode *code, CodeBuffer *out)
+{
+    for (size_t i = 0; i < code->count; i++)
+    {
+        const AsmLine *line = &code->lines[i];
+        if (line->deleted)
+            continue;
+        if (line->kind == ASM_LINE_INSTRUCTION)
+            write_instruction(&line->instruction, out);
+        else
+            code_buffer_puts(out, line->text);
+        if (line->kind == ASM_LINE_LABEL)
+            code_buffer_putc(out, ':');
+        code_buffer_putc(out, '\n');
+    }
+}
+
+static size_t next_line(const AsmCode *code, size_t index)
+{
+    do
+        index++;
+    while (index < code->count && code->lines[index].deleted);
+    return index;
+}
+
+/* The instruction right after this one, or NULL when a label or the end
+   of the function comes first. */
+static AsmInstruction *following_instruction(AsmCode *code, size_t index, size_t *found)
+{
+    size_t next = next_line(code, index);
+    if (next >= code->count || code->lines[next].kind != ASM_LINE_INSTRUCTION)
+        return NULL;
+    *found = next;
+    return &code->lines[next].instruction;
+}
+
+static AsmInstruction *preceding_instruction(AsmCode *code, size_t index, size_t *found)
+{
+    while (index > 0)
+    {
+        AsmLine *line = &code->lines[--index];
+        if (line->deleted)
+            continue;
+        if (line->kind != ASM_LINE_INSTRUCTION)
+            return NULL;
+        *found = index;
+        return &line->instruction;
+    }
+    return NULL;
+}
+
+static bool is_instruction(const AsmInstruction *instruction, AsmOpcode opcode, int operands)
+{
+    return instruction->opcode == opcode && instruction->operand_count == operands;
+}
+
+static bool is_register(const AsmOperand *operand, int size)
+{
+    return operand->kind == ASM_OPERAND_REGISTER && operand->size == size;
+}
+
+static bool same_register(const AsmOperand *operand, AsmRegister reg, int size)
+{
+    return is_register(operand, size) && operand->reg == reg;
+}
+
+static bool same_symbol(const char *a, const char *b)
+{
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/* Memory operands match on their address, whatever size they are
+   written with. */
+static bool same_location(const AsmOperand *a, const AsmOperand *b)
+{
+    if (a->kind != b->kind)
+        return false;
+    switch (a->kind)
+    {
+    case ASM_OPERAND_REGISTER:
+        return a->reg == b->reg && a->size == b->size;
+    case ASM_OPERAND_MEMORY:
+        return a->reg == b->reg && a->index == b->index && (a->index == ASM_NO_REGISTER || a->scale == b->scale) &&
+               a->value == b->value && same_symbol(a->symbol, b->symbol);
+    default:
+        return false;
+    }
+}
+
+static bool address_uses(const AsmOperand *address, AsmRegister reg)
+{
+    return address->reg == reg || address->index == reg;
+}
+
+/* A mov of eight bytes between registers and memory. */
+static bool is_qword_move(const AsmInstruction *instruction)
+{
+    if (!is_instruction(instruction, ASM_OP_MOV, 2))
+        return false;
+    for (int i = 0; i < 2; i++)
+    {
+        const AsmOperand *operand = &instruction->operands[i];
+        if (!is_register(operand, 8) && operand->kind != ASM_OPERAND_MEMORY)
+            return false;
+    }
+    return true;
+}
+
+static bool reads_flags(const AsmInstruction *instruction)
+{
+    return instruction->opcode == ASM_OP_J || instruction->opcode == ASM_OP_SET;
+}
+
+/* Whether the flags after this line are overwritten before anything on
+   the fall-through path reads them. Code reached by a jump never expects
+   flags from before it. */
+static bool flags_dead_after(const AsmCode *code, size_t index)
+{
+    for (size_t i = next_line(code, index); i < code->count; i = next_line(code, i))
+    {
+        const AsmLine *line = &code->lines[i];
+        if (line->kind != ASM_LINE_INSTRUCTION)
+            continue;
+        const AsmInstruction *instruction = &line->instruction;
+        if (reads_flags(instruction))
+            return false;
+        if (opcodes[instruction->opcode].writes_flags || instruction->opcode == ASM_OP_JMP ||
+            instruction->opcode == ASM_OP_RET || instruction->opcode == ASM_OP_CALL)
+            return true;
+    }
+    return true;
+}
+
+/* A register copied somewhere and read straight back goes, and a load of
+   what was just stored takes the stored register instead:
+   mov [m], r; mov r, [m] -> mov [m], r
+   mov [m], r; mov q, [m] -> mov [m], r; mov q, r */
+static bool rule_redundant_load(AsmCode *code, size_t index)
+{
+    AsmInstruction *first = &code->lines[index].instruction;
+    if (!is_qword_move(first) || !is_register(&first->operands[1], 8))
+        return false;
+    if (same_location(&first->operands[0], &first->operands[1]))
+    {
+        code->lines[index].deleted = true;
+        return true;
+    }
+
+    size_t next;
+    AsmInstruction *second = following_instruction(code, index, &next);
+    if (!second || !is_qword_move(second) || !same_location(&second->operands[1], &first->operands[0]))
+        return false;
+    if (same_location(&second->operands[0], &first->operands[1]))
+    {
+        code->lines[next].deleted = true;
+        return true;
+    }
+
+    if (first->operands[0].kind == ASM_OPERAND_MEMORY && is_register(&second->operands[0], 8))
+    {
+        second->operands[1] = first->operands[1];
+        return true;
+    }
+    return false;
+}
+
+/* mov r, [m]; mov [m], r -> mov r, [m] unless r is part of the address. */
+static bool rule_redundant_store(AsmCode *code, size_t index)
+{
+    AsmInstruction *first = &code->lines[index].instruction;
+    if (!is_qword_move(first) || !is_register(&first->operands[0], 8))
+        return false;
+    const AsmOperand *address = &first->operands[1];
+    if (address->kind != ASM_OPERAND_MEMORY || address_uses(address, first->operands[0].reg))
+        return false;
+
+    size_t next;
+    AsmInstruction *second = following_instruction(code, index, &next);
+    if (!second || !is_qword_move(second) || !same_location(&second->operands[0], address) ||
+        !same_location(&second->operands[1], &first->operands[0]))
+        return false;
+    code->lines[next].deleted = true;
+    return true;
+}
+
+/* A jump to a label that follows it directly. */
+static bool rule_jump_to_next(AsmCode *code, size_t index)
+{
+    AsmInstruction *jump = &code->lines[index].instruction;
+    if ((jump->opcode != ASM_OP_JMP && jump->opcode != ASM_OP_J) || jump->operand_count != 1)
+        return false;
+    const AsmOperand *target = &jump->operands[0];
+    if (target->kind != ASM_OPERAND_SYMBOL || target->plt)
+        return false;
+    for (size_t i = next_line(code, index); i < code->count && code->lines[i].kind != ASM_LINE_INSTRUCTION;
+         i = next_line(code, i))
+    {
+        if (code->lines[i].kind == ASM_LINE_LABEL && strcmp(code->lines[i].text, target->symbol) == 0)
+        {
+            code->lines[index].deleted = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* mov r, 0 -> xor r32, r32, which is shorter but sets the flags. */
+static bool rule_xor_zero(AsmCode *code, size_t index)
+{
+    AsmInstruction *move = &code->lines[index].instruction;
+    if (!is_instruction(move, ASM_OP_MOV, 2) || move->operands[1].kind != ASM_OPERAND_IMMEDIATE ||
+        move->operands[1].value != 0)
+        return false;
+    if (!is_register(&move->operands[0], 8) && !is_register(&move->operands[0], 4))
+        return false;
+    if (!flags_dead_after(code, index))
+        return false;
+
+    AsmRegister reg = move->operands[0].reg;
+    move->opcode = ASM_OP_XOR;
+    move->operands[0] = asm_reg32(reg);
+    move->operands[1] = asm_reg32(reg);
+    return true;
+}
+
+static bool is_arithmetic(AsmOpcode opcode)
+{
+    return opcode == ASM_OP_AND || opcode == ASM_OP_OR || opcode == ASM_OP_XOR || opcode == ASM_OP_ADD ||
+           opcode == ASM_OP_SUB;
+}
+
+/* test r, r; jz/jnz L after an instruction that already set the flags
+   for r: an and, or, xor, add or sub into r, or a setcc that r was
+   widened from, whose condition the jump can test directly. */
+static bool rule_compare_branch(AsmCode *code, size_t index)
+{
+    AsmInstruction *test = &code->lines[index].instruction;
+    if (!is_instruction(test, ASM_OP_TEST, 2) || !is_register(&test->operands[0], 8) ||
+        !same_location(&test->operands[0], &test->operands[1]))
+        return false;
+    AsmRegister reg = test->operands[0].reg;
+
+    size_t next, previous;
+    AsmInstruction *jump = following_instruction(code, index, &next);
+    AsmInstruction *producer = preceding_instruction(code, index, &previous);
+    if (!jump || !producer || !is_instruction(jump, ASM_OP_J, 1))
+        return false;
+    bool jump_if_zero = jump->condition == ASM_CC_Z || jump->condition == ASM_CC_E;
+    if (!jump_if_zero && jump->condition != ASM_CC_NZ && jump->condition != ASM_CC_NE)
+        return false;
+    if (!flags_dead_after(code, next))
+        return false;
+
+    if (is_arithmetic(producer->opcode) && producer->operand_count == 2 &&
+        same_register(&producer->operands[0], reg, 8))
+    {
+        code->lines[index].deleted = true;
+        return true;
+    }
+
+    size_t set_index;
+    AsmInstruction *set = is_instruction(producer, ASM_OP_MOVZX, 2) && same_register(&producer->operands[0], reg, 8) &&
+                                  same_register(&producer->operands[1], reg, 1)
+                              ? preceding_instruction(code, previous, &set_index)
+                              : NULL;
+    if (!set || !is_instruction(set, ASM_OP_SET, 1) || !same_register(&set->operands[0], reg, 1))
+        return false;
+
+    /* Each condition sits next to its negation. */
+    jump->condition = jump_if_zero ? (AsmCondition)(set->condition ^ 1) : set->condition;
+    code->lines[index].deleted = true;
+    return true;
+}
+
+static const PeepholeRule peephole_rules[ASM_PEEPHOLE_RULE_COUNT] = {
+    {"peephole: redundant load", rule_redundant_load},
+    {"peephole: redundant store", rule_redundant_store},
+    {"peephole: jump to next", rule_jump_to_next},
+    {"peephole: mov r, 0 -> xor", rule_xor_zero},
+    {"peephole: compare and branch", rule_compare_branch},
+};
+
+const char *asm_peephole_rule_name(AsmPeepholeRule rule)
+{
+    return rule < ASM_PEEPHOLE_RULE_COUNT ? peephole_rules[rule].name : "?";
+}
+
+void asm_peephole_optimize(AsmCode *code, AsmPeepholeStats *stats)
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 0; i < code->count; i++)
+        {
+            if (code->lines[i].deleted || code->lines[i].kind != ASM_LINE_INSTRUCTION)
+                continue;
+            for (int rule = 0; rule < ASM_PEEPHOLE_RULE_COUNT; rule++)
+            {
+                if (peephole_rules[rule].apply(code, i))
+                {
+                    stats->applied[rule]++;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,508 @@
+#include "backend/assembly/regalloc.h"
+#include "backend/ir/irCore.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+typedef struct LiveInterval {
+    int value;
+    size_t start;
+    size_t end;
+    bool seen;
+    bool crosses_call;
+} LiveInterval;
+
+static const char *register_names[ASM_REGISTER_COUNT] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+
+static const char *register_names_32[ASM_REGISTER_COUNT] = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"};
+
+static const char *register_names_8[ASM_REGISTER_COUNT] = {
+    "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+    "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"};
+
+const char *asm_register_name(AsmRegister reg)
+{
+    return reg < ASM_REGISTER_COUNT ? register_names[reg] : "?";
+}
+
+const char *asm_register_name_32(AsmRegister reg)
+{
+    return reg < ASM_REGISTER_COUNT ? register_names_32[reg] : "?";
+}
+
+const char *asm_register_name_8(AsmRegister reg)
+{
+    return reg < ASM_REGISTER_COUNT ? register_names_8[reg] : "?";
+}
+
+bool asm_operand_is_allocatable(const IROperand *operand)
+{
+    return operand && (operand->type == IR_OP_TEMP || operand->type == IR_OP_VAR) &&
+           operand->array_size <= 0 && operand->vector_width <= 0;
+}
+
+bool asm_operand_is_vector(const IROperand *operand)
+{
+    return operand && (operand->type == IR_OP_TEMP || operand->type == IR_OP_VAR) &&
+           operand->array_size <= 0 && operand->vector_width > 0;
+}
+
+static bool is_call(const IRInstruction *instr)
+{
+    return instr->opcode == IR_CALL || instr->opcode == IR_PRINT || instr->opcode == IR_PRINT_MULTIPLE;
+}
+
+static void live_add(uint64_t *live, int slot)
+{
+    if (slot >= 0)
+        live[slot / 64] |= (uint64_t)1 << (slot % 64);
+}
+
+static void live_remove(uint64_t *live, int slot)
+{
+    if (slot >= 0)
+        live[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+}
+
+static bool live_contains(const uint64_t *live, size_t slot)
+{
+    return (live[slot / 64] & ((uint64_t)1 << (slot % 64))) != 0;
+}
+
+static void live_transfer(IRInstruction *instr, const IRValueIndex *index, uint64_t *live, size_t words)
+{
+    if (instr->opcode == IR_INLINE_ASM)
+    {
+        memset(live, 0xff, words * sizeof(uint64_t));
+        return;
+    }
+
+    live_remove(live, ir_value_index_of(index, ir_instruction_def(instr)));
+
+    IROperand **uses[IR_MAX_INSTRUCTION_USES];
+    size_t use_count = ir_instruction_uses(instr, uses, IR_MAX_INSTRUCTION_USES);
+    for (size_t u = 0; u < use_count; u++)
+    {
+        live_add(live, ir_value_index_of(index, *uses[u]));
+    }
+}
+
+static void compute_live_out(IRBasicBlock *block, const uint64_t *live_in, uint64_t *live, size_t words)
+{
+    memset(live, 0, words * sizeof(uint64_t));
+    for (size_t s = 0; s < block->succs.size; s++)
+    {
+        IRBasicBlock *succ = (IRBasicBlock *)array_get(&block->succs, s);
+        const uint64_t *succ_in = live_in + succ->id * words;
+        for (size_t w = 0; w < words; w++)
+        {
+            live[w] |= succ_in[w];
+        }
+    }
+}
+
+static void compute_liveness(IRControlFlowGraph *cfg, const IRValueIndex *index, uint64_t *live_in, size_t words)
+{
+    IRFunction *func = cfg->function;
+    uint64_t *live = safe_malloc(words * sizeof(uint64_t));
+    bool changed = true;
+
+    while (changed)
+    {
+        changed = false;
+        for (size_t b = cfg->blocks.size; b-- > 0;)
+        {
+            IRBasicBlock *block = ir_cfg_block(cfg, b);
+            compute_live_out(block, live_in, live, words);
+            for (size_t i = block->end; i-- > block->start;)
+            {
+                live_transfer((IRInstruction *)array_get(&func->instructions, i), index, live, words);
+            }
+
+            uint64_t *block_in = live_in + b * words;
+            if (memcmp(block_in, live, words * sizeof(uint64_t)) != 0)
+            {
+                memcpy(block_in, live, words * sizeof(uint64_t));
+                changed = true;
+            }
+        }
+    }
+    safe_free(live);
+}
+
+static void extend(LiveInterval *interval, size_t position)
+{
+    if (!interval->seen)
+    {
+        interval->start = position;
+        interval->end = position;
+        interval->seen = true;
+        return;
+    }
+    if (position < interval->start)
+        interval->start = position;
+    if (position > interval->end)
+        interval->end = position;
+}
+
+static void extend_operand(LiveInterval *intervals, const IRValueIndex *index, const IROperand *operand, size_t position)
+{
+    int slot = ir_value_index_of(index, operand);
+    if (slot >= 0)
+        extend(&intervals[slot], position);
+}
+
+/* Values the allocator does not place: arrays, which live among the
+   frame's locals. Vectors are marked as well; they always get a stack
+   slot of their own size. */
+static void mark_excluded(IRFunction *func, const IRValueIndex *index, bool *excluded, bool *vectors)
+{
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        IROperand *operands[3] = {instr->result, instr->arg1, instr->arg2};
+        for (int k = 0; k < 3; k++)
+        {
+            int slot = ir_value_index_of(index, operands[k]);
+            if (slot >= 0 && asm_operand_is_vector(operands[k]))
+                vectors[slot] = true;
+            else if (slot >= 0 && !asm_operand_is_allocatable(operands[k]))
+                excluded[slot] = true;
+        }
+        int array = -1;
+        if (instr->opcode == IR_ARRAY_LOAD || instr->opcode == IR_ARRAY_STORE)
+            array = ir_value_index_of(index, instr->arg1);
+        else if (instr->opcode == IR_ARRAY_DECL || instr->opcode == IR_ARRAY_INIT)
+            array = ir_value_index_of(index, instr->result);
+        if (array >= 0)
+            excluded[array] = true;
+    }
+}
+
+/* One interval per value, covering every point where it is live. */
+static LiveInterval *build_intervals(IRFunction *func, const IRValueIndex *index)
+{
+    size_t count = ir_value_index_size(index);
+    LiveInterval *intervals = safe_malloc((count + 1) * sizeof(LiveInterval));
+    for (size_t v = 0; v < count; v++)
+    {
+        intervals[v].value = (int)v;
+        intervals[v].seen = false;
+        intervals[v].crosses_call = false;
+    }
+
+    for (size_t p = 0; p < func->params.size; p++)
+    {
+        extend_operand(intervals, index, (IROperand *)array_get(&func->params, p), 0);
+    }
+
+    IRControlFlowGraph *cfg = ir_cfg_build(func);
+    size_t words = count / 64 + 1;
+    uint64_t *live_in = safe_malloc((cfg->blocks.size + 1) * words * sizeof(uint64_t));
+    uint64_t *live_out = safe_malloc(words * sizeof(uint64_t));
+    memset(live_in, 0, (cfg->blocks.size + 1) * words * sizeof(uint64_t));
+    compute_liveness(cfg, index, live_in, words);
+
+    for (size_t b = 0; b < cfg->blocks.size; b++)
+    {
+        IRBasicBlock *block = ir_cfg_block(cfg, b);
+        if (block->end == block->start)
+            continue;
+        compute_live_out(block, live_in, live_out, words);
+        for (size_t v = 0; v < count; v++)
+        {
+            if (live_contains(live_in + b * words, v))
+                extend(&intervals[v], block->start);
+            if (live_contains(live_out, v))
+                extend(&intervals[v], block->end - 1);
+        }
+    }
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        extend_operand(intervals, index, ir_instruction_def(instr), i);
+        IROperand **uses[IR_MAX_INSTRUCTION_USES];
+        size_t use_count = ir_instruction_uses(instr, uses, IR_MAX_INSTRUCTION_USES);
+        for (size_t u = 0; u < use_count; u++)
+        {
+            extend_operand(intervals, index, *uses[u], i);
+        }
+    }
+
+    /* A PARAM only records its operand; the value is read when the call
+       passes its arguments, so it stays live up to the call. */
+    IROperand **params = safe_malloc((func->instructions.size + 1) * sizeof(IROperand *));
+    size_t param_count = 0;
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (instr->opcode == IR_PARAM)
+        {
+            params[param_count++] = instr->arg1;
+        }
+        else if (instr->opcode == IR_CALL)
+        {
+            for (size_t p = 0; p < param_count; p++)
+                extend_operand(intervals, index, params[p], i);
+            param_count = 0;
+        }
+    }
+    safe_free(params);
+
+    /* calls[i] is the number of calls before position i. */
+    size_t *calls = safe_malloc((func->instructions.size + 1) * sizeof(size_t));
+    calls[0] = 0;
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        calls[i + 1] = calls[i] + (is_call(instr) ? 1 : 0);
+    }
+    for (size_t v = 0; v < count; v++)
+    {
+        LiveInterval *interval = &intervals[v];
+        if (!interval->seen)
+            continue;
+        /* A value live on entry is in its register before the first
+           instruction, so a call there clobbers it as well. */
+        size_t first = interval->start + (live_contains(live_in, v) ? 0 : 1);
+        interval->crosses_call = interval->end > first && calls[interval->end] > calls[first];
+    }
+
+    safe_free(calls);
+    safe_free(live_out);
+    safe_free(live_in);
+    ir_cfg_destroy(cfg);
+    return intervals;
+}
+
+static int compare_start(const void *a, const void *b)
+{
+    const LiveInterval *left = *(const LiveInterval *const *)a;
+    const LiveInterval *right = *(const LiveInterval *const *)b;
+    if (left->start != right->start)
+        return left->start < right->start ? -1 : 1;
+    return left->value - right->value;
+}
+
+static bool contains_register(const AsmRegister *registers, size_t count, AsmRegister reg)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (registers[i] == reg)
+            return true;
+    }
+    return false;
+}
+
+static bool take_free_register(const bool *busy, const AsmRegister *registers, size_t count, AsmRegister *reg)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!busy[registers[i]])
+        {
+            *reg = registers[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void spill(RegisterAllocation *allocation, LiveInterval **spilled, LiveInterval *interval)
+{
+    allocation->locations[interval->value].kind = ASM_LOCATION_STACK;
+    spilled[allocation->spilled++] = interval;
+}
+
+/* Spilled values share a stack slot when their intervals do not overlap.
+   Taking the intervals in order of their start, a slot is free again once
+   the last value placed in it has ended. Each call hands out slots of
+   one size, in qwords, after the ones already taken. */
+static void assign_spill_slots(RegisterAllocation *allocation, LiveInterval **spilled, size_t count, int qwords)
+{
+    size_t *slot_end = safe_malloc((count + 1) * sizeof(size_t));
+    int slots = 0;
+    qsort(spilled, count, sizeof(LiveInterval *), compare_start);
+    for (size_t i = 0; i < count; i++)
+    {
+        int slot = 0;
+        while (slot < slots && slot_end[slot] >= spilled[i]->start)
+            slot++;
+        if (slot == slots)
+            slots++;
+        slot_end[slot] = spilled[i]->end;
+        allocation->locations[spilled[i]->value].kind = ASM_LOCATION_STACK;
+        allocation->locations[spilled[i]->value].slot = allocation->spill_slots + slot * qwords;
+    }
+    allocation->spill_slots += slots * qwords;
+    safe_free(slot_end);
+}
+
+/* Linear scan over the intervals in order of their start. An interval
+   ending at the position where another starts still conflicts with it, so
+   an instruction never writes its result over one of its own operands. */
+static void linear_scan(RegisterAllocation *allocation, LiveInterval **sorted, size_t count,
+                        const AsmRegisterSet *registers, LiveInterval **spilled)
+{
+    LiveInterval **active = safe_malloc((count + 1) * sizeof(LiveInterval *));
+    size_t active_count = 0;
+    bool busy[ASM_REGISTER_COUNT] = {false};
+
+    for (size_t i = 0; i < count; i++)
+    {
+        LiveInterval *current = sorted[i];
+        AsmLocation *location = &allocation->locations[current->value];
+
+        size_t kept = 0;
+        for (size_t a = 0; a < active_count; a++)
+        {
+            if (active[a]->end < current->start)
+                busy[allocation->locations[active[a]->value].reg] = false;
+            else
+                active[kept++] = active[a];
+        }
+        active_count = kept;
+
+        AsmRegister reg;
+        bool found = (!current->crosses_call &&
+                      take_free_register(busy, registers->caller_saved, registers->caller_saved_count, &reg)) ||
+                     take_free_register(busy, registers->callee_saved, registers->callee_saved_count, &reg);
+        if (!found)
+        {
+            /* Spill whichever interval that could give up a suitable
+               register is live the longest. */
+            size_t victim = active_count;
+            for (size_t a = 0; a < active_count; a++)
+            {
+                AsmRegister held = allocation->locations[active[a]->value].reg;
+                if (current->crosses_call &&
+                    !contains_register(registers->callee_saved, registers->callee_saved_count, held))
+                    continue;
+                if (victim == active_count || active[a]->end > active[victim]->end)
+                    victim = a;
+            }
+            if (victim == active_count || active[victim]->end <= current->end)
+            {
+                spill(allocation, spilled, current);
+                continue;
+            }
+            reg = allocation->locations[active[victim]->value].reg;
+            spill(allocation, spilled, active[victim]);
+            active[victim] = active[--active_count];
+        }
+
+        location->kind = ASM_LOCATION_REGISTER;
+        location->reg = reg;
+        busy[reg] = true;
+        allocation->used[reg] = true;
+        active[active_count++] = current;
+    }
+    safe_free(active);
+}
+
+static void count_reference(RegisterAllocation *allocation, const IROperand *operand)
+{
+    int slot = operand ? ir_value_index_of(allocation->values, operand) : -1;
+    if (slot >= 0)
+        allocation->references[slot]++;
+}
+
+static void count_references(RegisterAllocation *allocation, IRFunction *func)
+{
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        count_reference(allocation, instr->result);
+        count_reference(allocation, instr->arg1);
+        count_reference(allocation, instr->arg2);
+        for (size_t k = 0; instr->args && k < instr->args->size; k++)
+        {
+            count_reference(allocation, (IROperand *)array_get(instr->args, k));
+        }
+    }
+}
+
+RegisterAllocation *asm_allocate_registers(IRFunction *func, const AsmRegisterSet *registers)
+{
+    RegisterAllocation *allocation = safe_malloc(sizeof(RegisterAllocation));
+    allocation->values = ir_value_index_create(func);
+    size_t count = ir_value_index_size(allocation->values);
+    allocation->locations = safe_malloc((count + 1) * sizeof(AsmLocation));
+    memset(allocation->locations, 0, (count + 1) * sizeof(AsmLocation));
+    allocation->references = safe_malloc((count + 1) * sizeof(int));
+    memset(allocation->references, 0, (count + 1) * sizeof(int));
+    count_references(allocation, func);
+    memset(allocation->used, 0, sizeof(allocation->used));
+    allocation->spill_slots = 0;
+    allocation->intervals = 0;
+    allocation->spilled = 0;
+
+    bool *excluded = safe_malloc(count + 1);
+    memset(excluded, 0, count + 1);
+    bool *vectors = safe_malloc(count + 1);
+    memset(vectors, 0, count + 1);
+    mark_excluded(func, allocation->values, excluded, vectors);
+
+    LiveInterval *intervals = build_intervals(func, allocation->values);
+    LiveInterval **sorted = safe_malloc((count + 1) * sizeof(LiveInterval *));
+    LiveInterval **vector_intervals = safe_malloc((count + 1) * sizeof(LiveInterval *));
+    size_t vector_count = 0;
+    for (size_t v = 0; v < count; v++)
+    {
+        if (!intervals[v].seen || excluded[v])
+            continue;
+        if (vectors[v])
+            vector_intervals[vector_count++] = &intervals[v];
+        else
+            sorted[allocation->intervals++] = &intervals[v];
+    }
+    qsort(sorted, allocation->intervals, sizeof(LiveInterval *), compare_start);
+    LiveInterval **spilled = safe_malloc((count + 1) * sizeof(LiveInterval *));
+    linear_scan(allocation, sorted, allocation->intervals, registers, spilled);
+    assign_spill_slots(allocation, spilled, allocation->spilled, 1);
+    assign_spill_slots(allocation, vector_intervals, vector_count, ASM_VECTOR_QWORDS);
+
+    if (debug_enabled)
+    {
+        printf("[DEBUG] Register allocation: %s: %zu intervals, %zu spilled into %d slots\n", func->name,
+               allocation->intervals, allocation->spilled, allocation->spill_slots);
+    }
+
+    safe_free(spilled);
+    safe_free(vector_intervals);
+    safe_free(sorted);
+    safe_free(intervals);
+    safe_free(vectors);
+    safe_free(excluded);
+    return allocation;
+}
+
+void asm_register_allocation_destroy(RegisterAllocation *allocation)
+{
+    if (!allocation)
+        return;
+    ir_value_index_destroy(allocation->values);
+    safe_free(allocation->locations);
+    safe_free(allocation->references);
+    safe_free(allocation);
+}
+
+const AsmLocation *asm_location_of(const RegisterAllocation *allocation, const IROperand *operand)
+{
+    if (!allocation || !(asm_operand_is_allocatable(operand) || asm_operand_is_vector(operand)))
+        return NULL;
+    int slot = ir_value_index_of(allocation->values, operand);
+    if (slot < 0 || allocation->locations[slot].kind == ASM_LOCATION_NONE)
+        return NULL;
+    return &allocation->locations[slot];
+}
+
+int asm_reference_count(const RegisterAllocation *allocation, const IROperand *operand)
+{
+    int slot = allocation && operand ? ir_value_index_of(allocation->values, operand) : -1;
+    return slot < 0 ? 0 : allocation->references[slot];
+}
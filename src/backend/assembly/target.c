@@ -0,0 +1,61 @@
+#include "backend/assembly/target.h"
+#include "common/flags.h"
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+/* rax, the argument registers and rdx are the code generator's scratch
+   registers, so neither ABI hands them to the allocator. */
+static const AsmRegister caller_saved_registers[] = {ASM_R10, ASM_R11};
+
+static const AsmRegister win64_argument_registers[] = {ASM_RCX, ASM_RDX, ASM_R8, ASM_R9};
+static const AsmRegister win64_callee_saved[] = {ASM_RBX, ASM_RSI, ASM_RDI, ASM_R12, ASM_R13, ASM_R14, ASM_R15};
+
+static const AsmRegister sysv_argument_registers[] = {ASM_RDI, ASM_RSI, ASM_RDX, ASM_RCX, ASM_R8, ASM_R9};
+static const AsmRegister sysv_callee_saved[] = {ASM_RBX, ASM_R12, ASM_R13, ASM_R14, ASM_R15};
+
+static const AsmTarget win64_target = {
+    "win64",
+    "x86-64 Windows",
+    ASM_ABI_WIN64,
+    win64_argument_registers,
+    COUNT(win64_argument_registers),
+    32,
+    0,
+    {caller_saved_registers, COUNT(caller_saved_registers), win64_callee_saved, COUNT(win64_callee_saved)}};
+
+static const AsmTarget sysv_target = {
+    "sysv",
+    "x86-64 System V",
+    ASM_ABI_SYSV,
+    sysv_argument_registers,
+    COUNT(sysv_argument_registers),
+    0,
+    128,
+    {caller_saved_registers, COUNT(caller_saved_registers), sysv_callee_saved, COUNT(sysv_callee_saved)}};
+
+const AsmTarget *asm_target_win64(void)
+{
+    return &win64_target;
+}
+
+const AsmTarget *asm_target_sysv(void)
+{
+    return &sysv_target;
+}
+
+const AsmTarget *asm_target_find(const char *name)
+{
+    if (!name)
+        return NULL;
+    if (strcmp(name, win64_target.name) == 0)
+        return &win64_target;
+    if (strcmp(name, sysv_target.name) == 0)
+        return &sysv_target;
+    return NULL;
+}
+
+/* Windows uses its own ABI; Linux, macOS and the BSDs all follow System V. */
+const AsmTarget *asm_target_host(void)
+{
+    return strstr(get_target_machine(), "windows") ? &win64_target : &sysv_target;
+}
@@ -0,0 +1,133 @@
+#include "backend/codegen/codegenBuffer.h"
+#include <stdarg.h>
+#include <string.h>
+
+#define CODE_BUFFER_INITIAL_CAPACITY 65536
+
+CodeBuffer *code_buffer_create(void)
+{
+    CodeBuffer *buffer = safe_malloc(sizeof(CodeBuffer));
+    buffer->capacity = CODE_BUFFER_INITIAL_CAPACITY;
+    buffer->data = safe_malloc(buffer->capacity);
+    buffer->length = 0;
+    buffer->flushed = 0;
+    return buffer;
+}
+
+void code_buffer_destroy(CodeBuffer *buffer)
+{
+    if (!buffer)
+        return;
+    safe_free(buffer->data);
+    safe_free(buffer);
+}
+
+/* Leaves room for a terminator after the requested bytes. */
+static void reserve(CodeBuffer *buffer, size_t extra)
+{
+    size_t needed = buffer->length + extra + 1;
+    if (needed <= buffer->capacity)
+        return;
+    size_t capacity = buffer->capacity * 2;
+    while (capacity < needed)
+        capacity *= 2;
+    buffer->data = safe_realloc(buffer->data, capacity);
+    buffer->capacity = capacity;
+}
+
+void code_buffer_append(CodeBuffer *buffer, const char *text, size_t length)
+{
+    reserve(buffer, length);
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+}
+
+void code_buffer_puts(CodeBuffer *buffer, const char *text)
+{
+    code_buffer_append(buffer, text, strlen(text));
+}
+
+void code_buffer_putc(CodeBuffer *buffer, char c)
+{
+    reserve(buffer, 1);
+    buffer->data[buffer->length++] = c;
+}
+
+void code_buffer_int(CodeBuffer *buffer, long long value)
+{
+    char digits[24];
+    int count = 0;
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    do
+    {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    reserve(buffer, (size_t)count + 1);
+    if (value < 0)
+        buffer->data[buffer->length++] = '-';
+    while (count > 0)
+        buffer->data[buffer->length++] = digits[--count];
+}
+
+void code_buffer_indent(CodeBuffer *buffer, int level)
+{
+    if (level <= 0)
+        return;
+    size_t width = (size_t)level * 4;
+    reserve(buffer, width);
+    memset(buffer->data + buffer->length, ' ', width);
+    buffer->length += width;
+}
+
+void code_buffer_vprintf(CodeBuffer *buffer, const char *format, va_list args)
+{
+    va_list retry;
+    va_copy(retry, args);
+    size_t available = buffer->capacity - buffer->length;
+    int written = vsnprintf(buffer->data + buffer->length, available, format, args);
+    if (written >= 0 && (size_t)written >= available)
+    {
+        reserve(buffer, (size_t)written);
+        written = vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, retry);
+    }
+    va_end(retry);
+    if (written > 0)
+        buffer->length += (size_t)written;
+}
+
+void code_buffer_printf(CodeBuffer *buffer, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    code_buffer_vprintf(buffer, format, args);
+    va_end(args);
+}
+
+const char *code_buffer_text(CodeBuffer *buffer)
+{
+    buffer->data[buffer->length] = '\0';
+    return buffer->data;
+}
+
+bool code_buffer_flush(CodeBuffer *buffer, FILE *out)
+{
+    bool success = true;
+    if (out && buffer->length > 0)
+        success = fwrite(buffer->data, 1, buffer->length, out) == buffer->length;
+    buffer->flushed += buffer->length;
+    buffer->length = 0;
+    return success;
+}
+
+size_t code_buffer_total(const CodeBuffer *buffer)
+{
+    return buffer->flushed + buffer->length;
+}
+
+void code_buffer_truncate(CodeBuffer *buffer, size_t total)
+{
+    if (total >= buffer->flushed && total - buffer->flushed < buffer->length)
+        buffer->length = total - buffer->flushed;
+}
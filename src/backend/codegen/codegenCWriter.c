@@ -9,52 +9,78 @@
 
 extern bool debug_enabled;
 
-static void escape_string_for_c(const char *input, FILE *output) {
+static void escape_string_for_c(const char *input, CodeBuffer *output) {
     while (*input) {
         switch (*input) {
             case '\n':
-                fprintf(output, "\\n");
+                code_buffer_puts(output, "\\n");
                 break;
             case '\t':
-                fprintf(output, "\\t");
+                code_buffer_puts(output, "\\t");
                 break;
             case '\r':
-                fprintf(output, "\\r");
+                code_buffer_puts(output, "\\r");
                 break;
             case '\\':
-                fprintf(output, "\\\\");
+                code_buffer_puts(output, "\\\\");
                 break;
             case '"':
-                fprintf(output, "\\\"");
+                code_buffer_puts(output, "\\\"");
                 break;
             default:
-                fputc(*input, output);
+                code_buffer_putc(output, *input);
                 break;
         }
         input++;
     }
 }
 
+static bool program_uses_vectors(IRProgram *program)
+{
+    if (!program)
+        return false;
+
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        for (size_t j = 0; j < func->instructions.size; j++)
+        {
+            IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, j);
+            if (instr && instr->result && instr->result->vector_width > 0)
+                return true;
+        }
+    }
+    return false;
+}
+
 void codegen_c_writer_write_header(CodeGenerator *generator)
 {
-    fprintf(generator->output_file, "#include <stdio.h>\n");
-    fprintf(generator->output_file, "#include <stdlib.h>\n");
-    fprintf(generator->output_file, "#include <stdint.h>\n");
-    fprintf(generator->output_file, "#include <stdbool.h>\n");
-    fprintf(generator->output_file, "#include <inttypes.h>\n");
-    fprintf(generator->output_file, "#include <string.h>\n");
+    code_buffer_puts(generator->output, "#include <stdio.h>\n");
+    code_buffer_puts(generator->output, "#include <stdlib.h>\n");
+    code_buffer_puts(generator->output, "#include <stdint.h>\n");
+    code_buffer_puts(generator->output, "#include <stdbool.h>\n");
+    code_buffer_puts(generator->output, "#include <inttypes.h>\n");
+    code_buffer_puts(generator->output, "#include <string.h>\n");
     
     if (generator->program && generator->program->ffi_functions.size > 0)
     {
-        fprintf(generator->output_file, "#ifdef _WIN32\n");
-        fprintf(generator->output_file, "#include <windows.h>\n");
-        fprintf(generator->output_file, "#endif\n");
+        code_buffer_puts(generator->output, "#ifdef _WIN32\n");
+        code_buffer_puts(generator->output, "#include <windows.h>\n");
+        code_buffer_puts(generator->output, "#endif\n");
     }
     
-    fprintf(generator->output_file, "\n");
+    code_buffer_putc(generator->output, '\n');
 
     codegen_c_writer_write_runtime_functions(generator);
 
+    if (program_uses_vectors(generator->ir_program))
+    {
+        code_buffer_puts(generator->output, "typedef int64_t tl_v2i64 __attribute__((vector_size(16), aligned(8)));\n");
+        code_buffer_puts(generator->output, "typedef double tl_v2f64 __attribute__((vector_size(16), aligned(8)));\n");
+        code_buffer_puts(generator->output, "typedef float tl_v4f32 __attribute__((vector_size(16), aligned(4)));\n\n");
+    }
+
+    codegen_c_writer_write_profile_counters(generator);
     codegen_ffi_write_declarations(generator, generator->program);
     codegen_ffi_write_loading(generator, generator->program);
 
@@ -66,28 +92,58 @@ void codegen_c_writer_write_header(CodeGenerator *generator)
             DataType return_type = func->return_type;
 
             const char *return_type_str = codegen_c_writer_get_c_type_string(return_type);
-            fprintf(generator->output_file, "%s %s(", return_type_str, func->name);
+            code_buffer_printf(generator->output, "%s %s(", return_type_str, func->name);
 
             if (func->params.size == 0)
             {
-                fprintf(generator->output_file, "void");
+                code_buffer_puts(generator->output, "void");
             }
             else
             {
                 for (size_t j = 0; j < func->params.size; j++)
                 {
                     if (j > 0)
-                        fprintf(generator->output_file, ", ");
+                        code_buffer_puts(generator->output, ", ");
                     IROperand *param = (IROperand *)array_get(&func->params, j);
                     const char *param_type = codegen_c_writer_get_c_type_string(param->data_type);
-                    fprintf(generator->output_file, "%s %s", param_type, param->data.var_name);
+                    code_buffer_printf(generator->output, "%s %s", param_type, param->data.var_name);
                 }
             }
 
-            fprintf(generator->output_file, ");\n");
+            code_buffer_puts(generator->output, ");\n");
         }
     }
-    fprintf(generator->output_file, "\n");
+    code_buffer_putc(generator->output, '\n');
+}
+
+static void write_string_literal(CodeBuffer *out, const char *text)
+{
+    code_buffer_putc(out, '"');
+    for (const char *c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            code_buffer_putc(out, '\\');
+        code_buffer_putc(out, *c);
+    }
+    code_buffer_putc(out, '"');
+}
+
+void codegen_c_writer_write_profile_counters(CodeGenerator *generator)
+{
+    DynamicArray *counters = &generator->ir_program->profile_counters;
+    if (counters->size == 0)
+        return;
+
+    CodeBuffer *out = generator->output;
+    code_buffer_printf(out, "static uint64_t __tl_profile_counters[%zu];\n", counters->size);
+    code_buffer_printf(out, "static const char *const __tl_profile_names[%zu] = {\n", counters->size);
+    for (size_t i = 0; i < counters->size; i++)
+    {
+        code_buffer_puts(out, "    ");
+        write_string_literal(out, (const char *)array_get(counters, i));
+        code_buffer_puts(out, ",\n");
+    }
+    code_buffer_puts(out, "};\n\n");
 }
 
 void codegen_c_writer_write_runtime_functions(CodeGenerator *generator)
@@ -111,39 +167,42 @@ void codegen_c_writer_write_runtime_functions(CodeGenerator *generator)
     }
     normalized_path[strlen(runtime_header_path)] = '\0';
     
-    fprintf(generator->output_file, "#include \"%s\"\n\n", normalized_path);
+    code_buffer_printf(generator->output, "#include \"%s\"\n\n", normalized_path);
 }
 
 void codegen_c_writer_write_function_header(CodeGenerator *generator, IRFunction *func)
 {
     if (string_equal(func->name, "main"))
     {
-        fprintf(generator->output_file, "int main(void) {\n");
+        code_buffer_puts(generator->output, "int main(void) {\n");
     }
     else
     {
         DataType return_type = func->return_type;
 
         const char *return_type_str = codegen_c_writer_get_c_type_string(return_type);
-        fprintf(generator->output_file, "%s %s(", return_type_str, func->name);
+        if (func->memoize)
+            code_buffer_printf(generator->output, "static %s %s__impl(", return_type_str, func->name);
+        else
+            code_buffer_printf(generator->output, "%s %s(", return_type_str, func->name);
 
         if (func->params.size == 0)
         {
-            fprintf(generator->output_file, "void");
+            code_buffer_puts(generator->output, "void");
         }
         else
         {
             for (size_t i = 0; i < func->params.size; i++)
             {
                 if (i > 0)
-                    fprintf(generator->output_file, ", ");
+                    code_buffer_puts(generator->output, ", ");
                 IROperand *param = (IROperand *)array_get(&func->params, i);
                 const char *param_type = codegen_c_writer_get_c_type_string(param->data_type);
-                fprintf(generator->output_file, "%s %s", param_type, param->data.var_name);
+                code_buffer_printf(generator->output, "%s %s", param_type, param->data.var_name);
             }
         }
 
-        fprintf(generator->output_file, ") {\n");
+        code_buffer_puts(generator->output, ") {\n");
     }
 
     generator->indent_level++;
@@ -151,7 +210,16 @@ void codegen_c_writer_write_function_header(CodeGenerator *generator, IRFunction
     if (string_equal(func->name, "main") && generator->program && generator->program->ffi_functions.size > 0)
     {
         codegen_c_writer_write_indent(generator);
-        fprintf(generator->output_file, "load_ffi_functions();\n");
+        code_buffer_puts(generator->output, "load_ffi_functions();\n");
+    }
+
+    if (string_equal(func->name, "main") && generator->ir_program->profile_counters.size > 0)
+    {
+        codegen_c_writer_write_indent(generator);
+        code_buffer_puts(generator->output, "__tl_profile_register(");
+        write_string_literal(generator->output, generator->ir_program->profile_path);
+        code_buffer_printf(generator->output, ", __tl_profile_names, __tl_profile_counters, %zu);\n",
+                generator->ir_program->profile_counters.size);
     }
 
     for (size_t j = 0; j < func->instructions.size; j++)
@@ -163,7 +231,7 @@ void codegen_c_writer_write_function_header(CodeGenerator *generator, IRFunction
             {
                 codegen_c_writer_write_indent(generator);
                 const char *c_type = codegen_c_writer_get_c_type_string(instr->result->data_type);
-                fprintf(generator->output_file, "%s %s[%d];\n", c_type, instr->result->data.var_name, instr->result->array_size);
+                code_buffer_printf(generator->output, "%s %s[%d];\n", c_type, instr->result->data.var_name, instr->result->array_size);
             }
         }
         else if (instr->opcode == IR_VAR_DECL)
@@ -172,7 +240,7 @@ void codegen_c_writer_write_function_header(CodeGenerator *generator, IRFunction
             {
                 codegen_c_writer_write_indent(generator);
                 const char *c_type = codegen_c_writer_get_c_type_string(instr->result->data_type);
-                fprintf(generator->output_file, "%s %s;\n", c_type, instr->result->data.var_name);
+                code_buffer_printf(generator->output, "%s %s;\n", c_type, instr->result->data.var_name);
             }
         }
     }
@@ -216,6 +284,7 @@ void codegen_c_writer_write_function_header(CodeGenerator *generator, IRFunction
         char temp_name[32];
         snprintf(temp_name, sizeof(temp_name), "temp_%d", i);
         DataType temp_type = TYPE_INT;
+        int temp_width = 0;
 
         if (debug_enabled)
         {
@@ -233,6 +302,7 @@ void codegen_c_writer_write_function_header(CodeGenerator *generator, IRFunction
                 instr->result->data.temp_id == i)
             {
                 temp_type = instr->result->data_type;
+                temp_width = instr->result->vector_width;
                 found_as_result = true;
                 if (debug_enabled)
                 {
@@ -267,7 +337,8 @@ void codegen_c_writer_write_function_header(CodeGenerator *generator, IRFunction
             }
         }
 
-        const char *c_type = codegen_c_writer_get_c_type_string(temp_type);
+        const char *c_type = temp_width > 0 ? codegen_c_writer_get_vector_type_string(temp_type)
+                                            : codegen_c_writer_get_c_type_string(temp_type);
         if (debug_enabled)
         {
             printf("[DEBUG] codegen: temp_%d final type: %s\n", i, c_type);
@@ -279,28 +350,96 @@ void codegen_c_writer_write_function_header(CodeGenerator *generator, IRFunction
 
     if (func->temp_counter > 0)
     {
-        fprintf(generator->output_file, "\n");
+        code_buffer_putc(generator->output, '\n');
     }
 }
 
 void codegen_c_writer_write_function_footer(CodeGenerator *generator)
 {
     generator->indent_level--;
-    fprintf(generator->output_file, "}\n\n");
+    code_buffer_puts(generator->output, "}\n\n");
+}
+
+static void write_memo_call(CodeGenerator *generator, IRFunction *func)
+{
+    code_buffer_printf(generator->output, "%s__impl(", func->name);
+    for (size_t i = 0; i < func->params.size; i++)
+    {
+        IROperand *param = (IROperand *)array_get(&func->params, i);
+        code_buffer_printf(generator->output, "%s%s", i > 0 ? ", " : "", param->data.var_name);
+    }
+    code_buffer_puts(generator->output, ");\n");
+}
+
+/* Emits the public entry point of a memoized function. Single-argument
+   functions look small non-negative arguments up in a direct array; all
+   other calls go through the runtime's open-addressing table. */
+void codegen_c_writer_write_memo_wrapper(CodeGenerator *generator, IRFunction *func)
+{
+    CodeBuffer *out = generator->output;
+    const char *name = func->name;
+    const char *return_type_str = codegen_c_writer_get_c_type_string(func->return_type);
+    bool direct = func->params.size == 1;
+
+    if (direct)
+    {
+        code_buffer_printf(out, "static int64_t %s__memo_direct[TL_MEMO_DIRECT_SIZE];\n", name);
+        code_buffer_printf(out, "static unsigned char %s__memo_known[TL_MEMO_DIRECT_SIZE];\n", name);
+    }
+    code_buffer_printf(out, "static TLMemoTable %s__memo = {%zu, 0, 0, NULL, NULL, NULL};\n\n", name, func->params.size);
+
+    code_buffer_printf(out, "%s %s(", return_type_str, name);
+    for (size_t i = 0; i < func->params.size; i++)
+    {
+        IROperand *param = (IROperand *)array_get(&func->params, i);
+        code_buffer_printf(out, "%s%s %s", i > 0 ? ", " : "", codegen_c_writer_get_c_type_string(param->data_type),
+                param->data.var_name);
+    }
+    code_buffer_puts(out, ") {\n");
+    code_buffer_puts(out, "    int64_t memo_result;\n");
+
+    if (direct)
+    {
+        const char *arg = ((IROperand *)array_get(&func->params, 0))->data.var_name;
+        code_buffer_printf(out, "    if (%s >= 0 && %s < TL_MEMO_DIRECT_SIZE) {\n", arg, arg);
+        code_buffer_printf(out, "        if (%s__memo_known[%s]) return (%s)%s__memo_direct[%s];\n",
+                name, arg, return_type_str, name, arg);
+        code_buffer_puts(out, "        memo_result = ");
+        write_memo_call(generator, func);
+        code_buffer_printf(out, "        %s__memo_direct[%s] = memo_result;\n", name, arg);
+        code_buffer_printf(out, "        %s__memo_known[%s] = 1;\n", name, arg);
+        code_buffer_printf(out, "        return (%s)memo_result;\n", return_type_str);
+        code_buffer_puts(out, "    }\n");
+    }
+
+    code_buffer_printf(out, "    int64_t memo_key[%zu] = {", func->params.size);
+    for (size_t i = 0; i < func->params.size; i++)
+    {
+        IROperand *param = (IROperand *)array_get(&func->params, i);
+        code_buffer_printf(out, "%s%s", i > 0 ? ", " : "", param->data.var_name);
+    }
+    code_buffer_puts(out, "};\n");
+    code_buffer_printf(out, "    if (__tl_memo_lookup(&%s__memo, memo_key, &memo_result)) return (%s)memo_result;\n",
+            name, return_type_str);
+    code_buffer_puts(out, "    memo_result = ");
+    write_memo_call(generator, func);
+    code_buffer_printf(out, "    __tl_memo_store(&%s__memo, memo_key, memo_result);\n", name);
+    code_buffer_printf(out, "    return (%s)memo_result;\n", return_type_str);
+    code_buffer_puts(out, "}\n\n");
 }
 
 void codegen_c_writer_write_main_function(CodeGenerator *generator)
 {
-    fprintf(generator->output_file, "int main() {\n");
-    fprintf(generator->output_file, "    return 0;\n");
-    fprintf(generator->output_file, "}\n");
+    code_buffer_puts(generator->output, "int main() {\n");
+    code_buffer_puts(generator->output, "    return 0;\n");
+    code_buffer_puts(generator->output, "}\n");
 }
 
 void codegen_c_writer_write_operand(CodeGenerator *generator, IROperand *operand)
 {
     if (!operand)
     {
-        fprintf(generator->output_file, "NULL");
+        code_buffer_puts(generator->output, "NULL");
         return;
     }
 
@@ -309,48 +448,46 @@ void codegen_c_writer_write_operand(CodeGenerator *generator, IROperand *operand
     case IR_OP_CONST:
         if (operand->data_type == TYPE_FLOAT || operand->data_type == TYPE_DOUBLE || operand->is_float_const)
         {
-            fprintf(generator->output_file, "%f", operand->data.float_const_value);
+            code_buffer_printf(generator->output, "%f", operand->data.float_const_value);
         }
         else if (operand->data_type == TYPE_BOOL)
         {
-            fprintf(generator->output_file, "%s", operand->data.const_value ? "true" : "false");
+            code_buffer_puts(generator->output, operand->data.const_value ? "true" : "false");
         }
         else
         {
-            fprintf(generator->output_file, "%lld", operand->data.const_value);
+            code_buffer_int(generator->output, operand->data.const_value);
         }
         break;
 
     case IR_OP_STRING_CONST:
-        fprintf(generator->output_file, "\"");
-        escape_string_for_c(operand->data.string_const_value, generator->output_file);
-        fprintf(generator->output_file, "\"");
+        code_buffer_putc(generator->output, '"');
+        escape_string_for_c(operand->data.string_const_value, generator->output);
+        code_buffer_putc(generator->output, '"');
         break;
 
     case IR_OP_VAR:
-        fprintf(generator->output_file, "%s", operand->data.var_name);
+        code_buffer_puts(generator->output, operand->data.var_name);
         break;
 
     case IR_OP_TEMP:
-        fprintf(generator->output_file, "temp_%d", operand->data.temp_id);
+        code_buffer_append(generator->output, "temp_", 5);
+        code_buffer_int(generator->output, operand->data.temp_id);
         break;
 
     case IR_OP_NULL:
-        fprintf(generator->output_file, "NULL");
+        code_buffer_puts(generator->output, "NULL");
         break;
 
     default:
-        fprintf(generator->output_file, "UNKNOWN");
+        code_buffer_puts(generator->output, "UNKNOWN");
         break;
     }
 }
 
 void codegen_c_writer_write_indent(CodeGenerator *generator)
 {
-    for (int i = 0; i < generator->indent_level; i++)
-    {
-        fprintf(generator->output_file, "    ");
-    }
+    code_buffer_indent(generator->output, generator->indent_level);
 }
 
 void codegen_c_writer_write_line(CodeGenerator *generator, const char *format, ...)
@@ -359,8 +496,8 @@ void codegen_c_writer_write_line(CodeGenerator *generator, const char *format, .
     va_start(args, format);
 
     codegen_c_writer_write_indent(generator);
-    vfprintf(generator->output_file, format, args);
-    fprintf(generator->output_file, "\n");
+    code_buffer_vprintf(generator->output, format, args);
+    code_buffer_putc(generator->output, '\n');
 
     va_end(args);
 }
@@ -390,6 +527,19 @@ const char *codegen_c_writer_get_c_type_string(DataType type)
     }
 }
 
+const char *codegen_c_writer_get_vector_type_string(DataType type)
+{
+    switch (type)
+    {
+    case TYPE_FLOAT:
+        return "tl_v4f32";
+    case TYPE_DOUBLE:
+        return "tl_v2f64";
+    default:
+        return "tl_v2i64";
+    }
+}
+
 const char *get_printf_format(DataType type)
 {
     switch (type)
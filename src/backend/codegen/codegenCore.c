@@ -17,6 +17,7 @@ CodeGenerator *codegen_core_create(IRProgram *ir_program, Program *program, FILE
     generator->ir_program = ir_program;
     generator->program = program;
     generator->output_file = output_file;
+    generator->output = code_buffer_create();
     generator->error = error;
     generator->indent_level = 0;
     generator->temp_counter = 0;
@@ -30,6 +31,15 @@ CodeGenerator *codegen_core_create(IRProgram *ir_program, Program *program, FILE
     generator->current_function_return_type = TYPE_INT;
     generator->epilogue_label[0] = '\0';
     generator->declared_temps = hashtable_create(16);
+    generator->in_cold_block = false;
+    generator->register_allocation = NULL;
+    generator->string_labels = NULL;
+    generator->float_labels = NULL;
+    generator->local_offsets = NULL;
+    generator->saved_registers = 0;
+    generator->emitted_instructions = 0;
+    generator->function_code = NULL;
+    generator->peephole_stats = NULL;
     return generator;
 }
 
@@ -47,6 +57,7 @@ void codegen_core_destroy(CodeGenerator *generator)
     hashtable_destroy(generator->array_info);
     hashtable_destroy(generator->variable_types);
     hashtable_destroy(generator->declared_temps);
+    code_buffer_destroy(generator->output);
     safe_free(generator);
 }
 
@@ -65,6 +76,11 @@ bool codegen_core_generate(CodeGenerator *generator)
 
     generator->strategy->generate_header(generator);
     generator->strategy->generate_program(generator);
+    if (!code_buffer_flush(generator->output, generator->output_file))
+    {
+        codegen_core_error(generator, "Cannot write the generated code");
+        return false;
+    }
     return true;
 }
 
@@ -113,10 +129,7 @@ void codegen_core_generate_function(CodeGenerator *generator, IRFunction *func)
 
 void codegen_core_write_indent(CodeGenerator *generator)
 {
-    for (int i = 0; i < generator->indent_level; i++)
-    {
-        fprintf(generator->output_file, "    ");
-    }
+    code_buffer_indent(generator->output, generator->indent_level);
 }
 
 void codegen_core_write_line(CodeGenerator *generator, const char *format, ...)
@@ -125,8 +138,8 @@ void codegen_core_write_line(CodeGenerator *generator, const char *format, ...)
     va_start(args, format);
 
     codegen_core_write_indent(generator);
-    vfprintf(generator->output_file, format, args);
-    fprintf(generator->output_file, "\n");
+    code_buffer_vprintf(generator->output, format, args);
+    code_buffer_putc(generator->output, '\n');
 
     va_end(args);
 }
@@ -8,7 +8,7 @@ void codegen_ffi_write_declarations(CodeGenerator *generator, Program *program)
     if (!program || program->ffi_functions.size == 0)
         return;
     
-    fprintf(generator->output_file, "// FFI Function Pointers\n");
+    code_buffer_puts(generator->output, "// FFI Function Pointers\n");
     
     for (size_t i = 0; i < program->ffi_functions.size; i++)
     {
@@ -16,31 +16,31 @@ void codegen_ffi_write_declarations(CodeGenerator *generator, Program *program)
         
         const char *return_type = ffi_twink_to_c_type(ffi_func->return_type);
         
-        fprintf(generator->output_file, "typedef %s (*%s_func_t)(", return_type, ffi_func->name);
+        code_buffer_printf(generator->output, "typedef %s (*%s_func_t)(", return_type, ffi_func->name);
         
         DynamicArray *params = (DynamicArray*)ffi_func->params;
         if (params->size == 0)
         {
-            fprintf(generator->output_file, "void");
+            code_buffer_puts(generator->output, "void");
         }
         else
         {
             for (size_t j = 0; j < params->size; j++)
             {
                 if (j > 0)
-                    fprintf(generator->output_file, ", ");
+                    code_buffer_puts(generator->output, ", ");
                 Parameter *param = (Parameter *)array_get(params, j);
                 const char *param_type = ffi_twink_to_c_type(param->type);
-                fprintf(generator->output_file, "%s", param_type);
+                code_buffer_puts(generator->output, param_type);
             }
         }
         
-        fprintf(generator->output_file, ");\n");
+        code_buffer_puts(generator->output, ");\n");
         
-        fprintf(generator->output_file, "%s_func_t ffi_%s;\n", ffi_func->name, ffi_func->name);
+        code_buffer_printf(generator->output, "%s_func_t ffi_%s;\n", ffi_func->name, ffi_func->name);
     }
     
-    fprintf(generator->output_file, "\n");
+    code_buffer_putc(generator->output, '\n');
 }
 
 void codegen_ffi_write_loading(CodeGenerator *generator, Program *program)
@@ -48,9 +48,9 @@ void codegen_ffi_write_loading(CodeGenerator *generator, Program *program)
     if (!program || program->ffi_functions.size == 0)
         return;
     
-    fprintf(generator->output_file, "// FFI Dynamic Loading\n");
+    code_buffer_puts(generator->output, "// FFI Dynamic Loading\n");
     
-    fprintf(generator->output_file, "void load_ffi_functions() {\n");
+    code_buffer_puts(generator->output, "void load_ffi_functions() {\n");
     generator->indent_level++;
     
     HashTable *loaded_libs = hashtable_create(8);
@@ -71,39 +71,39 @@ void codegen_ffi_write_loading(CodeGenerator *generator, Program *program)
         if (!hashtable_get(loaded_libs, ffi_func->library))
         {
             codegen_core_write_indent(generator);
-            fprintf(generator->output_file, "void* %s = LoadLibraryA(\"%s\");\n", lib_var_name, ffi_func->library);
+            code_buffer_printf(generator->output, "void* %s = LoadLibraryA(\"%s\");\n", lib_var_name, ffi_func->library);
             
             codegen_core_write_indent(generator);
-            fprintf(generator->output_file, "if (!%s) {\n", lib_var_name);
+            code_buffer_printf(generator->output, "if (!%s) {\n", lib_var_name);
             generator->indent_level++;
             codegen_core_write_indent(generator);
-            fprintf(generator->output_file, "fprintf(stderr, \"Failed to load library: %s\\n\");\n", ffi_func->library);
+            code_buffer_printf(generator->output, "fprintf(stderr, \"Failed to load library: %s\\n\");\n", ffi_func->library);
             codegen_core_write_indent(generator);
-            fprintf(generator->output_file, "exit(1);\n");
+            code_buffer_puts(generator->output, "exit(1);\n");
             generator->indent_level--;
             codegen_core_write_indent(generator);
-            fprintf(generator->output_file, "}\n");
+            code_buffer_puts(generator->output, "}\n");
             
             hashtable_put(loaded_libs, ffi_func->library, (void*)1);
         }
         
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, "void* %s_ptr = GetProcAddress(%s, \"%s\");\n", 
+        code_buffer_printf(generator->output, "void* %s_ptr = GetProcAddress(%s, \"%s\");\n", 
                 ffi_func->name, lib_var_name, ffi_func->name);
         
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, "if (!%s_ptr) {\n", ffi_func->name);
+        code_buffer_printf(generator->output, "if (!%s_ptr) {\n", ffi_func->name);
         generator->indent_level++;
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, "fprintf(stderr, \"Failed to resolve function: %s\\n\");\n", ffi_func->name);
+        code_buffer_printf(generator->output, "fprintf(stderr, \"Failed to resolve function: %s\\n\");\n", ffi_func->name);
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, "exit(1);\n");
+        code_buffer_puts(generator->output, "exit(1);\n");
         generator->indent_level--;
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, "}\n");
+        code_buffer_puts(generator->output, "}\n");
         
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, "ffi_%s = (%s_func_t)%s_ptr;\n", 
+        code_buffer_printf(generator->output, "ffi_%s = (%s_func_t)%s_ptr;\n", 
                 ffi_func->name, ffi_func->name, ffi_func->name);
         
         safe_free(lib_var_name);
@@ -112,7 +112,7 @@ void codegen_ffi_write_loading(CodeGenerator *generator, Program *program)
     hashtable_destroy(loaded_libs);
     
     generator->indent_level--;
-    fprintf(generator->output_file, "}\n\n");
+    code_buffer_puts(generator->output, "}\n\n");
 }
 
 bool codegen_is_ffi_function(CodeGenerator *generator, const char *func_name)
@@ -28,6 +28,9 @@ void codegen_instruction_handlers_generate_instruction(CodeGenerator *generator,
     case IR_MUL:
     case IR_DIV:
     case IR_MOD:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
         codegen_handle_arithmetic(generator, instr);
         break;
     case IR_NEG:
@@ -76,6 +79,16 @@ void codegen_instruction_handlers_generate_instruction(CodeGenerator *generator,
     case IR_INLINE_ASM:
         codegen_handle_inline_asm(generator, instr);
         break;
+    case IR_VECTOR_SPLAT:
+    case IR_VECTOR_INDEX:
+        codegen_handle_vector_build(generator, instr);
+        break;
+    case IR_VECTOR_REDUCE:
+        codegen_handle_vector_reduce(generator, instr);
+        break;
+    case IR_PROFILE:
+        codegen_handle_profile(generator, instr);
+        break;
     case IR_EQ:
     case IR_NE:
     case IR_LT:
@@ -97,29 +110,46 @@ void codegen_handle_nop(CodeGenerator *generator, IRInstruction *instr)
 
 void codegen_handle_label(CodeGenerator *generator, IRInstruction *instr)
 {
-    codegen_core_write_line(generator, "%s:", instr->label);
+    generator->in_cold_block = instr->is_cold;
+    if (instr->is_cold)
+        codegen_core_write_line(generator, "%s: TL_COLD_LABEL;", instr->label);
+    else
+        codegen_core_write_line(generator, "%s:", instr->label);
 }
 
 void codegen_handle_jump(CodeGenerator *generator, IRInstruction *instr)
 {
     codegen_core_write_indent(generator);
-    fprintf(generator->output_file, "goto %s;\n", instr->label);
+    code_buffer_printf(generator->output, "goto %s;\n", instr->label);
 }
 
-void codegen_handle_jump_if(CodeGenerator *generator, IRInstruction *instr)
+/* Branches the profile shows to be heavily biased are wrapped in
+   TL_LIKELY/TL_UNLIKELY so the C compiler lays them out accordingly. */
+static void write_branch(CodeGenerator *generator, IRInstruction *instr, bool negate)
 {
+    static const char *const hints[] = {"TL_UNLIKELY", NULL, "TL_LIKELY"};
+    const char *hint = hints[ir_instruction_branch_bias(instr) + 1];
+
     codegen_core_write_indent(generator);
-    fprintf(generator->output_file, "if (");
+    code_buffer_puts(generator->output, "if (");
+    if (hint)
+        code_buffer_printf(generator->output, "%s(", hint);
+    if (negate)
+        code_buffer_putc(generator->output, '!');
     codegen_c_writer_write_operand(generator, instr->arg1);
-    fprintf(generator->output_file, ") goto %s;\n", instr->label);
+    if (hint)
+        code_buffer_putc(generator->output, ')');
+    code_buffer_printf(generator->output, ") goto %s;\n", instr->label);
+}
+
+void codegen_handle_jump_if(CodeGenerator *generator, IRInstruction *instr)
+{
+    write_branch(generator, instr, false);
 }
 
 void codegen_handle_jump_if_false(CodeGenerator *generator, IRInstruction *instr)
 {
-    codegen_core_write_indent(generator);
-    fprintf(generator->output_file, "if (!");
-    codegen_c_writer_write_operand(generator, instr->arg1);
-    fprintf(generator->output_file, ") goto %s;\n", instr->label);
+    write_branch(generator, instr, true);
 }
 
 void codegen_handle_return(CodeGenerator *generator, IRInstruction *instr)
@@ -127,17 +157,17 @@ void codegen_handle_return(CodeGenerator *generator, IRInstruction *instr)
     codegen_core_write_indent(generator);
     if (generator->current_function_return_type == TYPE_VOID)
     {
-        fprintf(generator->output_file, "return;\n");
+        code_buffer_puts(generator->output, "return;\n");
     }
     else if (instr->arg1)
     {
-        fprintf(generator->output_file, "return ");
+        code_buffer_puts(generator->output, "return ");
         codegen_c_writer_write_operand(generator, instr->arg1);
-        fprintf(generator->output_file, ";\n");
+        code_buffer_puts(generator->output, ";\n");
     }
     else
     {
-        fprintf(generator->output_file, "return 0;\n");
+        code_buffer_puts(generator->output, "return 0;\n");
     }
 }
 
@@ -145,73 +175,73 @@ void codegen_handle_move(CodeGenerator *generator, IRInstruction *instr)
 {
     codegen_core_write_indent(generator);
     codegen_c_writer_write_operand(generator, instr->result);
-    fprintf(generator->output_file, " = ");
+    code_buffer_puts(generator->output, " = ");
     if (instr->arg1 && instr->arg1->type == IR_OP_NULL)
     {
         if (instr->result && instr->result->data_type == TYPE_INT)
         {
-            fprintf(generator->output_file, "0");
+            code_buffer_putc(generator->output, '0');
         }
         else if (instr->result && instr->result->data_type == TYPE_BOOL)
         {
-            fprintf(generator->output_file, "false");
+            code_buffer_puts(generator->output, "false");
         }
         else if (instr->result && instr->result->data_type == TYPE_FLOAT)
         {
-            fprintf(generator->output_file, "0.0f");
+            code_buffer_puts(generator->output, "0.0f");
         }
         else if (instr->result && instr->result->data_type == TYPE_DOUBLE)
         {
-            fprintf(generator->output_file, "0.0");
+            code_buffer_puts(generator->output, "0.0");
         }
         else if (instr->result && instr->result->data_type == TYPE_STRING)
         {
-            fprintf(generator->output_file, "NULL");
+            code_buffer_puts(generator->output, "NULL");
         }
         else
         {
-            fprintf(generator->output_file, "NULL");
+            code_buffer_puts(generator->output, "NULL");
         }
     }
     else
     {
         codegen_c_writer_write_operand(generator, instr->arg1);
     }
-    fprintf(generator->output_file, ";\n");
+    code_buffer_puts(generator->output, ";\n");
 }
 
 void codegen_handle_arithmetic(CodeGenerator *generator, IRInstruction *instr)
 {
     codegen_core_write_indent(generator);
     codegen_c_writer_write_operand(generator, instr->result);
-    fprintf(generator->output_file, " = ");
+    code_buffer_puts(generator->output, " = ");
 
     codegen_c_writer_write_operand(generator, instr->arg1);
-    fprintf(generator->output_file, " %s ", ir_opcode_to_string(instr->opcode));
+    code_buffer_printf(generator->output, " %s ", ir_opcode_to_string(instr->opcode));
     codegen_c_writer_write_operand(generator, instr->arg2);
-    fprintf(generator->output_file, ";\n");
+    code_buffer_puts(generator->output, ";\n");
 }
 
 void codegen_handle_unary_arithmetic(CodeGenerator *generator, IRInstruction *instr)
 {
     codegen_core_write_indent(generator);
     codegen_c_writer_write_operand(generator, instr->result);
-    fprintf(generator->output_file, " = %s",
+    code_buffer_printf(generator->output, " = %s",
             instr->opcode == IR_NEG ? "-" : "!");
     codegen_c_writer_write_operand(generator, instr->arg1);
-    fprintf(generator->output_file, ";\n");
+    code_buffer_puts(generator->output, ";\n");
 }
 
 void codegen_handle_comparison(CodeGenerator *generator, IRInstruction *instr)
 {
     codegen_core_write_indent(generator);
     codegen_c_writer_write_operand(generator, instr->result);
-    fprintf(generator->output_file, " = ");
+    code_buffer_puts(generator->output, " = ");
 
     codegen_c_writer_write_operand(generator, instr->arg1);
-    fprintf(generator->output_file, " %s ", ir_opcode_to_string(instr->opcode));
+    code_buffer_printf(generator->output, " %s ", ir_opcode_to_string(instr->opcode));
     codegen_c_writer_write_operand(generator, instr->arg2);
-    fprintf(generator->output_file, ";\n");
+    code_buffer_puts(generator->output, ";\n");
 }
 
 void codegen_handle_param(CodeGenerator *generator, IRInstruction *instr)
@@ -228,14 +258,14 @@ void codegen_handle_call(CodeGenerator *generator, IRInstruction *instr)
     if (instr->result)
     {
         codegen_c_writer_write_operand(generator, instr->result);
-        fprintf(generator->output_file, " = ");
+        code_buffer_puts(generator->output, " = ");
     }
 
     const char *func_name = instr->label;
     
     if (codegen_is_ffi_function(generator, func_name))
     {
-        fprintf(generator->output_file, "ffi_%s(", func_name);
+        code_buffer_printf(generator->output, "ffi_%s(", func_name);
     }
     else if (strcmp(func_name, "concat") == 0 ||
         strcmp(func_name, "substr") == 0 ||
@@ -243,126 +273,216 @@ void codegen_handle_call(CodeGenerator *generator, IRInstruction *instr)
         strcmp(func_name, "strcmp") == 0 ||
         strcmp(func_name, "char_at") == 0)
     {
-        fprintf(generator->output_file, "__tl_%s(", func_name);
+        code_buffer_printf(generator->output, "__tl_%s(", func_name);
     }
     else
     {
-        fprintf(generator->output_file, "%s(", func_name);
+        code_buffer_printf(generator->output, "%s(", func_name);
     }
 
     for (int i = 0; i < generator->param_count; i++)
     {
         if (i > 0)
-            fprintf(generator->output_file, ", ");
+            code_buffer_puts(generator->output, ", ");
         codegen_c_writer_write_operand(generator, generator->params[i]);
     }
 
-    fprintf(generator->output_file, ");\n");
+    code_buffer_puts(generator->output, ");\n");
     generator->param_count = 0;
 }
 
+/* Integer literals are plain ints in C; printf's %lld needs a long long. */
+static void write_print_operand(CodeGenerator *generator, IROperand *operand)
+{
+    if (operand->type == IR_OP_CONST && !operand->is_float_const && operand->data_type != TYPE_BOOL &&
+        operand->data_type != TYPE_FLOAT && operand->data_type != TYPE_DOUBLE)
+    {
+        code_buffer_printf(generator->output, "%lldLL", (long long)operand->data.const_value);
+        return;
+    }
+    codegen_c_writer_write_operand(generator, operand);
+}
+
 void codegen_handle_print(CodeGenerator *generator, IRInstruction *instr)
 {
     codegen_core_write_indent(generator);
     if (instr->args)
     {
-        fprintf(generator->output_file, "printf(\"");
+        code_buffer_puts(generator->output, "printf(\"");
         for (size_t i = 0; i < instr->args->size; i++)
         {
             IROperand *arg = (IROperand *)array_get(instr->args, i);
             if (arg->data_type == TYPE_STRING)
             {
-                fprintf(generator->output_file, "%%s");
+                code_buffer_puts(generator->output, "%s");
             }
             else if (arg->data_type == TYPE_FLOAT || arg->data_type == TYPE_DOUBLE || arg->is_float_const)
             {
-                fprintf(generator->output_file, "%%f");
+                code_buffer_puts(generator->output, "%f");
             }
             else if (arg->data_type == TYPE_BOOL)
             {
-                fprintf(generator->output_file, "%%d");
+                code_buffer_puts(generator->output, "%d");
             }
             else
             {
-                fprintf(generator->output_file, "%%lld");
+                code_buffer_puts(generator->output, "%lld");
             }
         }
-        fprintf(generator->output_file, "\\n\"");
+        code_buffer_puts(generator->output, "\\n\"");
         
         for (size_t i = 0; i < instr->args->size; i++)
         {
-            fprintf(generator->output_file, ", ");
-            codegen_c_writer_write_operand(generator, (IROperand *)array_get(instr->args, i));
+            code_buffer_puts(generator->output, ", ");
+            write_print_operand(generator, (IROperand *)array_get(instr->args, i));
         }
-        fprintf(generator->output_file, ");\n");
+        code_buffer_puts(generator->output, ");\n");
     }
     else if (instr->arg1)
     {
-        if (instr->arg1->data_type == TYPE_STRING)
+        if (instr->arg1->data_type == TYPE_STRING && generator->in_cold_block)
         {
-            fprintf(generator->output_file, "printf(\"%%s\\n\", ");
+            /* Keeps the call setup for error messages out of hot code. */
+            code_buffer_puts(generator->output, "__tl_cold_print(");
             codegen_c_writer_write_operand(generator, instr->arg1);
-            fprintf(generator->output_file, ");\n");
+            code_buffer_puts(generator->output, ");\n");
+        }
+        else if (instr->arg1->data_type == TYPE_STRING)
+        {
+            code_buffer_puts(generator->output, "printf(\"%s\\n\", ");
+            codegen_c_writer_write_operand(generator, instr->arg1);
+            code_buffer_puts(generator->output, ");\n");
         }
         else if (instr->arg1->data_type == TYPE_FLOAT || instr->arg1->data_type == TYPE_DOUBLE || instr->arg1->is_float_const)
         {
-            fprintf(generator->output_file, "printf(\"%%f\\n\", ");
+            code_buffer_puts(generator->output, "printf(\"%f\\n\", ");
             codegen_c_writer_write_operand(generator, instr->arg1);
-            fprintf(generator->output_file, ");\n");
+            code_buffer_puts(generator->output, ");\n");
         }
         else if (instr->arg1->data_type == TYPE_BOOL)
         {
-            fprintf(generator->output_file, "printf(\"%%d\\n\", ");
+            code_buffer_puts(generator->output, "printf(\"%d\\n\", ");
             codegen_c_writer_write_operand(generator, instr->arg1);
-            fprintf(generator->output_file, ");\n");
+            code_buffer_puts(generator->output, ");\n");
         }
         else
         {
-            fprintf(generator->output_file, "printf(\"%%lld\\n\", ");
-            codegen_c_writer_write_operand(generator, instr->arg1);
-            fprintf(generator->output_file, ");\n");
+            code_buffer_puts(generator->output, "printf(\"%lld\\n\", ");
+            write_print_operand(generator, instr->arg1);
+            code_buffer_puts(generator->output, ");\n");
         }
     }
 }
 
+static void write_element_address(CodeGenerator *generator, IRInstruction *instr)
+{
+    code_buffer_putc(generator->output, '&');
+    codegen_c_writer_write_operand(generator, instr->arg1);
+    code_buffer_putc(generator->output, '[');
+    codegen_c_writer_write_operand(generator, instr->arg2);
+    code_buffer_putc(generator->output, ']');
+}
+
 void codegen_handle_array_load(CodeGenerator *generator, IRInstruction *instr)
 {
     codegen_core_write_indent(generator);
+    if (instr->result->vector_width > 0)
+    {
+        codegen_c_writer_write_operand(generator, instr->result);
+        code_buffer_printf(generator->output, " = *(%s *)",
+                codegen_c_writer_get_vector_type_string(instr->result->data_type));
+        write_element_address(generator, instr);
+        code_buffer_puts(generator->output, ";\n");
+        return;
+    }
     codegen_c_writer_write_operand(generator, instr->result);
-    fprintf(generator->output_file, " = ");
+    code_buffer_puts(generator->output, " = ");
     codegen_c_writer_write_operand(generator, instr->arg1);
-    fprintf(generator->output_file, "[");
+    code_buffer_putc(generator->output, '[');
     codegen_c_writer_write_operand(generator, instr->arg2);
-    fprintf(generator->output_file, "];\n");
+    code_buffer_puts(generator->output, "];\n");
 }
 
 void codegen_handle_array_store(CodeGenerator *generator, IRInstruction *instr)
 {
     codegen_core_write_indent(generator);
+    if (instr->result->vector_width > 0)
+    {
+        code_buffer_printf(generator->output, "*(%s *)",
+                codegen_c_writer_get_vector_type_string(instr->result->data_type));
+        write_element_address(generator, instr);
+        code_buffer_puts(generator->output, " = ");
+        codegen_c_writer_write_operand(generator, instr->result);
+        code_buffer_puts(generator->output, ";\n");
+        return;
+    }
     codegen_c_writer_write_operand(generator, instr->arg1);
-    fprintf(generator->output_file, "[");
+    code_buffer_putc(generator->output, '[');
     codegen_c_writer_write_operand(generator, instr->arg2);
-    fprintf(generator->output_file, "] = ");
+    code_buffer_puts(generator->output, "] = ");
     codegen_c_writer_write_operand(generator, instr->result);
-    fprintf(generator->output_file, ";\n");
+    code_buffer_puts(generator->output, ";\n");
 }
 
-void codegen_handle_bounds_check(CodeGenerator *generator, IRInstruction *instr)
+void codegen_handle_vector_build(CodeGenerator *generator, IRInstruction *instr)
 {
+    const char *lane_type = codegen_c_writer_get_c_type_string(instr->result->data_type);
     codegen_core_write_indent(generator);
-    fprintf(generator->output_file, "if (");
-    codegen_c_writer_write_operand(generator, instr->arg1);
-    fprintf(generator->output_file, " >= ");
-    codegen_c_writer_write_operand(generator, instr->arg2);
-    fprintf(generator->output_file, ") {\n");
-    generator->indent_level++;
+    codegen_c_writer_write_operand(generator, instr->result);
+    code_buffer_printf(generator->output, " = (%s){",
+            codegen_c_writer_get_vector_type_string(instr->result->data_type));
+    for (int lane = 0; lane < instr->result->vector_width; lane++)
+    {
+        code_buffer_printf(generator->output, "%s(%s)(", lane > 0 ? ", " : "", lane_type);
+        codegen_c_writer_write_operand(generator, instr->arg1);
+        if (instr->opcode == IR_VECTOR_INDEX)
+        {
+            code_buffer_printf(generator->output, " + %d", lane);
+        }
+        code_buffer_putc(generator->output, ')');
+    }
+    code_buffer_puts(generator->output, "};\n");
+}
+
+void codegen_handle_vector_reduce(CodeGenerator *generator, IRInstruction *instr)
+{
     codegen_core_write_indent(generator);
-    fprintf(generator->output_file, "fprintf(stderr, \"Array index out of bounds\\n\");\n");
+    codegen_c_writer_write_operand(generator, instr->result);
+    code_buffer_puts(generator->output, " = ");
+    for (int lane = 0; lane < instr->arg1->vector_width; lane++)
+    {
+        if (lane > 0)
+            code_buffer_puts(generator->output, " + ");
+        codegen_c_writer_write_operand(generator, instr->arg1);
+        code_buffer_printf(generator->output, "[%d]", lane);
+    }
+    code_buffer_puts(generator->output, ";\n");
+}
+
+void codegen_handle_profile(CodeGenerator *generator, IRInstruction *instr)
+{
     codegen_core_write_indent(generator);
-    fprintf(generator->output_file, "exit(1);\n");
-    generator->indent_level--;
+    code_buffer_printf(generator->output, "__tl_profile_counters[%lld]", (long long)instr->arg2->data.const_value);
+    if (instr->arg1)
+    {
+        code_buffer_puts(generator->output, " += (");
+        codegen_c_writer_write_operand(generator, instr->arg1);
+        code_buffer_puts(generator->output, ") != 0;\n");
+    }
+    else
+    {
+        code_buffer_puts(generator->output, "++;\n");
+    }
+}
+
+void codegen_handle_bounds_check(CodeGenerator *generator, IRInstruction *instr)
+{
     codegen_core_write_indent(generator);
-    fprintf(generator->output_file, "}\n");
+    code_buffer_puts(generator->output, "if (TL_UNLIKELY(");
+    codegen_c_writer_write_operand(generator, instr->arg1);
+    code_buffer_puts(generator->output, " >= ");
+    codegen_c_writer_write_operand(generator, instr->arg2);
+    code_buffer_puts(generator->output, ")) __tl_bounds_error();\n");
 }
 
 void codegen_handle_array_decl(CodeGenerator *generator, IRInstruction *instr)
@@ -374,16 +494,16 @@ void codegen_handle_array_decl(CodeGenerator *generator, IRInstruction *instr)
 void codegen_handle_array_init(CodeGenerator *generator, IRInstruction *instr)
 {
     codegen_core_write_indent(generator);
-    fprintf(generator->output_file, "for (int i = 0; i < %d; i++) {\n", instr->result->array_size);
+    code_buffer_printf(generator->output, "for (int i = 0; i < %d; i++) {\n", instr->result->array_size);
     generator->indent_level++;
     codegen_core_write_indent(generator);
     codegen_c_writer_write_operand(generator, instr->result);
-    fprintf(generator->output_file, "[i] = ");
+    code_buffer_puts(generator->output, "[i] = ");
     codegen_c_writer_write_operand(generator, instr->arg1);
-    fprintf(generator->output_file, ";\n");
+    code_buffer_puts(generator->output, ";\n");
     generator->indent_level--;
     codegen_core_write_indent(generator);
-    fprintf(generator->output_file, "}\n");
+    code_buffer_puts(generator->output, "}\n");
 }
 
 void codegen_handle_var_decl(CodeGenerator *generator, IRInstruction *instr)
@@ -401,14 +521,14 @@ void codegen_handle_inline_asm(CodeGenerator *generator, IRInstruction *instr)
     
     if (instr->asm_volatile)
     {
-        fprintf(generator->output_file, "__asm__ __volatile__");
+        code_buffer_puts(generator->output, "__asm__ __volatile__");
     }
     else
     {
-        fprintf(generator->output_file, "__asm__");
+        code_buffer_puts(generator->output, "__asm__");
     }
     
-    fprintf(generator->output_file, "(\n");
+    code_buffer_puts(generator->output, "(\n");
     generator->indent_level++;
     codegen_core_write_indent(generator);
     
@@ -423,18 +543,18 @@ void codegen_handle_inline_asm(CodeGenerator *generator, IRInstruction *instr)
             size_t len = p - start;
             if (len > 0)
             {
-                fprintf(generator->output_file, "\"");
+                code_buffer_putc(generator->output, '"');
                 for (size_t i = 0; i < len; i++)
                 {
                     char c = start[i];
                     if (c == '"' || c == '\\')
-                        fprintf(generator->output_file, "\\%c", c);
+                        code_buffer_printf(generator->output, "\\%c", c);
                     else if (c == '\t')
-                        fprintf(generator->output_file, "\\t");
+                        code_buffer_puts(generator->output, "\\t");
                     else
-                        fprintf(generator->output_file, "%c", c);
+                        code_buffer_putc(generator->output, c);
                 }
-                fprintf(generator->output_file, "\\n\"\n");
+                code_buffer_puts(generator->output, "\\n\"\n");
                 codegen_core_write_indent(generator);
             }
             start = p + 1;
@@ -444,84 +564,84 @@ void codegen_handle_inline_asm(CodeGenerator *generator, IRInstruction *instr)
     
     if (p > start)
     {
-        fprintf(generator->output_file, "\"");
+        code_buffer_putc(generator->output, '"');
         while (*start)
         {
             char c = *start;
             if (c == '"' || c == '\\')
-                fprintf(generator->output_file, "\\%c", c);
+                code_buffer_printf(generator->output, "\\%c", c);
             else if (c == '\t')
-                fprintf(generator->output_file, "\\t");
+                code_buffer_puts(generator->output, "\\t");
             else
-                fprintf(generator->output_file, "%c", c);
+                code_buffer_putc(generator->output, c);
             start++;
         }
-        fprintf(generator->output_file, "\"\n");
+        code_buffer_puts(generator->output, "\"\n");
     }
     else
     {
-        fprintf(generator->output_file, "\"\"\n");
+        code_buffer_puts(generator->output, "\"\"\n");
     }
     
     if (instr->asm_outputs && instr->asm_outputs->size > 0)
     {
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, ": ");
+        code_buffer_puts(generator->output, ": ");
         
         for (size_t i = 0; i < instr->asm_outputs->size; i++)
         {
             if (i > 0)
-                fprintf(generator->output_file, ", ");
+                code_buffer_puts(generator->output, ", ");
             
             InlineAsmOperand *op = (InlineAsmOperand *)array_get(instr->asm_outputs, i);
-            fprintf(generator->output_file, "\"%s\" (%s)", op->constraint, op->variable);
+            code_buffer_printf(generator->output, "\"%s\" (%s)", op->constraint, op->variable);
         }
-        fprintf(generator->output_file, "\n");
+        code_buffer_putc(generator->output, '\n');
     }
     else
     {
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, ":\n");
+        code_buffer_puts(generator->output, ":\n");
     }
     
     if (instr->asm_inputs && instr->asm_inputs->size > 0)
     {
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, ": ");
+        code_buffer_puts(generator->output, ": ");
         
         for (size_t i = 0; i < instr->asm_inputs->size; i++)
         {
             if (i > 0)
-                fprintf(generator->output_file, ", ");
+                code_buffer_puts(generator->output, ", ");
             
             InlineAsmOperand *op = (InlineAsmOperand *)array_get(instr->asm_inputs, i);
-            fprintf(generator->output_file, "\"%s\" (%s)", op->constraint, op->variable);
+            code_buffer_printf(generator->output, "\"%s\" (%s)", op->constraint, op->variable);
         }
-        fprintf(generator->output_file, "\n");
+        code_buffer_putc(generator->output, '\n');
     }
     else
     {
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, ":\n");
+        code_buffer_puts(generator->output, ":\n");
     }
     
     if (instr->asm_clobbers && instr->asm_clobbers->size > 0)
     {
         codegen_core_write_indent(generator);
-        fprintf(generator->output_file, ": ");
+        code_buffer_puts(generator->output, ": ");
         
         for (size_t i = 0; i < instr->asm_clobbers->size; i++)
         {
             if (i > 0)
-                fprintf(generator->output_file, ", ");
+                code_buffer_puts(generator->output, ", ");
             
             char *clobber = (char *)array_get(instr->asm_clobbers, i);
-            fprintf(generator->output_file, "\"%s\"", clobber);
+            code_buffer_printf(generator->output, "\"%s\"", clobber);
         }
-        fprintf(generator->output_file, "\n");
+        code_buffer_putc(generator->output, '\n');
     }
     
     generator->indent_level--;
     codegen_core_write_indent(generator);
-    fprintf(generator->output_file, ");\n");
+    code_buffer_puts(generator->output, ");\n");
 }
@@ -3,6 +3,10 @@
 #include "backend/codegen/codegenFfi.h"
 #include "backend/codegen/codegenIH.h"
 #include "backend/codegen/codegenPeephole.h"
+#include "backend/codegen/codegenStructure.h"
+#include "backend/codegen/codegen.h"
+#include "backend/assembly/target.h"
+#include "common/flags.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -21,17 +25,25 @@ static void c_strategy_generate_program(CodeGenerator *generator) {
 static void c_strategy_generate_function(CodeGenerator *generator, IRFunction *func) {
     generator->current_function_name = func->name;
     generator->current_function_return_type = func->return_type;
+    generator->in_cold_block = false;
     codegen_c_writer_write_function_header(generator, func);
 
-    for (size_t i = 0; i < func->instructions.size; i++)
+    if (!structured_c_output || !codegen_structure_write_function(generator, func))
     {
-        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
-        if (instr->opcode == IR_ARRAY_DECL || instr->opcode == IR_VAR_DECL)
-            continue;
-        codegen_instruction_handlers_generate_instruction(generator, instr);
+        for (size_t i = 0; i < func->instructions.size; i++)
+        {
+            IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+            if (instr->opcode == IR_ARRAY_DECL || instr->opcode == IR_VAR_DECL)
+                continue;
+            codegen_instruction_handlers_generate_instruction(generator, instr);
+        }
     }
 
     codegen_c_writer_write_function_footer(generator);
+    if (func->memoize)
+    {
+        codegen_c_writer_write_memo_wrapper(generator, func);
+    }
 }
 
 static void c_strategy_generate_instruction(CodeGenerator *generator, IRInstruction *instr) {
@@ -69,12 +81,48 @@ CodeGenStrategy *c_codegen_strategy_create(void) {
     strategy->write_ffi_loading = c_strategy_write_ffi_loading;
     strategy->write_runtime_functions = c_strategy_write_runtime_functions;
     strategy->destroy = c_strategy_destroy;
+    strategy->target = NULL;
+    return strategy;
+}
+
+static void asm_strategy_write_operand(CodeGenerator *generator, IROperand *operand) {
+    (void)generator;
+    (void)operand;
+}
+
+static void asm_strategy_write_ffi_declarations(CodeGenerator *generator, Program *program) {
+    (void)generator;
+    (void)program;
+}
+
+static void asm_strategy_write_ffi_loading(CodeGenerator *generator, Program *program) {
+    (void)generator;
+    (void)program;
+}
+
+static void asm_strategy_write_runtime_functions(CodeGenerator *generator) {
+    (void)generator;
+}
+
+CodeGenStrategy *asm_codegen_strategy_create_for_target(const AsmTarget *target) {
+    if (!target) return NULL;
+
+    CodeGenStrategy *strategy = safe_malloc(sizeof(CodeGenStrategy));
+    strategy->generate_header = codegenasm_write_header;
+    strategy->generate_program = codegenasm_generate_program;
+    strategy->generate_function = codegenasm_generate_function;
+    strategy->generate_instruction = codegenasm_generate_instruction;
+    strategy->write_operand = asm_strategy_write_operand;
+    strategy->write_ffi_declarations = asm_strategy_write_ffi_declarations;
+    strategy->write_ffi_loading = asm_strategy_write_ffi_loading;
+    strategy->write_runtime_functions = asm_strategy_write_runtime_functions;
+    strategy->destroy = c_strategy_destroy;
+    strategy->target = target;
     return strategy;
 }
 
 CodeGenStrategy *asm_codegen_strategy_create(void) {
-    // Implement assembly code generation strategy
-    return NULL;
+    return asm_codegen_strategy_create_for_target(asm_target_host());
 }
 
 CodeGenStrategy *codegen_strategy_factory(const char *target_language) {
@@ -84,6 +132,8 @@ CodeGenStrategy *codegen_strategy_factory(const char *target_language) {
         return c_codegen_strategy_create();
     } else if (strcmp(target_language, "asm") == 0) {
         return asm_codegen_strategy_create();
+    } else if (strncmp(target_language, "asm-", 4) == 0) {
+        return asm_codegen_strategy_create_for_target(asm_target_find(target_language + 4));
     }
     
     return NULL;
@@ -0,0 +1,752 @@
+#include "backend/codegen/codegenStructure.h"
+#include "backend/codegen/codegenCWriter.h"
+#include "backend/codegen/codegenIH.h"
+#include "optimizations/cfg.h"
+#include <stdint.h>
+#include <string.h>
+
+extern bool debug_enabled;
+
+#define NO_BLOCK ((size_t)-1)
+#define EDGE(edges, i) ((size_t)(uintptr_t)array_get(edges, i))
+
+/* Blocks are numbered as in the CFG; number `count` stands for the
+   function's exit. */
+typedef struct Structurizer {
+    CodeGenerator *generator;
+    IRFunction *func;
+    IRControlFlowGraph *cfg;
+    size_t count;
+    size_t (*succs)[2];
+    size_t *succ_count;
+    DynamicArray *out;
+    DynamicArray *in;
+    size_t *position;
+    size_t *idom;
+    size_t *ipdom;
+    size_t *loop_of;
+    size_t *loop_parent;
+    size_t *loop_exit;
+    bool *is_header;
+    bool *cold;
+    /* Written after the structured body and reached only by goto. */
+    bool *detached;
+    bool *emitted;
+    /* Open ifs and loops that will write the block after they close. */
+    int *pending;
+    bool *needs_label;
+    bool dry_run;
+} Structurizer;
+
+typedef struct StructureContext {
+    /* Where control goes on falling off the end of the statements. */
+    size_t follow;
+    size_t loop_header;
+    size_t loop_exit;
+} StructureContext;
+
+static size_t *block_array(size_t count, size_t value)
+{
+    size_t *array = safe_malloc(count * sizeof(size_t));
+    for (size_t i = 0; i < count; i++)
+        array[i] = value;
+    return array;
+}
+
+static bool *flag_array(size_t count)
+{
+    bool *array = safe_malloc(count * sizeof(bool));
+    memset(array, 0, count * sizeof(bool));
+    return array;
+}
+
+static size_t reverse_postorder(size_t nodes, size_t root, DynamicArray *out, size_t *order, size_t *position)
+{
+    size_t *stack = safe_malloc(nodes * sizeof(size_t));
+    size_t *next_edge = block_array(nodes, 0);
+    bool *seen = flag_array(nodes);
+    size_t depth = 0;
+    size_t finished = 0;
+
+    stack[depth++] = root;
+    seen[root] = true;
+    while (depth > 0)
+    {
+        size_t node = stack[depth - 1];
+        if (next_edge[node] < out[node].size)
+        {
+            size_t next = EDGE(&out[node], next_edge[node]++);
+            if (!seen[next])
+            {
+                seen[next] = true;
+                stack[depth++] = next;
+            }
+            continue;
+        }
+        order[finished++] = node;
+        depth--;
+    }
+
+    for (size_t i = 0; i < finished / 2; i++)
+    {
+        size_t swap = order[i];
+        order[i] = order[finished - 1 - i];
+        order[finished - 1 - i] = swap;
+    }
+    for (size_t i = 0; i < nodes; i++)
+        position[i] = NO_BLOCK;
+    for (size_t i = 0; i < finished; i++)
+        position[order[i]] = i;
+
+    safe_free(stack);
+    safe_free(next_edge);
+    safe_free(seen);
+    return finished;
+}
+
+static size_t intersect(const size_t *idom, const size_t *position, size_t a, size_t b)
+{
+    while (a != b)
+    {
+        while (position[a] > position[b])
+            a = idom[a];
+        while (position[b] > position[a])
+            b = idom[b];
+    }
+    return a;
+}
+
+/* Iterative dominators (Cooper, Harvey and Kennedy) over the nodes
+   reachable from the root along `out`; the rest get NO_BLOCK. */
+static void dominators(size_t nodes, size_t root, DynamicArray *out, DynamicArray *in, size_t *position, size_t *idom)
+{
+    size_t *order = safe_malloc(nodes * sizeof(size_t));
+    size_t reached = reverse_postorder(nodes, root, out, order, position);
+
+    for (size_t i = 0; i < nodes; i++)
+        idom[i] = NO_BLOCK;
+    idom[root] = root;
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t k = 1; k < reached; k++)
+        {
+            size_t node = order[k];
+            size_t best = NO_BLOCK;
+            for (size_t e = 0; e < in[node].size; e++)
+            {
+                size_t pred = EDGE(&in[node], e);
+                if (idom[pred] == NO_BLOCK)
+                    continue;
+                best = best == NO_BLOCK ? pred : intersect(idom, position, pred, best);
+            }
+            if (best != idom[node])
+            {
+                idom[node] = best;
+                changed = true;
+            }
+        }
+    }
+    safe_free(order);
+}
+
+static bool dominates(const Structurizer *s, size_t a, size_t b)
+{
+    while (b != a && s->idom[b] != b)
+        b = s->idom[b];
+    return b == a;
+}
+
+static bool in_loop(const Structurizer *s, size_t block, size_t header)
+{
+    if (block >= s->count)
+        return false;
+    for (size_t loop = s->loop_of[block]; loop != NO_BLOCK; loop = s->loop_parent[loop])
+    {
+        if (loop == header)
+            return true;
+    }
+    return false;
+}
+
+static void add_edge(Structurizer *s, size_t from, size_t to)
+{
+    s->succs[from][s->succ_count[from]++] = to;
+    array_push(&s->out[from], (void *)(uintptr_t)to);
+    array_push(&s->in[to], (void *)(uintptr_t)from);
+}
+
+static bool build_edges(Structurizer *s)
+{
+    for (size_t b = 0; b < s->count; b++)
+    {
+        IRInstruction *last = ir_cfg_terminator(s->cfg, ir_cfg_block(s->cfg, b));
+        size_t fallthrough = b + 1;
+        if (last && ir_instruction_is_branch(last))
+        {
+            IRBasicBlock *target = ir_cfg_block_for_label(s->cfg, last->label);
+            if (!target)
+                return false;
+            add_edge(s, b, target->id);
+            if (last->opcode != IR_JUMP)
+                add_edge(s, b, fallthrough);
+        }
+        else if (last && last->opcode == IR_RETURN)
+        {
+            add_edge(s, b, s->count);
+        }
+        else
+        {
+            add_edge(s, b, fallthrough);
+        }
+    }
+    return true;
+}
+
+/* Loop headers are the targets of back edges. A retreating edge whose
+   target does not dominate its source makes the flow irreducible. */
+static bool find_loops(Structurizer *s, size_t *order)
+{
+    size_t reached = 0;
+    for (size_t b = 0; b < s->count; b++)
+    {
+        if (s->position[b] == NO_BLOCK)
+            continue;
+        order[s->position[b]] = b;
+        reached++;
+        for (size_t e = 0; e < s->succ_count[b]; e++)
+        {
+            size_t next = s->succs[b][e];
+            if (next == s->count || s->position[next] > s->position[b])
+                continue;
+            if (!dominates(s, next, b))
+                return false;
+            s->is_header[next] = true;
+        }
+    }
+
+    /* Outer headers come first in reverse postorder, so inner loops
+       overwrite the blocks they share with them. */
+    size_t *stack = safe_malloc(s->count * sizeof(size_t));
+    size_t *mark = block_array(s->count, NO_BLOCK);
+    for (size_t k = 0; k < reached; k++)
+    {
+        size_t header = order[k];
+        if (!s->is_header[header])
+            continue;
+        s->loop_parent[header] = s->loop_of[header];
+        s->loop_of[header] = header;
+        mark[header] = header;
+
+        size_t depth = 0;
+        for (size_t e = 0; e < s->in[header].size; e++)
+        {
+            size_t pred = EDGE(&s->in[header], e);
+            if (s->position[pred] != NO_BLOCK && dominates(s, header, pred))
+                stack[depth++] = pred;
+        }
+        while (depth > 0)
+        {
+            size_t block = stack[--depth];
+            if (mark[block] == header)
+                continue;
+            mark[block] = header;
+            s->loop_of[block] = header;
+            for (size_t e = 0; e < s->in[block].size; e++)
+            {
+                size_t pred = EDGE(&s->in[block], e);
+                if (s->position[pred] != NO_BLOCK && mark[pred] != header)
+                    stack[depth++] = pred;
+            }
+        }
+    }
+    safe_free(stack);
+    safe_free(mark);
+    return true;
+}
+
+/* Cold blocks, and blocks that several paths jump to without them being
+   the merge of an if or the way out of a loop, go after the body so the
+   paths into them do not nest. */
+static void find_detached(Structurizer *s)
+{
+    for (size_t b = 1; b < s->count; b++)
+    {
+        if (s->position[b] == NO_BLOCK || s->is_header[b])
+            continue;
+        if (s->cold[b])
+        {
+            s->detached[b] = true;
+            continue;
+        }
+        if (s->in[b].size < 2 || s->loop_of[b] != NO_BLOCK || s->ipdom[s->idom[b]] == b)
+            continue;
+        bool loop_exit = false;
+        for (size_t e = 0; e < s->in[b].size; e++)
+            loop_exit |= s->is_header[EDGE(&s->in[b], e)];
+        s->detached[b] = !loop_exit;
+    }
+}
+
+static void find_loop_exits(Structurizer *s)
+{
+    /* A loop continues after the block its header exits to, or else
+       after the earliest block any of its members exits to. */
+    bool *from_header = flag_array(s->count);
+    for (size_t b = 0; b < s->count; b++)
+    {
+        if (s->position[b] == NO_BLOCK)
+            continue;
+        for (size_t e = 0; e < s->succ_count[b]; e++)
+        {
+            size_t next = s->succs[b][e];
+            for (size_t loop = s->loop_of[b]; loop != NO_BLOCK; loop = s->loop_parent[loop])
+            {
+                if (in_loop(s, next, loop) || from_header[loop] || (next < s->count && s->detached[next]))
+                    continue;
+                size_t current = s->loop_exit[loop];
+                size_t rank = next == s->count ? NO_BLOCK : s->position[next];
+                size_t current_rank = current == NO_BLOCK || current == s->count ? NO_BLOCK : s->position[current];
+                if (b == loop || current == NO_BLOCK || rank < current_rank)
+                    s->loop_exit[loop] = next;
+                from_header[loop] = b == loop;
+            }
+        }
+    }
+    safe_free(from_header);
+}
+
+static bool analyze(Structurizer *s)
+{
+    size_t nodes = s->count + 1;
+    s->succs = safe_malloc(s->count * sizeof(*s->succs));
+    s->succ_count = block_array(s->count, 0);
+    s->out = safe_malloc(nodes * sizeof(DynamicArray));
+    s->in = safe_malloc(nodes * sizeof(DynamicArray));
+    for (size_t i = 0; i < nodes; i++)
+    {
+        array_init(&s->out[i], 2);
+        array_init(&s->in[i], 2);
+    }
+    s->position = block_array(nodes, NO_BLOCK);
+    s->idom = block_array(nodes, NO_BLOCK);
+    s->ipdom = block_array(nodes, NO_BLOCK);
+    s->loop_of = block_array(s->count, NO_BLOCK);
+    s->loop_parent = block_array(s->count, NO_BLOCK);
+    s->loop_exit = block_array(s->count, NO_BLOCK);
+    s->is_header = flag_array(s->count);
+    s->cold = flag_array(s->count);
+    s->detached = flag_array(s->count);
+    s->emitted = flag_array(s->count);
+    s->pending = safe_malloc(s->count * sizeof(int));
+    memset(s->pending, 0, s->count * sizeof(int));
+    s->needs_label = flag_array(s->count);
+
+    if (!build_edges(s))
+        return false;
+
+    /* Postdominators run over the reversed graph from the exit. */
+    size_t *scratch = safe_malloc(nodes * sizeof(size_t));
+    dominators(nodes, s->count, s->in, s->out, scratch, s->ipdom);
+    dominators(nodes, 0, s->out, s->in, s->position, s->idom);
+    bool reducible = find_loops(s, scratch);
+    safe_free(scratch);
+    if (!reducible)
+        return false;
+
+    bool cold = false;
+    for (size_t b = 0; b < s->count; b++)
+    {
+        IRBasicBlock *block = ir_cfg_block(s->cfg, b);
+        IRInstruction *first = (IRInstruction *)array_get(&s->func->instructions, block->start);
+        if (first->opcode == IR_LABEL)
+            cold = first->is_cold;
+        s->cold[b] = cold;
+    }
+    find_detached(s);
+    find_loop_exits(s);
+    return true;
+}
+
+static void release(Structurizer *s)
+{
+    if (s->out)
+    {
+        for (size_t i = 0; i <= s->count; i++)
+        {
+            array_free(&s->out[i]);
+            array_free(&s->in[i]);
+        }
+    }
+    safe_free(s->succs);
+    safe_free(s->succ_count);
+    safe_free(s->out);
+    safe_free(s->in);
+    safe_free(s->position);
+    safe_free(s->idom);
+    safe_free(s->ipdom);
+    safe_free(s->loop_of);
+    safe_free(s->loop_parent);
+    safe_free(s->loop_exit);
+    safe_free(s->is_header);
+    safe_free(s->cold);
+    safe_free(s->detached);
+    safe_free(s->emitted);
+    safe_free(s->pending);
+    safe_free(s->needs_label);
+}
+
+static const char *block_label(Structurizer *s, size_t block, char *buffer, size_t size)
+{
+    IRBasicBlock *info = ir_cfg_block(s->cfg, block);
+    if (info->label)
+        return info->label;
+    snprintf(buffer, size, "__tl_block_%zu", block);
+    return buffer;
+}
+
+static void write_block(Structurizer *s, size_t block)
+{
+    s->emitted[block] = true;
+    if (s->dry_run)
+        return;
+
+    CodeGenerator *generator = s->generator;
+    IRBasicBlock *info = ir_cfg_block(s->cfg, block);
+    IRInstruction *first = (IRInstruction *)array_get(&s->func->instructions, info->start);
+    char name[48];
+    generator->in_cold_block = s->cold[block];
+    if (first->opcode == IR_LABEL && first->is_cold)
+        codegen_core_write_line(generator, "%s: TL_COLD_LABEL;", first->label);
+    else if (s->needs_label[block])
+        codegen_core_write_line(generator, "%s: ;", block_label(s, block, name, sizeof(name)));
+
+    for (size_t i = info->start; i < info->end; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&s->func->instructions, i);
+        if (instr->opcode == IR_LABEL || instr->opcode == IR_VAR_DECL || instr->opcode == IR_ARRAY_DECL ||
+            ir_instruction_is_branch(instr))
+            continue;
+        codegen_instruction_handlers_generate_instruction(generator, instr);
+    }
+}
+
+/* True when a jump to the block cannot simply run into its code. */
+static bool leaves(const Structurizer *s, const StructureContext *ctx, size_t target)
+{
+    if (target == ctx->loop_header || target == ctx->loop_exit)
+        return true;
+    if (target == ctx->follow)
+        return false;
+    return target == s->count || s->detached[target] || s->emitted[target] || s->pending[target] > 0;
+}
+
+static const char *jump_text(Structurizer *s, const StructureContext *ctx, size_t target, char *buffer, size_t size)
+{
+    if (target == ctx->loop_header)
+        return "continue;";
+    if (target == ctx->loop_exit)
+        return "break;";
+    if (target == s->count)
+        return s->generator->current_function_return_type == TYPE_VOID ? "return;" : "return 0;";
+
+    char name[48];
+    s->needs_label[target] = true;
+    snprintf(buffer, size, "goto %s;", block_label(s, target, name, sizeof(name)));
+    return buffer;
+}
+
+static void write_jump(Structurizer *s, const StructureContext *ctx, size_t target)
+{
+    char buffer[64];
+    const char *text = jump_text(s, ctx, target, buffer, sizeof(buffer));
+    if (!s->dry_run)
+        codegen_core_write_line(s->generator, "%s", text);
+}
+
+/* Either moves on to the target's code or writes the jump there. */
+static bool continue_with(Structurizer *s, const StructureContext *ctx, size_t target, size_t *next)
+{
+    if (target == ctx->follow)
+        return false;
+    if (leaves(s, ctx, target))
+    {
+        write_jump(s, ctx, target);
+        return false;
+    }
+    *next = target;
+    return true;
+}
+
+/* Writes "if (cond" for the branch going to its target, or to its
+   fallthrough block when toward_target is false. */
+static void write_condition(Structurizer *s, IRInstruction *branch, bool toward_target)
+{
+    static const char *const hints[] = {"TL_UNLIKELY", NULL, "TL_LIKELY"};
+    int bias = ir_instruction_branch_bias(branch);
+    const char *hint = hints[(toward_target ? bias : -bias) + 1];
+    bool negate = (branch->opcode == IR_JUMP_IF_FALSE) == toward_target;
+    CodeBuffer *out = s->generator->output;
+
+    codegen_core_write_indent(s->generator);
+    code_buffer_puts(out, "if (");
+    if (hint)
+    {
+        code_buffer_puts(out, hint);
+        code_buffer_putc(out, '(');
+    }
+    if (negate)
+        code_buffer_putc(out, '!');
+    codegen_c_writer_write_operand(s->generator, branch->arg1);
+    if (hint)
+        code_buffer_putc(out, ')');
+    code_buffer_putc(out, ')');
+}
+
+static void write_guarded_jump(Structurizer *s, const StructureContext *ctx, IRInstruction *branch,
+                               bool toward_target, size_t target)
+{
+    char buffer[64];
+    const char *text = jump_text(s, ctx, target, buffer, sizeof(buffer));
+    if (s->dry_run)
+        return;
+    write_condition(s, branch, toward_target);
+    code_buffer_printf(s->generator->output, " %s\n", text);
+}
+
+static void open_if(Structurizer *s, IRInstruction *branch, bool toward_target)
+{
+    if (s->dry_run)
+        return;
+    write_condition(s, branch, toward_target);
+    code_buffer_puts(s->generator->output, " {\n");
+    s->generator->indent_level++;
+}
+
+static void write_line(Structurizer *s, const char *text)
+{
+    if (!s->dry_run)
+        codegen_core_write_line(s->generator, "%s", text);
+}
+
+static void indent(Structurizer *s, int change)
+{
+    if (!s->dry_run)
+        s->generator->indent_level += change;
+}
+
+static size_t output_mark(const Structurizer *s)
+{
+    return code_buffer_total(s->generator->output);
+}
+
+static void drop_output(Structurizer *s, size_t mark)
+{
+    if (!s->dry_run)
+        code_buffer_truncate(s->generator->output, mark);
+}
+
+static void write_sequence(Structurizer *s, size_t block, StructureContext ctx, bool in_header);
+
+static void write_arm(Structurizer *s, size_t block, const StructureContext *ctx)
+{
+    if (block == ctx->follow)
+        return;
+    if (leaves(s, ctx, block))
+        write_jump(s, ctx, block);
+    else
+        write_sequence(s, block, *ctx, false);
+}
+
+/* The if's merge point is the branch's immediate postdominator, as
+   long as it lies in the current loop and nothing outside is waiting
+   to write it. */
+static size_t merge_point(const Structurizer *s, size_t block, const StructureContext *ctx)
+{
+    size_t merge = s->ipdom[block];
+    if (merge == NO_BLOCK || merge == s->count || s->detached[merge] || s->emitted[merge])
+        return NO_BLOCK;
+    if (ctx->loop_header != NO_BLOCK && !in_loop(s, merge, ctx->loop_header))
+        return NO_BLOCK;
+    if (s->pending[merge] > 0 && merge != ctx->follow)
+        return NO_BLOCK;
+    return merge;
+}
+
+static bool write_branch(Structurizer *s, size_t block, IRInstruction *branch, const StructureContext *ctx,
+                         size_t *next)
+{
+    size_t target = s->succs[block][0];
+    size_t fallthrough = s->succs[block][1];
+    if (target == fallthrough)
+        return continue_with(s, ctx, target, next);
+
+    /* A side that jumps away needs no arm of its own. */
+    if (leaves(s, ctx, target))
+    {
+        write_guarded_jump(s, ctx, branch, true, target);
+        return continue_with(s, ctx, fallthrough, next);
+    }
+    if (leaves(s, ctx, fallthrough))
+    {
+        write_guarded_jump(s, ctx, branch, false, fallthrough);
+        return continue_with(s, ctx, target, next);
+    }
+
+    size_t merge = merge_point(s, block, ctx);
+    if (merge == NO_BLOCK)
+        merge = ctx->follow;
+
+    StructureContext arm = *ctx;
+    arm.follow = merge;
+    bool owned = merge != ctx->follow;
+    if (owned)
+        s->pending[merge]++;
+
+    if (target == merge)
+    {
+        open_if(s, branch, false);
+        write_arm(s, fallthrough, &arm);
+    }
+    else if (fallthrough == merge)
+    {
+        open_if(s, branch, true);
+        write_arm(s, target, &arm);
+    }
+    else
+    {
+        /* An arm that writes nothing is left out, turning the condition
+           around when it is the first one. */
+        size_t start = output_mark(s);
+        open_if(s, branch, false);
+        size_t opened = output_mark(s);
+        write_arm(s, fallthrough, &arm);
+        indent(s, -1);
+        bool has_else = output_mark(s) != opened;
+        if (has_else)
+        {
+            start = output_mark(s);
+            write_line(s, "} else {");
+            indent(s, 1);
+            opened = output_mark(s);
+        }
+        else
+        {
+            drop_output(s, start);
+            open_if(s, branch, true);
+        }
+        write_arm(s, target, &arm);
+        if (has_else && output_mark(s) == opened)
+            drop_output(s, start);
+    }
+    indent(s, -1);
+    write_line(s, "}");
+
+    if (!owned)
+        return false;
+    s->pending[merge]--;
+    return continue_with(s, ctx, merge, next);
+}
+
+static size_t write_loop(Structurizer *s, size_t header)
+{
+    StructureContext inner = {header, header, s->loop_exit[header]};
+    bool owned = inner.loop_exit < s->count;
+    if (owned)
+        s->pending[inner.loop_exit]++;
+
+    write_line(s, "while (1) {");
+    indent(s, 1);
+    write_sequence(s, header, inner, true);
+    indent(s, -1);
+    write_line(s, "}");
+
+    if (owned)
+        s->pending[inner.loop_exit]--;
+    return inner.loop_exit;
+}
+
+static void write_sequence(Structurizer *s, size_t block, StructureContext ctx, bool in_header)
+{
+    for (;;)
+    {
+        if (s->is_header[block] && !in_header)
+        {
+            size_t exit = write_loop(s, block);
+            if (exit == NO_BLOCK || !continue_with(s, &ctx, exit, &block))
+                return;
+            continue;
+        }
+        in_header = false;
+
+        write_block(s, block);
+        IRInstruction *last = ir_cfg_terminator(s->cfg, ir_cfg_block(s->cfg, block));
+        if (last->opcode == IR_RETURN)
+            return;
+
+        bool more;
+        if (last->opcode == IR_JUMP_IF || last->opcode == IR_JUMP_IF_FALSE)
+            more = write_branch(s, block, last, &ctx, &block);
+        else
+            more = continue_with(s, &ctx, s->succs[block][0], &block);
+        if (!more)
+            return;
+    }
+}
+
+/* The body, then every detached block something jumps to. Nothing may
+   fall into the labels, so with detached blocks around each path ends in
+   an explicit jump or return. */
+static void write_body(Structurizer *s)
+{
+    bool any = false;
+    for (size_t b = 0; b < s->count; b++)
+        any |= s->detached[b];
+    StructureContext top = {any ? NO_BLOCK : s->count, NO_BLOCK, NO_BLOCK};
+    write_sequence(s, 0, top, false);
+
+    bool wrote = any;
+    while (wrote)
+    {
+        wrote = false;
+        for (size_t b = 0; b < s->count; b++)
+        {
+            if (!s->detached[b] || !s->needs_label[b] || s->emitted[b])
+                continue;
+            write_sequence(s, b, top, false);
+            wrote = true;
+        }
+    }
+}
+
+bool codegen_structure_write_function(CodeGenerator *generator, IRFunction *func)
+{
+    IRControlFlowGraph *cfg = ir_cfg_build(func);
+    Structurizer s;
+    memset(&s, 0, sizeof(s));
+    s.generator = generator;
+    s.func = func;
+    s.cfg = cfg;
+    s.count = cfg->blocks.size;
+
+    bool structured = s.count > 0 && analyze(&s);
+    if (structured)
+    {
+        /* A first pass finds the blocks that still need a label. */
+        s.dry_run = true;
+        write_body(&s);
+        memset(s.emitted, 0, s.count * sizeof(bool));
+        s.dry_run = false;
+        write_body(&s);
+    }
+    else if (debug_enabled)
+    {
+        printf("[DEBUG] structure: %s keeps goto form\n", func->name);
+    }
+
+    release(&s);
+    ir_cfg_destroy(cfg);
+    return structured;
+}
@@ -65,6 +65,10 @@ IRFunction *ir_function_create(const char *name, DataType return_type)
     func->label_counter = 0;
     array_init(&func->loop_stack, sizeof(LoopContext *));
     func->oob_error_label = NULL;
+    func->specialized_from = NULL;
+    func->memoize = false;
+    func->has_profile = false;
+    func->profile_count = 0;
     return func;
 }
 
@@ -72,6 +76,8 @@ IRProgram *ir_program_create(void)
 {
     IRProgram *program = safe_malloc(sizeof(IRProgram));
     array_init(&program->functions, 4);
+    array_init(&program->profile_counters, 4);
+    program->profile_path = NULL;
     return program;
 }
 
@@ -80,6 +86,47 @@ void ir_function_add_instruction(IRFunction *func, IRInstruction *instr)
     array_push(&func->instructions, instr);
 }
 
+static IROperand *unshare_operand(HashTable *seen, IROperand *operand)
+{
+    if (!operand)
+        return NULL;
+
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void *)operand);
+    if (hashtable_contains(seen, key))
+    {
+        return ir_operand_copy(operand);
+    }
+    hashtable_put(seen, key, (void *)1);
+    return operand;
+}
+
+void ir_function_unshare_operands(IRFunction *func)
+{
+    HashTable *seen = hashtable_create(64);
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (!instr)
+            continue;
+
+        instr->result = unshare_operand(seen, instr->result);
+        instr->arg1 = unshare_operand(seen, instr->arg1);
+        instr->arg2 = unshare_operand(seen, instr->arg2);
+        if (instr->args)
+        {
+            for (size_t j = 0; j < instr->args->size; j++)
+            {
+                IROperand *arg = (IROperand *)array_get(instr->args, j);
+                array_set(instr->args, j, unshare_operand(seen, arg));
+            }
+        }
+    }
+
+    hashtable_destroy(seen);
+}
+
 void ir_function_add_param(IRFunction *func, IROperand *param)
 {
     array_push(&func->params, param);
@@ -116,6 +163,7 @@ void ir_function_destroy(IRFunction *func)
     array_free(&func->loop_stack);
 
     safe_free(func->oob_error_label);
+    safe_free(func->specialized_from);
     safe_free(func);
 }
 
@@ -129,6 +177,12 @@ void ir_program_destroy(IRProgram *program)
         ir_function_destroy((IRFunction *)array_get(&program->functions, i));
     }
     array_free(&program->functions);
+    for (size_t i = 0; i < program->profile_counters.size; i++)
+    {
+        safe_free(array_get(&program->profile_counters, i));
+    }
+    array_free(&program->profile_counters);
+    safe_free(program->profile_path);
     safe_free(program);
 }
 
@@ -210,6 +264,12 @@ const char *ir_opcode_to_string(IROpcode opcode)
         return "&&";
     case IR_OR:
         return "||";
+    case IR_SHL:
+        return "<<";
+    case IR_SHR:
+        return ">>";
+    case IR_BAND:
+        return "&";
     case IR_JUMP:
         return "JUMP";
     case IR_JUMP_IF:
@@ -238,6 +298,14 @@ const char *ir_opcode_to_string(IROpcode opcode)
         return "VAR_DECL";
     case IR_INLINE_ASM:
         return "INLINE_ASM";
+    case IR_VECTOR_SPLAT:
+        return "VECTOR_SPLAT";
+    case IR_VECTOR_INDEX:
+        return "VECTOR_INDEX";
+    case IR_VECTOR_REDUCE:
+        return "VECTOR_REDUCE";
+    case IR_PROFILE:
+        return "PROFILE";
     default:
         return "UNKNOWN";
     }
@@ -8,6 +8,92 @@
 extern bool debug_enabled;
 
 IROperand *ir_generate_expression_impl(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer, DataType expected_type);
+IROperand *ir_generate_logical_expression(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer);
+void ir_generate_branch(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer, const char *label, bool jump_if_true);
+
+static bool is_logical_operator(Expr *expr, TLTokenType operator)
+{
+    return expr && expr->type == EXPR_BINARY && expr->data.binary.operator== operator;
+}
+
+static void ir_store_truth_value(IRFunction *ir_func, IROperand *result, IROperand *value)
+{
+    IROperand *dest = ir_operand_copy(result);
+    if (value && value->data_type == TYPE_BOOL)
+    {
+        ir_function_add_instruction(ir_func, ir_instruction_move(dest, value));
+    }
+    else
+    {
+        ir_function_add_instruction(ir_func, ir_instruction_binary(IR_NE, dest, value, ir_operand_const(0)));
+    }
+}
+
+IROperand *ir_generate_logical_expression(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer)
+{
+    bool is_and = expr->data.binary.operator== TOKEN_AND;
+    char *end_label = ir_function_new_label(ir_func);
+    IROperand *result = ir_operand_temp(ir_function_new_temp(ir_func));
+    result->data_type = TYPE_BOOL;
+
+    IROperand *left = ir_generate_expression_impl(ir_func, expr->data.binary.left, analyzer, TYPE_BOOL);
+    ir_store_truth_value(ir_func, result, left);
+
+    IROperand *condition = ir_operand_copy(result);
+    if (is_and)
+    {
+        ir_function_add_instruction(ir_func, ir_instruction_jump_if_false(condition, end_label));
+    }
+    else
+    {
+        ir_function_add_instruction(ir_func, ir_instruction_jump_if(condition, end_label));
+    }
+
+    IROperand *right = ir_generate_expression_impl(ir_func, expr->data.binary.right, analyzer, TYPE_BOOL);
+    ir_store_truth_value(ir_func, result, right);
+
+    ir_function_add_instruction(ir_func, ir_instruction_label(end_label));
+    safe_free(end_label);
+    return result;
+}
+
+void ir_generate_branch(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer, const char *label, bool jump_if_true)
+{
+    if (is_logical_operator(expr, TOKEN_AND) || is_logical_operator(expr, TOKEN_OR))
+    {
+        bool is_and = expr->data.binary.operator== TOKEN_AND;
+        if (is_and != jump_if_true)
+        {
+            ir_generate_branch(ir_func, expr->data.binary.left, analyzer, label, jump_if_true);
+            ir_generate_branch(ir_func, expr->data.binary.right, analyzer, label, jump_if_true);
+        }
+        else
+        {
+            char *skip_label = ir_function_new_label(ir_func);
+            ir_generate_branch(ir_func, expr->data.binary.left, analyzer, skip_label, !jump_if_true);
+            ir_generate_branch(ir_func, expr->data.binary.right, analyzer, label, jump_if_true);
+            ir_function_add_instruction(ir_func, ir_instruction_label(skip_label));
+            safe_free(skip_label);
+        }
+        return;
+    }
+
+    if (expr && expr->type == EXPR_UNARY && expr->data.unary.operator== TOKEN_BANG)
+    {
+        ir_generate_branch(ir_func, expr->data.unary.operand, analyzer, label, !jump_if_true);
+        return;
+    }
+
+    IROperand *condition = ir_generate_expression_impl(ir_func, expr, analyzer, TYPE_BOOL);
+    if (jump_if_true)
+    {
+        ir_function_add_instruction(ir_func, ir_instruction_jump_if(condition, label));
+    }
+    else
+    {
+        ir_function_add_instruction(ir_func, ir_instruction_jump_if_false(condition, label));
+    }
+}
 
 IROperand *ir_generate_expression_impl(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer, DataType expected_type)
 {
@@ -74,6 +160,11 @@ IROperand *ir_generate_expression_impl(IRFunction *ir_func, Expr *expr, Semantic
 
     case EXPR_BINARY:
     {
+        if (expr->data.binary.operator== TOKEN_AND || expr->data.binary.operator== TOKEN_OR)
+        {
+            return ir_generate_logical_expression(ir_func, expr, analyzer);
+        }
+
         DataType left_type = TYPE_NULL;
         DataType right_type = TYPE_NULL;
         if (expr->data.binary.left->type == EXPR_NULL_LITERAL)
@@ -140,12 +231,6 @@ IROperand *ir_generate_expression_impl(IRFunction *ir_func, Expr *expr, Semantic
         case TOKEN_GE:
             opcode = IR_GE;
             break;
-        case TOKEN_AND:
-            opcode = IR_AND;
-            break;
-        case TOKEN_OR:
-            opcode = IR_OR;
-            break;
         default:
             return NULL;
         }
@@ -383,6 +468,7 @@ IROperand *ir_generate_expression_impl(IRFunction *ir_func, Expr *expr, Semantic
                     IRInstruction *lower_compare = ir_instruction_binary(IR_LT, lower_condition, index, zero);
                     ir_function_add_instruction(ir_func, lower_compare);
                     IRInstruction *lower_jump = ir_instruction_jump_if(lower_condition, ir_func->oob_error_label);
+                    lower_jump->is_cold = true;
                     ir_function_add_instruction(ir_func, lower_jump);
 
                     IROperand *size = ir_operand_const(array_size);
@@ -390,6 +476,7 @@ IROperand *ir_generate_expression_impl(IRFunction *ir_func, Expr *expr, Semantic
                     IRInstruction *upper_compare = ir_instruction_binary(IR_GE, upper_condition, index, size);
                     ir_function_add_instruction(ir_func, upper_compare);
                     IRInstruction *upper_jump = ir_instruction_jump_if(upper_condition, ir_func->oob_error_label);
+                    upper_jump->is_cold = true;
                     ir_function_add_instruction(ir_func, upper_jump);
                 }
             }
@@ -399,9 +486,9 @@ IROperand *ir_generate_expression_impl(IRFunction *ir_func, Expr *expr, Semantic
             if (array->type == IR_OP_VAR)
             {
                 Symbol *symbol = scope_resolve(analyzer, array->data.var_name);
-                if (symbol && symbol->data_type == TYPE_ARRAY && symbol->element_type == TYPE_STRING)
+                if (symbol && symbol->data_type == TYPE_ARRAY)
                 {
-                    result->data_type = TYPE_STRING;
+                    result->data_type = symbol->element_type;
                 }
                 else
                 {
@@ -203,7 +203,18 @@ IRFunction *ir_generate_function_impl(Function *func, SemanticAnalyzer *analyzer
 
     if (ir_func->oob_error_label)
     {
+        /* The error block must only be reached through the bounds checks. */
+        IRInstruction *last = ir_func->instructions.size > 0
+                                  ? (IRInstruction *)array_get(&ir_func->instructions, ir_func->instructions.size - 1)
+                                  : NULL;
+        if (!last || (last->opcode != IR_RETURN && last->opcode != IR_JUMP))
+        {
+            IROperand *value = ir_func->return_type == TYPE_VOID ? NULL : ir_operand_const(0);
+            ir_function_add_instruction(ir_func, ir_instruction_return(value));
+        }
+
         IRInstruction *error_label_instr = ir_instruction_label(ir_func->oob_error_label);
+        error_label_instr->is_cold = true;
         ir_function_add_instruction(ir_func, error_label_instr);
         
         IROperand *error_msg = ir_operand_string_const("Array index out of bounds");
@@ -215,5 +226,7 @@ IRFunction *ir_generate_function_impl(Function *func, SemanticAnalyzer *analyzer
         ir_function_add_instruction(ir_func, exit_instr);
     }
 
+    ir_function_unshare_operands(ir_func);
+
     return ir_func;
 }
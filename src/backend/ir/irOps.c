@@ -33,6 +33,7 @@ IROperand *ir_operand_temp(int temp_id)
     IROperand *operand = safe_malloc(sizeof(IROperand));
     operand->type = IR_OP_TEMP;
     operand->array_size = -1;
+    operand->vector_width = 0;
     operand->is_float_const = false;
     operand->data_type = TYPE_INT;
     operand->data.temp_id = temp_id;
@@ -44,6 +45,7 @@ IROperand *ir_operand_var(const char *var_name)
     IROperand *operand = safe_malloc(sizeof(IROperand));
     operand->type = IR_OP_VAR;
     operand->array_size = -1;
+    operand->vector_width = 0;
     operand->is_float_const = false;
     operand->data_type = TYPE_INT;
     operand->data.var_name = string_copy(var_name);
@@ -55,6 +57,7 @@ IROperand *ir_operand_array_var(const char *var_name, int size)
     IROperand *operand = safe_malloc(sizeof(IROperand));
     operand->type = IR_OP_VAR;
     operand->array_size = size;
+    operand->vector_width = 0;
     operand->is_float_const = false;
     operand->data_type = TYPE_ARRAY;
     operand->data.var_name = string_copy(var_name);
@@ -66,6 +69,7 @@ IROperand *ir_operand_const(int64_t value)
     IROperand *operand = safe_malloc(sizeof(IROperand));
     operand->type = IR_OP_CONST;
     operand->array_size = -1;
+    operand->vector_width = 0;
     operand->is_float_const = false;
     operand->data_type = TYPE_INT;
     operand->data.const_value = value;
@@ -77,6 +81,7 @@ IROperand *ir_operand_float_const(double value)
     IROperand *operand = safe_malloc(sizeof(IROperand));
     operand->type = IR_OP_CONST;
     operand->array_size = -1;
+    operand->vector_width = 0;
     operand->is_float_const = true;
     operand->data_type = TYPE_FLOAT;
     operand->data.float_const_value = value;
@@ -88,6 +93,7 @@ IROperand *ir_operand_string_const(const char *value)
     IROperand *operand = safe_malloc(sizeof(IROperand));
     operand->type = IR_OP_STRING_CONST;
     operand->array_size = -1;
+    operand->vector_width = 0;
     operand->is_float_const = false;
     operand->data_type = TYPE_STRING;
     operand->data.string_const_value = string_copy(value);
@@ -99,6 +105,7 @@ IROperand *ir_operand_null(void)
     IROperand *operand = safe_malloc(sizeof(IROperand));
     operand->type = IR_OP_NULL;
     operand->array_size = -1;
+    operand->vector_width = 0;
     operand->is_float_const = false;
     operand->data_type = TYPE_NULL;
     return operand;
@@ -109,6 +116,7 @@ IROperand *ir_operand_null_with_type(DataType data_type)
     IROperand *operand = safe_malloc(sizeof(IROperand));
     operand->type = IR_OP_NULL;
     operand->array_size = -1;
+    operand->vector_width = 0;
     operand->is_float_const = false;
     operand->data_type = data_type;
     return operand;
@@ -119,12 +127,37 @@ IROperand *ir_operand_label(const char *label_name)
     IROperand *operand = safe_malloc(sizeof(IROperand));
     operand->type = IR_OP_LABEL;
     operand->array_size = -1;
+    operand->vector_width = 0;
     operand->is_float_const = false;
     operand->data_type = TYPE_VOID;
     operand->data.label_name = string_copy(label_name);
     return operand;
 }
 
+IROperand *ir_operand_copy(const IROperand *operand)
+{
+    if (!operand)
+        return NULL;
+
+    IROperand *copy = safe_malloc(sizeof(IROperand));
+    *copy = *operand;
+    switch (operand->type)
+    {
+    case IR_OP_VAR:
+        copy->data.var_name = string_copy(operand->data.var_name);
+        break;
+    case IR_OP_STRING_CONST:
+        copy->data.string_const_value = string_copy(operand->data.string_const_value);
+        break;
+    case IR_OP_LABEL:
+        copy->data.label_name = string_copy(operand->data.label_name);
+        break;
+    default:
+        break;
+    }
+    return copy;
+}
+
 void ir_operand_destroy(IROperand *operand)
 {
     if (!operand)
@@ -165,6 +198,8 @@ void ir_operand_print(const IROperand *operand)
     {
     case IR_OP_TEMP:
         printf("t%d", operand->data.temp_id);
+        if (operand->vector_width > 0)
+            printf("<%d>", operand->vector_width);
         break;
     case IR_OP_VAR:
         printf("%s", operand->data.var_name);
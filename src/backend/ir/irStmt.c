@@ -9,6 +9,7 @@ extern bool debug_enabled;
 
 IROperand *ir_generate_expression_impl(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer, DataType expected_type);
 void ir_generate_statement_impl(IRFunction *ir_func, Stmt *stmt, SemanticAnalyzer *analyzer);
+void ir_generate_branch(IRFunction *ir_func, Expr *expr, SemanticAnalyzer *analyzer, const char *label, bool jump_if_true);
 
 
 bool stmt_always_returns(Stmt *stmt)
@@ -113,6 +114,7 @@ void ir_generate_statement_impl(IRFunction *ir_func, Stmt *stmt, SemanticAnalyze
                 IRInstruction *lower_compare = ir_instruction_binary(IR_LT, lower_condition, index, zero);
                 ir_function_add_instruction(ir_func, lower_compare);
                 IRInstruction *lower_jump = ir_instruction_jump_if(lower_condition, ir_func->oob_error_label);
+                lower_jump->is_cold = true;
                 ir_function_add_instruction(ir_func, lower_jump);
                 
                 IROperand *size = ir_operand_const(array_size);
@@ -120,6 +122,7 @@ void ir_generate_statement_impl(IRFunction *ir_func, Stmt *stmt, SemanticAnalyze
                 IRInstruction *upper_compare = ir_instruction_binary(IR_GE, upper_condition, index, size);
                 ir_function_add_instruction(ir_func, upper_compare);
                 IRInstruction *upper_jump = ir_instruction_jump_if(upper_condition, ir_func->oob_error_label);
+                upper_jump->is_cold = true;
                 ir_function_add_instruction(ir_func, upper_jump);
             }
         }
@@ -133,9 +136,7 @@ void ir_generate_statement_impl(IRFunction *ir_func, Stmt *stmt, SemanticAnalyze
         char *then_label = ir_function_new_label(ir_func);
         char *end_label = ir_function_new_label(ir_func);
 
-        IROperand *condition = ir_generate_expression_impl(ir_func, stmt->data.if_stmt.condition, analyzer, TYPE_BOOL);
-        IRInstruction *jump_if_false = ir_instruction_jump_if_false(condition, then_label);
-        ir_function_add_instruction(ir_func, jump_if_false);
+        ir_generate_branch(ir_func, stmt->data.if_stmt.condition, analyzer, then_label, false);
 
         ir_generate_statement_impl(ir_func, stmt->data.if_stmt.then_branch, analyzer);
         bool then_returns = stmt_always_returns(stmt->data.if_stmt.then_branch);
@@ -186,9 +187,7 @@ void ir_generate_statement_impl(IRFunction *ir_func, Stmt *stmt, SemanticAnalyze
         IRInstruction *loop_lbl = ir_instruction_label(loop_label);
         ir_function_add_instruction(ir_func, loop_lbl);
 
-        IROperand *condition = ir_generate_expression_impl(ir_func, stmt->data.while_stmt.condition, analyzer, TYPE_BOOL);
-        IRInstruction *jump_if_false = ir_instruction_jump_if_false(condition, end_label);
-        ir_function_add_instruction(ir_func, jump_if_false);
+        ir_generate_branch(ir_func, stmt->data.while_stmt.condition, analyzer, end_label, false);
 
         ir_generate_statement_impl(ir_func, stmt->data.while_stmt.body, analyzer);
 
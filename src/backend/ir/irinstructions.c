@@ -1,9 +1,18 @@
 #include "backend/ir/irinstructions.h"
 #include "backend/ir/irOps.h"
 
-IRInstruction *ir_instruction_nop(void)
+#define IR_PROFILE_MIN_SAMPLES 16
+
+static IRInstruction *ir_instruction_alloc(void)
 {
     IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    memset(instr, 0, sizeof(IRInstruction));
+    return instr;
+}
+
+IRInstruction *ir_instruction_nop(void)
+{
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_NOP;
     instr->result = NULL;
     instr->arg1 = NULL;
@@ -15,7 +24,7 @@ IRInstruction *ir_instruction_nop(void)
 
 IRInstruction *ir_instruction_label(const char *label)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_LABEL;
     instr->result = NULL;
     instr->arg1 = NULL;
@@ -27,7 +36,7 @@ IRInstruction *ir_instruction_label(const char *label)
 
 IRInstruction *ir_instruction_move(IROperand *result, IROperand *source)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_MOVE;
     instr->result = result;
     instr->arg1 = source;
@@ -39,7 +48,7 @@ IRInstruction *ir_instruction_move(IROperand *result, IROperand *source)
 
 IRInstruction *ir_instruction_binary(IROpcode opcode, IROperand *result, IROperand *arg1, IROperand *arg2)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = opcode;
     instr->result = result;
     instr->arg1 = arg1;
@@ -51,7 +60,7 @@ IRInstruction *ir_instruction_binary(IROpcode opcode, IROperand *result, IROpera
 
 IRInstruction *ir_instruction_unary(IROpcode opcode, IROperand *result, IROperand *arg)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = opcode;
     instr->result = result;
     instr->arg1 = arg;
@@ -63,7 +72,7 @@ IRInstruction *ir_instruction_unary(IROpcode opcode, IROperand *result, IROperan
 
 IRInstruction *ir_instruction_jump(const char *label)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_JUMP;
     instr->result = NULL;
     instr->arg1 = NULL;
@@ -75,7 +84,7 @@ IRInstruction *ir_instruction_jump(const char *label)
 
 IRInstruction *ir_instruction_jump_if(IROperand *condition, const char *label)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_JUMP_IF;
     instr->result = NULL;
     instr->arg1 = condition;
@@ -87,7 +96,7 @@ IRInstruction *ir_instruction_jump_if(IROperand *condition, const char *label)
 
 IRInstruction *ir_instruction_jump_if_false(IROperand *condition, const char *label)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_JUMP_IF_FALSE;
     instr->result = NULL;
     instr->arg1 = condition;
@@ -99,7 +108,7 @@ IRInstruction *ir_instruction_jump_if_false(IROperand *condition, const char *la
 
 IRInstruction *ir_instruction_call(IROperand *result, const char *func_name)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_CALL;
     instr->result = result;
     instr->arg1 = NULL;
@@ -111,7 +120,7 @@ IRInstruction *ir_instruction_call(IROperand *result, const char *func_name)
 
 IRInstruction *ir_instruction_return(IROperand *value)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_RETURN;
     instr->result = NULL;
     instr->arg1 = value;
@@ -123,7 +132,7 @@ IRInstruction *ir_instruction_return(IROperand *value)
 
 IRInstruction *ir_instruction_param(IROperand *param)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_PARAM;
     instr->result = NULL;
     instr->arg1 = param;
@@ -135,7 +144,7 @@ IRInstruction *ir_instruction_param(IROperand *param)
 
 IRInstruction *ir_instruction_print_op(IROperand *value)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_PRINT;
     instr->result = NULL;
     instr->arg1 = value;
@@ -147,7 +156,7 @@ IRInstruction *ir_instruction_print_op(IROperand *value)
 
 IRInstruction *ir_instruction_print_multiple(DynamicArray *args)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_PRINT;
     instr->result = NULL;
     instr->arg1 = NULL;
@@ -159,7 +168,7 @@ IRInstruction *ir_instruction_print_multiple(DynamicArray *args)
 
 IRInstruction *ir_instruction_array_load(IROperand *result, IROperand *array, IROperand *index)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_ARRAY_LOAD;
     instr->result = result;
     instr->arg1 = array;
@@ -171,7 +180,7 @@ IRInstruction *ir_instruction_array_load(IROperand *result, IROperand *array, IR
 
 IRInstruction *ir_instruction_array_store(IROperand *array, IROperand *index, IROperand *value)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_ARRAY_STORE;
     instr->result = value;
     instr->arg1 = array;
@@ -183,7 +192,7 @@ IRInstruction *ir_instruction_array_store(IROperand *array, IROperand *index, IR
 
 IRInstruction *ir_instruction_bounds_check(IROperand *index, IROperand *size, const char *error_label)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_BOUNDS_CHECK;
     instr->result = NULL;
     instr->arg1 = index;
@@ -195,7 +204,7 @@ IRInstruction *ir_instruction_bounds_check(IROperand *index, IROperand *size, co
 
 IRInstruction *ir_instruction_array_decl(const char *array_name, int size, DataType element_type)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_ARRAY_DECL;
     IROperand *array_var = ir_operand_array_var(array_name, size);
     array_var->data_type = element_type;
@@ -209,7 +218,7 @@ IRInstruction *ir_instruction_array_decl(const char *array_name, int size, DataT
 
 IRInstruction *ir_instruction_array_init(const char *array_name, int size, DataType element_type, IROperand *value)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_ARRAY_INIT;
     IROperand *array_var = ir_operand_array_var(array_name, size);
     array_var->data_type = element_type;
@@ -223,7 +232,7 @@ IRInstruction *ir_instruction_array_init(const char *array_name, int size, DataT
 
 IRInstruction *ir_instruction_var_decl(const char *var_name, DataType type)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_VAR_DECL;
     IROperand *var = ir_operand_var(var_name);
     var->data_type = type;
@@ -235,9 +244,22 @@ IRInstruction *ir_instruction_var_decl(const char *var_name, DataType type)
     return instr;
 }
 
+/* Adds one to the counter, or the truth value of `condition` if given. */
+IRInstruction *ir_instruction_profile(int counter, IROperand *condition)
+{
+    IRInstruction *instr = ir_instruction_alloc();
+    instr->opcode = IR_PROFILE;
+    instr->result = NULL;
+    instr->arg1 = condition;
+    instr->arg2 = ir_operand_const(counter);
+    instr->args = NULL;
+    instr->label = NULL;
+    return instr;
+}
+
 IRInstruction *ir_instruction_inline_asm(const char *asm_code, bool is_volatile, DynamicArray *outputs, DynamicArray *inputs, DynamicArray *clobbers)
 {
-    IRInstruction *instr = safe_malloc(sizeof(IRInstruction));
+    IRInstruction *instr = ir_instruction_alloc();
     instr->opcode = IR_INLINE_ASM;
     instr->result = NULL;
     instr->arg1 = NULL;
@@ -254,6 +276,71 @@ IRInstruction *ir_instruction_inline_asm(const char *asm_code, bool is_volatile,
     return instr;
 }
 
+static DynamicArray *clone_asm_operands(const DynamicArray *operands)
+{
+    if (!operands)
+        return NULL;
+    DynamicArray *copy = safe_malloc(sizeof(DynamicArray));
+    array_init(copy, operands->size > 0 ? operands->size : 1);
+    for (size_t i = 0; i < operands->size; i++)
+    {
+        InlineAsmOperand *op = (InlineAsmOperand *)array_get(operands, i);
+        InlineAsmOperand *op_copy = safe_malloc(sizeof(InlineAsmOperand));
+        op_copy->constraint = string_copy(op->constraint);
+        op_copy->variable = string_copy(op->variable);
+        op_copy->is_output = op->is_output;
+        array_push(copy, op_copy);
+    }
+    return copy;
+}
+
+IRInstruction *ir_instruction_clone(const IRInstruction *instr)
+{
+    if (!instr)
+        return NULL;
+
+    IRInstruction *copy = ir_instruction_alloc();
+    copy->opcode = instr->opcode;
+    copy->result = ir_operand_copy(instr->result);
+    copy->arg1 = ir_operand_copy(instr->arg1);
+    copy->arg2 = ir_operand_copy(instr->arg2);
+    copy->label = instr->label ? string_copy(instr->label) : NULL;
+    copy->array_size = instr->array_size;
+    copy->element_type = instr->element_type;
+    copy->asm_volatile = instr->asm_volatile;
+    copy->is_tail_call = instr->is_tail_call;
+    copy->has_profile = instr->has_profile;
+    copy->profile_count = instr->profile_count;
+    copy->profile_taken = instr->profile_taken;
+    copy->is_cold = instr->is_cold;
+    copy->is_epilogue = instr->is_epilogue;
+
+    if (instr->args)
+    {
+        copy->args = safe_malloc(sizeof(DynamicArray));
+        array_init(copy->args, instr->args->size > 0 ? instr->args->size : 1);
+        for (size_t i = 0; i < instr->args->size; i++)
+        {
+            array_push(copy->args, ir_operand_copy((IROperand *)array_get(instr->args, i)));
+        }
+    }
+
+    if (instr->asm_code)
+        copy->asm_code = string_copy(instr->asm_code);
+    copy->asm_outputs = clone_asm_operands(instr->asm_outputs);
+    copy->asm_inputs = clone_asm_operands(instr->asm_inputs);
+    if (instr->asm_clobbers)
+    {
+        copy->asm_clobbers = safe_malloc(sizeof(DynamicArray));
+        array_init(copy->asm_clobbers, instr->asm_clobbers->size > 0 ? instr->asm_clobbers->size : 1);
+        for (size_t i = 0; i < instr->asm_clobbers->size; i++)
+        {
+            array_push(copy->asm_clobbers, string_copy((char *)array_get(instr->asm_clobbers, i)));
+        }
+    }
+    return copy;
+}
+
 void ir_instruction_destroy(IRInstruction *instr)
 {
     if (!instr)
@@ -326,7 +413,7 @@ void ir_instruction_print(const IRInstruction *instr)
         printf("NOP");
         break;
     case IR_LABEL:
-        printf("%s:", instr->label);
+        printf("%s:%s", instr->label, instr->is_cold ? " (cold)" : "");
         break;
     case IR_MOVE:
         ir_operand_print(instr->result);
@@ -346,6 +433,9 @@ void ir_instruction_print(const IRInstruction *instr)
     case IR_GE:
     case IR_AND:
     case IR_OR:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
         ir_operand_print(instr->result);
         printf(" = ");
         ir_operand_print(instr->arg1);
@@ -354,6 +444,9 @@ void ir_instruction_print(const IRInstruction *instr)
         break;
     case IR_NEG:
     case IR_NOT:
+    case IR_VECTOR_SPLAT:
+    case IR_VECTOR_INDEX:
+    case IR_VECTOR_REDUCE:
         ir_operand_print(instr->result);
         printf(" = %s ", ir_opcode_to_string(instr->opcode));
         ir_operand_print(instr->arg1);
@@ -378,6 +471,8 @@ void ir_instruction_print(const IRInstruction *instr)
             printf(" = ");
         }
         printf("CALL %s", instr->label);
+        if (instr->is_tail_call)
+            printf(" [tail]");
         break;
     case IR_RETURN:
         printf("RETURN");
@@ -391,6 +486,15 @@ void ir_instruction_print(const IRInstruction *instr)
         printf("PARAM ");
         ir_operand_print(instr->arg1);
         break;
+    case IR_PROFILE:
+        printf("PROFILE ");
+        ir_operand_print(instr->arg2);
+        if (instr->arg1)
+        {
+            printf(" += ");
+            ir_operand_print(instr->arg1);
+        }
+        break;
     case IR_PRINT:
         printf("PRINT ");
         ir_operand_print(instr->arg1);
@@ -434,3 +538,18 @@ void ir_instruction_print(const IRInstruction *instr)
     }
     printf("\n");
 }
+
+/* 1 when profile data shows the branch is almost always taken, -1 when it
+   almost never is or it leads to a cold block, 0 when nothing is known. */
+int ir_instruction_branch_bias(const IRInstruction *instr)
+{
+    if (!instr)
+        return 0;
+    if (!instr->has_profile || instr->profile_count < IR_PROFILE_MIN_SAMPLES)
+        return instr->is_cold ? -1 : 0;
+    if (instr->profile_taken * 5 >= instr->profile_count * 4)
+        return 1;
+    if (instr->profile_taken * 5 <= instr->profile_count)
+        return -1;
+    return 0;
+}
@@ -0,0 +1,1142 @@
+#include "backend/vm/bytecode.h"
+#include "backend/codegen/codegen.h"
+
+extern bool debug_enabled;
+
+/* Constants are numbered from here while a function is lowered, and move
+   above its value registers once their count is known. Jump targets,
+   counts and indices all stay far below it. */
+#define CONSTANT_BASE (1 << 30)
+
+typedef struct JumpFixup {
+    size_t instruction;
+    const char *label;
+} JumpFixup;
+
+typedef struct Lowering {
+    IRProgram *ir_program;
+    BytecodeProgram *program;
+    BytecodeFunction *function;
+    HashTable *functions;
+    HashTable *strings;
+    HashTable *variables;
+    HashTable *variable_types;
+    HashTable *constants;
+    HashTable *labels;
+    /* Per temporary: its register plus one, and how often it appears. */
+    int *temps;
+    int *temp_references;
+    JumpFixup *jumps;
+    size_t jump_count;
+    size_t jump_capacity;
+    IROperand *params[MAX_PARAMS];
+    int param_count;
+    int next_register;
+    int scratch;
+    int max_scratch;
+    Error *error;
+    bool failed;
+} Lowering;
+
+static const char *const opcode_names[BC_OPCODE_COUNT] = {
+    "move", "add.i", "sub.i", "mul.i", "div.i", "mod.i", "shl.i", "shr.i", "band.i", "neg.i",
+    "add.f", "sub.f", "mul.f", "div.f", "neg.f", "add.d", "sub.d", "mul.d", "div.d", "neg.d",
+    "eq.i", "ne.i", "lt.i", "le.i", "gt.i", "ge.i", "eq.f", "ne.f", "lt.f", "le.f", "gt.f", "ge.f",
+    "eq.d", "ne.d", "lt.d", "le.d", "gt.d", "ge.d", "not", "and", "or",
+    "i2f", "i2d", "f2i", "d2i", "f2d", "d2f", "jump", "jump.if", "jump.ifnot",
+    "br.eq.i", "br.ne.i", "br.lt.i", "br.le.i", "br.gt.i", "br.ge.i",
+    "load.element", "store.element", "fill", "bounds.check", "call", "tail.call", "call.builtin", "return",
+    "print", "profile", "profile.if", "vadd.i", "vsub.i", "vmul.i", "vshl.i", "vshr.i", "vband.i",
+    "vadd.d", "vsub.d", "vmul.d", "vload", "vstore", "vsplat", "vindex.i", "vindex.d", "vreduce.i", "vreduce.d"};
+
+const char *bytecode_opcode_name(BytecodeOpcode opcode)
+{
+    return opcode < BC_OPCODE_COUNT ? opcode_names[opcode] : "?";
+}
+
+static void fail(Lowering *lowering, const char *format, const char *name)
+{
+    if (lowering->failed)
+        return;
+    char message[256];
+    snprintf(message, sizeof(message), format, name);
+    error_set(lowering->error, ERROR_CODEGEN, message, 0, 0);
+    lowering->failed = true;
+}
+
+static size_t emit(Lowering *lowering, BytecodeOpcode opcode, int32_t a, int32_t b, int32_t c)
+{
+    BytecodeFunction *function = lowering->function;
+    if (function->code_size == function->code_capacity)
+    {
+        function->code_capacity = function->code_capacity ? function->code_capacity * 2 : 64;
+        function->code = safe_realloc(function->code, function->code_capacity * sizeof(BytecodeInstruction));
+    }
+    BytecodeInstruction *instruction = &function->code[function->code_size];
+    instruction->opcode = (uint8_t)opcode;
+    instruction->width = 0;
+    instruction->a = a;
+    instruction->b = b;
+    instruction->c = c;
+    return function->code_size++;
+}
+
+static void emit_vector(Lowering *lowering, BytecodeOpcode opcode, int32_t a, int32_t b, int32_t c, int width)
+{
+    size_t index = emit(lowering, opcode, a, b, c);
+    lowering->function->code[index].width = (uint8_t)width;
+}
+
+static int32_t add_operand(Lowering *lowering, int32_t value)
+{
+    BytecodeFunction *function = lowering->function;
+    if (function->operand_count == function->operand_capacity)
+    {
+        function->operand_capacity = function->operand_capacity ? function->operand_capacity * 2 : 16;
+        function->operands = safe_realloc(function->operands, function->operand_capacity * sizeof(int32_t));
+    }
+    function->operands[function->operand_count] = value;
+    return (int32_t)function->operand_count++;
+}
+
+static void jump_to(Lowering *lowering, size_t instruction, const char *label)
+{
+    if (lowering->jump_count == lowering->jump_capacity)
+    {
+        lowering->jump_capacity = lowering->jump_capacity ? lowering->jump_capacity * 2 : 16;
+        lowering->jumps = safe_realloc(lowering->jumps, lowering->jump_capacity * sizeof(JumpFixup));
+    }
+    lowering->jumps[lowering->jump_count].instruction = instruction;
+    lowering->jumps[lowering->jump_count].label = label;
+    lowering->jump_count++;
+}
+
+static int32_t constant(Lowering *lowering, BytecodeValue value)
+{
+    BytecodeFunction *function = lowering->function;
+    char key[24];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)value.i);
+    intptr_t index = (intptr_t)hashtable_get(lowering->constants, key);
+    if (index)
+        return CONSTANT_BASE + (int32_t)index - 1;
+
+    if (function->constant_count == function->constant_capacity)
+    {
+        function->constant_capacity = function->constant_capacity ? function->constant_capacity * 2 : 8;
+        function->constants = safe_realloc(function->constants, function->constant_capacity * sizeof(BytecodeValue));
+    }
+    function->constants[function->constant_count] = value;
+    hashtable_put(lowering->constants, key, (void *)(intptr_t)(function->constant_count + 1));
+    return CONSTANT_BASE + (int32_t)function->constant_count++;
+}
+
+static const char *intern_string(Lowering *lowering, const char *text)
+{
+    char *copy = (char *)hashtable_get(lowering->strings, text);
+    if (!copy)
+    {
+        copy = string_copy(text);
+        array_push(&lowering->program->strings, copy);
+        hashtable_put(lowering->strings, text, copy);
+    }
+    return copy;
+}
+
+static bool is_value(const IROperand *operand)
+{
+    return operand && (operand->type == IR_OP_TEMP || operand->type == IR_OP_VAR);
+}
+
+static bool is_zero(const IROperand *operand)
+{
+    return !operand || operand->type == IR_OP_NULL || operand->type == IR_OP_LABEL;
+}
+
+static bool is_float_type(DataType type)
+{
+    return type == TYPE_FLOAT || type == TYPE_DOUBLE;
+}
+
+/* A variable's uses may have been typed from another scope's symbol of
+   the same name; its declaration decides, as in the assembly backend. */
+static DataType declared_type(Lowering *lowering, const IROperand *operand)
+{
+    if (operand->type == IR_OP_VAR && operand->vector_width == 0)
+    {
+        intptr_t type = (intptr_t)hashtable_get(lowering->variable_types, operand->data.var_name);
+        if (type)
+            return (DataType)(type - 1);
+    }
+    return operand->data_type;
+}
+
+static DataType representation(DataType type)
+{
+    return is_float_type(type) ? type : TYPE_INT;
+}
+
+/* Registers hold integers, floats or doubles; strings, booleans and
+   pointers are integers. Float literals are doubles, as in C. */
+static DataType scalar_type(Lowering *lowering, const IROperand *operand)
+{
+    if (is_zero(operand) || operand->type == IR_OP_STRING_CONST)
+        return TYPE_INT;
+    if (operand->is_float_const)
+        return TYPE_DOUBLE;
+    return representation(declared_type(lowering, operand));
+}
+
+static DataType arithmetic_type(Lowering *lowering, const IROperand *arg1, const IROperand *arg2)
+{
+    DataType left = scalar_type(lowering, arg1), right = scalar_type(lowering, arg2);
+    if (left == TYPE_DOUBLE || right == TYPE_DOUBLE)
+        return TYPE_DOUBLE;
+    return left == TYPE_FLOAT || right == TYPE_FLOAT ? TYPE_FLOAT : TYPE_INT;
+}
+
+static int storage_size(const IROperand *operand)
+{
+    if (operand->array_size > 0)
+        return operand->array_size;
+    return operand->vector_width > 0 ? operand->vector_width : 1;
+}
+
+/* The first register of a variable or temporary. Arrays and vectors take
+   one register per element. */
+static int32_t register_of(Lowering *lowering, const IROperand *operand)
+{
+    if (operand->type == IR_OP_TEMP)
+        return lowering->temps[operand->data.temp_id] - 1;
+    return (int32_t)(intptr_t)hashtable_get(lowering->variables, operand->data.var_name) - 1;
+}
+
+static void record_type(Lowering *lowering, const IROperand *variable)
+{
+    if (variable && variable->type == IR_OP_VAR)
+        hashtable_put(lowering->variable_types, variable->data.var_name, (void *)(intptr_t)(variable->data_type + 1));
+}
+
+static void record_size(HashTable *sizes, int *temp_sizes, const IROperand *operand)
+{
+    if (!is_value(operand))
+        return;
+    int size = storage_size(operand);
+    if (operand->type == IR_OP_TEMP)
+    {
+        if (temp_sizes[operand->data.temp_id] < size)
+            temp_sizes[operand->data.temp_id] = size;
+    }
+    else if ((intptr_t)hashtable_get(sizes, operand->data.var_name) < size)
+    {
+        hashtable_put(sizes, operand->data.var_name, (void *)(intptr_t)size);
+    }
+}
+
+static void reserve(Lowering *lowering, HashTable *sizes, const int *temp_sizes, const IROperand *operand)
+{
+    if (!is_value(operand))
+        return;
+    if (operand->type == IR_OP_TEMP)
+    {
+        lowering->temp_references[operand->data.temp_id]++;
+        if (lowering->temps[operand->data.temp_id] == 0)
+        {
+            lowering->temps[operand->data.temp_id] = lowering->next_register + 1;
+            lowering->next_register += temp_sizes[operand->data.temp_id];
+        }
+    }
+    else if (!hashtable_contains(lowering->variables, operand->data.var_name))
+    {
+        hashtable_put(lowering->variables, operand->data.var_name, (void *)(intptr_t)(lowering->next_register + 1));
+        lowering->next_register += (int)(intptr_t)hashtable_get(sizes, operand->data.var_name);
+    }
+}
+
+static int max_temp_id(IRFunction *func)
+{
+    int max = func->temp_counter;
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        IROperand *operands[3] = {instr->result, instr->arg1, instr->arg2};
+        for (int k = 0; k < 3; k++)
+        {
+            if (operands[k] && operands[k]->type == IR_OP_TEMP && operands[k]->data.temp_id > max)
+                max = operands[k]->data.temp_id;
+        }
+        for (size_t k = 0; instr->args && k < instr->args->size; k++)
+        {
+            IROperand *arg = (IROperand *)array_get(instr->args, k);
+            if (arg && arg->type == IR_OP_TEMP && arg->data.temp_id > max)
+                max = arg->data.temp_id;
+        }
+    }
+    return max;
+}
+
+/* Gives the parameters the first registers, so a call can copy its
+   arguments straight into them, then every other value in order of first
+   appearance, each sized for its largest use. */
+static void assign_registers(Lowering *lowering, IRFunction *func)
+{
+    size_t count = func->instructions.size;
+    int temp_count = max_temp_id(func) + 1;
+    HashTable *sizes = hashtable_create(count / 4 + 16);
+    int *temp_sizes = safe_malloc(temp_count * sizeof(int));
+    memset(temp_sizes, 0, temp_count * sizeof(int));
+    lowering->temps = safe_malloc(temp_count * sizeof(int));
+    memset(lowering->temps, 0, temp_count * sizeof(int));
+    lowering->temp_references = safe_malloc(temp_count * sizeof(int));
+    memset(lowering->temp_references, 0, temp_count * sizeof(int));
+
+    for (size_t i = 0; i < func->params.size; i++)
+    {
+        IROperand *param = (IROperand *)array_get(&func->params, i);
+        record_type(lowering, param);
+        record_size(sizes, temp_sizes, param);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (instr->opcode == IR_VAR_DECL || instr->opcode == IR_ARRAY_DECL || instr->opcode == IR_ARRAY_INIT)
+            record_type(lowering, instr->result);
+        record_size(sizes, temp_sizes, instr->result);
+        record_size(sizes, temp_sizes, instr->arg1);
+        record_size(sizes, temp_sizes, instr->arg2);
+        for (size_t k = 0; instr->args && k < instr->args->size; k++)
+        {
+            record_size(sizes, temp_sizes, (IROperand *)array_get(instr->args, k));
+        }
+    }
+
+    for (size_t i = 0; i < func->params.size; i++)
+    {
+        reserve(lowering, sizes, temp_sizes, (IROperand *)array_get(&func->params, i));
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        reserve(lowering, sizes, temp_sizes, instr->result);
+        reserve(lowering, sizes, temp_sizes, instr->arg1);
+        reserve(lowering, sizes, temp_sizes, instr->arg2);
+        for (size_t k = 0; instr->args && k < instr->args->size; k++)
+        {
+            reserve(lowering, sizes, temp_sizes, (IROperand *)array_get(instr->args, k));
+        }
+    }
+    safe_free(temp_sizes);
+    hashtable_destroy(sizes);
+}
+
+static int32_t scratch(Lowering *lowering)
+{
+    int32_t reg = lowering->next_register + lowering->scratch++;
+    if (lowering->scratch > lowering->max_scratch)
+        lowering->max_scratch = lowering->scratch;
+    return reg;
+}
+
+static BytecodeOpcode conversion(DataType from, DataType to)
+{
+    if (from == TYPE_INT)
+        return to == TYPE_FLOAT ? BC_I2F : BC_I2D;
+    if (from == TYPE_FLOAT)
+        return to == TYPE_INT ? BC_F2I : BC_F2D;
+    return to == TYPE_INT ? BC_D2I : BC_D2F;
+}
+
+static bool same_representation(DataType from, DataType to)
+{
+    return from == to || (!is_float_type(from) && !is_float_type(to));
+}
+
+static BytecodeValue constant_value(const IROperand *operand, DataType type)
+{
+    BytecodeValue value;
+    value.i = 0;
+    if (is_zero(operand))
+        return value;
+    double number = operand->is_float_const ? operand->data.float_const_value : (double)operand->data.const_value;
+    if (type == TYPE_FLOAT)
+        value.f = (float)number;
+    else if (type == TYPE_DOUBLE)
+        value.d = number;
+    else
+        value.i = operand->is_float_const ? (int64_t)operand->data.float_const_value : operand->data.const_value;
+    return value;
+}
+
+/* Register holding the operand as a value of `type`. Constants are
+   converted as they enter the pool; other values of another
+   representation are converted into a scratch register. */
+static int32_t value_as(Lowering *lowering, IROperand *operand, DataType type)
+{
+    if (operand && operand->type == IR_OP_STRING_CONST)
+    {
+        BytecodeValue value;
+        value.i = 0;
+        value.s = intern_string(lowering, operand->data.string_const_value);
+        return constant(lowering, value);
+    }
+    if (!is_value(operand))
+        return constant(lowering, constant_value(operand, type));
+
+    int32_t reg = register_of(lowering, operand);
+    DataType from = scalar_type(lowering, operand);
+    if (same_representation(from, type))
+        return reg;
+    int32_t converted = scratch(lowering);
+    emit(lowering, conversion(from, type), converted, reg, 0);
+    return converted;
+}
+
+/* The operand in its own representation. */
+static int32_t value_of(Lowering *lowering, IROperand *operand)
+{
+    return value_as(lowering, operand, scalar_type(lowering, operand));
+}
+
+/* Where to compute a value of `type` headed for `result`: the result's
+   own register unless it needs converting first. */
+static int32_t destination(Lowering *lowering, IROperand *result, DataType type)
+{
+    if (!is_value(result))
+        return scratch(lowering);
+    if (same_representation(scalar_type(lowering, result), type))
+        return register_of(lowering, result);
+    return scratch(lowering);
+}
+
+/* Where to store a value whose bits go to the result unconverted. */
+static int32_t raw_destination(Lowering *lowering, IROperand *result)
+{
+    return is_value(result) ? register_of(lowering, result) : scratch(lowering);
+}
+
+/* Converts a value computed by destination() into the result. */
+static void finish(Lowering *lowering, IROperand *result, int32_t reg, DataType type)
+{
+    if (!is_value(result) || reg == register_of(lowering, result))
+        return;
+    emit(lowering, conversion(type, scalar_type(lowering, result)), register_of(lowering, result), reg, 0);
+}
+
+/* Copies the operand into `dest` as a value of `type`. */
+static void move_into(Lowering *lowering, int32_t dest, IROperand *operand, DataType type)
+{
+    if (!is_value(operand))
+    {
+        emit(lowering, BC_MOVE, dest, value_as(lowering, operand, type), 0);
+        return;
+    }
+    DataType from = scalar_type(lowering, operand);
+    int32_t reg = register_of(lowering, operand);
+    if (!same_representation(from, type))
+        emit(lowering, conversion(from, type), dest, reg, 0);
+    else if (reg != dest)
+        emit(lowering, BC_MOVE, dest, reg, 0);
+}
+
+/* The float and double forms of an opcode follow the integer one, in the
+   same order. */
+static BytecodeOpcode typed(BytecodeOpcode integer, DataType type)
+{
+    if (type == TYPE_INT)
+        return integer;
+    if (integer == BC_NEG_I)
+        return type == TYPE_FLOAT ? BC_NEG_F : BC_NEG_D;
+    if (integer >= BC_EQ_I && integer <= BC_GE_I)
+        return (BytecodeOpcode)((type == TYPE_FLOAT ? BC_EQ_F : BC_EQ_D) + (integer - BC_EQ_I));
+    return (BytecodeOpcode)((type == TYPE_FLOAT ? BC_ADD_F : BC_ADD_D) + (integer - BC_ADD_I));
+}
+
+static bool is_comparison(IROpcode opcode)
+{
+    return opcode == IR_EQ || opcode == IR_NE || opcode == IR_LT || opcode == IR_LE || opcode == IR_GT ||
+           opcode == IR_GE;
+}
+
+static BytecodeOpcode comparison(IROpcode opcode, bool negate)
+{
+    static const IROpcode order[] = {IR_EQ, IR_NE, IR_LT, IR_LE, IR_GT, IR_GE};
+    static const int negation[] = {1, 0, 5, 4, 3, 2};
+    int index = 0;
+    while (order[index] != opcode)
+        index++;
+    return (BytecodeOpcode)(BC_EQ_I + (negate ? negation[index] : index));
+}
+
+static void arithmetic(Lowering *lowering, BytecodeOpcode integer, IRInstruction *instr)
+{
+    DataType type = arithmetic_type(lowering, instr->arg1, instr->arg2);
+    int32_t left = value_as(lowering, instr->arg1, type);
+    int32_t right = value_as(lowering, instr->arg2, type);
+    /* Integer results are stored as they are, whatever the result's type. */
+    int32_t dest = type == TYPE_INT ? raw_destination(lowering, instr->result)
+                                    : destination(lowering, instr->result, type);
+    emit(lowering, typed(integer, type), dest, left, right);
+    if (type != TYPE_INT)
+        finish(lowering, instr->result, dest, type);
+}
+
+static void integer_binary(Lowering *lowering, BytecodeOpcode opcode, IRInstruction *instr)
+{
+    int32_t left = value_as(lowering, instr->arg1, TYPE_INT);
+    int32_t right = value_as(lowering, instr->arg2, TYPE_INT);
+    emit(lowering, opcode, raw_destination(lowering, instr->result), left, right);
+}
+
+static void vector_binary(Lowering *lowering, BytecodeOpcode integer, BytecodeOpcode floating, IRInstruction *instr)
+{
+    BytecodeOpcode opcode = instr->result->data_type == TYPE_DOUBLE && floating != BC_OPCODE_COUNT ? floating
+                                                                                                     : integer;
+    emit_vector(lowering, opcode, register_of(lowering, instr->result), register_of(lowering, instr->arg1),
+                register_of(lowering, instr->arg2), instr->result->vector_width);
+}
+
+static void compare(Lowering *lowering, IRInstruction *instr)
+{
+    DataType type = arithmetic_type(lowering, instr->arg1, instr->arg2);
+    int32_t left = value_as(lowering, instr->arg1, type);
+    int32_t right = value_as(lowering, instr->arg2, type);
+    emit(lowering, typed(comparison(instr->opcode, false), type), raw_destination(lowering, instr->result),
+         left, right);
+}
+
+static bool constant_is_true(const IROperand *condition)
+{
+    if (is_zero(condition))
+        return false;
+    if (condition->type == IR_OP_CONST)
+        return condition->is_float_const ? condition->data.float_const_value != 0 : condition->data.const_value != 0;
+    return true;
+}
+
+static void conditional_jump(Lowering *lowering, IRInstruction *instr, bool jump_if_true)
+{
+    if (!is_value(instr->arg1))
+    {
+        if (constant_is_true(instr->arg1) == jump_if_true)
+            jump_to(lowering, emit(lowering, BC_JUMP, 0, 0, 0), instr->label);
+        return;
+    }
+    int32_t reg = value_of(lowering, instr->arg1);
+    jump_to(lowering, emit(lowering, jump_if_true ? BC_JUMP_IF : BC_JUMP_IF_NOT, 0, reg, 0), instr->label);
+}
+
+static int builtin_of(const char *name)
+{
+    if (strncmp(name, "__tl_", 5) == 0)
+        name += 5;
+    if (strcmp(name, "concat") == 0)
+        return BUILTIN_CONCAT;
+    if (strcmp(name, "substr") == 0)
+        return BUILTIN_SUBSTR;
+    if (strcmp(name, "strlen") == 0)
+        return BUILTIN_STRLEN;
+    if (strcmp(name, "strcmp") == 0)
+        return BUILTIN_STRCMP;
+    if (strcmp(name, "char_at") == 0)
+        return BUILTIN_CHAR_AT;
+    return -1;
+}
+
+static int builtin_arity(int builtin)
+{
+    switch (builtin)
+    {
+    case BUILTIN_SUBSTR:
+        return 3;
+    case BUILTIN_STRLEN:
+        return 1;
+    default:
+        return 2;
+    }
+}
+
+static IRFunction *find_function(Lowering *lowering, const char *name, int *index)
+{
+    intptr_t found = (intptr_t)hashtable_get(lowering->functions, name);
+    if (!found)
+        return NULL;
+    *index = (int)found - 1;
+    return (IRFunction *)array_get(&lowering->ir_program->functions, (size_t)found - 1);
+}
+
+/* Converts each pending argument to the callee's parameter type and lists
+   the registers in the operand pool. */
+static int32_t argument_list(Lowering *lowering, IRFunction *callee)
+{
+    int32_t registers[MAX_PARAMS];
+    for (int i = 0; i < lowering->param_count; i++)
+    {
+        IROperand *arg = lowering->params[i];
+        DataType type = scalar_type(lowering, arg);
+        if (callee && i < (int)callee->params.size)
+            type = representation(((IROperand *)array_get(&callee->params, i))->data_type);
+        registers[i] = value_as(lowering, arg, type);
+    }
+    int32_t list = add_operand(lowering, lowering->param_count);
+    for (int i = 0; i < lowering->param_count; i++)
+    {
+        add_operand(lowering, registers[i]);
+    }
+    lowering->param_count = 0;
+    return list;
+}
+
+static void call(Lowering *lowering, IRInstruction *instr)
+{
+    const char *name = instr->label;
+    int index = 0;
+    IRFunction *callee = find_function(lowering, name, &index);
+    if (!callee)
+    {
+        int builtin = builtin_of(name);
+        if (builtin < 0)
+        {
+            fail(lowering, "Cannot interpret a call to '%s', which the program does not define", name);
+            return;
+        }
+        if (lowering->param_count != builtin_arity(builtin))
+        {
+            fail(lowering, "Wrong number of arguments to '%s'", name);
+            return;
+        }
+        int32_t list = argument_list(lowering, NULL);
+        emit(lowering, BC_CALL_BUILTIN, raw_destination(lowering, instr->result), builtin, list);
+        return;
+    }
+
+    DataType returned = representation(callee->return_type);
+    IRFunction *caller = (IRFunction *)array_get(&lowering->ir_program->functions,
+                                                 (size_t)(lowering->function - lowering->program->functions));
+    /* The callee's return takes the place of ours, so both must return
+       the same representation. */
+    if (instr->is_tail_call && !callee->memoize && returned == representation(caller->return_type))
+    {
+        emit(lowering, BC_TAIL_CALL, 0, index, argument_list(lowering, callee));
+        return;
+    }
+    int32_t list = argument_list(lowering, callee);
+    /* Integer results are stored as they are, like integer arithmetic. */
+    int32_t dest = returned == TYPE_INT ? raw_destination(lowering, instr->result)
+                                        : destination(lowering, instr->result, returned);
+    emit(lowering, BC_CALL, dest, index, list);
+    if (returned != TYPE_INT)
+        finish(lowering, instr->result, dest, returned);
+}
+
+static void print(Lowering *lowering, IRInstruction *instr)
+{
+    size_t count = instr->args ? instr->args->size : (instr->arg1 ? 1 : 0);
+    int32_t registers[64];
+    int32_t kinds[64];
+    if (count > sizeof(registers) / sizeof(registers[0]))
+    {
+        fail(lowering, "Too many values in one print in '%s'", lowering->function->name);
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        IROperand *value = instr->args ? (IROperand *)array_get(instr->args, i) : instr->arg1;
+        DataType type = scalar_type(lowering, value);
+        if (value->type == IR_OP_STRING_CONST || declared_type(lowering, value) == TYPE_STRING)
+            kinds[i] = PRINT_STRING;
+        else
+            kinds[i] = type == TYPE_FLOAT ? PRINT_FLOAT : type == TYPE_DOUBLE ? PRINT_DOUBLE : PRINT_INT;
+        registers[i] = value_of(lowering, value);
+    }
+    int32_t list = add_operand(lowering, (int32_t)count);
+    for (size_t i = 0; i < count; i++)
+    {
+        add_operand(lowering, registers[i]);
+        add_operand(lowering, kinds[i]);
+    }
+    emit(lowering, BC_PRINT, list, 0, 0);
+}
+
+static void array_load(Lowering *lowering, IRInstruction *instr)
+{
+    int32_t index = value_as(lowering, instr->arg2, TYPE_INT);
+    if (instr->result->vector_width > 0)
+    {
+        emit_vector(lowering, BC_VLOAD, register_of(lowering, instr->result), register_of(lowering, instr->arg1), index,
+                    instr->result->vector_width);
+        return;
+    }
+    emit(lowering, BC_LOAD_ELEMENT, raw_destination(lowering, instr->result), register_of(lowering, instr->arg1),
+         index);
+}
+
+static void array_store(Lowering *lowering, IRInstruction *instr)
+{
+    int32_t index = value_as(lowering, instr->arg2, TYPE_INT);
+    if (instr->result->vector_width > 0)
+    {
+        emit_vector(lowering, BC_VSTORE, register_of(lowering, instr->result), register_of(lowering, instr->arg1),
+                    index, instr->result->vector_width);
+        return;
+    }
+    int32_t value = value_as(lowering, instr->result, scalar_type(lowering, instr->arg1));
+    emit(lowering, BC_STORE_ELEMENT, value, register_of(lowering, instr->arg1), index);
+}
+
+static void vector_build(Lowering *lowering, IRInstruction *instr)
+{
+    bool to_double = instr->result->data_type == TYPE_DOUBLE;
+    int32_t result = register_of(lowering, instr->result);
+    if (instr->opcode == IR_VECTOR_SPLAT)
+    {
+        int32_t value = to_double ? value_as(lowering, instr->arg1, TYPE_DOUBLE) : value_of(lowering, instr->arg1);
+        emit_vector(lowering, BC_VSPLAT, result, value, 0, instr->result->vector_width);
+        return;
+    }
+    emit_vector(lowering, to_double ? BC_VINDEX_D : BC_VINDEX_I, result, value_of(lowering, instr->arg1), 0,
+                instr->result->vector_width);
+}
+
+static void profile(Lowering *lowering, IRInstruction *instr)
+{
+    int32_t counter = (int32_t)instr->arg2->data.const_value;
+    if (is_value(instr->arg1))
+        emit(lowering, BC_PROFILE_IF, counter, value_of(lowering, instr->arg1), 0);
+    else if (!instr->arg1 || constant_is_true(instr->arg1))
+        emit(lowering, BC_PROFILE, counter, 0, 0);
+}
+
+/* A temporary defined by one instruction and read only by the next. */
+static bool feeds_next(Lowering *lowering, const IROperand *value, const IROperand *use)
+{
+    return value && use && value->type == IR_OP_TEMP && use->type == IR_OP_TEMP &&
+           value->data.temp_id == use->data.temp_id && lowering->temp_references[value->data.temp_id] == 2;
+}
+
+/* Opcodes whose scalar result can be written straight to any register. */
+static bool computes_scalar(const IRInstruction *instr)
+{
+    switch (instr->opcode)
+    {
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_NEG:
+    case IR_NOT:
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+    case IR_AND:
+    case IR_OR:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
+    case IR_ARRAY_LOAD:
+    case IR_CALL:
+        return instr->result->vector_width == 0;
+    default:
+        return false;
+    }
+}
+
+static void lower_instruction(Lowering *lowering, IRInstruction *instr);
+
+/* Pairs that save a dispatch: an integer comparison that only feeds a
+   branch becomes a compare-and-branch, and a value that is only copied
+   into a variable is computed straight into it. */
+static bool lower_pair(Lowering *lowering, IRInstruction *instr, IRInstruction *next)
+{
+    if (!next || !instr->result)
+        return false;
+
+    if (is_comparison(instr->opcode) && (next->opcode == IR_JUMP_IF || next->opcode == IR_JUMP_IF_FALSE) &&
+        feeds_next(lowering, instr->result, next->arg1) &&
+        arithmetic_type(lowering, instr->arg1, instr->arg2) == TYPE_INT)
+    {
+        int32_t left = value_of(lowering, instr->arg1);
+        int32_t right = value_of(lowering, instr->arg2);
+        BytecodeOpcode opcode = comparison(instr->opcode, next->opcode == IR_JUMP_IF_FALSE);
+        jump_to(lowering, emit(lowering, (BytecodeOpcode)(BC_BR_EQ_I + (opcode - BC_EQ_I)), 0, left, right),
+                next->label);
+        return true;
+    }
+
+    if (next->opcode == IR_MOVE && computes_scalar(instr) && is_value(next->result) &&
+        next->result->vector_width == 0 && next->result->array_size <= 0 &&
+        scalar_type(lowering, instr->result) == scalar_type(lowering, next->result) &&
+        feeds_next(lowering, instr->result, next->arg1))
+    {
+        IROperand *result = instr->result;
+        instr->result = next->result;
+        lower_instruction(lowering, instr);
+        instr->result = result;
+        return true;
+    }
+    return false;
+}
+
+static void lower_instruction(Lowering *lowering, IRInstruction *instr)
+{
+    IROperand *result = instr->result;
+    bool vector = result && result->vector_width > 0;
+
+    switch (instr->opcode)
+    {
+    case IR_MOVE:
+        if (is_value(result))
+            move_into(lowering, register_of(lowering, result), instr->arg1, scalar_type(lowering, result));
+        break;
+    case IR_ADD:
+        if (vector)
+            vector_binary(lowering, BC_VADD_I, BC_VADD_D, instr);
+        else
+            arithmetic(lowering, BC_ADD_I, instr);
+        break;
+    case IR_SUB:
+        if (vector)
+            vector_binary(lowering, BC_VSUB_I, BC_VSUB_D, instr);
+        else
+            arithmetic(lowering, BC_SUB_I, instr);
+        break;
+    case IR_MUL:
+        if (vector)
+            vector_binary(lowering, BC_VMUL_I, BC_VMUL_D, instr);
+        else
+            arithmetic(lowering, BC_MUL_I, instr);
+        break;
+    case IR_DIV:
+        arithmetic(lowering, BC_DIV_I, instr);
+        break;
+    case IR_MOD:
+        integer_binary(lowering, BC_MOD_I, instr);
+        break;
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
+    {
+        BytecodeOpcode scalar = instr->opcode == IR_SHL ? BC_SHL_I : instr->opcode == IR_SHR ? BC_SHR_I : BC_BAND_I;
+        if (vector)
+            vector_binary(lowering, (BytecodeOpcode)(BC_VSHL_I + (scalar - BC_SHL_I)), BC_OPCODE_COUNT, instr);
+        else
+            integer_binary(lowering, scalar, instr);
+        break;
+    }
+    case IR_NEG:
+    {
+        DataType type = scalar_type(lowering, instr->arg1);
+        int32_t value = value_of(lowering, instr->arg1);
+        int32_t dest = type == TYPE_INT ? raw_destination(lowering, result) : destination(lowering, result, type);
+        emit(lowering, typed(BC_NEG_I, type), dest, value, 0);
+        if (type != TYPE_INT)
+            finish(lowering, result, dest, type);
+        break;
+    }
+    case IR_NOT:
+    {
+        int32_t value = value_of(lowering, instr->arg1);
+        emit(lowering, BC_NOT, raw_destination(lowering, result), value, 0);
+        break;
+    }
+    case IR_AND:
+    case IR_OR:
+    {
+        int32_t left = value_of(lowering, instr->arg1);
+        int32_t right = value_of(lowering, instr->arg2);
+        emit(lowering, instr->opcode == IR_AND ? BC_AND : BC_OR, raw_destination(lowering, result), left, right);
+        break;
+    }
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+        compare(lowering, instr);
+        break;
+    case IR_LABEL:
+        hashtable_put(lowering->labels, instr->label, (void *)(intptr_t)(lowering->function->code_size + 1));
+        break;
+    case IR_JUMP:
+        jump_to(lowering, emit(lowering, BC_JUMP, 0, 0, 0), instr->label);
+        break;
+    case IR_JUMP_IF:
+        conditional_jump(lowering, instr, true);
+        break;
+    case IR_JUMP_IF_FALSE:
+        conditional_jump(lowering, instr, false);
+        break;
+    case IR_PARAM:
+        if (lowering->param_count < MAX_PARAMS)
+            lowering->params[lowering->param_count++] = instr->arg1;
+        break;
+    case IR_CALL:
+        call(lowering, instr);
+        break;
+    case IR_RETURN:
+    {
+        IRFunction *func = (IRFunction *)array_get(&lowering->ir_program->functions,
+                                                   (size_t)(lowering->function - lowering->program->functions));
+        emit(lowering, BC_RETURN, value_as(lowering, instr->arg1, representation(func->return_type)), 0, 0);
+        break;
+    }
+    case IR_PRINT:
+    case IR_PRINT_MULTIPLE:
+        print(lowering, instr);
+        break;
+    case IR_ARRAY_LOAD:
+        array_load(lowering, instr);
+        break;
+    case IR_ARRAY_STORE:
+        array_store(lowering, instr);
+        break;
+    case IR_BOUNDS_CHECK:
+    {
+        int32_t index = value_as(lowering, instr->arg1, TYPE_INT);
+        int32_t size = value_as(lowering, instr->arg2, TYPE_INT);
+        jump_to(lowering, emit(lowering, BC_BOUNDS_CHECK, 0, index, size), instr->label);
+        break;
+    }
+    case IR_ARRAY_INIT:
+        if (result->array_size > 0)
+            emit(lowering, BC_FILL, register_of(lowering, result),
+                 value_as(lowering, instr->arg1, scalar_type(lowering, result)), result->array_size);
+        break;
+    case IR_VECTOR_SPLAT:
+    case IR_VECTOR_INDEX:
+        vector_build(lowering, instr);
+        break;
+    case IR_VECTOR_REDUCE:
+        /* The sum is stored as it is, like integer arithmetic. */
+        emit_vector(lowering, instr->result->data_type == TYPE_DOUBLE ? BC_VREDUCE_D : BC_VREDUCE_I,
+                    raw_destination(lowering, result),
+                    register_of(lowering, instr->arg1), 0, instr->arg1->vector_width);
+        break;
+    case IR_PROFILE:
+        profile(lowering, instr);
+        break;
+    case IR_NOP:
+    case IR_ARRAY_DECL:
+    case IR_VAR_DECL:
+    case IR_INLINE_ASM:
+        break;
+    }
+}
+
+/* Points the jumps at their labels and moves the constants above the
+   value registers. */
+static void resolve_function(Lowering *lowering)
+{
+    BytecodeFunction *function = lowering->function;
+    for (size_t i = 0; i < lowering->jump_count; i++)
+    {
+        intptr_t target = (intptr_t)hashtable_get(lowering->labels, lowering->jumps[i].label);
+        if (!target)
+        {
+            fail(lowering, "Jump to an undefined label '%s'", lowering->jumps[i].label);
+            return;
+        }
+        function->code[lowering->jumps[i].instruction].a = (int32_t)target - 1;
+    }
+
+    function->value_count = lowering->next_register + lowering->max_scratch;
+    function->frame_size = function->value_count + (int)function->constant_count;
+    int32_t shift = function->value_count - CONSTANT_BASE;
+    for (size_t i = 0; i < function->code_size; i++)
+    {
+        BytecodeInstruction *instruction = &function->code[i];
+        if (instruction->a >= CONSTANT_BASE)
+            instruction->a += shift;
+        if (instruction->b >= CONSTANT_BASE)
+            instruction->b += shift;
+        if (instruction->c >= CONSTANT_BASE)
+            instruction->c += shift;
+    }
+    for (size_t i = 0; i < function->operand_count; i++)
+    {
+        if (function->operands[i] >= CONSTANT_BASE)
+            function->operands[i] += shift;
+    }
+}
+
+static void lower_function(Lowering *lowering, IRFunction *func, BytecodeFunction *function)
+{
+    size_t count = func->instructions.size;
+    lowering->function = function;
+    lowering->variables = hashtable_create(count / 4 + 16);
+    lowering->variable_types = hashtable_create(count / 4 + 16);
+    lowering->constants = hashtable_create(count / 4 + 16);
+    lowering->labels = hashtable_create(count / 4 + 16);
+    lowering->jump_count = 0;
+    lowering->param_count = 0;
+    lowering->next_register = 0;
+    lowering->max_scratch = 0;
+
+    function->name = string_copy(func->name);
+    function->param_count = (int)func->params.size;
+    if (func->memoize && func->params.size > 0 && func->params.size <= TL_MEMO_MAX_ARGS)
+    {
+        function->memo = safe_malloc(sizeof(TLMemoTable));
+        memset(function->memo, 0, sizeof(TLMemoTable));
+        function->memo->arity = (int)func->params.size;
+    }
+
+    assign_registers(lowering, func);
+    for (size_t i = 0; i < count && !lowering->failed; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        IRInstruction *next = i + 1 < count ? (IRInstruction *)array_get(&func->instructions, i + 1) : NULL;
+        lowering->scratch = 0;
+        if (lower_pair(lowering, instr, next))
+        {
+            i++;
+            continue;
+        }
+        lower_instruction(lowering, instr);
+    }
+    /* Falling off the end returns zero, as the native backends do. */
+    BytecodeValue zero;
+    zero.i = 0;
+    emit(lowering, BC_RETURN, constant(lowering, zero), 0, 0);
+    if (!lowering->failed)
+        resolve_function(lowering);
+
+    hashtable_destroy(lowering->variables);
+    hashtable_destroy(lowering->variable_types);
+    hashtable_destroy(lowering->constants);
+    hashtable_destroy(lowering->labels);
+    safe_free(lowering->temps);
+    safe_free(lowering->temp_references);
+    lowering->temps = NULL;
+    lowering->temp_references = NULL;
+}
+
+BytecodeProgram *bytecode_compile(IRProgram *ir_program, Error *error)
+{
+    BytecodeProgram *program = safe_malloc(sizeof(BytecodeProgram));
+    memset(program, 0, sizeof(BytecodeProgram));
+    size_t count = ir_program->functions.size;
+    program->function_count = count;
+    program->functions = safe_malloc((count > 0 ? count : 1) * sizeof(BytecodeFunction));
+    memset(program->functions, 0, (count > 0 ? count : 1) * sizeof(BytecodeFunction));
+    program->main_function = -1;
+    array_init(&program->strings, 16);
+    array_init(&program->profile_names, 16);
+
+    Lowering lowering;
+    memset(&lowering, 0, sizeof(lowering));
+    lowering.ir_program = ir_program;
+    lowering.program = program;
+    lowering.error = error;
+    lowering.functions = hashtable_create(count + 16);
+    lowering.strings = hashtable_create(64);
+    for (size_t i = 0; i < count; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&ir_program->functions, i);
+        hashtable_put(lowering.functions, func->name, (void *)(intptr_t)(i + 1));
+        if (strcmp(func->name, "main") == 0)
+            program->main_function = (int)i;
+    }
+
+    for (size_t i = 0; i < count && !lowering.failed; i++)
+    {
+        lower_function(&lowering, (IRFunction *)array_get(&ir_program->functions, i), &program->functions[i]);
+    }
+
+    size_t counters = ir_program->profile_counters.size;
+    if (counters > 0)
+    {
+        program->profile_counters = safe_malloc(counters * sizeof(uint64_t));
+        memset(program->profile_counters, 0, counters * sizeof(uint64_t));
+        for (size_t i = 0; i < counters; i++)
+        {
+            array_push(&program->profile_names, string_copy((const char *)array_get(&ir_program->profile_counters, i)));
+        }
+        program->profile_path = string_copy(ir_program->profile_path);
+    }
+
+    hashtable_destroy(lowering.functions);
+    hashtable_destroy(lowering.strings);
+    safe_free(lowering.jumps);
+    if (lowering.failed)
+    {
+        bytecode_program_destroy(program);
+        return NULL;
+    }
+
+    if (debug_enabled)
+    {
+        size_t instructions = 0, constants = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            instructions += program->functions[i].code_size;
+            constants += program->functions[i].constant_count;
+        }
+        printf("[DEBUG] Bytecode: %zu functions, %zu instructions, %zu constants\n", count, instructions, constants);
+        bytecode_program_print(program, stdout);
+    }
+    return program;
+}
+
+void bytecode_program_destroy(BytecodeProgram *program)
+{
+    if (!program)
+        return;
+    for (size_t i = 0; i < program->function_count; i++)
+    {
+        BytecodeFunction *function = &program->functions[i];
+        safe_free(function->name);
+        safe_free(function->code);
+        safe_free(function->operands);
+        safe_free(function->constants);
+        if (function->memo)
+        {
+            /* The runtime allocated the table's contents. */
+            free(function->memo->keys);
+            free(function->memo->values);
+            free(function->memo->used);
+            safe_free(function->memo);
+        }
+    }
+    for (size_t i = 0; i < program->strings.size; i++)
+    {
+        safe_free(array_get(&program->strings, i));
+    }
+    for (size_t i = 0; i < program->profile_names.size; i++)
+    {
+        safe_free(array_get(&program->profile_names, i));
+    }
+    array_free(&program->strings);
+    array_free(&program->profile_names);
+    safe_free(program->profile_counters);
+    safe_free(program->profile_path);
+    safe_free(program->functions);
+    safe_free(program);
+}
+
+void bytecode_program_print(const BytecodeProgram *program, FILE *out)
+{
+    for (size_t i = 0; i < program->function_count; i++)
+    {
+        const BytecodeFunction *function = &program->functions[i];
+        fprintf(out, "function %s: %d params, %d registers, %zu constants\n", function->name, function->param_count,
+                function->value_count, function->constant_count);
+        for (size_t k = 0; k < function->constant_count; k++)
+        {
+            fprintf(out, "    r%zu = 0x%016llx\n", function->value_count + k,
+                    (unsigned long long)function->constants[k].i);
+        }
+        for (size_t k = 0; k < function->code_size; k++)
+        {
+            const BytecodeInstruction *instruction = &function->code[k];
+            fprintf(out, "%6zu  %-14s %d, %d, %d", k, bytecode_opcode_name((BytecodeOpcode)instruction->opcode),
+                    instruction->a, instruction->b, instruction->c);
+            if (instruction->width)
+                fprintf(out, " x%d", instruction->width);
+            fprintf(out, "\n");
+        }
+    }
+}
@@ -0,0 +1,590 @@
+#include "backend/vm/interpreter.h"
+#include "backend/codegen/codegen.h"
+
+/* Each instruction jumps straight to the next one's handler where the
+   compiler supports taking the address of a label; elsewhere a switch
+   dispatches. */
+#if defined(__GNUC__) || defined(__clang__)
+#define INTERPRETER_THREADED 1
+#endif
+
+#define MAX_FRAMES (1 << 20)
+
+typedef struct Instruction {
+#ifdef INTERPRETER_THREADED
+    const void *handler;
+#else
+    int opcode;
+#endif
+    int32_t a;
+    int32_t b;
+    int32_t c;
+    int32_t width;
+} Instruction;
+
+typedef struct Frame {
+    int function;
+    const Instruction *return_pc;
+    size_t base;
+    int32_t result;
+    /* The memo table the returned value goes into, with its key. */
+    TLMemoTable *memo;
+    int64_t key[TL_MEMO_MAX_ARGS];
+} Frame;
+
+typedef struct Machine {
+    BytecodeProgram *program;
+    Instruction **code;
+    BytecodeValue *stack;
+    size_t stack_capacity;
+    Frame *frames;
+    size_t frame_capacity;
+    bool failed;
+} Machine;
+
+/* Gives a function its frame at `base`: the arguments, cleared values and
+   a copy of the constant pool. Arguments are read before the stack can
+   move. */
+static BytecodeValue *enter(Machine *machine, const BytecodeFunction *function, size_t base,
+                            const BytecodeValue *caller, const int32_t *list)
+{
+    BytecodeValue args[MAX_PARAMS];
+    int count = list[0] < function->param_count ? list[0] : function->param_count;
+    for (int i = 0; i < count; i++)
+    {
+        args[i] = caller[list[i + 1]];
+    }
+
+    size_t needed = base + (size_t)function->frame_size;
+    if (needed > machine->stack_capacity)
+    {
+        while (needed > machine->stack_capacity)
+            machine->stack_capacity *= 2;
+        machine->stack = safe_realloc(machine->stack, machine->stack_capacity * sizeof(BytecodeValue));
+    }
+    BytecodeValue *regs = machine->stack + base;
+    memcpy(regs, args, count * sizeof(BytecodeValue));
+    memset(regs + count, 0, (function->value_count - count) * sizeof(BytecodeValue));
+    memcpy(regs + function->value_count, function->constants, function->constant_count * sizeof(BytecodeValue));
+    return regs;
+}
+
+static Frame *push_frame(Machine *machine, size_t depth)
+{
+    if (depth >= MAX_FRAMES)
+        return NULL;
+    if (depth == machine->frame_capacity)
+    {
+        machine->frame_capacity *= 2;
+        machine->frames = safe_realloc(machine->frames, machine->frame_capacity * sizeof(Frame));
+    }
+    return &machine->frames[depth];
+}
+
+/* Out of range values and NaN give what cvttsd2si does. */
+static int64_t to_integer(double value)
+{
+    if (value >= -9223372036854775808.0 && value < 9223372036854775808.0)
+        return (int64_t)value;
+    return INT64_MIN;
+}
+
+#define R(x) regs[x]
+
+#ifdef INTERPRETER_THREADED
+#define OP(name) op_##name
+#define DISPATCH() goto *pc->handler
+#define HANDLER(name) [name] = &&op_##name
+#else
+#define OP(name) case name
+#define DISPATCH() goto dispatch
+#endif
+
+#define NEXT()                                                                                                         \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        pc++;                                                                                                          \
+        DISPATCH();                                                                                                    \
+    } while (0)
+
+/* Floats keep the high half of their register clear. */
+#define SET_FLOAT(reg, value)                                                                                          \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        float value_ = (value);                                                                                        \
+        R(reg).i = 0;                                                                                                  \
+        R(reg).f = value_;                                                                                             \
+    } while (0)
+
+/* Integer arithmetic wraps, as it does in machine code. */
+#define INTEGER_BINARY(name, op)                                                                                       \
+    OP(name) : R(pc->a).i = (int64_t)((uint64_t)R(pc->b).i op(uint64_t) R(pc->c).i);                                   \
+    NEXT()
+
+#define FLOAT_BINARY(name, op)                                                                                         \
+    OP(name) : SET_FLOAT(pc->a, R(pc->b).f op R(pc->c).f);                                                             \
+    NEXT()
+
+#define DOUBLE_BINARY(name, op)                                                                                        \
+    OP(name) : R(pc->a).d = R(pc->b).d op R(pc->c).d;                                                                  \
+    NEXT()
+
+#define COMPARE(name, field, op)                                                                                       \
+    OP(name) : R(pc->a).i = R(pc->b).field op R(pc->c).field;                                                          \
+    NEXT()
+
+#define BRANCH(name, op)                                                                                               \
+    OP(name) : pc = R(pc->b).i op R(pc->c).i ? code + pc->a : pc + 1;                                                  \
+    DISPATCH()
+
+#define VECTOR_INTEGER(name, op)                                                                                       \
+    OP(name) : for (int32_t lane = 0; lane < pc->width; lane++)                                                       \
+    {                                                                                                                  \
+        R(pc->a + lane).i = (int64_t)((uint64_t)R(pc->b + lane).i op(uint64_t) R(pc->c + lane).i);                    \
+    }                                                                                                                  \
+    NEXT()
+
+#define VECTOR_DOUBLE(name, op)                                                                                        \
+    OP(name) : for (int32_t lane = 0; lane < pc->width; lane++)                                                       \
+    {                                                                                                                  \
+        R(pc->a + lane).d = R(pc->b + lane).d op R(pc->c + lane).d;                                                    \
+    }                                                                                                                  \
+    NEXT()
+
+/* Runs main. Called with `handlers` set, it only hands out its table of
+   handler addresses for threading the code. */
+static int64_t execute(Machine *machine, const void *const **handlers)
+{
+#ifdef INTERPRETER_THREADED
+    static const void *const table[BC_OPCODE_COUNT] = {
+        HANDLER(BC_MOVE),          HANDLER(BC_ADD_I),         HANDLER(BC_SUB_I),       HANDLER(BC_MUL_I),
+        HANDLER(BC_DIV_I),         HANDLER(BC_MOD_I),         HANDLER(BC_SHL_I),       HANDLER(BC_SHR_I),
+        HANDLER(BC_BAND_I),        HANDLER(BC_NEG_I),         HANDLER(BC_ADD_F),       HANDLER(BC_SUB_F),
+        HANDLER(BC_MUL_F),         HANDLER(BC_DIV_F),         HANDLER(BC_NEG_F),       HANDLER(BC_ADD_D),
+        HANDLER(BC_SUB_D),         HANDLER(BC_MUL_D),         HANDLER(BC_DIV_D),       HANDLER(BC_NEG_D),
+        HANDLER(BC_EQ_I),          HANDLER(BC_NE_I),          HANDLER(BC_LT_I),        HANDLER(BC_LE_I),
+        HANDLER(BC_GT_I),          HANDLER(BC_GE_I),          HANDLER(BC_EQ_F),        HANDLER(BC_NE_F),
+        HANDLER(BC_LT_F),          HANDLER(BC_LE_F),          HANDLER(BC_GT_F),        HANDLER(BC_GE_F),
+        HANDLER(BC_EQ_D),          HANDLER(BC_NE_D),          HANDLER(BC_LT_D),        HANDLER(BC_LE_D),
+        HANDLER(BC_GT_D),          HANDLER(BC_GE_D),          HANDLER(BC_NOT),         HANDLER(BC_AND),
+        HANDLER(BC_OR),            HANDLER(BC_I2F),           HANDLER(BC_I2D),         HANDLER(BC_F2I),
+        HANDLER(BC_D2I),           HANDLER(BC_F2D),           HANDLER(BC_D2F),         HANDLER(BC_JUMP),
+        HANDLER(BC_JUMP_IF),       HANDLER(BC_JUMP_IF_NOT),   HANDLER(BC_BR_EQ_I),     HANDLER(BC_BR_NE_I),
+        HANDLER(BC_BR_LT_I),       HANDLER(BC_BR_LE_I),       HANDLER(BC_BR_GT_I),     HANDLER(BC_BR_GE_I),
+        HANDLER(BC_LOAD_ELEMENT),  HANDLER(BC_STORE_ELEMENT), HANDLER(BC_FILL),        HANDLER(BC_BOUNDS_CHECK),
+        HANDLER(BC_CALL),          HANDLER(BC_TAIL_CALL),     HANDLER(BC_CALL_BUILTIN), HANDLER(BC_RETURN),
+        HANDLER(BC_PRINT),         HANDLER(BC_PROFILE),       HANDLER(BC_PROFILE_IF),  HANDLER(BC_VADD_I),
+        HANDLER(BC_VSUB_I),        HANDLER(BC_VMUL_I),        HANDLER(BC_VSHL_I),      HANDLER(BC_VSHR_I),
+        HANDLER(BC_VBAND_I),       HANDLER(BC_VADD_D),        HANDLER(BC_VSUB_D),      HANDLER(BC_VMUL_D),
+        HANDLER(BC_VLOAD),         HANDLER(BC_VSTORE),        HANDLER(BC_VSPLAT),      HANDLER(BC_VINDEX_I),
+        HANDLER(BC_VINDEX_D),      HANDLER(BC_VREDUCE_I),     HANDLER(BC_VREDUCE_D)};
+    if (handlers)
+    {
+        *handlers = table;
+        return 0;
+    }
+#else
+    (void)handlers;
+#endif
+
+    BytecodeProgram *program = machine->program;
+    int function_index = program->main_function;
+    const BytecodeFunction *function = &program->functions[function_index];
+    static const int32_t no_arguments[1] = {0};
+    size_t base = 0;
+    size_t depth = 0;
+    BytecodeValue *regs = enter(machine, function, base, NULL, no_arguments);
+    const Instruction *code = machine->code[function_index];
+    const Instruction *pc = code;
+    int64_t result = 0;
+
+#ifdef INTERPRETER_THREADED
+    DISPATCH();
+#else
+dispatch:
+    switch (pc->opcode)
+    {
+#endif
+
+    OP(BC_MOVE) : R(pc->a) = R(pc->b);
+    NEXT();
+    INTEGER_BINARY(BC_ADD_I, +);
+    INTEGER_BINARY(BC_SUB_I, -);
+    INTEGER_BINARY(BC_MUL_I, *);
+    OP(BC_DIV_I) : if (R(pc->c).i == 0) goto division_by_zero;
+    R(pc->a).i = R(pc->c).i == -1 ? (int64_t)(0 - (uint64_t)R(pc->b).i) : R(pc->b).i / R(pc->c).i;
+    NEXT();
+    OP(BC_MOD_I) : if (R(pc->c).i == 0) goto division_by_zero;
+    R(pc->a).i = R(pc->c).i == -1 ? 0 : R(pc->b).i % R(pc->c).i;
+    NEXT();
+    OP(BC_SHL_I) : R(pc->a).i = (int64_t)((uint64_t)R(pc->b).i << (R(pc->c).i & 63));
+    NEXT();
+    OP(BC_SHR_I) : R(pc->a).i = R(pc->b).i >> (R(pc->c).i & 63);
+    NEXT();
+    INTEGER_BINARY(BC_BAND_I, &);
+    OP(BC_NEG_I) : R(pc->a).i = (int64_t)(0 - (uint64_t)R(pc->b).i);
+    NEXT();
+    FLOAT_BINARY(BC_ADD_F, +);
+    FLOAT_BINARY(BC_SUB_F, -);
+    FLOAT_BINARY(BC_MUL_F, *);
+    FLOAT_BINARY(BC_DIV_F, /);
+    OP(BC_NEG_F) : SET_FLOAT(pc->a, -R(pc->b).f);
+    NEXT();
+    DOUBLE_BINARY(BC_ADD_D, +);
+    DOUBLE_BINARY(BC_SUB_D, -);
+    DOUBLE_BINARY(BC_MUL_D, *);
+    DOUBLE_BINARY(BC_DIV_D, /);
+    OP(BC_NEG_D) : R(pc->a).d = -R(pc->b).d;
+    NEXT();
+
+    COMPARE(BC_EQ_I, i, ==);
+    COMPARE(BC_NE_I, i, !=);
+    COMPARE(BC_LT_I, i, <);
+    COMPARE(BC_LE_I, i, <=);
+    COMPARE(BC_GT_I, i, >);
+    COMPARE(BC_GE_I, i, >=);
+    COMPARE(BC_EQ_F, f, ==);
+    COMPARE(BC_NE_F, f, !=);
+    COMPARE(BC_LT_F, f, <);
+    COMPARE(BC_LE_F, f, <=);
+    COMPARE(BC_GT_F, f, >);
+    COMPARE(BC_GE_F, f, >=);
+    COMPARE(BC_EQ_D, d, ==);
+    COMPARE(BC_NE_D, d, !=);
+    COMPARE(BC_LT_D, d, <);
+    COMPARE(BC_LE_D, d, <=);
+    COMPARE(BC_GT_D, d, >);
+    COMPARE(BC_GE_D, d, >=);
+    OP(BC_NOT) : R(pc->a).i = R(pc->b).i == 0;
+    NEXT();
+    OP(BC_AND) : R(pc->a).i = R(pc->b).i != 0 && R(pc->c).i != 0;
+    NEXT();
+    OP(BC_OR) : R(pc->a).i = R(pc->b).i != 0 || R(pc->c).i != 0;
+    NEXT();
+
+    OP(BC_I2F) : SET_FLOAT(pc->a, (float)R(pc->b).i);
+    NEXT();
+    OP(BC_I2D) : R(pc->a).d = (double)R(pc->b).i;
+    NEXT();
+    OP(BC_F2I) : R(pc->a).i = to_integer(R(pc->b).f);
+    NEXT();
+    OP(BC_D2I) : R(pc->a).i = to_integer(R(pc->b).d);
+    NEXT();
+    OP(BC_F2D) : R(pc->a).d = R(pc->b).f;
+    NEXT();
+    OP(BC_D2F) : SET_FLOAT(pc->a, (float)R(pc->b).d);
+    NEXT();
+
+    OP(BC_JUMP) : pc = code + pc->a;
+    DISPATCH();
+    OP(BC_JUMP_IF) : pc = R(pc->b).i != 0 ? code + pc->a : pc + 1;
+    DISPATCH();
+    OP(BC_JUMP_IF_NOT) : pc = R(pc->b).i == 0 ? code + pc->a : pc + 1;
+    DISPATCH();
+    BRANCH(BC_BR_EQ_I, ==);
+    BRANCH(BC_BR_NE_I, !=);
+    BRANCH(BC_BR_LT_I, <);
+    BRANCH(BC_BR_LE_I, <=);
+    BRANCH(BC_BR_GT_I, >);
+    BRANCH(BC_BR_GE_I, >=);
+
+    OP(BC_LOAD_ELEMENT) : R(pc->a) = R(pc->b + R(pc->c).i);
+    NEXT();
+    OP(BC_STORE_ELEMENT) : R(pc->b + R(pc->c).i) = R(pc->a);
+    NEXT();
+    OP(BC_FILL) : for (int32_t k = 0; k < pc->c; k++)
+    {
+        R(pc->a + k) = R(pc->b);
+    }
+    NEXT();
+    BRANCH(BC_BOUNDS_CHECK, >=);
+
+    OP(BC_CALL) :
+    {
+        const int32_t *list = function->operands + pc->c;
+        const BytecodeFunction *callee = &program->functions[pc->b];
+        int64_t key[TL_MEMO_MAX_ARGS];
+        if (callee->memo)
+        {
+            int64_t value;
+            for (int32_t i = 0; i < list[0]; i++)
+            {
+                key[i] = R(list[i + 1]).i;
+            }
+            if (__tl_memo_lookup(callee->memo, key, &value))
+            {
+                R(pc->a).i = value;
+                NEXT();
+            }
+        }
+
+        Frame *frame = push_frame(machine, depth);
+        if (!frame)
+            goto stack_overflow;
+        depth++;
+        frame->function = function_index;
+        frame->return_pc = pc + 1;
+        frame->base = base;
+        frame->result = pc->a;
+        frame->memo = callee->memo;
+        if (callee->memo)
+            memcpy(frame->key, key, sizeof(key));
+
+        base += function->frame_size;
+        regs = enter(machine, callee, base, regs, list);
+        function_index = pc->b;
+        function = callee;
+        code = machine->code[function_index];
+        pc = code;
+        DISPATCH();
+    }
+    OP(BC_TAIL_CALL) :
+    {
+        const int32_t *list = function->operands + pc->c;
+        function_index = pc->b;
+        function = &program->functions[function_index];
+        regs = enter(machine, function, base, regs, list);
+        code = machine->code[function_index];
+        pc = code;
+        DISPATCH();
+    }
+    OP(BC_CALL_BUILTIN) :
+    {
+        const int32_t *args = function->operands + pc->c + 1;
+        switch (pc->b)
+        {
+        case BUILTIN_CONCAT:
+            R(pc->a).i = (int64_t)(intptr_t)__tl_concat(R(args[0]).s, R(args[1]).s);
+            break;
+        case BUILTIN_SUBSTR:
+            R(pc->a).i = (int64_t)(intptr_t)__tl_substr(R(args[0]).s, R(args[1]).i, R(args[2]).i);
+            break;
+        case BUILTIN_STRLEN:
+            R(pc->a).i = __tl_strlen(R(args[0]).s);
+            break;
+        case BUILTIN_STRCMP:
+            R(pc->a).i = __tl_strcmp(R(args[0]).s, R(args[1]).s);
+            break;
+        default:
+            R(pc->a).i = (int64_t)(intptr_t)__tl_char_at(R(args[0]).s, R(args[1]).i);
+            break;
+        }
+        NEXT();
+    }
+    OP(BC_RETURN) :
+    {
+        BytecodeValue value = R(pc->a);
+        if (depth == 0)
+        {
+            result = value.i;
+            goto done;
+        }
+        Frame *frame = &machine->frames[--depth];
+        if (frame->memo)
+            __tl_memo_store(frame->memo, frame->key, value.i);
+        function_index = frame->function;
+        function = &program->functions[function_index];
+        base = frame->base;
+        regs = machine->stack + base;
+        R(frame->result) = value;
+        code = machine->code[function_index];
+        pc = frame->return_pc;
+        DISPATCH();
+    }
+
+    OP(BC_PRINT) :
+    {
+        const int32_t *list = function->operands + pc->a;
+        for (int32_t i = 0; i < list[0]; i++)
+        {
+            BytecodeValue value = R(list[1 + 2 * i]);
+            switch (list[2 + 2 * i])
+            {
+            case PRINT_STRING:
+                printf("%s", value.s);
+                break;
+            case PRINT_FLOAT:
+                printf("%f", (double)value.f);
+                break;
+            case PRINT_DOUBLE:
+                printf("%f", value.d);
+                break;
+            default:
+                printf("%lld", (long long)value.i);
+                break;
+            }
+        }
+        putchar('\n');
+        NEXT();
+    }
+    OP(BC_PROFILE) : program->profile_counters[pc->a]++;
+    NEXT();
+    OP(BC_PROFILE_IF) : program->profile_counters[pc->a] += R(pc->b).i != 0;
+    NEXT();
+
+    VECTOR_INTEGER(BC_VADD_I, +);
+    VECTOR_INTEGER(BC_VSUB_I, -);
+    VECTOR_INTEGER(BC_VMUL_I, *);
+    VECTOR_INTEGER(BC_VBAND_I, &);
+    VECTOR_DOUBLE(BC_VADD_D, +);
+    VECTOR_DOUBLE(BC_VSUB_D, -);
+    VECTOR_DOUBLE(BC_VMUL_D, *);
+    /* Every lane shifts by the first lane's count, as psllq does. */
+    OP(BC_VSHL_I) :
+    {
+        uint64_t count = (uint64_t)R(pc->c).i;
+        for (int32_t lane = 0; lane < pc->width; lane++)
+        {
+            R(pc->a + lane).i = count > 63 ? 0 : (int64_t)((uint64_t)R(pc->b + lane).i << count);
+        }
+        NEXT();
+    }
+    OP(BC_VSHR_I) :
+    {
+        uint64_t count = (uint64_t)R(pc->c).i;
+        for (int32_t lane = 0; lane < pc->width; lane++)
+        {
+            R(pc->a + lane).i = count > 63 ? 0 : (int64_t)((uint64_t)R(pc->b + lane).i >> count);
+        }
+        NEXT();
+    }
+    OP(BC_VLOAD) :
+    {
+        const BytecodeValue *element = &R(pc->b + R(pc->c).i);
+        for (int32_t lane = 0; lane < pc->width; lane++)
+        {
+            R(pc->a + lane) = element[lane];
+        }
+        NEXT();
+    }
+    OP(BC_VSTORE) :
+    {
+        BytecodeValue *element = &R(pc->b + R(pc->c).i);
+        for (int32_t lane = 0; lane < pc->width; lane++)
+        {
+            element[lane] = R(pc->a + lane);
+        }
+        NEXT();
+    }
+    OP(BC_VSPLAT) : for (int32_t lane = 0; lane < pc->width; lane++)
+    {
+        R(pc->a + lane) = R(pc->b);
+    }
+    NEXT();
+    OP(BC_VINDEX_I) : for (int32_t lane = 0; lane < pc->width; lane++)
+    {
+        R(pc->a + lane).i = (int64_t)((uint64_t)R(pc->b).i + (uint64_t)lane);
+    }
+    NEXT();
+    OP(BC_VINDEX_D) : for (int32_t lane = 0; lane < pc->width; lane++)
+    {
+        R(pc->a + lane).d = (double)(int64_t)((uint64_t)R(pc->b).i + (uint64_t)lane);
+    }
+    NEXT();
+    OP(BC_VREDUCE_I) :
+    {
+        uint64_t sum = 0;
+        for (int32_t lane = 0; lane < pc->width; lane++)
+        {
+            sum += (uint64_t)R(pc->b + lane).i;
+        }
+        R(pc->a).i = (int64_t)sum;
+        NEXT();
+    }
+    OP(BC_VREDUCE_D) :
+    {
+        double sum = 0;
+        for (int32_t lane = 0; lane < pc->width; lane++)
+        {
+            sum += R(pc->b + lane).d;
+        }
+        R(pc->a).d = sum;
+        NEXT();
+    }
+
+#ifndef INTERPRETER_THREADED
+    default:
+        goto done;
+    }
+#endif
+
+division_by_zero:
+    fflush(stdout);
+    fprintf(stderr, "Division by zero\n");
+    machine->failed = true;
+    return 1;
+stack_overflow:
+    fflush(stdout);
+    fprintf(stderr, "Stack overflow\n");
+    machine->failed = true;
+    return 1;
+done:
+    return result;
+}
+
+static void write_profile(const BytecodeProgram *program)
+{
+    FILE *file = fopen(program->profile_path, "a");
+    if (!file)
+        return;
+    fprintf(file, "# tlprof 1\n");
+    for (size_t i = 0; i < program->profile_names.size; i++)
+    {
+        fprintf(file, "%llu %s\n", (unsigned long long)program->profile_counters[i],
+                (const char *)array_get((DynamicArray *)&program->profile_names, i));
+    }
+    fclose(file);
+}
+
+int interpreter_run(BytecodeProgram *program)
+{
+    if (program->main_function < 0)
+        return 0;
+
+    Machine machine;
+    memset(&machine, 0, sizeof(machine));
+    machine.program = program;
+    machine.stack_capacity = 1024;
+    machine.stack = safe_malloc(machine.stack_capacity * sizeof(BytecodeValue));
+    machine.frame_capacity = 64;
+    machine.frames = safe_malloc(machine.frame_capacity * sizeof(Frame));
+
+#ifdef INTERPRETER_THREADED
+    const void *const *handlers = NULL;
+    execute(&machine, &handlers);
+#endif
+    machine.code = safe_malloc(program->function_count * sizeof(Instruction *));
+    for (size_t i = 0; i < program->function_count; i++)
+    {
+        const BytecodeFunction *function = &program->functions[i];
+        machine.code[i] = safe_malloc((function->code_size + 1) * sizeof(Instruction));
+        for (size_t k = 0; k < function->code_size; k++)
+        {
+            const BytecodeInstruction *instruction = &function->code[k];
+            Instruction *threaded = &machine.code[i][k];
+#ifdef INTERPRETER_THREADED
+            threaded->handler = handlers[instruction->opcode];
+#else
+            threaded->opcode = instruction->opcode;
+#endif
+            threaded->a = instruction->a;
+            threaded->b = instruction->b;
+            threaded->c = instruction->c;
+            threaded->width = instruction->width;
+        }
+    }
+
+    int64_t result = execute(&machine, NULL);
+    fflush(stdout);
+    if (!machine.failed && program->profile_counters)
+        write_profile(program);
+
+    for (size_t i = 0; i < program->function_count; i++)
+    {
+        safe_free(machine.code[i]);
+    }
+    safe_free(machine.code);
+    safe_free(machine.stack);
+    safe_free(machine.frames);
+    return (int)result;
+}
@@ -370,6 +370,13 @@ size_t total_memory_freed = 0;
 size_t total_allocations = 0;
 size_t total_frees = 0;
 
+/* The optimizer allocates from several threads at once. */
+#ifdef __GNUC__
+#define COUNT_MEMORY(counter, amount) __atomic_fetch_add(&(counter), (amount), __ATOMIC_RELAXED)
+#else
+#define COUNT_MEMORY(counter, amount) ((counter) += (amount))
+#endif
+
 void *safe_malloc(size_t size)
 {
     void *ptr = malloc(size);
@@ -378,8 +385,8 @@ void *safe_malloc(size_t size)
         print_fatal_error("compiler", "memory allocation failed");
         exit(1);
     }
-    total_memory_allocated += size;
-    total_allocations++;
+    COUNT_MEMORY(total_memory_allocated, size);
+    COUNT_MEMORY(total_allocations, 1);
     return ptr;
 }
 
@@ -391,8 +398,8 @@ void *safe_realloc(void *ptr, size_t size)
         print_fatal_error("compiler", "memory reallocation failed");
         exit(1);
     }
-    total_memory_allocated += size;
-    total_allocations++;
+    COUNT_MEMORY(total_memory_allocated, size);
+    COUNT_MEMORY(total_allocations, 1);
     return new_ptr;
 }
 
@@ -401,7 +408,7 @@ void safe_free(void *ptr)
     if (ptr)
     {
         free(ptr);
-        total_frees++;
+        COUNT_MEMORY(total_frees, 1);
     }
 }
 
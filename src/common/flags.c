@@ -1,4 +1,5 @@
 #include "common/flags.h"
+#include "optimizations/optimizer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +14,8 @@
 
 bool debug_enabled = false;
 bool suppress_warnings = false;
+const char *assembly_target = NULL;
+bool structured_c_output = true;
 
 void handle_help(int *i, int argc, char *argv[], void *context)
 {
@@ -174,6 +177,50 @@ void handle_asm(int *i, int argc, char *argv[], void *context)
     (void)argv;
     CompilerContext *ctx = (CompilerContext *)context;
     ctx->assembly_output = true;
+    optimization_options.vectorize_floats = false;
+}
+
+void handle_run(int *i, int argc, char *argv[], void *context)
+{
+    (void)i;
+    (void)argc;
+    (void)argv;
+    CompilerContext *ctx = (CompilerContext *)context;
+    ctx->run_flag = true;
+    ctx->assembly_output = true;
+    optimization_options.vectorize_floats = false;
+}
+
+void handle_interpret(int *i, int argc, char *argv[], void *context)
+{
+    (void)i;
+    (void)argc;
+    (void)argv;
+    CompilerContext *ctx = (CompilerContext *)context;
+    ctx->interpret_flag = true;
+    optimization_options.vectorize_floats = false;
+}
+
+void handle_c_gotos(int *i, int argc, char *argv[], void *context)
+{
+    (void)i;
+    (void)argc;
+    (void)argv;
+    (void)context;
+    structured_c_output = false;
+}
+
+void handle_target(int *i, int argc, char *argv[], void *context)
+{
+    (void)argc;
+    (void)context;
+    const char *value = strchr(argv[*i], '=') + 1;
+    if (strcmp(value, "sysv") != 0 && strcmp(value, "win64") != 0)
+    {
+        print_error(argv[0], "invalid assembly target (expected sysv or win64)");
+        exit(1);
+    }
+    assembly_target = value;
 }
 
 void handle_input_file(int *i, int argc, char *argv[], void *context)
@@ -193,6 +240,106 @@ void handle_debug(int *i, int argc, char *argv[], void *context)
     debug_enabled = true;
 }
 
+void handle_unroll(int *i, int argc, char *argv[], void *context)
+{
+    (void)argc;
+    (void)context;
+    const char *value = strchr(argv[*i], '=') + 1;
+    char *end = NULL;
+    long factor = strtol(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || factor < 0 || factor > 64)
+    {
+        print_error(argv[0], "invalid unroll factor (expected 0-64)");
+        exit(1);
+    }
+    optimization_options.unroll_factor = (int)factor;
+}
+
+void handle_clone_budget(int *i, int argc, char *argv[], void *context)
+{
+    (void)argc;
+    (void)context;
+    const char *value = strchr(argv[*i], '=') + 1;
+    char *end = NULL;
+    long budget = strtol(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || budget < 0 || budget > 65536)
+    {
+        print_error(argv[0], "invalid clone budget (expected 0-65536)");
+        exit(1);
+    }
+    optimization_options.clone_budget = (int)budget;
+}
+
+void handle_profile_generate(int *i, int argc, char *argv[], void *context)
+{
+    (void)argc;
+    (void)context;
+    const char *value = strchr(argv[*i], '=');
+    if (value && value[1] == '\0')
+    {
+        print_error(argv[0], "missing profile file name");
+        exit(1);
+    }
+    optimization_options.profile_generate = value ? value + 1 : "default.tlprof";
+}
+void handle_profile_use(int *i, int argc, char *argv[], void *context)
+{
+    (void)argc;
+    (void)context;
+    const char *value = strchr(argv[*i], '=') + 1;
+    if (*value == '\0')
+    {
+        print_error(argv[0], "missing profile file name");
+        exit(1);
+    }
+    optimization_options.profile_use = value;
+}
+void handle_max_comptime_steps(int *i, int argc, char *argv[], void *context)
+{
+    (void)argc;
+    (void)context;
+    const char *value = strchr(argv[*i], '=') + 1;
+    char *end = NULL;
+    long steps = strtol(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || steps < 0 || steps > 100000000)
+    {
+        print_error(argv[0], "invalid comptime step limit (expected 0-100000000)");
+        exit(1);
+    }
+    optimization_options.max_comptime_steps = (int)steps;
+}
+
+void handle_jobs(int *i, int argc, char *argv[], void *context)
+{
+    (void)argc;
+    (void)context;
+    const char *value = strchr(argv[*i], '=') + 1;
+    char *end = NULL;
+    long jobs = strtol(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || jobs < 0 || jobs > 64)
+    {
+        print_error(argv[0], "invalid job count (expected 0-64)");
+        exit(1);
+    }
+    optimization_options.jobs = (int)jobs;
+}
+
+void handle_optimization_level(int *i, int argc, char *argv[], void *context)
+{
+    (void)argc;
+    (void)context;
+    optimization_options.level = argv[*i][2] - '0';
+}
+
+void handle_time_passes(int *i, int argc, char *argv[], void *context)
+{
+    (void)i;
+    (void)argc;
+    (void)argv;
+    (void)context;
+    optimization_options.time_passes = true;
+}
+
 static const Command commands[] = {
     {"--help", handle_help, "Show this help message"},
     {"--dumpspecs", handle_dumpspecs, "Display all of the built in spec strings"},
@@ -205,8 +352,24 @@ static const Command commands[] = {
     {"--dump-ast-json", handle_dump_ast_json, "Dump AST in JSON format"},
     {"--no-warnings", handle_no_warnings, "Suppress warning messages"},
     {"-o", handle_output, "Specify output file"},
-    {"--asm", handle_asm, "Generate assembly code instead of C"},
+    {"--asm", handle_asm, "Generate assembly code instead of C (an ELF object if -o ends in .o)"},
+    {"--run", handle_run, "Compile the program into memory and run it"},
+    {"--interpret", handle_interpret, "Run the program in the bytecode interpreter"},
+    {"--c-gotos", handle_c_gotos, "Write C control flow as gotos instead of loops and ifs"},
+    {"--target=ABI", handle_target, "Calling convention for --asm: sysv or win64 (default: the host's)"},
     {"--debug", handle_debug, "Enable debug output"},
+    {"-O0", handle_optimization_level, "Disable optimizations"},
+    {"-O1", handle_optimization_level, "Run the scalar optimization passes"},
+    {"-O2", handle_optimization_level, "Also unroll counted loops (default)"},
+    {"-O3", handle_optimization_level, "Also vectorize element-wise array loops"},
+    {"--unroll=N", handle_unroll, "Set the loop unroll factor (0 disables unrolling)"},
+    {"--clone-budget=N", handle_clone_budget, "Limit instructions added by function specialization (0 disables cloning)"},
+    {"--max-comptime-steps=N", handle_max_comptime_steps, "Limit steps per compile-time function call (0 disables)"},
+    {"--profile-generate", handle_profile_generate, "Instrument the program to write default.tlprof on exit"},
+    {"--profile-generate=FILE", handle_profile_generate, "Instrument the program to write FILE on exit"},
+    {"--profile-use=FILE", handle_profile_use, "Optimize using the profile recorded in FILE"},
+    {"--jobs=N", handle_jobs, "Optimize functions on N threads (0 uses every core, 1 disables threading)"},
+    {"--time-passes", handle_time_passes, "Report time spent in each optimization pass"},
     {"--memory", handle_memory_stats, "Show memory usage statistics"},
     {"--modules", handle_module_mode, "Enable module compilation mode"},
     {"-I", handle_module_include_path, "Add include path for modules"},
@@ -221,6 +384,12 @@ void process_argument(int *i, int argc, char *argv[], CompilerContext *context)
             commands[j].handler(i, argc, argv, context);
             return;
         }
+        const char *value_sep = strchr(commands[j].name, '=');
+        if (value_sep && strncmp(argv[*i], commands[j].name, (size_t)(value_sep - commands[j].name) + 1) == 0)
+        {
+            commands[j].handler(i, argc, argv, context);
+            return;
+        }
         if (strcmp(argv[*i], commands[j].name) == 0)
         {
             commands[j].handler(i, argc, argv, context);
@@ -380,6 +549,15 @@ bool has_asm_extension(const char *filename)
     return false;
 }
 
+bool has_object_extension(const char *filename)
+{
+    if (!filename)
+        return false;
+
+    size_t len = strlen(filename);
+    return len >= 2 && strcmp(filename + len - 2, ".o") == 0;
+}
+
 void print_usage(const char *program_name)
 {
     printf("Usage: %s <input_file> [input_file2] ... -o <output_file>\n", program_name);
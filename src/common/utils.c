@@ -8,6 +8,7 @@
 #include "analysis/semantic/semantic.h"
 #include "backend/ir/ir.h"
 #include "backend/codegen/codegen.h"
+#include "backend/vm/interpreter.h"
 #include "optimizations/optimizer.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -926,6 +927,10 @@ bool compile_multiple_files(DynamicArray *input_filenames, const char *output_fi
                 printf("[DEBUG] compile_combined_files: Running optimizations\n");
             }
             optimization_optimize_program(ir_program);
+            if (verbose)
+            {
+                optimization_stats_print(stdout);
+            }
         }
     }
 
@@ -942,7 +947,8 @@ bool compile_multiple_files(DynamicArray *input_filenames, const char *output_fi
         return false;
     }
 
-    FILE *output_file = fopen(output_filename, "w");
+    bool object_output = assembly_output && has_object_extension(output_filename);
+    FILE *output_file = fopen(output_filename, object_output ? "wb" : "w");
     if (!output_file)
     {
         error_context_add_error(combined_error_context, ERROR_CODEGEN, SEVERITY_ERROR,
@@ -980,7 +986,11 @@ bool compile_multiple_files(DynamicArray *input_filenames, const char *output_fi
     }
     else if (generator)
     {
-        if (assembly_output)
+        if (object_output)
+        {
+            success = codegenasm_generate_object(generator);
+        }
+        else if (assembly_output)
         {
             success = codegenasm_generate(generator);
         }
@@ -992,14 +1002,21 @@ bool compile_multiple_files(DynamicArray *input_filenames, const char *output_fi
         if (!success)
         {
             error_context_add_error(combined_error_context, ERROR_CODEGEN, SEVERITY_ERROR,
-                                    "Code generation failed",
+                                    error.type != ERROR_NONE ? error.message : "Code generation failed",
                                     "Check for unsupported language constructs", 0, 0);
         }
     }
 
     if (generator)
     {
-        codegen_destroy(generator);
+        if (assembly_output)
+        {
+            codegenasm_destroy(generator);
+        }
+        else
+        {
+            codegen_destroy(generator);
+        }
     }
     fclose(output_file);
 
@@ -1030,9 +1047,15 @@ bool compile_multiple_files(DynamicArray *input_filenames, const char *output_fi
     return true;
 }
 
-bool compile_file(const char *input_filename, const char *output_filename, bool verbose, bool assembly_output)
+/* Compiles one file. With an exit code to fill in, the program is run
+   instead of being written out: assembled into memory, or lowered to
+   bytecode and interpreted. */
+static bool compile_source(const char *input_filename, const char *output_filename, bool verbose,
+                           bool assembly_output, bool interpret, int *exit_code)
 {
-    if (verbose)
+    bool run_mode = exit_code != NULL;
+    double start_time = optimization_clock_seconds();
+    if (verbose && !run_mode)
     {
         printf("Using built-in specs.\n");
         printf("COLLECT_GCC=%s\n", "compiler.exe");
@@ -1169,6 +1192,10 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
                 fflush(stdout);
             }
             optimization_optimize_program(ir_program);
+            if (verbose)
+            {
+                optimization_stats_print(stdout);
+            }
             if (debug_enabled)
             {
                 printf("[DEBUG] compile_file: Optimizations completed\n");
@@ -1195,8 +1222,9 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
         return false;
     }
 
-    FILE *output_file = fopen(output_filename, "w");
-    if (!output_file)
+    bool object_output = !run_mode && assembly_output && has_object_extension(output_filename);
+    FILE *output_file = run_mode ? NULL : fopen(output_filename, object_output ? "wb" : "w");
+    if (!run_mode && !output_file)
     {
         error_context_add_error(error_context, ERROR_CODEGEN, SEVERITY_ERROR,
                                 "Cannot create output file",
@@ -1218,7 +1246,10 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
     }
 
     CodeGenerator *generator = NULL;
+    BytecodeProgram *bytecode = NULL;
     bool success = false;
+    JitImage image;
+    memset(&image, 0, sizeof(image));
 
     if (debug_enabled)
     {
@@ -1226,7 +1257,11 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
         fflush(stdout);
     }
 
-    if (assembly_output)
+    if (interpret)
+    {
+        bytecode = bytecode_compile(ir_program, &error);
+    }
+    else if (assembly_output)
     {
         generator = codegenasm_create(ir_program, output_file, &error);
     }
@@ -1237,7 +1272,7 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
 
     if (debug_enabled)
     {
-        printf("[DEBUG] compile_file: Code generator created: %s\n", generator ? "yes" : "no");
+        printf("[DEBUG] compile_file: Code generator created: %s\n", generator || bytecode ? "yes" : "no");
         if (error.type != ERROR_NONE)
         {
             printf("[DEBUG] compile_file: Error during generator creation: %s\n", error.message);
@@ -1257,7 +1292,16 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
             printf("[DEBUG] compile_file: Code generator created, starting generation\n");
         }
 
-        if (assembly_output)
+        double codegen_start = optimization_clock_seconds();
+        if (run_mode)
+        {
+            success = codegenasm_generate_image(generator, &image);
+        }
+        else if (object_output)
+        {
+            success = codegenasm_generate_object(generator);
+        }
+        else if (assembly_output)
         {
             success = codegenasm_generate(generator);
         }
@@ -1269,13 +1313,21 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
         if (!success)
         {
             error_context_add_error(error_context, ERROR_CODEGEN, SEVERITY_ERROR,
-                                    "Code generation failed",
+                                    error.type != ERROR_NONE ? error.message : "Code generation failed",
                                     "Check for unsupported language constructs", 0, 0);
         }
         else if (debug_enabled)
         {
             printf("[DEBUG] compile_file: Code generation completed successfully\n");
         }
+
+        if (success && optimization_options.time_passes)
+        {
+            double seconds = optimization_clock_seconds() - codegen_start;
+            size_t bytes = code_buffer_total(generator->output);
+            printf("Code generation: %zu bytes in %.3f ms (%.1f MB/s)\n", bytes, seconds * 1000.0,
+                   seconds > 0.0 ? bytes / seconds / 1e6 : 0.0);
+        }
     }
     else if (debug_enabled)
     {
@@ -1293,12 +1345,14 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
             codegen_destroy(generator);
         }
     }
-    fclose(output_file);
+    if (output_file)
+        fclose(output_file);
 
     if (error_context->count > 0)
     {
         error_context_print_all(error_context);
         error_context_destroy(error_context);
+        bytecode_program_destroy(bytecode);
         if (ir_program)
             ir_program_destroy(ir_program);
         if (analyzer)
@@ -1337,9 +1391,30 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
         lexer_destroy(lexer);
     safe_free(source);
 
-    const char *output_type = assembly_output ? "assembly" : "C";
-    printf("Successfully compiled '%s' to '%s' (%s)\n", input_filename, output_filename, output_type);
-    fflush(stdout);
+    if (run_mode)
+    {
+        if (verbose || optimization_options.time_passes)
+        {
+            fprintf(stderr, "Compile to first instruction: %.3f ms\n",
+                    (optimization_clock_seconds() - start_time) * 1000.0);
+        }
+        if (bytecode)
+        {
+            *exit_code = interpreter_run(bytecode);
+            bytecode_program_destroy(bytecode);
+        }
+        else
+        {
+            *exit_code = jit_run(&image);
+            jit_unload(&image);
+        }
+    }
+    else
+    {
+        const char *output_type = assembly_output ? "assembly" : "C";
+        printf("Successfully compiled '%s' to '%s' (%s)\n", input_filename, output_filename, output_type);
+        fflush(stdout);
+    }
 
     if (debug_enabled)
     {
@@ -1349,6 +1424,21 @@ bool compile_file(const char *input_filename, const char *output_filename, bool
     return true;
 }
 
+bool compile_file(const char *input_filename, const char *output_filename, bool verbose, bool assembly_output)
+{
+    return compile_source(input_filename, output_filename, verbose, assembly_output, false, NULL);
+}
+
+bool run_file(const char *input_filename, bool verbose, int *exit_code)
+{
+    return compile_source(input_filename, NULL, verbose, true, false, exit_code);
+}
+
+bool interpret_file(const char *input_filename, bool verbose, int *exit_code)
+{
+    return compile_source(input_filename, NULL, verbose, true, true, exit_code);
+}
+
 bool compile_module_system(const char *input_filename, const char *output_filename, bool verbose,
                            const char *module_output_dir, DynamicArray *include_paths)
 {
@@ -1619,6 +1709,10 @@ bool compile_module_system(const char *input_filename, const char *output_filena
                 printf("[DEBUG] compile_file_with_modules: Running optimizations\n");
             }
             optimization_optimize_program(ir_program);
+            if (verbose)
+            {
+                optimization_stats_print(stdout);
+            }
         }
     }
 
@@ -45,6 +45,7 @@ int main(int argc, char *argv[])
     }
 
     CompilerContext context = {0};
+    int exit_code = 0;
     array_init(&context.input_filenames, 4);
     array_init(&context.module_include_paths, 4);
 
@@ -124,6 +125,42 @@ int main(int argc, char *argv[])
                 return 1;
             }
         }
+        else if (context.interpret_flag)
+        {
+            if (context.input_filenames.size > 1)
+            {
+                print_error(argv[0], "--interpret takes a single input file");
+                safe_free(source);
+                if (context.memory_stats_flag)
+                    print_memory_usage_stats();
+                return 1;
+            }
+            if (!interpret_file(main_input_file, context.verbose_flag, &exit_code))
+            {
+                safe_free(source);
+                if (context.memory_stats_flag)
+                    print_memory_usage_stats();
+                return 1;
+            }
+        }
+        else if (context.run_flag)
+        {
+            if (context.input_filenames.size > 1)
+            {
+                print_error(argv[0], "--run takes a single input file");
+                safe_free(source);
+                if (context.memory_stats_flag)
+                    print_memory_usage_stats();
+                return 1;
+            }
+            if (!run_file(main_input_file, context.verbose_flag, &exit_code))
+            {
+                safe_free(source);
+                if (context.memory_stats_flag)
+                    print_memory_usage_stats();
+                return 1;
+            }
+        }
         else
         {
             if (!context.output_filename)
@@ -138,9 +175,9 @@ int main(int argc, char *argv[])
 
             if (context.assembly_output)
             {
-                if (!has_asm_extension(context.output_filename))
+                if (!has_asm_extension(context.output_filename) && !has_object_extension(context.output_filename))
                 {
-                    print_error(argv[0], "assembly output requires .s or .asm extension");
+                    print_error(argv[0], "assembly output requires .s, .asm or .o extension");
                     fprintf(stderr, "  %s\n", context.output_filename);
                     fprintf(stderr, "  Use: %s %s -o %s.s --asm\n", argv[0], main_input_file,
                             context.output_filename[0] == '-' ? "output" : context.output_filename);
@@ -204,7 +241,7 @@ int main(int argc, char *argv[])
         fflush(stdout);
         if (context.memory_stats_flag)
             print_memory_usage_stats();
-        return 0;
+        return exit_code;
     }
 
     safe_free(source);
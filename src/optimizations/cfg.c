@@ -0,0 +1,396 @@
+#include "optimizations/cfg.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+bool ir_instruction_is_branch(const IRInstruction *instr)
+{
+    return instr && (instr->opcode == IR_JUMP ||
+                     instr->opcode == IR_JUMP_IF ||
+                     instr->opcode == IR_JUMP_IF_FALSE);
+}
+
+bool ir_instruction_is_conditional_branch(const IRInstruction *instr)
+{
+    return instr && (instr->opcode == IR_JUMP_IF || instr->opcode == IR_JUMP_IF_FALSE);
+}
+
+bool ir_instruction_references_label(const IRInstruction *instr)
+{
+    return instr && instr->label && (ir_instruction_is_branch(instr) || instr->opcode == IR_BOUNDS_CHECK);
+}
+
+bool ir_instruction_falls_through(const IRInstruction *instr)
+{
+    return instr && instr->opcode != IR_JUMP && instr->opcode != IR_RETURN;
+}
+
+bool ir_instruction_has_side_effects(const IRInstruction *instr)
+{
+    if (!instr)
+        return false;
+
+    switch (instr->opcode)
+    {
+    case IR_CALL:
+    case IR_PARAM:
+    case IR_PRINT:
+    case IR_PRINT_MULTIPLE:
+    case IR_RETURN:
+    case IR_ARRAY_STORE:
+    case IR_BOUNDS_CHECK:
+    case IR_ARRAY_DECL:
+    case IR_ARRAY_INIT:
+    case IR_VAR_DECL:
+    case IR_INLINE_ASM:
+    case IR_PROFILE:
+    case IR_LABEL:
+    case IR_JUMP:
+    case IR_JUMP_IF:
+    case IR_JUMP_IF_FALSE:
+        return true;
+    case IR_DIV:
+    case IR_MOD:
+        return !(instr->arg2 && instr->arg2->type == IR_OP_CONST &&
+                 (instr->arg2->is_float_const || instr->arg2->data.const_value != 0));
+    default:
+        return false;
+    }
+}
+
+IROperand *ir_instruction_def(IRInstruction *instr)
+{
+    if (!instr || !instr->result)
+        return NULL;
+
+    switch (instr->opcode)
+    {
+    case IR_MOVE:
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+    case IR_AND:
+    case IR_OR:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
+    case IR_NOT:
+    case IR_NEG:
+    case IR_CALL:
+    case IR_ARRAY_LOAD:
+    case IR_VECTOR_SPLAT:
+    case IR_VECTOR_INDEX:
+    case IR_VECTOR_REDUCE:
+        return instr->result;
+    default:
+        return NULL;
+    }
+}
+
+static size_t push_use(IROperand ***uses, size_t count, size_t max_uses, IROperand **slot)
+{
+    if (*slot && count < max_uses)
+    {
+        uses[count++] = slot;
+    }
+    return count;
+}
+
+size_t ir_instruction_uses(IRInstruction *instr, IROperand ***uses, size_t max_uses)
+{
+    size_t count = 0;
+    if (!instr)
+        return 0;
+
+    switch (instr->opcode)
+    {
+    case IR_ARRAY_STORE:
+        count = push_use(uses, count, max_uses, &instr->result);
+        count = push_use(uses, count, max_uses, &instr->arg2);
+        break;
+    case IR_ARRAY_LOAD:
+        count = push_use(uses, count, max_uses, &instr->arg2);
+        break;
+    case IR_ARRAY_DECL:
+    case IR_VAR_DECL:
+    case IR_LABEL:
+    case IR_JUMP:
+    case IR_NOP:
+    case IR_CALL:
+    case IR_INLINE_ASM:
+        break;
+    default:
+        count = push_use(uses, count, max_uses, &instr->arg1);
+        count = push_use(uses, count, max_uses, &instr->arg2);
+        break;
+    }
+
+    if (instr->args && (instr->opcode == IR_PRINT || instr->opcode == IR_PRINT_MULTIPLE))
+    {
+        for (size_t i = 0; i < instr->args->size; i++)
+        {
+            count = push_use(uses, count, max_uses, (IROperand **)&instr->args->data[i]);
+        }
+    }
+    return count;
+}
+
+size_t ir_call_collect_params(IRFunction *func, size_t call_index, size_t *param_indices, size_t max_params)
+{
+    size_t count = 0;
+    for (size_t i = call_index; i-- > 0;)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (!instr)
+            continue;
+        if (instr->opcode == IR_CALL || instr->opcode == IR_LABEL ||
+            instr->opcode == IR_JUMP || instr->opcode == IR_JUMP_IF ||
+            instr->opcode == IR_JUMP_IF_FALSE || instr->opcode == IR_RETURN)
+            break;
+        if (instr->opcode == IR_PARAM)
+        {
+            if (count == max_params)
+                return max_params + 1;
+            param_indices[count++] = i;
+        }
+    }
+
+    for (size_t i = 0; i < count / 2; i++)
+    {
+        size_t tmp = param_indices[i];
+        param_indices[i] = param_indices[count - 1 - i];
+        param_indices[count - 1 - i] = tmp;
+    }
+    return count;
+}
+
+IRInstruction *ir_function_instr_at(IRFunction *func, size_t index)
+{
+    return (IRInstruction *)array_get(&func->instructions, index);
+}
+
+bool ir_operand_same(const IROperand *a, const IROperand *b)
+{
+    if (!a || !b || a->type != b->type)
+        return false;
+    if (a->type == IR_OP_VAR)
+        return string_equal(a->data.var_name, b->data.var_name);
+    if (a->type == IR_OP_TEMP)
+        return a->data.temp_id == b->data.temp_id;
+    return false;
+}
+
+void ir_function_replace_instructions(IRFunction *func, DynamicArray *instructions)
+{
+    safe_free(func->instructions.data);
+    func->instructions.data = instructions->data;
+    func->instructions.size = instructions->size;
+    func->instructions.capacity = instructions->capacity;
+    instructions->data = NULL;
+    instructions->size = 0;
+    instructions->capacity = 0;
+}
+
+static bool ends_block(const IRInstruction *instr)
+{
+    return ir_instruction_is_branch(instr) || (instr && instr->opcode == IR_RETURN);
+}
+
+static void add_edge(IRBasicBlock *from, IRBasicBlock *to)
+{
+    if (!from || !to)
+        return;
+    array_push(&from->succs, to);
+    array_push(&to->preds, from);
+}
+
+IRControlFlowGraph *ir_cfg_build(IRFunction *func)
+{
+    IRControlFlowGraph *cfg = safe_malloc(sizeof(IRControlFlowGraph));
+    cfg->function = func;
+    array_init(&cfg->blocks, 16);
+    cfg->label_blocks = hashtable_create(64);
+
+    size_t count = func->instructions.size;
+    size_t start = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        IRInstruction *next = i + 1 < count ? (IRInstruction *)array_get(&func->instructions, i + 1) : NULL;
+        bool last = i + 1 == count || ends_block(instr) || (next && next->opcode == IR_LABEL);
+        if (!last)
+            continue;
+
+        IRBasicBlock *block = safe_malloc(sizeof(IRBasicBlock));
+        block->id = cfg->blocks.size;
+        block->start = start;
+        block->end = i + 1;
+        block->label = NULL;
+        array_init(&block->succs, 2);
+        array_init(&block->preds, 2);
+
+        IRInstruction *first = (IRInstruction *)array_get(&func->instructions, start);
+        if (first && first->opcode == IR_LABEL && first->label)
+        {
+            block->label = first->label;
+            hashtable_put(cfg->label_blocks, first->label, block);
+        }
+        array_push(&cfg->blocks, block);
+        start = i + 1;
+    }
+
+    for (size_t b = 0; b < cfg->blocks.size; b++)
+    {
+        IRBasicBlock *block = ir_cfg_block(cfg, b);
+        IRBasicBlock *fallthrough = b + 1 < cfg->blocks.size ? ir_cfg_block(cfg, b + 1) : NULL;
+        IRInstruction *last = ir_cfg_terminator(cfg, block);
+
+        if (last && ir_instruction_is_branch(last))
+        {
+            add_edge(block, ir_cfg_block_for_label(cfg, last->label));
+            if (last->opcode != IR_JUMP)
+                add_edge(block, fallthrough);
+        }
+        else if (!last || last->opcode != IR_RETURN)
+        {
+            add_edge(block, fallthrough);
+        }
+    }
+
+    if (debug_enabled)
+    {
+        printf("[DEBUG] CFG for %s: %zu blocks\n", func->name, cfg->blocks.size);
+    }
+    return cfg;
+}
+
+void ir_cfg_destroy(IRControlFlowGraph *cfg)
+{
+    if (!cfg)
+        return;
+
+    for (size_t i = 0; i < cfg->blocks.size; i++)
+    {
+        IRBasicBlock *block = ir_cfg_block(cfg, i);
+        array_free(&block->succs);
+        array_free(&block->preds);
+        safe_free(block);
+    }
+    array_free(&cfg->blocks);
+    hashtable_destroy(cfg->label_blocks);
+    safe_free(cfg);
+}
+
+IRBasicBlock *ir_cfg_block(IRControlFlowGraph *cfg, size_t index)
+{
+    return (IRBasicBlock *)array_get(&cfg->blocks, index);
+}
+
+IRBasicBlock *ir_cfg_block_for_label(IRControlFlowGraph *cfg, const char *label)
+{
+    return label ? (IRBasicBlock *)hashtable_get(cfg->label_blocks, label) : NULL;
+}
+
+IRInstruction *ir_cfg_terminator(IRControlFlowGraph *cfg, IRBasicBlock *block)
+{
+    if (!block || block->end == block->start)
+        return NULL;
+    return (IRInstruction *)array_get(&cfg->function->instructions, block->end - 1);
+}
+
+static void index_operand(IRValueIndex *index, IROperand *operand)
+{
+    if (!operand)
+        return;
+
+    if (operand->type == IR_OP_TEMP)
+    {
+        if ((size_t)operand->data.temp_id + 1 > index->temp_count)
+            index->temp_count = (size_t)operand->data.temp_id + 1;
+    }
+    else if (operand->type == IR_OP_VAR && !hashtable_contains(index->vars, operand->data.var_name))
+    {
+        index->var_count++;
+        hashtable_put(index->vars, operand->data.var_name, (void *)(intptr_t)index->var_count);
+        array_push(&index->var_names, string_copy(operand->data.var_name));
+    }
+}
+
+IRValueIndex *ir_value_index_create(IRFunction *func)
+{
+    IRValueIndex *index = safe_malloc(sizeof(IRValueIndex));
+    index->vars = hashtable_create(64);
+    array_init(&index->var_names, 16);
+    index->var_count = 0;
+    index->temp_count = func->temp_counter > 0 ? (size_t)func->temp_counter : 0;
+
+    for (size_t i = 0; i < func->params.size; i++)
+    {
+        index_operand(index, (IROperand *)array_get(&func->params, i));
+    }
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (!instr)
+            continue;
+        index_operand(index, instr->result);
+        index_operand(index, instr->arg1);
+        index_operand(index, instr->arg2);
+        if (instr->args)
+        {
+            for (size_t j = 0; j < instr->args->size; j++)
+            {
+                index_operand(index, (IROperand *)array_get(instr->args, j));
+            }
+        }
+    }
+    return index;
+}
+
+void ir_value_index_destroy(IRValueIndex *index)
+{
+    if (!index)
+        return;
+    hashtable_destroy(index->vars);
+    for (size_t i = 0; i < index->var_names.size; i++)
+    {
+        safe_free(array_get(&index->var_names, i));
+    }
+    array_free(&index->var_names);
+    safe_free(index);
+}
+
+size_t ir_value_index_size(const IRValueIndex *index)
+{
+    return index->var_count + index->temp_count;
+}
+
+int ir_value_index_of_var(const IRValueIndex *index, const char *name)
+{
+    intptr_t slot = (intptr_t)hashtable_get(index->vars, name);
+    return slot > 0 ? (int)(slot - 1) : -1;
+}
+
+int ir_value_index_of(const IRValueIndex *index, const IROperand *operand)
+{
+    if (!operand)
+        return -1;
+    if (operand->type == IR_OP_VAR)
+        return ir_value_index_of_var(index, operand->data.var_name);
+    if (operand->type == IR_OP_TEMP && operand->data.temp_id >= 0 &&
+        (size_t)operand->data.temp_id < index->temp_count)
+        return (int)(index->var_count + (size_t)operand->data.temp_id);
+    return -1;
+}
@@ -0,0 +1,354 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+#define MAX_THREAD_DEPTH 16
+
+typedef struct LabelInfo {
+    HashTable *positions;
+    HashTable *references;
+} LabelInfo;
+
+static bool is_filler(const IRInstruction *instr)
+{
+    return instr->opcode == IR_LABEL || instr->opcode == IR_NOP;
+}
+
+static void label_info_build(LabelInfo *info, IRFunction *func)
+{
+    info->positions = hashtable_create(32);
+    info->references = hashtable_create(32);
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (instr->opcode == IR_LABEL && instr->label)
+        {
+            hashtable_put(info->positions, instr->label, (void *)(intptr_t)(i + 1));
+        }
+        else if (ir_instruction_references_label(instr))
+        {
+            intptr_t count = (intptr_t)hashtable_get(info->references, instr->label);
+            hashtable_put(info->references, instr->label, (void *)(count + 1));
+        }
+    }
+}
+
+static void label_info_destroy(LabelInfo *info)
+{
+    hashtable_destroy(info->positions);
+    hashtable_destroy(info->references);
+}
+
+static bool label_position(const LabelInfo *info, const char *label, size_t *position)
+{
+    intptr_t entry = label ? (intptr_t)hashtable_get(info->positions, label) : 0;
+    if (entry <= 0)
+        return false;
+    *position = (size_t)(entry - 1);
+    return true;
+}
+
+static size_t label_references(const LabelInfo *info, const char *label)
+{
+    return (size_t)(intptr_t)hashtable_get(info->references, label);
+}
+
+/* Index of the first instruction that actually executes once control
+   reaches `index`. */
+static size_t skip_filler(IRFunction *func, size_t index)
+{
+    while (index < func->instructions.size && is_filler(ir_function_instr_at(func, index)))
+        index++;
+    return index;
+}
+
+/* Labels that sit next to each other name the same point; the first of the
+   run is used as the canonical name so the others become unreferenced. */
+static const char *canonical_label(IRFunction *func, size_t position)
+{
+    while (position > 0 && ir_function_instr_at(func, position - 1)->opcode == IR_LABEL)
+        position--;
+    return ir_function_instr_at(func, position)->label;
+}
+
+static bool retarget(IRInstruction *instr, const char *label)
+{
+    if (string_equal(instr->label, label))
+        return false;
+    safe_free(instr->label);
+    instr->label = string_copy(label);
+    instr->is_cold = false;
+    return true;
+}
+
+static void make_nop(IRInstruction *instr)
+{
+    ir_operand_destroy(instr->arg1);
+    instr->arg1 = NULL;
+    safe_free(instr->label);
+    instr->label = NULL;
+    instr->opcode = IR_NOP;
+}
+
+static bool fold_constant_branch(IRFunction *func, IRInstruction *instr)
+{
+    if ((instr->opcode != IR_JUMP_IF && instr->opcode != IR_JUMP_IF_FALSE) ||
+        !instr->arg1 || instr->arg1->type != IR_OP_CONST)
+        return false;
+
+    bool truthy = instr->arg1->is_float_const ? instr->arg1->data.float_const_value != 0.0
+                                              : instr->arg1->data.const_value != 0;
+    bool taken = instr->opcode == IR_JUMP_IF ? truthy : !truthy;
+    if (debug_enabled)
+    {
+        printf("[DEBUG] CFG simplification: Branch to %s in %s is %s\n", instr->label, func->name,
+               taken ? "always taken" : "never taken");
+    }
+    if (taken)
+    {
+        ir_operand_destroy(instr->arg1);
+        instr->arg1 = NULL;
+        instr->opcode = IR_JUMP;
+    }
+    else
+    {
+        make_nop(instr);
+    }
+    optimization_stats_add("constant branches folded", 1);
+    return true;
+}
+
+/* Follows the target of a branch through blocks that consist of nothing
+   but an unconditional jump. Cycles of such blocks are left alone. */
+static bool thread_branch(IRFunction *func, const LabelInfo *info, IRInstruction *instr)
+{
+    size_t visited[MAX_THREAD_DEPTH + 1];
+    size_t position;
+    if (!label_position(info, instr->label, &position))
+        return false;
+
+    visited[0] = position;
+    for (int depth = 1; depth <= MAX_THREAD_DEPTH; depth++)
+    {
+        size_t next = skip_filler(func, position);
+        if (next >= func->instructions.size)
+            break;
+        IRInstruction *target = ir_function_instr_at(func, next);
+        if (target == instr || target->opcode != IR_JUMP || !label_position(info, target->label, &position))
+            break;
+        for (int k = 0; k < depth; k++)
+        {
+            if (visited[k] == position)
+                return false;
+        }
+        visited[depth] = position;
+    }
+
+    if (!retarget(instr, canonical_label(func, position)))
+        return false;
+    optimization_stats_add("branches threaded", 1);
+    return true;
+}
+
+/* A jump to a block that only returns is replaced by the return itself. */
+static bool duplicate_return(IRFunction *func, const LabelInfo *info, size_t index)
+{
+    IRInstruction *instr = ir_function_instr_at(func, index);
+    size_t position;
+    if (instr->opcode != IR_JUMP || !label_position(info, instr->label, &position))
+        return false;
+
+    size_t next = skip_filler(func, position);
+    if (next >= func->instructions.size || ir_function_instr_at(func, next)->opcode != IR_RETURN)
+        return false;
+
+    IRInstruction *copy = ir_instruction_clone(ir_function_instr_at(func, next));
+    ir_instruction_destroy(instr);
+    array_set(&func->instructions, index, copy);
+    optimization_stats_add("returns duplicated", 1);
+    return true;
+}
+
+static bool targets_fallthrough(IRFunction *func, const LabelInfo *info, size_t index)
+{
+    size_t position;
+    if (!label_position(info, ir_function_instr_at(func, index)->label, &position) || position <= index)
+        return false;
+    for (size_t i = index + 1; i < position; i++)
+    {
+        if (!is_filler(ir_function_instr_at(func, i)))
+            return false;
+    }
+    return true;
+}
+
+/* `if (!c) goto L1; goto L2; L1:` becomes `if (c) goto L2; L1:`. */
+static bool invert_branch(IRFunction *func, const LabelInfo *info, size_t index)
+{
+    IRInstruction *instr = ir_function_instr_at(func, index);
+    size_t position;
+    if ((instr->opcode != IR_JUMP_IF && instr->opcode != IR_JUMP_IF_FALSE) || index + 1 >= func->instructions.size ||
+        !label_position(info, instr->label, &position) || position <= index + 1)
+        return false;
+    IRInstruction *jump = ir_function_instr_at(func, index + 1);
+    if (jump->opcode != IR_JUMP)
+        return false;
+    for (size_t i = index + 2; i < position; i++)
+    {
+        if (!is_filler(ir_function_instr_at(func, i)))
+            return false;
+    }
+
+    instr->opcode = instr->opcode == IR_JUMP_IF ? IR_JUMP_IF_FALSE : IR_JUMP_IF;
+    instr->profile_taken = instr->profile_count - instr->profile_taken;
+    retarget(instr, jump->label);
+    make_nop(jump);
+    optimization_stats_add("branches inverted", 1);
+    return true;
+}
+
+static bool remove_jump_to_next(IRFunction *func, const LabelInfo *info, size_t index)
+{
+    IRInstruction *instr = ir_function_instr_at(func, index);
+    if (!ir_instruction_is_branch(instr) || !targets_fallthrough(func, info, index))
+        return false;
+    make_nop(instr);
+    optimization_stats_add("jumps to next removed", 1);
+    return true;
+}
+
+/* Moves the block that a jump is the only way into in place of the jump.
+   The block has to end in an unconditional transfer so that nothing relies
+   on its fall-through, and may not declare variables since declarations
+   must stay ahead of their uses. */
+static bool merge_block(IRFunction *func, const LabelInfo *info, size_t index)
+{
+    IRInstruction *jump = ir_function_instr_at(func, index);
+    size_t start;
+    if (jump->opcode != IR_JUMP || label_references(info, jump->label) != 1 ||
+        !label_position(info, jump->label, &start) || start == 0 || start == index + 1)
+        return false;
+    if (ir_instruction_falls_through(ir_function_instr_at(func, start - 1)))
+        return false;
+
+    size_t end = start + 1;
+    for (; end < func->instructions.size; end++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, end);
+        if (instr->opcode == IR_LABEL || instr->opcode == IR_VAR_DECL || instr->opcode == IR_ARRAY_DECL)
+            return false;
+        if (!ir_instruction_falls_through(instr))
+            break;
+    }
+    if (end >= func->instructions.size || (index >= start && index <= end))
+        return false;
+
+    if (debug_enabled)
+    {
+        printf("[DEBUG] CFG simplification: Merging block %s into its only predecessor in %s\n",
+               jump->label, func->name);
+    }
+
+    DynamicArray out;
+    array_init(&out, func->instructions.size);
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        if (i == index)
+        {
+            for (size_t k = start + 1; k <= end; k++)
+            {
+                array_push(&out, ir_function_instr_at(func, k));
+            }
+            ir_instruction_destroy(jump);
+        }
+        else if (i == start)
+        {
+            ir_instruction_destroy(ir_function_instr_at(func, i));
+        }
+        else if (i < start || i > end)
+        {
+            array_push(&out, ir_function_instr_at(func, i));
+        }
+    }
+    ir_function_replace_instructions(func, &out);
+    optimization_stats_add("blocks merged", 1);
+    return true;
+}
+
+static bool remove_dead_instructions(IRFunction *func)
+{
+    LabelInfo info;
+    label_info_build(&info, func);
+
+    DynamicArray out;
+    array_init(&out, func->instructions.size > 0 ? func->instructions.size : 1);
+    size_t removed_labels = 0;
+    bool changed = false;
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        bool unused_label = instr->opcode == IR_LABEL && label_references(&info, instr->label) == 0;
+        if (instr->opcode == IR_NOP || unused_label)
+        {
+            removed_labels += unused_label ? 1 : 0;
+            ir_instruction_destroy(instr);
+            changed = true;
+            continue;
+        }
+        array_push(&out, instr);
+    }
+
+    if (changed)
+        ir_function_replace_instructions(func, &out);
+    else
+        array_free(&out);
+    if (removed_labels > 0)
+        optimization_stats_add("unused labels removed", removed_labels);
+
+    label_info_destroy(&info);
+    return changed;
+}
+
+static bool simplify_function_cfg(IRFunction *func)
+{
+    bool changed = false;
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        LabelInfo info;
+        label_info_build(&info, func);
+
+        for (size_t i = 0; i < func->instructions.size; i++)
+        {
+            IRInstruction *instr = ir_function_instr_at(func, i);
+            if (fold_constant_branch(func, instr))
+                progress = true;
+            if (ir_instruction_is_branch(instr) && thread_branch(func, &info, instr))
+                progress = true;
+        }
+        /* Block merging moves instructions around and relies on exact
+           reference counts, so the rest is done one rewrite at a time. */
+        for (size_t i = 0; i < func->instructions.size && !progress; i++)
+        {
+            progress = invert_branch(func, &info, i) || remove_jump_to_next(func, &info, i) ||
+                       duplicate_return(func, &info, i) || merge_block(func, &info, i);
+        }
+
+        label_info_destroy(&info);
+        if (remove_dead_instructions(func))
+            progress = true;
+        changed = changed || progress;
+    }
+    return changed;
+}
+
+bool optimization_cfg_simplification(IRProgram *program)
+{
+    return optimization_run_per_function(program, simplify_function_cfg);
+}
@@ -0,0 +1,334 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+#define MAX_COMPTIME_DEPTH 256
+
+typedef struct ComptimeFunction {
+    IRFunction *func;
+    IRValueIndex *values;
+    HashTable *labels;
+    bool pure;
+} ComptimeFunction;
+
+typedef struct ComptimeContext {
+    HashTable *functions;
+    DynamicArray entries;
+    size_t steps;
+    size_t max_steps;
+} ComptimeContext;
+
+static void context_init(ComptimeContext *ctx, IRProgram *program)
+{
+    ctx->functions = hashtable_create(32);
+    array_init(&ctx->entries, program->functions.size > 0 ? program->functions.size : 1);
+    ctx->steps = 0;
+    ctx->max_steps = (size_t)optimization_options.max_comptime_steps;
+
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        ComptimeFunction *entry = safe_malloc(sizeof(ComptimeFunction));
+        entry->func = func;
+        entry->values = NULL;
+        entry->labels = NULL;
+        entry->pure = false;
+        array_push(&ctx->entries, entry);
+
+        /* Overloads share a name; calls to them cannot be resolved here. */
+        if (hashtable_contains(ctx->functions, func->name))
+            hashtable_put(ctx->functions, func->name, NULL);
+        else
+            hashtable_put(ctx->functions, func->name, entry);
+    }
+}
+
+static void context_destroy(ComptimeContext *ctx)
+{
+    for (size_t i = 0; i < ctx->entries.size; i++)
+    {
+        ComptimeFunction *entry = (ComptimeFunction *)array_get(&ctx->entries, i);
+        ir_value_index_destroy(entry->values);
+        if (entry->labels)
+            hashtable_destroy(entry->labels);
+        safe_free(entry);
+    }
+    array_free(&ctx->entries);
+    hashtable_destroy(ctx->functions);
+}
+
+static ComptimeFunction *lookup_callee(ComptimeContext *ctx, const IRInstruction *call)
+{
+    return call->label ? (ComptimeFunction *)hashtable_get(ctx->functions, call->label) : NULL;
+}
+
+static void bind_pure_functions(ComptimeContext *ctx, IRProgram *program)
+{
+    HashTable *pure = optimization_infer_pure_functions(program);
+    for (size_t i = 0; i < ctx->entries.size; i++)
+    {
+        ComptimeFunction *entry = (ComptimeFunction *)array_get(&ctx->entries, i);
+        entry->pure = hashtable_get(pure, entry->func->name) == entry->func;
+        if (!entry->pure)
+            continue;
+
+        entry->values = ir_value_index_create(entry->func);
+        entry->labels = hashtable_create(16);
+        for (size_t j = 0; j < entry->func->instructions.size; j++)
+        {
+            IRInstruction *instr = ir_function_instr_at(entry->func, j);
+            if (instr->opcode == IR_LABEL && instr->label)
+                hashtable_put(entry->labels, instr->label, (void *)(intptr_t)(j + 1));
+        }
+    }
+    hashtable_destroy(pure);
+}
+
+typedef struct ComptimeFrame {
+    ComptimeFunction *function;
+    int64_t *values;
+    bool *defined;
+} ComptimeFrame;
+
+static bool read_value(ComptimeFrame *frame, const IROperand *operand, int64_t *value)
+{
+    if (!operand)
+        return false;
+    if (operand->type == IR_OP_CONST)
+    {
+        *value = operand->data.const_value;
+        return true;
+    }
+
+    int slot = ir_value_index_of(frame->function->values, operand);
+    if (slot < 0 || !frame->defined[slot])
+        return false;
+    *value = frame->values[slot];
+    return true;
+}
+
+static bool write_value(ComptimeFrame *frame, const IROperand *operand, int64_t value)
+{
+    int slot = ir_value_index_of(frame->function->values, operand);
+    if (slot < 0)
+        return false;
+    frame->values[slot] = operand->data_type == TYPE_BOOL ? value != 0 : value;
+    frame->defined[slot] = true;
+    return true;
+}
+
+static bool fold_value(IROpcode opcode, int64_t lhs, const int64_t *rhs, int64_t *result)
+{
+    IROperand a;
+    IROperand b;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    a.type = IR_OP_CONST;
+    a.data.const_value = lhs;
+    b.type = IR_OP_CONST;
+    b.data.const_value = rhs ? *rhs : 0;
+
+    IROperand *folded = rhs ? ir_fold_binary_constant(opcode, &a, &b) : ir_fold_unary_constant(opcode, &a);
+    if (!folded)
+        return false;
+    *result = folded->data.const_value;
+    ir_operand_destroy(folded);
+    return true;
+}
+
+static bool comptime_call(ComptimeContext *ctx, ComptimeFunction *function, const int64_t *args,
+                          size_t arg_count, int depth, int64_t *result);
+
+static bool execute(ComptimeContext *ctx, ComptimeFrame *frame, int depth, int64_t *result)
+{
+    IRFunction *func = frame->function->func;
+    int64_t args[MAX_PARAMS];
+    size_t arg_count = 0;
+    size_t pc = 0;
+
+    while (pc < func->instructions.size)
+    {
+        if (++ctx->steps > ctx->max_steps)
+            return false;
+
+        IRInstruction *instr = ir_function_instr_at(func, pc++);
+        int64_t lhs;
+        int64_t rhs;
+        int64_t value;
+
+        switch (instr->opcode)
+        {
+        case IR_NOP:
+        case IR_LABEL:
+        case IR_VAR_DECL:
+            break;
+        case IR_MOVE:
+            if (!read_value(frame, instr->arg1, &value) || !write_value(frame, instr->result, value))
+                return false;
+            break;
+        case IR_NOT:
+        case IR_NEG:
+            if (!read_value(frame, instr->arg1, &lhs) || !fold_value(instr->opcode, lhs, NULL, &value) ||
+                !write_value(frame, instr->result, value))
+                return false;
+            break;
+        case IR_JUMP:
+        case IR_JUMP_IF:
+        case IR_JUMP_IF_FALSE:
+        {
+            if (instr->opcode != IR_JUMP)
+            {
+                if (!read_value(frame, instr->arg1, &value))
+                    return false;
+                if ((value != 0) != (instr->opcode == IR_JUMP_IF))
+                    break;
+            }
+            intptr_t target = (intptr_t)hashtable_get(frame->function->labels, instr->label);
+            if (target <= 0)
+                return false;
+            pc = (size_t)target;
+            break;
+        }
+        case IR_PARAM:
+            if (arg_count == MAX_PARAMS || !read_value(frame, instr->arg1, &args[arg_count]))
+                return false;
+            arg_count++;
+            break;
+        case IR_CALL:
+        {
+            ComptimeFunction *callee = lookup_callee(ctx, instr);
+            if (!callee || !callee->pure || !comptime_call(ctx, callee, args, arg_count, depth + 1, &value))
+                return false;
+            arg_count = 0;
+            if (instr->result && !write_value(frame, instr->result, value))
+                return false;
+            break;
+        }
+        case IR_RETURN:
+            return read_value(frame, instr->arg1, result);
+        default:
+            if (!read_value(frame, instr->arg1, &lhs) || !read_value(frame, instr->arg2, &rhs) ||
+                !fold_value(instr->opcode, lhs, &rhs, &value) || !write_value(frame, instr->result, value))
+                return false;
+            break;
+        }
+    }
+    return false;
+}
+
+static bool comptime_call(ComptimeContext *ctx, ComptimeFunction *function, const int64_t *args,
+                          size_t arg_count, int depth, int64_t *result)
+{
+    IRFunction *func = function->func;
+    if (depth > MAX_COMPTIME_DEPTH || arg_count != func->params.size)
+        return false;
+
+    size_t size = ir_value_index_size(function->values);
+    ComptimeFrame frame;
+    frame.function = function;
+    frame.values = safe_malloc((size > 0 ? size : 1) * sizeof(int64_t));
+    frame.defined = safe_malloc((size > 0 ? size : 1) * sizeof(bool));
+    memset(frame.defined, 0, (size > 0 ? size : 1) * sizeof(bool));
+
+    bool ok = true;
+    for (size_t k = 0; k < arg_count && ok; k++)
+    {
+        ok = write_value(&frame, (IROperand *)array_get(&func->params, k), args[k]);
+    }
+    ok = ok && execute(ctx, &frame, depth, result);
+    if (ok && func->return_type == TYPE_BOOL)
+        *result = *result != 0;
+
+    safe_free(frame.values);
+    safe_free(frame.defined);
+    return ok;
+}
+
+static bool evaluate_call_site(ComptimeContext *ctx, IRFunction *caller, size_t call_index)
+{
+    IRInstruction *call = ir_function_instr_at(caller, call_index);
+    ComptimeFunction *callee = lookup_callee(ctx, call);
+    if (!call->result || !callee || !callee->pure)
+        return false;
+
+    size_t param_indices[MAX_PARAMS + 1];
+    size_t param_count = ir_call_collect_params(caller, call_index, param_indices, MAX_PARAMS);
+    if (param_count != callee->func->params.size)
+        return false;
+
+    int64_t args[MAX_PARAMS];
+    for (size_t k = 0; k < param_count; k++)
+    {
+        IROperand *arg = ir_function_instr_at(caller, param_indices[k])->arg1;
+        if (!arg || arg->type != IR_OP_CONST || arg->is_float_const)
+            return false;
+        args[k] = arg->data.const_value;
+    }
+
+    int64_t value;
+    ctx->steps = 0;
+    if (!comptime_call(ctx, callee, args, param_count, 0, &value))
+    {
+        if (debug_enabled)
+        {
+            printf("[DEBUG] Comptime: Gave up on call to %s in %s after %zu steps\n",
+                   callee->func->name, caller->name, ctx->steps);
+        }
+        return false;
+    }
+
+    if (debug_enabled)
+    {
+        printf("[DEBUG] Comptime: %s(...) in %s evaluated to %lld in %zu steps\n",
+               callee->func->name, caller->name, (long long)value, ctx->steps);
+    }
+
+    for (size_t k = 0; k < param_count; k++)
+    {
+        IRInstruction *param = ir_function_instr_at(caller, param_indices[k]);
+        ir_operand_destroy(param->arg1);
+        param->arg1 = NULL;
+        param->opcode = IR_NOP;
+    }
+
+    IROperand *constant = ir_operand_const(value);
+    constant->data_type = call->result->data_type;
+    safe_free(call->label);
+    call->label = NULL;
+    call->opcode = IR_MOVE;
+    call->arg1 = constant;
+    return true;
+}
+
+bool optimization_comptime_evaluation(IRProgram *program)
+{
+    if (!program || optimization_options.max_comptime_steps <= 0)
+        return false;
+
+    ComptimeContext ctx;
+    context_init(&ctx, program);
+    bind_pure_functions(&ctx, program);
+
+    bool changed = false;
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        for (size_t j = 0; j < func->instructions.size; j++)
+        {
+            IRInstruction *instr = ir_function_instr_at(func, j);
+            if (instr && instr->opcode == IR_CALL && evaluate_call_site(&ctx, func, j))
+            {
+                optimization_stats_add("calls evaluated at compile time", 1);
+                changed = true;
+            }
+        }
+    }
+
+    context_destroy(&ctx);
+    return changed;
+}
@@ -20,12 +20,14 @@ static int64_t get_const_value(IROperand *operand)
 
 static double get_const_float_value(IROperand *operand)
 {
-    if (!is_constant(operand) || !operand->is_float_const)
+    if (!is_constant(operand))
         return 0.0;
+    if (!operand->is_float_const)
+        return (double)operand->data.const_value;
     return operand->data.float_const_value;
 }
 
-static IROperand *fold_binary_op(IROpcode opcode, IROperand *arg1, IROperand *arg2, DataType result_type)
+IROperand *ir_fold_binary_constant(IROpcode opcode, IROperand *arg1, IROperand *arg2)
 {
     if (!is_constant(arg1) || !is_constant(arg2))
         return NULL;
@@ -93,21 +95,21 @@ static IROperand *fold_binary_op(IROpcode opcode, IROperand *arg1, IROperand *ar
         switch (opcode)
         {
         case IR_ADD:
-            result_int = val1 + val2;
+            result_int = (int64_t)((uint64_t)val1 + (uint64_t)val2);
             break;
         case IR_SUB:
-            result_int = val1 - val2;
+            result_int = (int64_t)((uint64_t)val1 - (uint64_t)val2);
             break;
         case IR_MUL:
-            result_int = val1 * val2;
+            result_int = (int64_t)((uint64_t)val1 * (uint64_t)val2);
             break;
         case IR_DIV:
-            if (val2 == 0)
+            if (val2 == 0 || (val1 == INT64_MIN && val2 == -1))
                 return NULL; 
             result_int = val1 / val2;
             break;
         case IR_MOD:
-            if (val2 == 0)
+            if (val2 == 0 || (val1 == INT64_MIN && val2 == -1))
                 return NULL; 
             result_int = val1 % val2;
             break;
@@ -135,6 +137,19 @@ static IROperand *fold_binary_op(IROpcode opcode, IROperand *arg1, IROperand *ar
         case IR_OR:
             result_int = (val1 || val2) ? 1 : 0;
             break;
+        case IR_SHL:
+            if (val2 < 0 || val2 > 63)
+                return NULL;
+            result_int = (int64_t)((uint64_t)val1 << val2);
+            break;
+        case IR_SHR:
+            if (val2 < 0 || val2 > 63)
+                return NULL;
+            result_int = val1 >> val2;
+            break;
+        case IR_BAND:
+            result_int = val1 & val2;
+            break;
         default:
             valid = false;
             break;
@@ -150,7 +165,7 @@ static IROperand *fold_binary_op(IROpcode opcode, IROperand *arg1, IROperand *ar
         return ir_operand_const(result_int);
 }
 
-static IROperand *fold_unary_op(IROpcode opcode, IROperand *arg, DataType result_type)
+IROperand *ir_fold_unary_constant(IROpcode opcode, IROperand *arg)
 {
     if (!is_constant(arg))
         return NULL;
@@ -177,7 +192,7 @@ static IROperand *fold_unary_op(IROpcode opcode, IROperand *arg, DataType result
         switch (opcode)
         {
         case IR_NEG:
-            result_int = -val;
+            result_int = (int64_t)(0 - (uint64_t)val);
             break;
         case IR_NOT:
             result_int = (!val) ? 1 : 0;
@@ -302,10 +317,10 @@ static bool optimize_function_constant_folding(IRFunction *func)
             cp_state->constants = hashtable_create(16);
         }
 
-        if ((instr->opcode >= IR_ADD && instr->opcode <= IR_OR) && 
+        if ((instr->opcode >= IR_ADD && instr->opcode <= IR_BAND) && 
             instr->arg1 && instr->arg2 && instr->result)
         {
-            IROperand *folded = fold_binary_op(instr->opcode, instr->arg1, instr->arg2, instr->result->data_type);
+            IROperand *folded = ir_fold_binary_constant(instr->opcode, instr->arg1, instr->arg2);
             if (folded)
             {
                 IROperand *old_arg1 = instr->arg1;
@@ -327,7 +342,7 @@ static bool optimize_function_constant_folding(IRFunction *func)
         if ((instr->opcode == IR_NEG || instr->opcode == IR_NOT) && 
             instr->arg1 && instr->result)
         {
-            IROperand *folded = fold_unary_op(instr->opcode, instr->arg1, instr->result->data_type);
+            IROperand *folded = ir_fold_unary_constant(instr->opcode, instr->arg1);
             if (folded)
             {
                 IROperand *old_arg1 = instr->arg1;
@@ -422,7 +437,7 @@ static bool optimize_function_constant_folding(IRFunction *func)
             }
         }
         
-        if ((instr->opcode >= IR_ADD && instr->opcode <= IR_OR) && instr->result)
+        if ((instr->opcode >= IR_ADD && instr->opcode <= IR_BAND) && instr->result)
         {
             if (instr->result->type == IR_OP_VAR)
             {
@@ -543,22 +558,6 @@ static bool optimize_function_constant_folding(IRFunction *func)
 
 bool optimization_constant_folding(IRProgram *program)
 {
-    if (!program)
-        return false;
-
-    bool changed = false;
-    for (size_t i = 0; i < program->functions.size; i++)
-    {
-        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
-        if (func)
-        {
-            if (optimize_function_constant_folding(func))
-            {
-                changed = true;
-            }
-        }
-    }
-
-    return changed;
+    return optimization_run_per_function(program, optimize_function_constant_folding);
 }
 
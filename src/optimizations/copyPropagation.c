@@ -36,6 +36,54 @@ static bool is_simple_operand(IROperand *op)
     return op && (op->type == IR_OP_VAR || op->type == IR_OP_TEMP);
 }
 
+static void add_definition(HashTable *def_counts, const char *key, intptr_t count)
+{
+    if (!key[0])
+        return;
+    intptr_t current = (intptr_t)hashtable_get(def_counts, key);
+    hashtable_put(def_counts, key, (void *)(current + count));
+}
+
+static void count_definitions(IRFunction *func, HashTable *def_counts)
+{
+    char key[64];
+    for (size_t i = 0; i < func->params.size; i++)
+    {
+        get_operand_key((IROperand *)array_get(&func->params, i), key, sizeof(key));
+        add_definition(def_counts, key, 1);
+    }
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (!instr)
+            continue;
+
+        if (instr->opcode == IR_INLINE_ASM && instr->asm_outputs)
+        {
+            for (size_t j = 0; j < instr->asm_outputs->size; j++)
+            {
+                InlineAsmOperand *output = (InlineAsmOperand *)array_get(instr->asm_outputs, j);
+                snprintf(key, sizeof(key), "v:%s", output->variable);
+                add_definition(def_counts, key, 2);
+            }
+            continue;
+        }
+
+        if (!instr->result || instr->opcode == IR_ARRAY_STORE ||
+            instr->opcode == IR_VAR_DECL || instr->opcode == IR_ARRAY_DECL)
+            continue;
+        get_operand_key(instr->result, key, sizeof(key));
+        add_definition(def_counts, key, 1);
+    }
+}
+
+static bool is_stable_copy(HashTable *def_counts, const char *result_key, const char *source_key)
+{
+    return (intptr_t)hashtable_get(def_counts, result_key) == 1 &&
+           (intptr_t)hashtable_get(def_counts, source_key) <= 1;
+}
+
 static bool optimize_function_copy_propagation(IRFunction *func)
 {
     bool changed = false;
@@ -43,6 +91,9 @@ static bool optimize_function_copy_propagation(IRFunction *func)
     
     HashTable *redefined = hashtable_create(32);
     
+    HashTable *def_counts = hashtable_create(32);
+    count_definitions(func, def_counts);
+    
     for (size_t i = 0; i < func->instructions.size; i++)
     {
         IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
@@ -51,13 +102,14 @@ static bool optimize_function_copy_propagation(IRFunction *func)
         
         if (instr->opcode == IR_MOVE && instr->result && instr->arg1)
         {
-            if (is_simple_operand(instr->result) && is_simple_operand(instr->arg1))
+            char result_key[64];
+            get_operand_key(instr->result, result_key, sizeof(result_key));
+            char arg1_key[64];
+            get_operand_key(instr->arg1, arg1_key, sizeof(arg1_key));
+            
+            if (is_simple_operand(instr->result) && is_simple_operand(instr->arg1) &&
+                is_stable_copy(def_counts, result_key, arg1_key))
             {
-                char result_key[64];
-                get_operand_key(instr->result, result_key, sizeof(result_key));
-                char arg1_key[64];
-                get_operand_key(instr->arg1, arg1_key, sizeof(arg1_key));
-                
                 IROperand *source = (IROperand *)hashtable_get(copy_map, arg1_key);
                 if (source)
                 {
@@ -112,8 +164,6 @@ static bool optimize_function_copy_propagation(IRFunction *func)
             {
                 if (is_simple_operand(instr->result))
                 {
-                    char result_key[64];
-                    get_operand_key(instr->result, result_key, sizeof(result_key));
                     IROperand *old = (IROperand *)hashtable_get(copy_map, result_key);
                     if (old)
                     {
@@ -287,29 +337,13 @@ static bool optimize_function_copy_propagation(IRFunction *func)
     }
     hashtable_destroy(copy_map);
     hashtable_destroy(redefined);
+    hashtable_destroy(def_counts);
     
     return changed;
 }
 
 bool optimization_copy_propagation(IRProgram *program)
 {
-    if (!program)
-        return false;
-        
-    bool changed = false;
-    
-    for (size_t i = 0; i < program->functions.size; i++)
-    {
-        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
-        if (!func)
-            continue;
-            
-        if (optimize_function_copy_propagation(func))
-        {
-            changed = true;
-        }
-    }
-    
-    return changed;
+    return optimization_run_per_function(program, optimize_function_copy_propagation);
 }
 
@@ -1,4 +1,5 @@
 #include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
 #include "backend/ir/irCore.h"
 #include "backend/ir/irOps.h"
 #include "backend/ir/irinstructions.h"
@@ -53,78 +54,190 @@ static void mark_reachable_labels(IRFunction *func, HashTable *reachable_labels)
     }
 }
 
-static void analyze_uses(IRFunction *func, HashTable *used_vars, HashTable *used_temps)
+static void mark_used_var(HashTable *used_vars, IROperand *operand)
+{
+    if (operand && operand->type == IR_OP_VAR)
+    {
+        hashtable_put(used_vars, operand->data.var_name, (void *)1);
+    }
+}
+
+static void analyze_uses(IRFunction *func, HashTable *used_vars)
 {
     for (size_t i = 0; i < func->instructions.size; i++)
     {
         IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
-        if (!instr)
+        if (!instr || instr->opcode == IR_VAR_DECL)
             continue;
 
-        if (instr->arg1)
+        mark_used_var(used_vars, instr->arg1);
+        mark_used_var(used_vars, instr->arg2);
+        mark_used_var(used_vars, instr->result);
+
+        if (instr->args)
         {
-            if (instr->arg1->type == IR_OP_VAR)
-            {
-                hashtable_put(used_vars, instr->arg1->data.var_name, (void *)1);
-            }
-            else if (instr->arg1->type == IR_OP_TEMP)
+            for (size_t j = 0; j < instr->args->size; j++)
             {
-                char temp_key[32];
-                snprintf(temp_key, sizeof(temp_key), "t%d", instr->arg1->data.temp_id);
-                hashtable_put(used_temps, temp_key, (void *)1);
+                mark_used_var(used_vars, (IROperand *)array_get(instr->args, j));
             }
         }
+    }
+}
+
+static void live_add(uint64_t *live, int slot)
+{
+    if (slot >= 0)
+        live[slot / 64] |= (uint64_t)1 << (slot % 64);
+}
+
+static void live_remove(uint64_t *live, int slot)
+{
+    if (slot >= 0)
+        live[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+}
+
+static bool live_contains(const uint64_t *live, int slot)
+{
+    return slot >= 0 && (live[slot / 64] & ((uint64_t)1 << (slot % 64))) != 0;
+}
+
+static bool is_dead_store(IRInstruction *instr, const IRValueIndex *index, const uint64_t *live)
+{
+    IROperand *def = ir_instruction_def(instr);
+    if (!def || ir_instruction_has_side_effects(instr))
+        return false;
+
+    int slot = ir_value_index_of(index, def);
+    return slot >= 0 && !live_contains(live, slot);
+}
+
+static void live_transfer(IRInstruction *instr, const IRValueIndex *index, uint64_t *live, size_t words)
+{
+    if (instr->opcode == IR_INLINE_ASM)
+    {
+        memset(live, 0xff, words * sizeof(uint64_t));
+        return;
+    }
+
+    live_remove(live, ir_value_index_of(index, ir_instruction_def(instr)));
 
-        if (instr->arg2)
+    IROperand **uses[IR_MAX_INSTRUCTION_USES];
+    size_t use_count = ir_instruction_uses(instr, uses, IR_MAX_INSTRUCTION_USES);
+    for (size_t u = 0; u < use_count; u++)
+    {
+        live_add(live, ir_value_index_of(index, *uses[u]));
+    }
+}
+
+static void compute_live_out(IRBasicBlock *block, const uint64_t *live_in, uint64_t *live, size_t words)
+{
+    memset(live, 0, words * sizeof(uint64_t));
+    for (size_t s = 0; s < block->succs.size; s++)
+    {
+        IRBasicBlock *succ = (IRBasicBlock *)array_get(&block->succs, s);
+        const uint64_t *succ_in = live_in + succ->id * words;
+        for (size_t w = 0; w < words; w++)
         {
-            if (instr->arg2->type == IR_OP_VAR)
+            live[w] |= succ_in[w];
+        }
+    }
+}
+
+static void compute_liveness(IRControlFlowGraph *cfg, const IRValueIndex *index, uint64_t *live_in, size_t words)
+{
+    IRFunction *func = cfg->function;
+    uint64_t *live = safe_malloc(words * sizeof(uint64_t));
+    bool changed = true;
+
+    while (changed)
+    {
+        changed = false;
+        for (size_t b = cfg->blocks.size; b-- > 0;)
+        {
+            IRBasicBlock *block = ir_cfg_block(cfg, b);
+            compute_live_out(block, live_in, live, words);
+
+            for (size_t i = block->end; i-- > block->start;)
             {
-                hashtable_put(used_vars, instr->arg2->data.var_name, (void *)1);
+                IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+                if (instr && !is_dead_store(instr, index, live))
+                {
+                    live_transfer(instr, index, live, words);
+                }
             }
-            else if (instr->arg2->type == IR_OP_TEMP)
+
+            uint64_t *block_in = live_in + b * words;
+            if (memcmp(block_in, live, words * sizeof(uint64_t)) != 0)
             {
-                char temp_key[32];
-                snprintf(temp_key, sizeof(temp_key), "t%d", instr->arg2->data.temp_id);
-                hashtable_put(used_temps, temp_key, (void *)1);
+                memcpy(block_in, live, words * sizeof(uint64_t));
+                changed = true;
             }
         }
+    }
+    safe_free(live);
+}
 
-        if (instr->opcode == IR_PRINT || 
-            instr->opcode == IR_PRINT_MULTIPLE ||
-            instr->opcode == IR_CALL ||
-            instr->opcode == IR_RETURN ||
-            instr->opcode == IR_ARRAY_STORE ||
-            instr->opcode == IR_INLINE_ASM)
+static size_t eliminate_dead_stores(IRFunction *func)
+{
+    if (func->instructions.size == 0)
+        return 0;
+
+    IRControlFlowGraph *cfg = ir_cfg_build(func);
+    IRValueIndex *index = ir_value_index_create(func);
+    size_t words = (ir_value_index_size(index) + 63) / 64 + 1;
+    size_t block_count = cfg->blocks.size;
+
+    uint64_t *live_in = safe_malloc((block_count + 1) * words * sizeof(uint64_t));
+    memset(live_in, 0, (block_count + 1) * words * sizeof(uint64_t));
+    uint64_t *live = safe_malloc(words * sizeof(uint64_t));
+
+    compute_liveness(cfg, index, live_in, words);
+
+    size_t removed = 0;
+    for (size_t b = 0; b < block_count; b++)
+    {
+        IRBasicBlock *block = ir_cfg_block(cfg, b);
+        compute_live_out(block, live_in, live, words);
+
+        for (size_t i = block->end; i-- > block->start;)
         {
-            if (instr->result && instr->result->type == IR_OP_VAR)
-            {
-                hashtable_put(used_vars, instr->result->data.var_name, (void *)1);
-            }
-            
-            if (instr->opcode == IR_PRINT_MULTIPLE && instr->args)
+            IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+            if (!instr)
+                continue;
+
+            if (is_dead_store(instr, index, live))
             {
-                for (size_t j = 0; j < instr->args->size; j++)
+                if (debug_enabled)
                 {
-                    IROperand *arg = (IROperand *)array_get(instr->args, j);
-                    if (arg && arg->type == IR_OP_VAR)
-                    {
-                        hashtable_put(used_vars, arg->data.var_name, (void *)1);
-                    }
-                    else if (arg && arg->type == IR_OP_TEMP)
-                    {
-                        char temp_key[32];
-                        snprintf(temp_key, sizeof(temp_key), "t%d", arg->data.temp_id);
-                        hashtable_put(used_temps, temp_key, (void *)1);
-                    }
+                    printf("[DEBUG] Removing dead store at instruction %zu, opcode=%d\n", i, instr->opcode);
                 }
+                ir_instruction_destroy(instr);
+                array_set(&func->instructions, i, NULL);
+                removed++;
+                continue;
             }
+            live_transfer(instr, index, live, words);
         }
-        
-        if (instr->result && instr->result->type == IR_OP_VAR)
+    }
+
+    if (removed > 0)
+    {
+        DynamicArray kept;
+        array_init(&kept, func->instructions.size);
+        for (size_t i = 0; i < func->instructions.size; i++)
         {
-            hashtable_put(used_vars, instr->result->data.var_name, (void *)1);
+            IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+            if (instr)
+                array_push(&kept, instr);
         }
+        ir_function_replace_instructions(func, &kept);
     }
+
+    safe_free(live);
+    safe_free(live_in);
+    ir_value_index_destroy(index);
+    ir_cfg_destroy(cfg);
+    return removed;
 }
 
 static bool eliminate_dead_code(IRFunction *func)
@@ -132,11 +245,10 @@ static bool eliminate_dead_code(IRFunction *func)
     bool changed = false;
     HashTable *reachable_labels = hashtable_create(16);
     HashTable *used_vars = hashtable_create(32);
-    HashTable *used_temps = hashtable_create(32);
 
     mark_reachable_labels(func, reachable_labels);
 
-    analyze_uses(func, used_vars, used_temps);
+    analyze_uses(func, used_vars);
 
     DynamicArray new_instructions;
     size_t initial_capacity = func->instructions.size > 0 ? func->instructions.size : 16;
@@ -158,7 +270,9 @@ static bool eliminate_dead_code(IRFunction *func)
 
         if (instr->opcode == IR_LABEL && instr->label)
         {
-            if (!hashtable_contains(reachable_labels, instr->label))
+            IRInstruction *prev = new_instructions.size > 0 ? (IRInstruction *)array_get(&new_instructions, new_instructions.size - 1) : NULL;
+            bool falls_through = !prev || ir_instruction_falls_through(prev);
+            if (!hashtable_contains(reachable_labels, instr->label) && (in_unreachable_block || !falls_through))
             {
                 in_unreachable_block = true;
                 if (debug_enabled)
@@ -196,53 +310,6 @@ static bool eliminate_dead_code(IRFunction *func)
             continue;
         }
 
-        bool is_dead_assignment = false;
-        if (instr->opcode == IR_MOVE && instr->result)
-        {
-            if (instr->result->type == IR_OP_VAR)
-            {
-                if (!hashtable_contains(used_vars, instr->result->data.var_name))
-                {
-                    if (instr->arg1)
-                    {
-                        is_dead_assignment = true;
-                    }
-                }
-            }
-            else if (instr->result->type == IR_OP_TEMP)
-            {
-                char temp_key[32];
-                snprintf(temp_key, sizeof(temp_key), "t%d", instr->result->data.temp_id);
-                if (!hashtable_contains(used_temps, temp_key))
-                {
-                    if (instr->arg1)
-                    {
-                        is_dead_assignment = true;
-                    }
-                }
-            }
-        }
-        
-        if ((instr->opcode >= IR_ADD && instr->opcode <= IR_OR) && instr->result)
-        {
-            if (instr->result->type == IR_OP_VAR)
-            {
-                if (!hashtable_contains(used_vars, instr->result->data.var_name))
-                {
-                    is_dead_assignment = true;
-                }
-            }
-            else if (instr->result->type == IR_OP_TEMP)
-            {
-                char temp_key[32];
-                snprintf(temp_key, sizeof(temp_key), "t%d", instr->result->data.temp_id);
-                if (!hashtable_contains(used_temps, temp_key))
-                {
-                    is_dead_assignment = true;
-                }
-            }
-        }
-
         if (instr->opcode == IR_NOP)
         {
             if (debug_enabled)
@@ -270,32 +337,6 @@ static bool eliminate_dead_code(IRFunction *func)
             }
         }
 
-        if (is_dead_assignment)
-        {
-            if (debug_enabled)
-            {
-                printf("[DEBUG] Removing dead assignment at instruction %zu, opcode=%d\n", i, instr->opcode);
-                if (instr->result)
-                {
-                    printf("[DEBUG]   Result type=%d\n", instr->result->type);
-                }
-                if (instr->arg1)
-                {
-                    printf("[DEBUG]   Arg1 type=%d\n", instr->arg1->type);
-                }
-                fflush(stdout);
-            }
-            
-            ir_instruction_destroy(instr);
-            changed = true;
-            if (debug_enabled)
-            {
-                printf("[DEBUG] Dead assignment destroyed, continuing loop\n");
-                fflush(stdout);
-            }
-            continue;
-        }
-
         if (debug_enabled && i < 5)
         {
             printf("[DEBUG] Keeping instruction %zu, opcode=%d\n", i, instr->opcode);
@@ -327,7 +368,6 @@ static bool eliminate_dead_code(IRFunction *func)
 
     hashtable_destroy(reachable_labels);
     hashtable_destroy(used_vars);
-    hashtable_destroy(used_temps);
 
     if (debug_enabled)
     {
@@ -338,24 +378,25 @@ static bool eliminate_dead_code(IRFunction *func)
     return changed;
 }
 
-bool optimization_dead_code_elimination(IRProgram *program)
+static bool optimize_function_dead_code(IRFunction *func)
 {
-    if (!program)
-        return false;
+    bool changed = eliminate_dead_code(func);
 
-    bool changed = false;
-    for (size_t i = 0; i < program->functions.size; i++)
+    size_t removed = eliminate_dead_stores(func);
+    if (removed > 0)
     {
-        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
-        if (func)
+        if (debug_enabled)
         {
-            if (eliminate_dead_code(func))
-            {
-                changed = true;
-            }
+            printf("[DEBUG] Dead store elimination: Removed %zu stores in %s\n", removed, func->name);
         }
+        optimization_stats_add("dead stores removed", removed);
+        changed = true;
     }
-
     return changed;
 }
 
+bool optimization_dead_code_elimination(IRProgram *program)
+{
+    return optimization_run_per_function(program, optimize_function_dead_code);
+}
+
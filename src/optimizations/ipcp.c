@@ -0,0 +1,505 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+#define MAX_SPECIALIZE_SIZE 256
+#define MAX_CLONES_PER_FUNCTION 4
+#define MAX_SPECIALIZED_NAME 512
+
+typedef struct CallSite {
+    IRFunction *caller;
+    IRFunction *callee;
+    size_t call_index;
+    size_t order;
+    size_t param_count;
+    size_t param_indices[MAX_PARAMS];
+} CallSite;
+
+typedef struct CallGraph {
+    HashTable *functions;
+    HashTable *ambiguous;
+    HashTable *opaque;
+    DynamicArray sites;
+} CallGraph;
+
+static IROperand *site_arg(const CallSite *site, size_t k)
+{
+    return ir_function_instr_at(site->caller, site->param_indices[k])->arg1;
+}
+
+static IROperand *callee_param(IRFunction *callee, size_t k)
+{
+    return (IROperand *)array_get(&callee->params, k);
+}
+
+static bool is_propagatable(IROperand *arg, IROperand *param)
+{
+    if (!arg || arg->type != IR_OP_CONST || arg->is_float_const)
+        return false;
+    return param->data_type == TYPE_INT || param->data_type == TYPE_BOOL;
+}
+
+static const char *base_name(IRFunction *func)
+{
+    return func->specialized_from ? func->specialized_from : func->name;
+}
+
+static void call_graph_build(CallGraph *graph, IRProgram *program)
+{
+    graph->functions = hashtable_create(32);
+    graph->ambiguous = hashtable_create(8);
+    graph->opaque = hashtable_create(8);
+    array_init(&graph->sites, 16);
+
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        if (hashtable_contains(graph->functions, func->name))
+            hashtable_put(graph->ambiguous, func->name, (void *)1);
+        hashtable_put(graph->functions, func->name, func);
+    }
+
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *caller = (IRFunction *)array_get(&program->functions, i);
+        for (size_t j = 0; j < caller->instructions.size; j++)
+        {
+            IRInstruction *instr = ir_function_instr_at(caller, j);
+            if (!instr || instr->opcode != IR_CALL || !instr->label)
+                continue;
+
+            IRFunction *callee = (IRFunction *)hashtable_get(graph->functions, instr->label);
+            if (!callee)
+                continue;
+
+            CallSite *site = safe_malloc(sizeof(CallSite));
+            site->caller = caller;
+            site->callee = callee;
+            site->call_index = j;
+            site->order = graph->sites.size;
+            site->param_count = ir_call_collect_params(caller, j, site->param_indices, MAX_PARAMS);
+            if (site->param_count != callee->params.size)
+            {
+                hashtable_put(graph->opaque, callee->name, (void *)1);
+                safe_free(site);
+                continue;
+            }
+            array_push(&graph->sites, site);
+        }
+    }
+}
+
+static void call_graph_destroy(CallGraph *graph)
+{
+    for (size_t i = 0; i < graph->sites.size; i++)
+    {
+        safe_free(array_get(&graph->sites, i));
+    }
+    array_free(&graph->sites);
+    hashtable_destroy(graph->functions);
+    hashtable_destroy(graph->ambiguous);
+    hashtable_destroy(graph->opaque);
+}
+
+static bool can_rewrite(CallGraph *graph, IRFunction *callee)
+{
+    return !string_equal(callee->name, "main") &&
+           !hashtable_contains(graph->ambiguous, callee->name) &&
+           !hashtable_contains(graph->opaque, callee->name);
+}
+
+static void remove_param_instruction(IRFunction *caller, size_t index)
+{
+    IRInstruction *param = ir_function_instr_at(caller, index);
+    ir_operand_destroy(param->arg1);
+    param->arg1 = NULL;
+    param->opcode = IR_NOP;
+}
+
+/* Rebuilds the parameter list of `func`, turning every parameter whose
+   slot in `constants` is set into a local initialised with that constant. */
+static void bind_constant_params(IRFunction *func, IROperand **constants, size_t param_count)
+{
+    DynamicArray params;
+    DynamicArray out;
+    array_init(&params, param_count > 0 ? param_count : 1);
+    array_init(&out, func->instructions.size + 2 * param_count);
+
+    for (size_t k = 0; k < param_count; k++)
+    {
+        IROperand *param = callee_param(func, k);
+        if (!constants[k])
+        {
+            array_push(&params, param);
+            continue;
+        }
+
+        IROperand *var = ir_operand_var(param->data.var_name);
+        var->data_type = param->data_type;
+        IROperand *value = ir_operand_copy(constants[k]);
+        value->data_type = param->data_type;
+        array_push(&out, ir_instruction_var_decl(param->data.var_name, param->data_type));
+        array_push(&out, ir_instruction_move(var, value));
+        ir_operand_destroy(param);
+    }
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        array_push(&out, ir_function_instr_at(func, i));
+    }
+
+    array_free(&func->params);
+    func->params = params;
+    ir_function_replace_instructions(func, &out);
+}
+
+/* Returns the constants that every call site of `callee` agrees on, or
+   NULL when no parameter can be bound. */
+static IROperand **find_agreed_constants(CallGraph *graph, IRFunction *callee)
+{
+    size_t param_count = callee->params.size;
+    if (param_count == 0 || !can_rewrite(graph, callee))
+        return NULL;
+
+    IROperand *agreed[MAX_PARAMS];
+    bool any_site = false;
+    for (size_t s = 0; s < graph->sites.size; s++)
+    {
+        CallSite *site = (CallSite *)array_get(&graph->sites, s);
+        if (site->callee != callee)
+            continue;
+
+        for (size_t k = 0; k < param_count; k++)
+        {
+            IROperand *arg = site_arg(site, k);
+            if (!any_site)
+            {
+                agreed[k] = is_propagatable(arg, callee_param(callee, k)) ? arg : NULL;
+            }
+            else if (agreed[k] && (!is_propagatable(arg, callee_param(callee, k)) ||
+                                   arg->data.const_value != agreed[k]->data.const_value))
+            {
+                agreed[k] = NULL;
+            }
+        }
+        any_site = true;
+    }
+    if (!any_site)
+        return NULL;
+
+    size_t bound = 0;
+    for (size_t k = 0; k < param_count; k++)
+    {
+        if (agreed[k])
+            bound++;
+    }
+    if (bound == 0)
+        return NULL;
+
+    if (debug_enabled)
+    {
+        printf("[DEBUG] IPCP: Binding %zu constant parameter(s) of %s\n", bound, callee->name);
+    }
+    optimization_stats_add("constant parameters propagated", bound);
+
+    IROperand **constants = safe_malloc(param_count * sizeof(IROperand *));
+    for (size_t k = 0; k < param_count; k++)
+    {
+        constants[k] = agreed[k] ? ir_operand_copy(agreed[k]) : NULL;
+    }
+    return constants;
+}
+
+static bool propagate_agreed_constants(CallGraph *graph, IRProgram *program)
+{
+    size_t count = program->functions.size;
+    if (count == 0)
+        return false;
+
+    IROperand ***bindings = safe_malloc(count * sizeof(IROperand **));
+    bool changed = false;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        bindings[i] = find_agreed_constants(graph, (IRFunction *)array_get(&program->functions, i));
+        changed = changed || bindings[i];
+    }
+
+    /* PARAM removal keeps instruction positions stable; binding prepends
+       to the callee, so it runs only once every site has been rewritten. */
+    for (size_t s = 0; s < graph->sites.size; s++)
+    {
+        CallSite *site = (CallSite *)array_get(&graph->sites, s);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!bindings[i] || array_get(&program->functions, i) != site->callee)
+                continue;
+            for (size_t k = 0; k < site->param_count; k++)
+            {
+                if (bindings[i][k])
+                    remove_param_instruction(site->caller, site->param_indices[k]);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!bindings[i])
+            continue;
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        size_t param_count = func->params.size;
+        bind_constant_params(func, bindings[i], param_count);
+        for (size_t k = 0; k < param_count; k++)
+        {
+            ir_operand_destroy(bindings[i][k]);
+        }
+        safe_free(bindings[i]);
+    }
+    safe_free(bindings);
+    return changed;
+}
+
+static bool specialized_name(const CallSite *site, char *name, size_t size)
+{
+    int written = snprintf(name, size, "%s_", site->callee->name);
+    bool any_constant = false;
+
+    for (size_t k = 0; k < site->param_count && written > 0 && (size_t)written < size; k++)
+    {
+        IROperand *arg = site_arg(site, k);
+        int n;
+        if (is_propagatable(arg, callee_param(site->callee, k)))
+        {
+            int64_t value = arg->data.const_value;
+            if (value < 0)
+                n = snprintf(name + written, size - (size_t)written, "_m%llu",
+                             (unsigned long long)(0 - (uint64_t)value));
+            else
+                n = snprintf(name + written, size - (size_t)written, "_%lld", (long long)value);
+            any_constant = true;
+        }
+        else
+        {
+            n = snprintf(name + written, size - (size_t)written, "_x");
+        }
+        written = n < 0 ? -1 : written + n;
+    }
+    return any_constant && written > 0 && (size_t)written < size;
+}
+
+static IRFunction *clone_specialized(const CallSite *site, const char *name)
+{
+    IRFunction *callee = site->callee;
+    IRFunction *clone = ir_function_create(name, callee->return_type);
+    clone->specialized_from = string_copy(callee->name);
+    clone->temp_counter = callee->temp_counter;
+    clone->label_counter = callee->label_counter;
+    if (callee->oob_error_label)
+        clone->oob_error_label = string_copy(callee->oob_error_label);
+
+    IROperand *constants[MAX_PARAMS];
+    for (size_t k = 0; k < callee->params.size; k++)
+    {
+        IROperand *arg = site_arg(site, k);
+        constants[k] = is_propagatable(arg, callee_param(callee, k)) ? arg : NULL;
+        array_push(&clone->params, ir_operand_copy(callee_param(callee, k)));
+    }
+    for (size_t i = 0; i < callee->instructions.size; i++)
+    {
+        array_push(&clone->instructions, ir_instruction_clone(ir_function_instr_at(callee, i)));
+    }
+
+    bind_constant_params(clone, constants, callee->params.size);
+    return clone;
+}
+
+static void retarget_call(const CallSite *site, const char *name)
+{
+    IRInstruction *call = ir_function_instr_at(site->caller, site->call_index);
+    for (size_t k = 0; k < site->param_count; k++)
+    {
+        if (is_propagatable(site_arg(site, k), callee_param(site->callee, k)))
+            remove_param_instruction(site->caller, site->param_indices[k]);
+    }
+    safe_free(call->label);
+    call->label = string_copy(name);
+}
+
+/* Call count recorded by the profile; sites without one are treated as hot. */
+static uint64_t site_heat(const CallSite *site)
+{
+    IRInstruction *call = ir_function_instr_at(site->caller, site->call_index);
+    return call->has_profile ? call->profile_count : UINT64_MAX;
+}
+
+static int compare_site_heat(const void *a, const void *b)
+{
+    const CallSite *left = *(const CallSite *const *)a;
+    const CallSite *right = *(const CallSite *const *)b;
+    uint64_t left_heat = site_heat(left);
+    uint64_t right_heat = site_heat(right);
+    if (left_heat != right_heat)
+        return left_heat > right_heat ? -1 : 1;
+    return left->order < right->order ? -1 : (left->order > right->order ? 1 : 0);
+}
+
+static bool specialize_call_sites(CallGraph *graph, IRProgram *program, HashTable *retargeted)
+{
+    bool changed = false;
+    HashTable *clone_counts = hashtable_create(16);
+    size_t growth = 0;
+
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        if (!func->specialized_from)
+            continue;
+        intptr_t count = (intptr_t)hashtable_get(clone_counts, func->specialized_from);
+        hashtable_put(clone_counts, func->specialized_from, (void *)(count + 1));
+        growth += func->instructions.size;
+    }
+
+    /* With a profile the clone budget goes to the hottest sites first and
+       sites that never ran are left alone. */
+    if (graph->sites.size > 1)
+        qsort(graph->sites.data, graph->sites.size, sizeof(void *), compare_site_heat);
+
+    char name[MAX_SPECIALIZED_NAME];
+    for (size_t s = 0; s < graph->sites.size; s++)
+    {
+        CallSite *site = (CallSite *)array_get(&graph->sites, s);
+        IRFunction *callee = site->callee;
+        if (site_heat(site) == 0 || !can_rewrite(graph, callee) || callee->specialized_from ||
+            string_equal(base_name(site->caller), callee->name) ||
+            callee->instructions.size > MAX_SPECIALIZE_SIZE ||
+            !specialized_name(site, name, sizeof(name)))
+            continue;
+
+        IRFunction *clone = (IRFunction *)hashtable_get(graph->functions, name);
+        if (clone && !string_equal(clone->specialized_from, callee->name))
+            continue;
+
+        if (!clone)
+        {
+            intptr_t count = (intptr_t)hashtable_get(clone_counts, callee->name);
+            if (count >= MAX_CLONES_PER_FUNCTION ||
+                growth + callee->instructions.size > (size_t)optimization_options.clone_budget)
+            {
+                if (debug_enabled)
+                {
+                    printf("[DEBUG] IPCP: Clone budget exhausted for %s\n", name);
+                }
+                continue;
+            }
+
+            if (debug_enabled)
+            {
+                printf("[DEBUG] IPCP: Specializing %s as %s\n", callee->name, name);
+            }
+            clone = clone_specialized(site, name);
+            ir_program_add_function(program, clone);
+            hashtable_put(graph->functions, clone->name, clone);
+            hashtable_put(clone_counts, callee->name, (void *)(count + 1));
+            growth += clone->instructions.size;
+            optimization_stats_add("functions specialized", 1);
+        }
+
+        retarget_call(site, clone->name);
+        hashtable_put(retargeted, callee->name, (void *)1);
+        optimization_stats_add("call sites specialized", 1);
+        changed = true;
+    }
+
+    hashtable_destroy(clone_counts);
+    return changed;
+}
+
+static void mark_reachable(HashTable *functions, HashTable *reachable, IRFunction *func)
+{
+    if (hashtable_contains(reachable, func->name))
+        return;
+    hashtable_put(reachable, func->name, (void *)1);
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (!instr || instr->opcode != IR_CALL || !instr->label)
+            continue;
+        IRFunction *callee = (IRFunction *)hashtable_get(functions, instr->label);
+        if (callee)
+            mark_reachable(functions, reachable, callee);
+    }
+}
+
+/* Drops clones and fully specialized originals that main can no longer
+   reach. Other uncalled functions are left alone. */
+static bool remove_dead_functions(CallGraph *graph, IRProgram *program, HashTable *retargeted)
+{
+    IRFunction *main_func = (IRFunction *)hashtable_get(graph->functions, "main");
+    if (!main_func || hashtable_contains(graph->ambiguous, "main"))
+        return false;
+
+    HashTable *reachable = hashtable_create(32);
+    mark_reachable(graph->functions, reachable, main_func);
+
+    DynamicArray kept;
+    array_init(&kept, program->functions.size);
+    bool changed = false;
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        bool removable = func->specialized_from || hashtable_contains(retargeted, func->name);
+        if (!removable || hashtable_contains(reachable, func->name) ||
+            hashtable_contains(graph->ambiguous, func->name))
+        {
+            array_push(&kept, func);
+            continue;
+        }
+
+        if (debug_enabled)
+        {
+            printf("[DEBUG] IPCP: Removing unreachable function %s\n", func->name);
+        }
+        hashtable_remove(graph->functions, func->name);
+        ir_function_destroy(func);
+        optimization_stats_add("functions removed", 1);
+        changed = true;
+    }
+
+    array_free(&program->functions);
+    program->functions = kept;
+    hashtable_destroy(reachable);
+    return changed;
+}
+
+bool optimization_interprocedural_constants(IRProgram *program)
+{
+    if (!program)
+        return false;
+
+    CallGraph graph;
+    call_graph_build(&graph, program);
+
+    bool changed = propagate_agreed_constants(&graph, program);
+
+    /* Binding parameters invalidates the recorded PARAM positions, so
+       specialization waits for the next pipeline iteration. */
+    if (!changed && optimization_options.level >= 2 && optimization_options.clone_budget > 0)
+    {
+        HashTable *retargeted = hashtable_create(8);
+        if (specialize_call_sites(&graph, program, retargeted))
+        {
+            remove_dead_functions(&graph, program, retargeted);
+            changed = true;
+        }
+        hashtable_destroy(retargeted);
+    }
+
+    call_graph_destroy(&graph);
+    return changed;
+}
@@ -0,0 +1,195 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+static HashTable *label_positions(IRFunction *func)
+{
+    HashTable *positions = hashtable_create(32);
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (instr->opcode == IR_LABEL && instr->label)
+            hashtable_put(positions, instr->label, (void *)(intptr_t)(i + 1));
+    }
+    return positions;
+}
+
+static bool find_label(HashTable *positions, const char *label, size_t *position)
+{
+    intptr_t entry = label ? (intptr_t)hashtable_get(positions, label) : 0;
+    if (entry <= 0)
+        return false;
+    *position = (size_t)(entry - 1);
+    return true;
+}
+
+/* The region [start, end) can only be moved if nothing outside of it jumps
+   into it and it declares no variables. */
+static bool region_is_movable(IRFunction *func, size_t start, size_t end)
+{
+    HashTable *inner_labels = hashtable_create(8);
+    bool movable = true;
+    for (size_t i = start; i < end && movable; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (instr->opcode == IR_VAR_DECL || instr->opcode == IR_ARRAY_DECL || instr->opcode == IR_INLINE_ASM)
+            movable = false;
+        else if (instr->opcode == IR_LABEL && instr->label)
+            hashtable_put(inner_labels, instr->label, (void *)1);
+    }
+    for (size_t i = 0; i < func->instructions.size && movable; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if ((i < start || i >= end) && ir_instruction_references_label(instr) &&
+            hashtable_contains(inner_labels, instr->label))
+            movable = false;
+    }
+    hashtable_destroy(inner_labels);
+    return movable;
+}
+
+/* A branch that is almost always taken skips over code that rarely runs.
+   That code is moved to the end of the function and the branch inverted,
+   so the hot path falls through:
+
+     if (!c) goto L; <cold> L:   becomes   if (c) goto C; L: ... C: <cold> goto L; */
+static bool move_cold_fallthrough(IRFunction *func, HashTable *positions, size_t index)
+{
+    IRInstruction *branch = ir_function_instr_at(func, index);
+    size_t target;
+    if (!ir_instruction_is_conditional_branch(branch) || ir_instruction_branch_bias(branch) != 1 ||
+        !find_label(positions, branch->label, &target) || target <= index + 1 ||
+        !region_is_movable(func, index + 1, target))
+        return false;
+
+    if (debug_enabled)
+    {
+        printf("[DEBUG] Block layout: Moving cold code after branch to %s in %s\n", branch->label, func->name);
+    }
+
+    char *cold_label = ir_function_new_label(func);
+    bool needs_jump = ir_instruction_falls_through(ir_function_instr_at(func, target - 1));
+
+    DynamicArray out;
+    array_init(&out, func->instructions.size + 2);
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        if (i <= index || i >= target)
+            array_push(&out, ir_function_instr_at(func, i));
+    }
+    IRInstruction *label = ir_instruction_label(cold_label);
+    label->is_cold = true;
+    array_push(&out, label);
+    for (size_t i = index + 1; i < target; i++)
+    {
+        array_push(&out, ir_function_instr_at(func, i));
+    }
+    if (needs_jump)
+        array_push(&out, ir_instruction_jump(branch->label));
+
+    branch->opcode = branch->opcode == IR_JUMP_IF ? IR_JUMP_IF_FALSE : IR_JUMP_IF;
+    branch->profile_taken = branch->profile_count - branch->profile_taken;
+    branch->is_cold = true;
+    safe_free(branch->label);
+    branch->label = cold_label;
+
+    ir_function_replace_instructions(func, &out);
+    optimization_stats_add("cold blocks moved", 1);
+    return true;
+}
+
+/* The target of a branch that is almost never taken is moved to the end of
+   the function, provided nothing falls into it and it ends in a jump or
+   return. */
+static bool move_cold_target(IRFunction *func, HashTable *positions, size_t index)
+{
+    IRInstruction *branch = ir_function_instr_at(func, index);
+    size_t start;
+    if (!ir_instruction_is_conditional_branch(branch) || ir_instruction_branch_bias(branch) != -1 ||
+        !find_label(positions, branch->label, &start) || start == 0)
+        return false;
+    if (ir_function_instr_at(func, start)->is_cold ||
+        ir_instruction_falls_through(ir_function_instr_at(func, start - 1)))
+        return false;
+
+    size_t end = start + 1;
+    while (end < func->instructions.size && ir_instruction_falls_through(ir_function_instr_at(func, end)))
+        end++;
+    if (end + 1 >= func->instructions.size || !region_is_movable(func, start + 1, end + 1))
+        return false;
+
+    /* A return reached on every call is the exit of a loop, not cold code. */
+    IRInstruction *label = ir_function_instr_at(func, start);
+    if (ir_function_instr_at(func, end)->opcode == IR_RETURN && label->has_profile && func->has_profile &&
+        label->profile_count >= func->profile_count)
+        return false;
+
+    if (debug_enabled)
+    {
+        printf("[DEBUG] Block layout: Moving cold block %s to the end of %s\n", branch->label, func->name);
+    }
+
+    DynamicArray out;
+    array_init(&out, func->instructions.size);
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        if (i < start || i > end)
+            array_push(&out, ir_function_instr_at(func, i));
+    }
+    for (size_t i = start; i <= end; i++)
+    {
+        array_push(&out, ir_function_instr_at(func, i));
+    }
+    label->is_cold = true;
+
+    ir_function_replace_instructions(func, &out);
+    optimization_stats_add("cold blocks moved", 1);
+    return true;
+}
+
+/* Branches into a cold block are unlikely to be taken. */
+static void mark_cold_branches(IRFunction *func, HashTable *positions)
+{
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        size_t target;
+        if (ir_instruction_is_conditional_branch(instr) && !instr->is_cold &&
+            find_label(positions, instr->label, &target) && ir_function_instr_at(func, target)->is_cold)
+            instr->is_cold = true;
+    }
+}
+
+static bool layout_function(IRFunction *func)
+{
+    size_t count = func->instructions.size;
+    if (count == 0 || ir_instruction_falls_through(ir_function_instr_at(func, count - 1)))
+        return false;
+
+    /* Moved blocks are marked cold and are not biased the other way, so
+       every block moves at most once. */
+    bool changed = false;
+    HashTable *positions = label_positions(func);
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        if (move_cold_fallthrough(func, positions, i) || move_cold_target(func, positions, i))
+        {
+            hashtable_destroy(positions);
+            positions = label_positions(func);
+            changed = true;
+        }
+    }
+    mark_cold_branches(func, positions);
+    hashtable_destroy(positions);
+    return changed;
+}
+
+bool optimization_block_layout(IRProgram *program)
+{
+    return optimization_run_per_function(program, layout_function);
+}
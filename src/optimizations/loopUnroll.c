@@ -0,0 +1,326 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "optimizations/loops.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+#define MAX_FULL_UNROLL_TRIPS 16
+#define MAX_FULL_UNROLL_SIZE 256
+#define MAX_PARTIAL_UNROLL_SIZE 512
+#define COLD_LOOP_HEADER_COUNT 64
+
+static bool compare_holds(IROpcode opcode, int64_t value, int64_t bound)
+{
+    switch (opcode)
+    {
+    case IR_NE:
+        return value != bound;
+    case IR_LT:
+        return value < bound;
+    case IR_LE:
+        return value <= bound;
+    case IR_GT:
+        return value > bound;
+    case IR_GE:
+        return value >= bound;
+    default:
+        return false;
+    }
+}
+
+static bool limit_fits(int64_t bound, int64_t offset)
+{
+    return offset > 0 ? bound >= INT64_MIN + offset : bound <= INT64_MAX + offset;
+}
+
+static bool compute_trip_count(IRFunction *func, const CountedLoop *loop, size_t *trips)
+{
+    int64_t value;
+    if (!ir_operand_is_int_const(loop->bound) || !ir_loop_initial_value(func, loop, &value))
+        return false;
+
+    size_t count = 0;
+    while (compare_holds(loop->compare, value, loop->bound->data.const_value))
+    {
+        if (++count > MAX_FULL_UNROLL_TRIPS)
+            return false;
+        value = (int64_t)((uint64_t)value + (uint64_t)loop->step);
+    }
+    *trips = count;
+    return true;
+}
+
+static void mark_outside_temps(IRFunction *func, const CountedLoop *loop, HashTable *outside)
+{
+    char key[32];
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        if (i >= loop->body_start && i < loop->latch)
+            continue;
+
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        IROperand *operands[3] = {instr->result, instr->arg1, instr->arg2};
+        for (size_t k = 0; k < 3; k++)
+        {
+            if (operands[k] && operands[k]->type == IR_OP_TEMP)
+            {
+                snprintf(key, sizeof(key), "%d", operands[k]->data.temp_id);
+                hashtable_put(outside, key, (void *)1);
+            }
+        }
+        if (instr->args)
+        {
+            for (size_t k = 0; k < instr->args->size; k++)
+            {
+                IROperand *arg = (IROperand *)array_get(instr->args, k);
+                if (arg && arg->type == IR_OP_TEMP)
+                {
+                    snprintf(key, sizeof(key), "%d", arg->data.temp_id);
+                    hashtable_put(outside, key, (void *)1);
+                }
+            }
+        }
+    }
+}
+
+static void rename_temp(HashTable *temps, IROperand *operand)
+{
+    if (!operand || operand->type != IR_OP_TEMP)
+        return;
+
+    char key[32];
+    snprintf(key, sizeof(key), "%d", operand->data.temp_id);
+    intptr_t renamed = (intptr_t)hashtable_get(temps, key);
+    if (renamed > 0)
+        operand->data.temp_id = (int)(renamed - 1);
+}
+
+static void free_label_map(HashTable *labels)
+{
+    for (size_t i = 0; i < labels->capacity; i++)
+    {
+        for (HashTableEntry *entry = labels->buckets[i]; entry; entry = entry->next)
+        {
+            safe_free(entry->value);
+        }
+    }
+    hashtable_destroy(labels);
+}
+
+static void append_body_copy(IRFunction *func, const CountedLoop *loop, HashTable *outside_temps,
+                             DynamicArray *out)
+{
+    HashTable *labels = hashtable_create(16);
+    HashTable *temps = hashtable_create(32);
+    char key[32];
+
+    for (size_t i = loop->body_start; i < loop->latch; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (instr->opcode == IR_LABEL)
+        {
+            hashtable_put(labels, instr->label, ir_function_new_label(func));
+        }
+
+        IROperand *def = ir_instruction_def(instr);
+        if (def && def->type == IR_OP_TEMP)
+        {
+            snprintf(key, sizeof(key), "%d", def->data.temp_id);
+            if (!hashtable_contains(outside_temps, key) && !hashtable_contains(temps, key))
+            {
+                hashtable_put(temps, key, (void *)(intptr_t)(ir_function_new_temp(func) + 1));
+            }
+        }
+    }
+
+    for (size_t i = loop->body_start; i < loop->latch; i++)
+    {
+        IRInstruction *copy = ir_instruction_clone(ir_function_instr_at(func, i));
+        if (copy->label && (copy->opcode == IR_LABEL || ir_instruction_is_branch(copy)))
+        {
+            const char *renamed = (const char *)hashtable_get(labels, copy->label);
+            if (renamed)
+            {
+                safe_free(copy->label);
+                copy->label = string_copy(renamed);
+            }
+        }
+
+        rename_temp(temps, copy->result);
+        rename_temp(temps, copy->arg1);
+        rename_temp(temps, copy->arg2);
+        if (copy->args)
+        {
+            for (size_t k = 0; k < copy->args->size; k++)
+            {
+                rename_temp(temps, (IROperand *)array_get(copy->args, k));
+            }
+        }
+        array_push(out, copy);
+    }
+
+    free_label_map(labels);
+    hashtable_destroy(temps);
+}
+
+static void fully_unroll(IRFunction *func, const CountedLoop *loop, size_t trips)
+{
+    HashTable *outside_temps = hashtable_create(64);
+    mark_outside_temps(func, loop, outside_temps);
+
+    DynamicArray out;
+    array_init(&out, func->instructions.size + trips * (loop->latch - loop->body_start));
+    for (size_t i = 0; i < loop->header; i++)
+    {
+        array_push(&out, ir_function_instr_at(func, i));
+    }
+    for (size_t t = 0; t < trips; t++)
+    {
+        append_body_copy(func, loop, outside_temps, &out);
+    }
+    for (size_t i = loop->header; i <= loop->latch; i++)
+    {
+        ir_instruction_destroy(ir_function_instr_at(func, i));
+    }
+    for (size_t i = loop->latch + 1; i < func->instructions.size; i++)
+    {
+        array_push(&out, ir_function_instr_at(func, i));
+    }
+
+    hashtable_destroy(outside_temps);
+    ir_function_replace_instructions(func, &out);
+}
+
+static void partially_unroll(IRFunction *func, const CountedLoop *loop, int factor)
+{
+    HashTable *outside_temps = hashtable_create(64);
+    mark_outside_temps(func, loop, outside_temps);
+
+    char *group_label = ir_function_new_label(func);
+    char *remainder_label = ir_function_new_label(func);
+
+    DynamicArray out;
+    array_init(&out, func->instructions.size + (size_t)factor * (loop->latch - loop->body_start) + 9);
+    for (size_t i = 0; i < loop->header; i++)
+    {
+        array_push(&out, ir_function_instr_at(func, i));
+    }
+
+    /* A group runs while iv + offset still passes the test. Comparing iv
+       against bound - offset instead cannot overflow; when bound - offset
+       itself would wrap, only the remainder loop runs. */
+    int64_t offset = loop->step * (factor - 1);
+    IROperand *limit;
+    if (ir_operand_is_int_const(loop->bound))
+    {
+        limit = ir_operand_const(loop->bound->data.const_value - offset);
+        limit->data_type = TYPE_INT;
+    }
+    else
+    {
+        IROperand *fits = ir_operand_temp(ir_function_new_temp(func));
+        fits->data_type = TYPE_BOOL;
+        IROperand *edge = ir_operand_const(offset > 0 ? INT64_MIN + offset : INT64_MAX + offset);
+        edge->data_type = TYPE_INT;
+        IROperand *amount = ir_operand_const(offset);
+        amount->data_type = TYPE_INT;
+        limit = ir_operand_temp(ir_function_new_temp(func));
+        limit->data_type = TYPE_INT;
+
+        array_push(&out, ir_instruction_binary(offset > 0 ? IR_GE : IR_LE, fits, ir_operand_copy(loop->bound),
+                                               edge));
+        array_push(&out, ir_instruction_jump_if_false(ir_operand_copy(fits), remainder_label));
+        array_push(&out, ir_instruction_binary(IR_SUB, ir_operand_copy(limit), ir_operand_copy(loop->bound),
+                                               amount));
+    }
+    IROperand *condition = ir_operand_temp(ir_function_new_temp(func));
+    condition->data_type = TYPE_BOOL;
+
+    array_push(&out, ir_instruction_label(group_label));
+    array_push(&out, ir_instruction_binary(loop->compare, condition, ir_operand_copy(loop->iv),
+                                           ir_operand_copy(limit)));
+    array_push(&out, ir_instruction_jump_if_false(ir_operand_copy(condition), remainder_label));
+    for (int k = 0; k < factor; k++)
+    {
+        append_body_copy(func, loop, outside_temps, &out);
+    }
+    array_push(&out, ir_instruction_jump(group_label));
+    array_push(&out, ir_instruction_label(remainder_label));
+    ir_operand_destroy(limit);
+
+    for (size_t i = loop->header; i < func->instructions.size; i++)
+    {
+        array_push(&out, ir_function_instr_at(func, i));
+    }
+
+    safe_free(group_label);
+    safe_free(remainder_label);
+    hashtable_destroy(outside_temps);
+    ir_function_replace_instructions(func, &out);
+}
+
+static bool unroll_function_loops(IRFunction *func)
+{
+    bool changed = false;
+    int factor = optimization_options.unroll_factor;
+    if (factor <= 0)
+        return false;
+
+    for (size_t h = func->instructions.size; h-- > 0;)
+    {
+        CountedLoop loop;
+        if (!ir_loop_match_counted(func, h, &loop) || ir_function_instr_at(func, h)->is_epilogue)
+            continue;
+
+        size_t body_size = loop.latch - loop.body_start;
+        size_t trips = 0;
+        if (compute_trip_count(func, &loop, &trips) && trips * body_size <= MAX_FULL_UNROLL_SIZE)
+        {
+            if (debug_enabled)
+            {
+                printf("[DEBUG] Loop unrolling: Fully unrolling loop at %zu in %s (%zu iterations)\n",
+                       h, func->name, trips);
+            }
+            fully_unroll(func, &loop, trips);
+            optimization_stats_add("loops fully unrolled", 1);
+            changed = true;
+            continue;
+        }
+
+        bool ascending = (loop.compare == IR_LT || loop.compare == IR_LE) && loop.step > 0;
+        bool descending = (loop.compare == IR_GT || loop.compare == IR_GE) && loop.step < 0;
+        if (factor < 2 || !(ascending || descending) || body_size * (size_t)factor > MAX_PARTIAL_UNROLL_SIZE)
+            continue;
+        if (loop.step > INT32_MAX / factor || loop.step < INT32_MIN / factor)
+            continue;
+        if (ir_operand_is_int_const(loop.bound) &&
+            !limit_fits(loop.bound->data.const_value, loop.step * (factor - 1)))
+            continue;
+
+        /* Loops the profile shows to be cold are not worth the code growth. */
+        IRInstruction *header = ir_function_instr_at(func, loop.header);
+        if (header->has_profile && header->profile_count < COLD_LOOP_HEADER_COUNT)
+        {
+            optimization_stats_add("cold loops not unrolled", 1);
+            continue;
+        }
+
+        if (debug_enabled)
+        {
+            printf("[DEBUG] Loop unrolling: Unrolling loop at %zu in %s by %d\n", h, func->name, factor);
+        }
+        partially_unroll(func, &loop, factor);
+        optimization_stats_add("loops partially unrolled", 1);
+        changed = true;
+    }
+    return changed;
+}
+
+bool optimization_loop_unrolling(IRProgram *program)
+{
+    return optimization_run_per_function(program, unroll_function_loops);
+}
@@ -0,0 +1,166 @@
+#include "optimizations/loops.h"
+#include "optimizations/cfg.h"
+#include "common/common.h"
+
+bool ir_operand_is_int_const(const IROperand *operand)
+{
+    return operand && operand->type == IR_OP_CONST && !operand->is_float_const &&
+           operand->data_type != TYPE_FLOAT && operand->data_type != TYPE_DOUBLE;
+}
+
+static size_t count_label_references(IRFunction *func, const char *label)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (ir_instruction_is_branch(instr) && string_equal(instr->label, label))
+            count++;
+    }
+    return count;
+}
+
+static bool match_step(IRInstruction *instr, const IROperand *iv, int64_t *step)
+{
+    if (!instr || (instr->opcode != IR_ADD && instr->opcode != IR_SUB))
+        return false;
+
+    if (ir_operand_same(instr->arg1, iv) && ir_operand_is_int_const(instr->arg2))
+    {
+        *step = instr->opcode == IR_ADD ? instr->arg2->data.const_value : -instr->arg2->data.const_value;
+        return true;
+    }
+    if (instr->opcode == IR_ADD && ir_operand_is_int_const(instr->arg1) && ir_operand_same(instr->arg2, iv))
+    {
+        *step = instr->arg1->data.const_value;
+        return true;
+    }
+    return false;
+}
+
+static bool match_induction_update(IRFunction *func, CountedLoop *loop, size_t update)
+{
+    IRInstruction *instr = ir_function_instr_at(func, update);
+    loop->update_start = update;
+    loop->update_end = update + 1;
+    if (match_step(instr, loop->iv, &loop->step))
+        return true;
+
+    if (instr->opcode == IR_MOVE && instr->arg1 && instr->arg1->type == IR_OP_TEMP && update > loop->body_start)
+    {
+        IRInstruction *prev = ir_function_instr_at(func, update - 1);
+        loop->update_start = update - 1;
+        return ir_operand_same(prev->result, instr->arg1) && match_step(prev, loop->iv, &loop->step);
+    }
+    return false;
+}
+
+static bool label_in_range(IRFunction *func, const char *label, size_t start, size_t end)
+{
+    for (size_t i = start; i < end; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (instr->opcode == IR_LABEL && string_equal(instr->label, label))
+            return true;
+    }
+    return false;
+}
+
+bool ir_loop_match_counted(IRFunction *func, size_t header, CountedLoop *loop)
+{
+    size_t count = func->instructions.size;
+    IRInstruction *label = ir_function_instr_at(func, header);
+    if (!label || label->opcode != IR_LABEL || header + 3 >= count)
+        return false;
+    if (count_label_references(func, label->label) != 1)
+        return false;
+
+    size_t latch = header + 3;
+    while (latch + 1 < count)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, latch);
+        if (instr->opcode == IR_JUMP && string_equal(instr->label, label->label))
+            break;
+        latch++;
+    }
+    if (latch + 1 >= count || latch == header + 3)
+        return false;
+
+    IRInstruction *compare = ir_function_instr_at(func, header + 1);
+    IRInstruction *exit_branch = ir_function_instr_at(func, header + 2);
+    IRInstruction *exit_label = ir_function_instr_at(func, latch + 1);
+    if (compare->opcode < IR_NE || compare->opcode > IR_GE)
+        return false;
+    if (!compare->result || compare->result->type != IR_OP_TEMP)
+        return false;
+    if (!compare->arg1 || compare->arg1->type != IR_OP_VAR || compare->arg1->data_type != TYPE_INT)
+        return false;
+    if (!ir_operand_is_int_const(compare->arg2) &&
+        !(compare->arg2 && compare->arg2->type == IR_OP_VAR && compare->arg2->data_type == TYPE_INT &&
+          !ir_operand_same(compare->arg1, compare->arg2)))
+        return false;
+    if (exit_branch->opcode != IR_JUMP_IF_FALSE || !ir_operand_same(exit_branch->arg1, compare->result))
+        return false;
+    if (exit_label->opcode != IR_LABEL || !string_equal(exit_label->label, exit_branch->label))
+        return false;
+
+    loop->header = header;
+    loop->latch = latch;
+    loop->body_start = header + 3;
+    loop->compare = compare->opcode;
+    loop->iv = compare->arg1;
+    loop->bound = compare->arg2;
+    loop->exit_label = exit_branch->label;
+
+    size_t update = 0;
+    bool found_update = false;
+    bool straight_line = true;
+    for (size_t i = loop->body_start; i < latch; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (instr->opcode == IR_INLINE_ASM)
+            return false;
+        if (ir_instruction_is_branch(instr) && string_equal(instr->label, label->label))
+            return false;
+
+        IROperand *def = ir_instruction_def(instr);
+        if (def && ir_operand_same(def, loop->bound))
+            return false;
+        if (def && ir_operand_same(def, loop->iv))
+        {
+            if (found_update || !straight_line)
+                return false;
+            found_update = true;
+            update = i;
+        }
+
+        if (instr->opcode == IR_LABEL ||
+            (ir_instruction_is_branch(instr) && label_in_range(func, instr->label, loop->body_start, latch)))
+        {
+            straight_line = false;
+        }
+    }
+
+    return found_update && match_induction_update(func, loop, update) && loop->step != 0;
+}
+
+bool ir_loop_initial_value(IRFunction *func, const CountedLoop *loop, int64_t *value)
+{
+    for (size_t i = loop->header; i-- > 0;)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (instr->opcode == IR_LABEL || ir_instruction_is_branch(instr) ||
+            instr->opcode == IR_RETURN || instr->opcode == IR_INLINE_ASM)
+            return false;
+
+        IROperand *def = ir_instruction_def(instr);
+        if (def && ir_operand_same(def, loop->iv))
+        {
+            if (instr->opcode != IR_MOVE || !ir_operand_is_int_const(instr->arg1))
+                return false;
+            *value = instr->arg1->data.const_value;
+            return true;
+        }
+    }
+    return false;
+}
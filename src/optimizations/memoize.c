@@ -0,0 +1,49 @@
+#include "optimizations/optimizer.h"
+#include "backend/ir/irCore.h"
+#include "common/common.h"
+#include "runtime/runtime.h"
+
+extern bool debug_enabled;
+
+static bool calls_itself(IRFunction *func)
+{
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (instr && instr->opcode == IR_CALL && string_equal(instr->label, func->name))
+            return true;
+    }
+    return false;
+}
+
+/* Tail-call elimination has already turned linear recursion into loops, so
+   a pure function that still calls itself branches into several recursive
+   calls and is worth caching. The C and assembly backends emit the memo
+   wrapper. */
+bool optimization_memoize(IRProgram *program)
+{
+    if (!program)
+        return false;
+
+    HashTable *pure = optimization_infer_pure_functions(program);
+    bool changed = false;
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        if (func->memoize || hashtable_get(pure, func->name) != func)
+            continue;
+        if (func->params.size == 0 || func->params.size > TL_MEMO_MAX_ARGS || !calls_itself(func))
+            continue;
+
+        if (debug_enabled)
+        {
+            printf("[DEBUG] Memoize: Caching results of %s\n", func->name);
+        }
+        func->memoize = true;
+        optimization_stats_add("functions memoized", 1);
+        changed = true;
+    }
+
+    hashtable_destroy(pure);
+    return changed;
+}
@@ -9,6 +9,116 @@ extern bool debug_enabled;
 extern bool optimization_constant_folding(IRProgram *program);
 extern bool optimization_dead_code_elimination(IRProgram *program);
 extern bool optimization_copy_propagation(IRProgram *program);
+extern bool optimization_tail_call_elimination(IRProgram *program);
+extern bool optimization_sccp(IRProgram *program);
+extern bool optimization_loop_unrolling(IRProgram *program);
+extern bool optimization_vectorize(IRProgram *program);
+extern bool optimization_interprocedural_constants(IRProgram *program);
+extern bool optimization_comptime_evaluation(IRProgram *program);
+extern bool optimization_memoize(IRProgram *program);
+extern bool optimization_algebraic_simplification(IRProgram *program);
+extern bool optimization_cfg_simplification(IRProgram *program);
+extern bool optimization_block_layout(IRProgram *program);
+
+OptimizationOptions optimization_options = {
+    .level = 2,
+    .unroll_factor = 4,
+    .clone_budget = 512,
+    .max_comptime_steps = 100000,
+    .time_passes = false,
+    .vectorize_floats = true,
+    .jobs = 0,
+    .profile_generate = NULL,
+    .profile_use = NULL
+};
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/* Passes that run on worker threads record their statistics in a buffer of
+   their own, which the driver merges in function order so the report does
+   not depend on scheduling. */
+static OptimizationStatsBuffer optimization_stats;
+static THREAD_LOCAL OptimizationStatsBuffer *optimization_stats_sink = NULL;
+
+static void stats_buffer_add(OptimizationStatsBuffer *buffer, const char *name, size_t count)
+{
+    for (size_t i = 0; i < buffer->count; i++)
+    {
+        if (strcmp(buffer->stats[i].name, name) == 0)
+        {
+            buffer->stats[i].count += count;
+            return;
+        }
+    }
+
+    if (buffer->count == buffer->capacity)
+    {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 8;
+        buffer->stats = safe_realloc(buffer->stats, buffer->capacity * sizeof(OptimizationStat));
+    }
+    buffer->stats[buffer->count].name = name;
+    buffer->stats[buffer->count].count = count;
+    buffer->count++;
+}
+
+void optimization_stats_reset(void)
+{
+    optimization_stats.count = 0;
+}
+
+void optimization_stats_add(const char *name, size_t count)
+{
+    if (!name)
+        return;
+    stats_buffer_add(optimization_stats_sink ? optimization_stats_sink : &optimization_stats, name, count);
+}
+
+OptimizationStatsBuffer *optimization_stats_redirect(OptimizationStatsBuffer *buffer)
+{
+    OptimizationStatsBuffer *previous = optimization_stats_sink;
+    optimization_stats_sink = buffer;
+    return previous;
+}
+
+void optimization_stats_merge(OptimizationStatsBuffer *buffer)
+{
+    if (!buffer)
+        return;
+    for (size_t i = 0; i < buffer->count; i++)
+    {
+        optimization_stats_add(buffer->stats[i].name, buffer->stats[i].count);
+    }
+    safe_free(buffer->stats);
+    buffer->stats = NULL;
+    buffer->count = 0;
+    buffer->capacity = 0;
+}
+
+size_t optimization_stats_get(const char *name)
+{
+    for (size_t i = 0; i < optimization_stats.count; i++)
+    {
+        if (strcmp(optimization_stats.stats[i].name, name) == 0)
+            return optimization_stats.stats[i].count;
+    }
+    return 0;
+}
+
+void optimization_stats_print(FILE *out)
+{
+    if (!out || optimization_stats.count == 0)
+        return;
+
+    fprintf(out, "Optimization statistics:\n");
+    for (size_t i = 0; i < optimization_stats.count; i++)
+    {
+        fprintf(out, "  %-32s %zu\n", optimization_stats.stats[i].name, optimization_stats.stats[i].count);
+    }
+}
 
 OptimizationPipeline *optimization_pipeline_create(void)
 {
@@ -30,6 +140,8 @@ void optimization_pipeline_add_pass(OptimizationPipeline *pipeline, Optimization
 {
     if (!pipeline || !pass)
         return;
+    pass->seconds = 0.0;
+    pass->runs = 0;
     array_push(&pipeline->passes, pass);
 }
 
@@ -53,7 +165,11 @@ bool optimization_pipeline_run(OptimizationPipeline *pipeline, IRProgram *progra
             {
                 printf("[DEBUG] Running optimization pass: %s\n", pass->name);
             }
-            if (pass->run(program))
+            double start = optimization_clock_seconds();
+            bool pass_changed = pass->run(program);
+            pass->seconds += optimization_clock_seconds() - start;
+            pass->runs++;
+            if (pass_changed)
             {
                 changed = true;
                 if (debug_enabled)
@@ -67,13 +183,45 @@ bool optimization_pipeline_run(OptimizationPipeline *pipeline, IRProgram *progra
     return changed;
 }
 
+void optimization_pipeline_print_timings(OptimizationPipeline *pipeline, FILE *out)
+{
+    if (!pipeline || !out)
+        return;
+
+    for (size_t i = 0; i < pipeline->passes.size; i++)
+    {
+        OptimizationPass *pass = (OptimizationPass *)array_get(&pipeline->passes, i);
+        fprintf(out, "  %-32s %4d runs %10.3f ms\n", pass->name, pass->runs, pass->seconds * 1000.0);
+    }
+}
+
 OptimizationPipeline *optimization_pipeline_create_default(void)
 {
     OptimizationPipeline *pipeline = optimization_pipeline_create();
     
-    static OptimizationPass constant_folding_pass = {
-        .name = "constant_folding",
-        .run = optimization_constant_folding
+    static OptimizationPass tail_call_pass = {
+        .name = "tail_call_elimination",
+        .run = optimization_tail_call_elimination
+    };
+    
+    static OptimizationPass comptime_pass = {
+        .name = "comptime_evaluation",
+        .run = optimization_comptime_evaluation
+    };
+    
+    static OptimizationPass ipcp_pass = {
+        .name = "interprocedural_constants",
+        .run = optimization_interprocedural_constants
+    };
+    
+    static OptimizationPass sccp_pass = {
+        .name = "sccp",
+        .run = optimization_sccp
+    };
+    
+    static OptimizationPass simplify_pass = {
+        .name = "algebraic_simplification",
+        .run = optimization_algebraic_simplification
     };
     
     static OptimizationPass dead_code_pass = {
@@ -86,20 +234,19 @@ OptimizationPipeline *optimization_pipeline_create_default(void)
         .run = optimization_copy_propagation
     };
     
-    optimization_pipeline_add_pass(pipeline, &constant_folding_pass);
+    optimization_pipeline_add_pass(pipeline, &tail_call_pass);
+    optimization_pipeline_add_pass(pipeline, &comptime_pass);
+    optimization_pipeline_add_pass(pipeline, &ipcp_pass);
+    optimization_pipeline_add_pass(pipeline, &sccp_pass);
+    optimization_pipeline_add_pass(pipeline, &simplify_pass);
     optimization_pipeline_add_pass(pipeline, &copy_propagation_pass);
     optimization_pipeline_add_pass(pipeline, &dead_code_pass);
     
     return pipeline;
 }
 
-bool optimization_optimize_program(IRProgram *program)
+static bool optimization_pipeline_run_to_fixpoint(OptimizationPipeline *pipeline, IRProgram *program)
 {
-    if (!program)
-        return false;
-    
-    OptimizationPipeline *pipeline = optimization_pipeline_create_default();
-    
     bool changed = false;
     int iterations = 0;
     const int max_iterations = 10;
@@ -126,8 +273,118 @@ bool optimization_optimize_program(IRProgram *program)
         printf("[DEBUG] Optimizations completed after %d iterations\n", iterations);
         fflush(stdout);
     }
+    return changed;
+}
+
+OptimizationPipeline *optimization_pipeline_create_loop(void)
+{
+    OptimizationPipeline *pipeline = optimization_pipeline_create();
+    
+    static OptimizationPass vectorize_pass = {
+        .name = "vectorize",
+        .run = optimization_vectorize
+    };
+    
+    static OptimizationPass loop_unrolling_pass = {
+        .name = "loop_unrolling",
+        .run = optimization_loop_unrolling
+    };
+    
+    static OptimizationPass memoize_pass = {
+        .name = "memoize",
+        .run = optimization_memoize
+    };
+    
+    if (optimization_options.level >= 3)
+    {
+        optimization_pipeline_add_pass(pipeline, &vectorize_pass);
+    }
+    optimization_pipeline_add_pass(pipeline, &loop_unrolling_pass);
+    if (optimization_options.level >= 3)
+    {
+        optimization_pipeline_add_pass(pipeline, &memoize_pass);
+    }
+    
+    return pipeline;
+}
+
+OptimizationPipeline *optimization_pipeline_create_cleanup(void)
+{
+    OptimizationPipeline *pipeline = optimization_pipeline_create();
+    
+    static OptimizationPass block_layout_pass = {
+        .name = "block_layout",
+        .run = optimization_block_layout
+    };
+    
+    static OptimizationPass cfg_simplification_pass = {
+        .name = "cfg_simplification",
+        .run = optimization_cfg_simplification
+    };
+    
+    static OptimizationPass dead_code_pass = {
+        .name = "dead_code_elimination",
+        .run = optimization_dead_code_elimination
+    };
+    
+    optimization_pipeline_add_pass(pipeline, &block_layout_pass);
+    optimization_pipeline_add_pass(pipeline, &cfg_simplification_pass);
+    optimization_pipeline_add_pass(pipeline, &dead_code_pass);
+    
+    return pipeline;
+}
+
+bool optimization_optimize_program(IRProgram *program)
+{
+    if (!program)
+        return false;
+    
+    optimization_stats_reset();
+    /* Profile counters are named after the unoptimized IR, so both the
+       instrumented build and the one consuming the profile see it first. */
+    if (optimization_options.profile_use)
+        optimization_profile_annotate(program, optimization_options.profile_use);
+    if (optimization_options.profile_generate)
+        optimization_profile_instrument(program, optimization_options.profile_generate);
+    if (optimization_options.level <= 0)
+        return false;
+    
+    OptimizationPipeline *pipeline = optimization_pipeline_create_default();
+    OptimizationPipeline *loop_pipeline = optimization_pipeline_create_loop();
+    OptimizationPipeline *cleanup_pipeline = optimization_pipeline_create_cleanup();
+    
+    bool changed = optimization_pipeline_run_to_fixpoint(pipeline, program);
+    
+    /* Loop transformations and memoization run once on the cleaned-up IR;
+       running them inside the fixpoint loop would unroll the remainder
+       loops again. */
+    if (optimization_options.level >= 2 && !optimization_options.profile_generate &&
+        optimization_pipeline_run(loop_pipeline, program))
+    {
+        changed = true;
+        optimization_pipeline_run_to_fixpoint(pipeline, program);
+    }
+    
+    /* Control flow cleanup rewrites the branch shapes the loop passes
+       match on, so it only runs once they are done. */
+    if (optimization_pipeline_run_to_fixpoint(cleanup_pipeline, program))
+    {
+        changed = true;
+    }
+    
+    if (optimization_options.time_passes)
+    {
+        printf("Optimization pass timings:\n");
+        optimization_pipeline_print_timings(pipeline, stdout);
+        optimization_pipeline_print_timings(loop_pipeline, stdout);
+        optimization_pipeline_print_timings(cleanup_pipeline, stdout);
+        optimization_stats_print(stdout);
+    }
     
     optimization_pipeline_destroy(pipeline);
+    optimization_pipeline_destroy(loop_pipeline);
+    optimization_pipeline_destroy(cleanup_pipeline);
+    optimization_worker_pool_shutdown();
     
     if (debug_enabled)
     {
@@ -136,4 +393,4 @@ bool optimization_optimize_program(IRProgram *program)
     }
     
     return changed;
-}
\ No newline at end of file
+}
@@ -0,0 +1,356 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "optimizations/optimizer.h"
+#include "common/common.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+extern bool debug_enabled;
+
+#define MAX_OPTIMIZATION_JOBS 64
+/* Below this many instructions waking the workers costs more than the
+   passes themselves. */
+#define PARALLEL_MIN_INSTRUCTIONS 2048
+
+typedef struct ParallelWork {
+    IRProgram *program;
+    OptimizationFunctionPass run;
+    size_t next;
+    bool *changed;
+    OptimizationStatsBuffer *stats;
+} ParallelWork;
+
+double optimization_clock_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+}
+
+int optimization_job_count(void)
+{
+    long jobs = optimization_options.jobs;
+    if (jobs <= 0)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        jobs = (long)info.dwNumberOfProcessors;
+#else
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+    if (jobs < 1)
+        return 1;
+    return jobs > MAX_OPTIMIZATION_JOBS ? MAX_OPTIMIZATION_JOBS : (int)jobs;
+}
+
+static size_t claim_function(ParallelWork *work)
+{
+#if defined(_MSC_VER)
+    return (size_t)InterlockedExchangeAdd64((volatile LONG64 *)&work->next, 1);
+#else
+    return __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static void run_work(ParallelWork *work)
+{
+    size_t count = work->program->functions.size;
+    for (size_t i = claim_function(work); i < count; i = claim_function(work))
+    {
+        IRFunction *func = (IRFunction *)array_get(&work->program->functions, i);
+        if (!func)
+            continue;
+        OptimizationStatsBuffer *previous = optimization_stats_redirect(&work->stats[i]);
+        work->changed[i] = work->run(func);
+        optimization_stats_redirect(previous);
+    }
+}
+
+/* Worker threads are started on the first threaded pass and then reused by
+   every later one, so the fixpoint loop does not pay for thread creation on
+   each pass invocation. Each dispatch bumps the generation; workers run the
+   published work once per generation and report back through busy. */
+typedef struct WorkerPool {
+#ifdef _WIN32
+    HANDLE threads[MAX_OPTIMIZATION_JOBS];
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE work_ready;
+    CONDITION_VARIABLE work_done;
+#else
+    pthread_t threads[MAX_OPTIMIZATION_JOBS];
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+#endif
+    int size;
+    bool started;
+    bool stopping;
+    unsigned generation;
+    int busy;
+    ParallelWork *work;
+} WorkerPool;
+
+static WorkerPool pool;
+
+static void pool_lock(void)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&pool.lock);
+#else
+    pthread_mutex_lock(&pool.lock);
+#endif
+}
+
+static void pool_unlock(void)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&pool.lock);
+#else
+    pthread_mutex_unlock(&pool.lock);
+#endif
+}
+
+static void pool_wait_ready(void)
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(&pool.work_ready, &pool.lock, INFINITE);
+#else
+    pthread_cond_wait(&pool.work_ready, &pool.lock);
+#endif
+}
+
+static void pool_wait_done(void)
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(&pool.work_done, &pool.lock, INFINITE);
+#else
+    pthread_cond_wait(&pool.work_done, &pool.lock);
+#endif
+}
+
+static void pool_wake_workers(void)
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(&pool.work_ready);
+#else
+    pthread_cond_broadcast(&pool.work_ready);
+#endif
+}
+
+static void pool_wake_dispatcher(void)
+{
+#ifdef _WIN32
+    WakeConditionVariable(&pool.work_done);
+#else
+    pthread_cond_signal(&pool.work_done);
+#endif
+}
+
+static void worker_loop(void)
+{
+    /* The pool starts at generation 0, so a worker that is scheduled late
+       still sees the first dispatch as new. */
+    unsigned seen = 0;
+    pool_lock();
+    for (;;)
+    {
+        while (!pool.stopping && pool.generation == seen)
+            pool_wait_ready();
+        if (pool.stopping)
+            break;
+        seen = pool.generation;
+        ParallelWork *work = pool.work;
+        pool_unlock();
+
+        run_work(work);
+
+        pool_lock();
+        if (--pool.busy == 0)
+            pool_wake_dispatcher();
+    }
+    pool_unlock();
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID arg)
+{
+    (void)arg;
+    worker_loop();
+    return 0;
+}
+#else
+static void *worker_main(void *arg)
+{
+    (void)arg;
+    worker_loop();
+    return NULL;
+}
+#endif
+
+static void pool_start(int workers)
+{
+#ifdef _WIN32
+    InitializeCriticalSection(&pool.lock);
+    InitializeConditionVariable(&pool.work_ready);
+    InitializeConditionVariable(&pool.work_done);
+#else
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.work_ready, NULL);
+    pthread_cond_init(&pool.work_done, NULL);
+#endif
+    pool.size = 0;
+    pool.stopping = false;
+    pool.generation = 0;
+    pool.busy = 0;
+    pool.work = NULL;
+    pool.started = true;
+
+    for (int t = 0; t < workers; t++)
+    {
+#ifdef _WIN32
+        pool.threads[pool.size] = CreateThread(NULL, 0, worker_main, NULL, 0, NULL);
+        if (!pool.threads[pool.size])
+            break;
+#else
+        if (pthread_create(&pool.threads[pool.size], NULL, worker_main, NULL) != 0)
+            break;
+#endif
+        pool.size++;
+    }
+}
+
+/* Hands the work to every pool worker, joins in from the calling thread and
+   returns once all of them have run out of functions to claim. */
+static void pool_dispatch(ParallelWork *work)
+{
+    pool_lock();
+    pool.work = work;
+    pool.busy = pool.size;
+    pool.generation++;
+    pool_wake_workers();
+    pool_unlock();
+
+    run_work(work);
+
+    pool_lock();
+    while (pool.busy > 0)
+        pool_wait_done();
+    pool.work = NULL;
+    pool_unlock();
+}
+
+void optimization_worker_pool_shutdown(void)
+{
+    if (!pool.started)
+        return;
+
+    pool_lock();
+    pool.stopping = true;
+    pool_wake_workers();
+    pool_unlock();
+
+    for (int t = 0; t < pool.size; t++)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(pool.threads[t], INFINITE);
+        CloseHandle(pool.threads[t]);
+#else
+        pthread_join(pool.threads[t], NULL);
+#endif
+    }
+#ifdef _WIN32
+    DeleteCriticalSection(&pool.lock);
+#else
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.work_ready);
+    pthread_cond_destroy(&pool.work_done);
+#endif
+    pool.size = 0;
+    pool.started = false;
+}
+
+static bool run_serial(IRProgram *program, OptimizationFunctionPass run)
+{
+    bool changed = false;
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        if (func && run(func))
+        {
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+static bool worth_threading(IRProgram *program, int jobs)
+{
+    if (jobs <= 1 || debug_enabled || program->functions.size < 2)
+        return false;
+
+    size_t instructions = 0;
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        if (func)
+            instructions += func->instructions.size;
+    }
+    return instructions >= PARALLEL_MIN_INSTRUCTIONS;
+}
+
+/* Runs a function-local pass over every function of the program. Functions
+   are handed out to the workers one at a time, so a few large functions do
+   not leave the other threads idle. Each function's statistics are kept
+   apart and merged in program order afterwards, which keeps --time-passes
+   output identical to a serial run. */
+bool optimization_run_per_function(IRProgram *program, OptimizationFunctionPass run)
+{
+    if (!program || !run)
+        return false;
+
+    int jobs = optimization_job_count();
+    if (!worth_threading(program, jobs))
+        return run_serial(program, run);
+
+    size_t count = program->functions.size;
+    ParallelWork work;
+    work.program = program;
+    work.run = run;
+    work.next = 0;
+    work.changed = safe_malloc(count * sizeof(bool));
+    work.stats = safe_malloc(count * sizeof(OptimizationStatsBuffer));
+    memset(work.changed, 0, count * sizeof(bool));
+    memset(work.stats, 0, count * sizeof(OptimizationStatsBuffer));
+
+    /* The calling thread is the first worker. */
+    if (!pool.started)
+        pool_start(jobs - 1);
+    pool_dispatch(&work);
+
+    bool changed = false;
+    for (size_t i = 0; i < count; i++)
+    {
+        changed = changed || work.changed[i];
+        optimization_stats_merge(&work.stats[i]);
+    }
+    safe_free(work.changed);
+    safe_free(work.stats);
+    return changed;
+}
@@ -0,0 +1,257 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+#define MAX_COUNTER_NAME 512
+#define MAX_PROFILE_LINE 1024
+
+/* Counters are named after the unoptimized IR, which is identical between
+   the instrumented build and the build that consumes its profile:
+
+     <func> entry            times the function was entered
+     <func> label <L>        times control reached label L
+     <func> branch <k>       times the k-th conditional branch ran
+     <func> branch <k> true  ... and how often its condition held
+     <func> call <k> <f>     times the k-th call site ran
+
+   Overloaded functions share a name and get a #n suffix. */
+typedef struct ProfileNamer {
+    HashTable *seen;
+    char prefix[MAX_COUNTER_NAME / 2];
+    size_t branches;
+    size_t calls;
+} ProfileNamer;
+
+static void namer_begin_function(ProfileNamer *namer, IRFunction *func)
+{
+    intptr_t overload = (intptr_t)hashtable_get(namer->seen, func->name);
+    hashtable_put(namer->seen, func->name, (void *)(overload + 1));
+    if (overload == 0)
+        snprintf(namer->prefix, sizeof(namer->prefix), "%s", func->name);
+    else
+        snprintf(namer->prefix, sizeof(namer->prefix), "%s#%ld", func->name, (long)overload);
+    namer->branches = 0;
+    namer->calls = 0;
+}
+
+/* Writes the names of the counters `instr` owns and returns how many. */
+static size_t counter_names(ProfileNamer *namer, const IRInstruction *instr, char names[2][MAX_COUNTER_NAME])
+{
+    if (!instr)
+    {
+        snprintf(names[0], MAX_COUNTER_NAME, "%s entry", namer->prefix);
+        return 1;
+    }
+    if (instr->opcode == IR_LABEL && instr->label)
+    {
+        snprintf(names[0], MAX_COUNTER_NAME, "%s label %s", namer->prefix, instr->label);
+        return 1;
+    }
+    if (ir_instruction_is_conditional_branch(instr))
+    {
+        snprintf(names[0], MAX_COUNTER_NAME, "%s branch %zu", namer->prefix, namer->branches);
+        snprintf(names[1], MAX_COUNTER_NAME, "%s branch %zu true", namer->prefix, namer->branches);
+        namer->branches++;
+        return 2;
+    }
+    if (instr->opcode == IR_CALL && instr->label)
+    {
+        snprintf(names[0], MAX_COUNTER_NAME, "%s call %zu %s", namer->prefix, namer->calls, instr->label);
+        namer->calls++;
+        return 1;
+    }
+    return 0;
+}
+
+static IRInstruction *add_counter(IRProgram *program, const char *name, IROperand *condition)
+{
+    int counter = (int)program->profile_counters.size;
+    array_push(&program->profile_counters, string_copy(name));
+    return ir_instruction_profile(counter, condition);
+}
+
+static void instrument_function(IRProgram *program, ProfileNamer *namer, IRFunction *func)
+{
+    char names[2][MAX_COUNTER_NAME];
+    size_t count = func->instructions.size;
+
+    /* Call counters go in front of the call's first PARAM so that the
+       PARAM/CALL sequence and tail call patterns stay intact. */
+    char **call_names = safe_malloc((count + 1) * sizeof(char *));
+    memset(call_names, 0, (count + 1) * sizeof(char *));
+    for (size_t i = 0; i < count; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (instr->opcode != IR_CALL || counter_names(namer, instr, names) == 0)
+            continue;
+        size_t params[MAX_PARAMS + 1];
+        size_t param_count = ir_call_collect_params(func, i, params, MAX_PARAMS);
+        size_t first = param_count > 0 && param_count <= MAX_PARAMS ? params[0] : i;
+        call_names[first] = string_copy(names[0]);
+    }
+
+    DynamicArray out;
+    array_init(&out, count * 2 + 1);
+    counter_names(namer, NULL, names);
+    array_push(&out, add_counter(program, names[0], NULL));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (call_names[i])
+        {
+            array_push(&out, add_counter(program, call_names[i], NULL));
+            safe_free(call_names[i]);
+        }
+
+        if (ir_instruction_is_conditional_branch(instr))
+        {
+            counter_names(namer, instr, names);
+            array_push(&out, add_counter(program, names[0], NULL));
+            array_push(&out, add_counter(program, names[1], ir_operand_copy(instr->arg1)));
+        }
+        array_push(&out, instr);
+        if (instr->opcode == IR_LABEL && counter_names(namer, instr, names) > 0)
+        {
+            array_push(&out, add_counter(program, names[0], NULL));
+        }
+    }
+
+    safe_free(call_names);
+    ir_function_replace_instructions(func, &out);
+}
+
+void optimization_profile_instrument(IRProgram *program, const char *path)
+{
+    if (!program || !path)
+        return;
+
+    ProfileNamer namer;
+    namer.seen = hashtable_create(32);
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        namer_begin_function(&namer, (IRFunction *)array_get(&program->functions, i));
+        instrument_function(program, &namer, (IRFunction *)array_get(&program->functions, i));
+    }
+    hashtable_destroy(namer.seen);
+
+    safe_free(program->profile_path);
+    program->profile_path = string_copy(path);
+    if (debug_enabled)
+    {
+        printf("[DEBUG] Profile: Instrumented program with %zu counters\n", program->profile_counters.size);
+    }
+}
+
+static HashTable *load_profile(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return NULL;
+
+    HashTable *counts = hashtable_create(256);
+    char line[MAX_PROFILE_LINE];
+    while (fgets(line, sizeof(line), file))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0')
+            continue;
+
+        char *name = NULL;
+        unsigned long long count = strtoull(line, &name, 10);
+        if (name == line || *name != ' ')
+            continue;
+        /* Stored off by one so that a missing counter reads as NULL.
+           Repeated entries come from runs appended to the same file. */
+        uintptr_t previous = (uintptr_t)hashtable_get(counts, name + 1);
+        hashtable_put(counts, name + 1, (void *)(uintptr_t)(count + (previous ? previous : 1)));
+    }
+    fclose(file);
+    return counts;
+}
+
+static bool lookup_count(HashTable *counts, const char *name, uint64_t *count)
+{
+    uintptr_t stored = (uintptr_t)hashtable_get(counts, name);
+    if (stored == 0)
+        return false;
+    *count = (uint64_t)(stored - 1);
+    return true;
+}
+
+static size_t annotate_function(HashTable *counts, ProfileNamer *namer, IRFunction *func)
+{
+    char names[2][MAX_COUNTER_NAME];
+    size_t matched = 0;
+
+    counter_names(namer, NULL, names);
+    if (lookup_count(counts, names[0], &func->profile_count))
+    {
+        func->has_profile = true;
+        matched++;
+    }
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        size_t n = counter_names(namer, instr, names);
+        if (n == 0 || !lookup_count(counts, names[0], &instr->profile_count))
+            continue;
+
+        uint64_t taken = 0;
+        if (n == 2)
+        {
+            if (!lookup_count(counts, names[1], &taken))
+                continue;
+            if (instr->opcode == IR_JUMP_IF_FALSE)
+                taken = instr->profile_count >= taken ? instr->profile_count - taken : 0;
+        }
+        instr->profile_taken = taken;
+        instr->has_profile = true;
+        matched++;
+    }
+    return matched;
+}
+
+void optimization_profile_annotate(IRProgram *program, const char *path)
+{
+    if (!program || !path)
+        return;
+
+    HashTable *counts = load_profile(path);
+    if (!counts)
+    {
+        fprintf(stderr, "Warning: cannot read profile '%s', ignoring --profile-use\n", path);
+        return;
+    }
+
+    ProfileNamer namer;
+    namer.seen = hashtable_create(32);
+    size_t matched = 0;
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        namer_begin_function(&namer, func);
+        matched += annotate_function(counts, &namer, func);
+    }
+    hashtable_destroy(namer.seen);
+    hashtable_destroy(counts);
+
+    if (matched == 0)
+    {
+        fprintf(stderr, "Warning: profile '%s' does not match this program\n", path);
+    }
+    else
+    {
+        optimization_stats_add("profile counters matched", matched);
+    }
+    if (debug_enabled)
+    {
+        printf("[DEBUG] Profile: Matched %zu counters from %s\n", matched, path);
+    }
+}
@@ -0,0 +1,122 @@
+#include "optimizations/optimizer.h"
+#include "backend/ir/irCore.h"
+#include "common/common.h"
+
+static bool is_integral(const IROperand *operand)
+{
+    if (!operand)
+        return true;
+    if (operand->type == IR_OP_STRING_CONST || operand->is_float_const || operand->vector_width > 0)
+        return false;
+    return operand->data_type == TYPE_INT || operand->data_type == TYPE_BOOL;
+}
+
+static bool instruction_is_evaluable(const IRInstruction *instr)
+{
+    switch (instr->opcode)
+    {
+    case IR_NOP:
+    case IR_LABEL:
+    case IR_VAR_DECL:
+    case IR_MOVE:
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+    case IR_AND:
+    case IR_OR:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
+    case IR_NOT:
+    case IR_NEG:
+    case IR_JUMP:
+    case IR_JUMP_IF:
+    case IR_JUMP_IF_FALSE:
+    case IR_CALL:
+    case IR_RETURN:
+    case IR_PARAM:
+        break;
+    default:
+        return false;
+    }
+    return is_integral(instr->result) && is_integral(instr->arg1) && is_integral(instr->arg2);
+}
+
+static bool is_locally_pure(const IRFunction *func)
+{
+    if (string_equal(func->name, "main"))
+        return false;
+    if (func->return_type != TYPE_INT && func->return_type != TYPE_BOOL)
+        return false;
+    for (size_t k = 0; k < func->params.size; k++)
+    {
+        if (!is_integral((IROperand *)array_get(&func->params, k)))
+            return false;
+    }
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (!instr || !instruction_is_evaluable(instr))
+            return false;
+    }
+    return true;
+}
+
+/* Purity is the greatest fixpoint over the call graph: start from every
+   locally pure function and drop those that call FFI, runtime builtins
+   or impure functions until nothing changes. Overloaded names are never
+   pure because their calls cannot be resolved from the IR. */
+HashTable *optimization_infer_pure_functions(IRProgram *program)
+{
+    HashTable *pure = hashtable_create(32);
+    HashTable *rejected = hashtable_create(8);
+    for (size_t i = 0; i < program->functions.size; i++)
+    {
+        IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+        if (hashtable_contains(pure, func->name) || hashtable_contains(rejected, func->name))
+        {
+            hashtable_remove(pure, func->name);
+            hashtable_put(rejected, func->name, (void *)1);
+        }
+        else if (is_locally_pure(func))
+        {
+            hashtable_put(pure, func->name, func);
+        }
+        else
+        {
+            hashtable_put(rejected, func->name, (void *)1);
+        }
+    }
+    hashtable_destroy(rejected);
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 0; i < program->functions.size; i++)
+        {
+            IRFunction *func = (IRFunction *)array_get(&program->functions, i);
+            if (hashtable_get(pure, func->name) != func)
+                continue;
+            for (size_t j = 0; j < func->instructions.size; j++)
+            {
+                IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, j);
+                if (instr->opcode == IR_CALL && (!instr->label || !hashtable_contains(pure, instr->label)))
+                {
+                    hashtable_remove(pure, func->name);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    return pure;
+}
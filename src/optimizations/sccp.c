@@ -0,0 +1,478 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+typedef enum {
+    LATTICE_TOP,
+    LATTICE_CONST,
+    LATTICE_BOTTOM
+} LatticeKind;
+
+typedef struct LatticeValue {
+    LatticeKind kind;
+    bool is_float;
+    int64_t int_value;
+    double float_value;
+} LatticeValue;
+
+typedef struct SCCPState {
+    IRFunction *func;
+    IRControlFlowGraph *cfg;
+    IRValueIndex *index;
+    size_t value_count;
+    LatticeValue *out_states;
+    bool *block_executable;
+    bool *edge_executable;
+    size_t *edge_offsets;
+} SCCPState;
+
+static const LatticeValue lattice_top = {LATTICE_TOP, false, 0, 0.0};
+static const LatticeValue lattice_bottom = {LATTICE_BOTTOM, false, 0, 0.0};
+
+static bool is_trackable_type(DataType type)
+{
+    return type == TYPE_INT || type == TYPE_BOOL || type == TYPE_FLOAT || type == TYPE_DOUBLE;
+}
+
+static LatticeValue lattice_int(int64_t value)
+{
+    LatticeValue result = {LATTICE_CONST, false, value, 0.0};
+    return result;
+}
+
+static LatticeValue lattice_float(double value)
+{
+    LatticeValue result = {LATTICE_CONST, true, 0, value};
+    return result;
+}
+
+static bool lattice_equal(const LatticeValue *a, const LatticeValue *b)
+{
+    if (a->kind != b->kind)
+        return false;
+    if (a->kind != LATTICE_CONST)
+        return true;
+    if (a->is_float != b->is_float)
+        return false;
+    if (a->is_float)
+        return memcmp(&a->float_value, &b->float_value, sizeof(double)) == 0;
+    return a->int_value == b->int_value;
+}
+
+static LatticeValue lattice_meet(LatticeValue a, LatticeValue b)
+{
+    if (a.kind == LATTICE_TOP)
+        return b;
+    if (b.kind == LATTICE_TOP)
+        return a;
+    if (a.kind == LATTICE_BOTTOM || b.kind == LATTICE_BOTTOM)
+        return lattice_bottom;
+    return lattice_equal(&a, &b) ? a : lattice_bottom;
+}
+
+static LatticeValue lattice_coerce(LatticeValue value, DataType type)
+{
+    if (!is_trackable_type(type))
+        return lattice_bottom;
+    if (value.kind != LATTICE_CONST)
+        return value;
+
+    switch (type)
+    {
+    case TYPE_FLOAT:
+        return lattice_float((double)(float)(value.is_float ? value.float_value : (double)value.int_value));
+    case TYPE_DOUBLE:
+        return value.is_float ? value : lattice_float((double)value.int_value);
+    case TYPE_BOOL:
+        return lattice_int(value.is_float ? value.float_value != 0.0 : value.int_value != 0);
+    default:
+        if (!value.is_float)
+            return value;
+        if (!(value.float_value > -9.2e18 && value.float_value < 9.2e18))
+            return lattice_bottom;
+        return lattice_int((int64_t)value.float_value);
+    }
+}
+
+static LatticeValue lattice_from_operand(const IROperand *operand)
+{
+    if (operand->is_float_const)
+        return lattice_float(operand->data.float_const_value);
+    return lattice_int(operand->data.const_value);
+}
+
+static void lattice_to_operand(const LatticeValue *value, IROperand *operand)
+{
+    memset(operand, 0, sizeof(IROperand));
+    operand->type = IR_OP_CONST;
+    operand->array_size = -1;
+    operand->is_float_const = value->is_float;
+    if (value->is_float)
+    {
+        operand->data_type = TYPE_DOUBLE;
+        operand->data.float_const_value = value->float_value;
+    }
+    else
+    {
+        operand->data_type = TYPE_INT;
+        operand->data.const_value = value->int_value;
+    }
+}
+
+static LatticeValue sccp_value(SCCPState *s, const LatticeValue *state, const IROperand *operand)
+{
+    if (!operand)
+        return lattice_bottom;
+    if (operand->type == IR_OP_CONST)
+        return lattice_from_operand(operand);
+    if (operand->type != IR_OP_VAR && operand->type != IR_OP_TEMP)
+        return lattice_bottom;
+    if (!is_trackable_type(operand->data_type) || operand->array_size >= 0 || operand->vector_width > 0)
+        return lattice_bottom;
+
+    int slot = ir_value_index_of(s->index, operand);
+    return slot < 0 ? lattice_bottom : state[slot];
+}
+
+static LatticeValue sccp_fold(IROpcode opcode, LatticeValue a, LatticeValue b, bool binary)
+{
+    if (a.kind == LATTICE_BOTTOM || (binary && b.kind == LATTICE_BOTTOM))
+        return lattice_bottom;
+    if (a.kind == LATTICE_TOP || (binary && b.kind == LATTICE_TOP))
+        return lattice_top;
+
+    IROperand left;
+    IROperand right;
+    lattice_to_operand(&a, &left);
+    lattice_to_operand(&b, &right);
+
+    IROperand *folded = binary ? ir_fold_binary_constant(opcode, &left, &right)
+                               : ir_fold_unary_constant(opcode, &left);
+    if (!folded)
+        return lattice_bottom;
+
+    LatticeValue result = lattice_from_operand(folded);
+    ir_operand_destroy(folded);
+    return result;
+}
+
+static LatticeValue sccp_evaluate(SCCPState *s, const LatticeValue *state, IRInstruction *instr)
+{
+    switch (instr->opcode)
+    {
+    case IR_MOVE:
+        return sccp_value(s, state, instr->arg1);
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+    case IR_AND:
+    case IR_OR:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_BAND:
+        return sccp_fold(instr->opcode, sccp_value(s, state, instr->arg1),
+                         sccp_value(s, state, instr->arg2), true);
+    case IR_NOT:
+    case IR_NEG:
+        return sccp_fold(instr->opcode, sccp_value(s, state, instr->arg1), lattice_bottom, false);
+    default:
+        return lattice_bottom;
+    }
+}
+
+static void sccp_transfer(SCCPState *s, LatticeValue *state, IRInstruction *instr)
+{
+    if (instr->opcode == IR_INLINE_ASM)
+    {
+        for (size_t i = 0; i < s->index->var_count; i++)
+        {
+            state[i] = lattice_bottom;
+        }
+        return;
+    }
+
+    IROperand *def = ir_instruction_def(instr);
+    if (!def)
+        return;
+
+    int slot = ir_value_index_of(s->index, def);
+    if (slot < 0)
+        return;
+    state[slot] = lattice_coerce(sccp_evaluate(s, state, instr), def->data_type);
+}
+
+static void sccp_block_input(SCCPState *s, IRBasicBlock *block, LatticeValue *state)
+{
+    if (block->id == 0)
+    {
+        for (size_t i = 0; i < s->value_count; i++)
+            state[i] = lattice_bottom;
+        return;
+    }
+
+    for (size_t i = 0; i < s->value_count; i++)
+        state[i] = lattice_top;
+
+    for (size_t p = 0; p < block->preds.size; p++)
+    {
+        IRBasicBlock *pred = (IRBasicBlock *)array_get(&block->preds, p);
+        for (size_t k = 0; k < pred->succs.size; k++)
+        {
+            if (array_get(&pred->succs, k) != block || !s->edge_executable[s->edge_offsets[pred->id] + k])
+                continue;
+            LatticeValue *pred_out = &s->out_states[pred->id * s->value_count];
+            for (size_t i = 0; i < s->value_count; i++)
+                state[i] = lattice_meet(state[i], pred_out[i]);
+            break;
+        }
+    }
+}
+
+static bool branch_feasible(SCCPState *s, const LatticeValue *state, IRInstruction *last, size_t succ_index)
+{
+    if (!last || !ir_instruction_is_branch(last) || last->opcode == IR_JUMP)
+        return true;
+
+    LatticeValue cond = sccp_value(s, state, last->arg1);
+    if (cond.kind != LATTICE_CONST)
+        return true;
+
+    bool truthy = cond.is_float ? cond.float_value != 0.0 : cond.int_value != 0;
+    bool taken = last->opcode == IR_JUMP_IF ? truthy : !truthy;
+    bool is_target_edge = succ_index == 0 && ir_cfg_block_for_label(s->cfg, last->label) != NULL;
+    return taken == is_target_edge;
+}
+
+static void sccp_solve(SCCPState *s)
+{
+    size_t block_count = s->cfg->blocks.size;
+    size_t *worklist = safe_malloc((block_count + 1) * sizeof(size_t));
+    bool *queued = safe_malloc((block_count + 1) * sizeof(bool));
+    memset(queued, 0, (block_count + 1) * sizeof(bool));
+    bool *visited = safe_malloc((block_count + 1) * sizeof(bool));
+    memset(visited, 0, (block_count + 1) * sizeof(bool));
+    size_t head = 0;
+    size_t tail = 0;
+    LatticeValue *state = safe_malloc((s->value_count + 1) * sizeof(LatticeValue));
+
+    worklist[tail] = 0;
+    tail = (tail + 1) % (block_count + 1);
+    queued[0] = true;
+    s->block_executable[0] = true;
+
+    while (head != tail)
+    {
+        size_t id = worklist[head];
+        head = (head + 1) % (block_count + 1);
+        queued[id] = false;
+
+        IRBasicBlock *block = ir_cfg_block(s->cfg, id);
+        sccp_block_input(s, block, state);
+        for (size_t i = block->start; i < block->end; i++)
+        {
+            sccp_transfer(s, state, (IRInstruction *)array_get(&s->func->instructions, i));
+        }
+
+        LatticeValue *out = &s->out_states[id * s->value_count];
+        bool out_changed = !visited[id];
+        visited[id] = true;
+        for (size_t i = 0; i < s->value_count; i++)
+        {
+            if (!lattice_equal(&out[i], &state[i]))
+            {
+                out[i] = state[i];
+                out_changed = true;
+            }
+        }
+
+        IRInstruction *last = ir_cfg_terminator(s->cfg, block);
+        for (size_t k = 0; k < block->succs.size; k++)
+        {
+            IRBasicBlock *succ = (IRBasicBlock *)array_get(&block->succs, k);
+            if (!branch_feasible(s, state, last, k))
+                continue;
+
+            bool *edge = &s->edge_executable[s->edge_offsets[id] + k];
+            if (*edge && !out_changed)
+                continue;
+            *edge = true;
+            s->block_executable[succ->id] = true;
+            if (!queued[succ->id])
+            {
+                queued[succ->id] = true;
+                worklist[tail] = succ->id;
+                tail = (tail + 1) % (block_count + 1);
+            }
+        }
+    }
+
+    safe_free(state);
+    safe_free(visited);
+    safe_free(queued);
+    safe_free(worklist);
+}
+
+static IROperand *constant_operand(const LatticeValue *value, DataType type)
+{
+    IROperand *operand = value->is_float ? ir_operand_float_const(value->float_value)
+                                         : ir_operand_const(value->int_value);
+    operand->data_type = type;
+    return operand;
+}
+
+static bool sccp_rewrite_uses(SCCPState *s, const LatticeValue *state, IRInstruction *instr)
+{
+    if (instr->opcode == IR_INLINE_ASM)
+        return false;
+
+    bool changed = false;
+    IROperand **uses[IR_MAX_INSTRUCTION_USES + 16];
+    size_t count = ir_instruction_uses(instr, uses, IR_MAX_INSTRUCTION_USES + 16);
+    for (size_t u = 0; u < count; u++)
+    {
+        IROperand *operand = *uses[u];
+        if (operand->type != IR_OP_VAR && operand->type != IR_OP_TEMP)
+            continue;
+
+        LatticeValue value = lattice_coerce(sccp_value(s, state, operand), operand->data_type);
+        if (value.kind != LATTICE_CONST)
+            continue;
+
+        *uses[u] = constant_operand(&value, operand->data_type);
+        ir_operand_destroy(operand);
+        changed = true;
+    }
+    return changed;
+}
+
+static bool optimize_function_sccp(IRFunction *func)
+{
+    if (func->instructions.size == 0)
+        return false;
+
+    SCCPState s;
+    s.func = func;
+    s.cfg = ir_cfg_build(func);
+    s.index = ir_value_index_create(func);
+    s.value_count = ir_value_index_size(s.index);
+
+    size_t block_count = s.cfg->blocks.size;
+    size_t edge_count = 0;
+    s.edge_offsets = safe_malloc((block_count + 1) * sizeof(size_t));
+    for (size_t b = 0; b < block_count; b++)
+    {
+        s.edge_offsets[b] = edge_count;
+        edge_count += ir_cfg_block(s.cfg, b)->succs.size;
+    }
+    s.edge_executable = safe_malloc((edge_count + 1) * sizeof(bool));
+    memset(s.edge_executable, 0, (edge_count + 1) * sizeof(bool));
+    s.block_executable = safe_malloc((block_count + 1) * sizeof(bool));
+    memset(s.block_executable, 0, (block_count + 1) * sizeof(bool));
+    s.out_states = safe_malloc((block_count * s.value_count + 1) * sizeof(LatticeValue));
+    for (size_t i = 0; i < block_count * s.value_count; i++)
+        s.out_states[i] = lattice_top;
+
+    sccp_solve(&s);
+
+    bool changed = false;
+    size_t folded = 0;
+    size_t branches = 0;
+    size_t removed = 0;
+    LatticeValue *state = safe_malloc((s.value_count + 1) * sizeof(LatticeValue));
+    DynamicArray new_instructions;
+    array_init(&new_instructions, func->instructions.size);
+
+    for (size_t b = 0; b < block_count; b++)
+    {
+        IRBasicBlock *block = ir_cfg_block(s.cfg, b);
+        if (!s.block_executable[b])
+        {
+            for (size_t i = block->start; i < block->end; i++)
+            {
+                ir_instruction_destroy((IRInstruction *)array_get(&func->instructions, i));
+                removed++;
+            }
+            changed = true;
+            continue;
+        }
+
+        sccp_block_input(&s, block, state);
+        for (size_t i = block->start; i < block->end; i++)
+        {
+            IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+            if (sccp_rewrite_uses(&s, state, instr))
+                changed = true;
+            sccp_transfer(&s, state, instr);
+
+            IROperand *def = ir_instruction_def(instr);
+            if (def && instr->opcode >= IR_ADD && instr->opcode <= IR_NEG)
+            {
+                LatticeValue value = lattice_coerce(sccp_value(&s, state, def), def->data_type);
+                if (value.kind == LATTICE_CONST)
+                {
+                    ir_operand_destroy(instr->arg1);
+                    ir_operand_destroy(instr->arg2);
+                    instr->opcode = IR_MOVE;
+                    instr->arg1 = constant_operand(&value, def->data_type);
+                    instr->arg2 = NULL;
+                    folded++;
+                    changed = true;
+                }
+            }
+
+            if (ir_instruction_is_conditional_branch(instr) &&
+                instr->arg1 && instr->arg1->type == IR_OP_CONST)
+            {
+                bool truthy = instr->arg1->is_float_const ? instr->arg1->data.float_const_value != 0.0
+                                                          : instr->arg1->data.const_value != 0;
+                bool taken = instr->opcode == IR_JUMP_IF ? truthy : !truthy;
+                branches++;
+                changed = true;
+                if (!taken)
+                {
+                    ir_instruction_destroy(instr);
+                    continue;
+                }
+                ir_operand_destroy(instr->arg1);
+                instr->arg1 = NULL;
+                instr->opcode = IR_JUMP;
+            }
+            array_push(&new_instructions, instr);
+        }
+    }
+
+    ir_function_replace_instructions(func, &new_instructions);
+
+    if (debug_enabled && changed)
+    {
+        printf("[DEBUG] SCCP %s: folded %zu instructions, %zu branches, removed %zu unreachable instructions\n",
+               func->name, folded, branches, removed);
+    }
+
+    safe_free(state);
+    safe_free(s.out_states);
+    safe_free(s.block_executable);
+    safe_free(s.edge_executable);
+    safe_free(s.edge_offsets);
+    ir_value_index_destroy(s.index);
+    ir_cfg_destroy(s.cfg);
+    return changed;
+}
+
+bool optimization_sccp(IRProgram *program)
+{
+    return optimization_run_per_function(program, optimize_function_sccp);
+}
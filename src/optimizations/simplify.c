@@ -0,0 +1,510 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "optimizations/loops.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+#define DEF_NONE 0
+#define DEF_MULTIPLE SIZE_MAX
+
+#define SIGN_NON_NEGATIVE ((void *)1)
+#define SIGN_UNKNOWN ((void *)2)
+
+typedef enum {
+    RULE_INT,
+    RULE_ANY
+} RuleTypes;
+
+typedef struct SimplifyContext {
+    IRFunction *func;
+    size_t *defs;
+    bool *non_negative;
+    HashTable *var_signs;
+    size_t temp_count;
+    size_t index;
+} SimplifyContext;
+
+typedef struct SimplifyRule {
+    const char *name;
+    IROpcode opcode;
+    RuleTypes types;
+    bool (*apply)(SimplifyContext *ctx, IRInstruction *instr);
+} SimplifyRule;
+
+static bool is_float_operand(const IROperand *operand)
+{
+    return operand && (operand->is_float_const || operand->data_type == TYPE_FLOAT ||
+                       operand->data_type == TYPE_DOUBLE);
+}
+
+static bool is_float_instruction(const IRInstruction *instr)
+{
+    return is_float_operand(instr->result) || is_float_operand(instr->arg1) || is_float_operand(instr->arg2);
+}
+
+static bool is_const_value(const IROperand *operand, int64_t value)
+{
+    if (!operand || operand->type != IR_OP_CONST)
+        return false;
+    if (operand->is_float_const)
+        return operand->data.float_const_value == (double)value;
+    return operand->data.const_value == value;
+}
+
+static int power_of_two(const IROperand *operand)
+{
+    if (!ir_operand_is_int_const(operand) || operand->data.const_value < 2)
+        return -1;
+    uint64_t value = (uint64_t)operand->data.const_value;
+    if (value & (value - 1))
+        return -1;
+    int k = 0;
+    while (value > 1)
+    {
+        value >>= 1;
+        k++;
+    }
+    return k;
+}
+
+static bool is_temp(const SimplifyContext *ctx, const IROperand *operand)
+{
+    return operand && operand->type == IR_OP_TEMP && operand->data.temp_id >= 0 &&
+           (size_t)operand->data.temp_id < ctx->temp_count;
+}
+
+static IRInstruction *single_def(SimplifyContext *ctx, const IROperand *operand, size_t *index)
+{
+    if (!is_temp(ctx, operand))
+        return NULL;
+    size_t def = ctx->defs[operand->data.temp_id];
+    if (def == DEF_NONE || def == DEF_MULTIPLE)
+        return NULL;
+    *index = def - 1;
+    return ir_function_instr_at(ctx->func, def - 1);
+}
+
+/* The operand a definition read must still hold the same value at the
+   current instruction: constants and single-definition temps always do,
+   anything else only when the definition immediately precedes it. */
+static bool unchanged_since(SimplifyContext *ctx, const IROperand *operand, size_t def_index)
+{
+    if (!operand)
+        return false;
+    if (operand->type == IR_OP_CONST)
+        return true;
+    size_t ignored;
+    if (single_def(ctx, operand, &ignored))
+        return true;
+    return def_index + 1 == ctx->index;
+}
+
+static bool is_non_negative(const SimplifyContext *ctx, const IROperand *operand)
+{
+    if (ir_operand_is_int_const(operand))
+        return operand->data.const_value >= 0;
+    if (operand && operand->type == IR_OP_VAR)
+        return hashtable_get(ctx->var_signs, operand->data.var_name) == SIGN_NON_NEGATIVE;
+    return is_temp(ctx, operand) && ctx->non_negative[operand->data.temp_id];
+}
+
+static void rewrite_move(IRInstruction *instr, IROperand *source)
+{
+    if (instr->arg1 != source)
+        ir_operand_destroy(instr->arg1);
+    if (instr->arg2 != source)
+        ir_operand_destroy(instr->arg2);
+    instr->opcode = IR_MOVE;
+    instr->arg1 = source;
+    instr->arg2 = NULL;
+}
+
+static void rewrite_const(IRInstruction *instr, int64_t value)
+{
+    IROperand *constant = ir_operand_const(value);
+    constant->data_type = instr->result->data_type;
+    ir_operand_destroy(instr->arg1);
+    ir_operand_destroy(instr->arg2);
+    instr->opcode = IR_MOVE;
+    instr->arg1 = constant;
+    instr->arg2 = NULL;
+}
+
+static void rewrite_binary(IRInstruction *instr, IROpcode opcode, IROperand *source, int64_t value)
+{
+    IROperand *constant = ir_operand_const(value);
+    constant->data_type = TYPE_INT;
+    if (instr->arg1 != source)
+        ir_operand_destroy(instr->arg1);
+    if (instr->arg2 != source)
+        ir_operand_destroy(instr->arg2);
+    instr->opcode = opcode;
+    instr->arg1 = source;
+    instr->arg2 = constant;
+}
+
+/* For commutative operations, finds the non-constant side of `x op c`. */
+static IROperand *other_side(IRInstruction *instr, int64_t value)
+{
+    if (is_const_value(instr->arg2, value))
+        return instr->arg1;
+    if (is_const_value(instr->arg1, value))
+        return instr->arg2;
+    return NULL;
+}
+
+static bool rule_add_zero(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    IROperand *x = other_side(instr, 0);
+    if (!x)
+        return false;
+    rewrite_move(instr, x);
+    return true;
+}
+
+static bool rule_sub_zero(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    if (!is_const_value(instr->arg2, 0))
+        return false;
+    rewrite_move(instr, instr->arg1);
+    return true;
+}
+
+static bool rule_sub_self(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    if (!ir_operand_same(instr->arg1, instr->arg2))
+        return false;
+    rewrite_const(instr, 0);
+    return true;
+}
+
+static bool rule_mul_one(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    IROperand *x = other_side(instr, 1);
+    if (!x)
+        return false;
+    rewrite_move(instr, x);
+    return true;
+}
+
+static bool rule_mul_minus_one(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    IROperand *x = other_side(instr, -1);
+    if (!x)
+        return false;
+    if (instr->arg1 != x)
+        ir_operand_destroy(instr->arg1);
+    if (instr->arg2 != x)
+        ir_operand_destroy(instr->arg2);
+    instr->opcode = IR_NEG;
+    instr->arg1 = x;
+    instr->arg2 = NULL;
+    return true;
+}
+
+static bool rule_mul_zero(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    if (!other_side(instr, 0))
+        return false;
+    rewrite_const(instr, 0);
+    return true;
+}
+
+/* The C backend writes the shift as a signed <<, which is undefined for
+   negative values where the multiply is not. */
+static bool rule_mul_pow2(SimplifyContext *ctx, IRInstruction *instr)
+{
+    int k = power_of_two(instr->arg2);
+    IROperand *x = instr->arg1;
+    if (k < 0)
+    {
+        k = power_of_two(instr->arg1);
+        x = instr->arg2;
+    }
+    if (k < 0 || x->type == IR_OP_CONST || !is_non_negative(ctx, x))
+        return false;
+    rewrite_binary(instr, IR_SHL, x, k);
+    return true;
+}
+
+static bool rule_div_one(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    if (!is_const_value(instr->arg2, 1))
+        return false;
+    rewrite_move(instr, instr->arg1);
+    return true;
+}
+
+/* Signed division rounds towards zero, so the shift is only exact for
+   dividends that are known to be non-negative. The same holds for %. */
+static bool rule_div_pow2(SimplifyContext *ctx, IRInstruction *instr)
+{
+    int k = power_of_two(instr->arg2);
+    if (k < 0 || !is_non_negative(ctx, instr->arg1))
+        return false;
+    rewrite_binary(instr, IR_SHR, instr->arg1, k);
+    return true;
+}
+
+static bool rule_mod_one(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    if (!is_const_value(instr->arg2, 1) && !is_const_value(instr->arg2, -1))
+        return false;
+    rewrite_const(instr, 0);
+    return true;
+}
+
+static bool rule_mod_pow2(SimplifyContext *ctx, IRInstruction *instr)
+{
+    int k = power_of_two(instr->arg2);
+    if (k < 0 || !is_non_negative(ctx, instr->arg1))
+        return false;
+    rewrite_binary(instr, IR_BAND, instr->arg1, (int64_t)((UINT64_C(1) << k) - 1));
+    return true;
+}
+
+static bool rule_compare_self(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    if (!ir_operand_same(instr->arg1, instr->arg2))
+        return false;
+    bool holds = instr->opcode == IR_EQ || instr->opcode == IR_LE || instr->opcode == IR_GE;
+    rewrite_const(instr, holds ? 1 : 0);
+    return true;
+}
+
+static bool is_bool_operand(const IROperand *operand)
+{
+    return operand && (operand->data_type == TYPE_BOOL ||
+                       (ir_operand_is_int_const(operand) && (operand->data.const_value & ~INT64_C(1)) == 0));
+}
+
+/* && and || yield 0 or 1, so the identity only holds for boolean x. */
+static bool rule_logic_identity(SimplifyContext *ctx, IRInstruction *instr)
+{
+    (void)ctx;
+    int64_t identity = instr->opcode == IR_AND ? 1 : 0;
+    IROperand *x = other_side(instr, identity);
+    if (x && is_bool_operand(x))
+    {
+        rewrite_move(instr, x);
+        return true;
+    }
+    if (other_side(instr, 1 - identity))
+    {
+        rewrite_const(instr, 1 - identity);
+        return true;
+    }
+    return false;
+}
+
+static bool rule_double_not(SimplifyContext *ctx, IRInstruction *instr)
+{
+    size_t def_index;
+    IRInstruction *def = single_def(ctx, instr->arg1, &def_index);
+    if (!def || def->opcode != IR_NOT || !unchanged_since(ctx, def->arg1, def_index))
+        return false;
+
+    IROperand *inner = ir_operand_copy(def->arg1);
+    if (is_bool_operand(inner))
+    {
+        rewrite_move(instr, inner);
+    }
+    else
+    {
+        rewrite_binary(instr, IR_NE, inner, 0);
+    }
+    return true;
+}
+
+static bool rule_double_neg(SimplifyContext *ctx, IRInstruction *instr)
+{
+    size_t def_index;
+    IRInstruction *def = single_def(ctx, instr->arg1, &def_index);
+    if (!def || def->opcode != IR_NEG || !unchanged_since(ctx, def->arg1, def_index))
+        return false;
+    rewrite_move(instr, ir_operand_copy(def->arg1));
+    return true;
+}
+
+static const SimplifyRule simplify_rules[] = {
+    {"simplify: x + 0 -> x", IR_ADD, RULE_INT, rule_add_zero},
+    {"simplify: x - 0 -> x", IR_SUB, RULE_ANY, rule_sub_zero},
+    {"simplify: x - x -> 0", IR_SUB, RULE_INT, rule_sub_self},
+    {"simplify: x * 1 -> x", IR_MUL, RULE_ANY, rule_mul_one},
+    {"simplify: x * -1 -> -x", IR_MUL, RULE_ANY, rule_mul_minus_one},
+    {"simplify: x * 0 -> 0", IR_MUL, RULE_INT, rule_mul_zero},
+    {"simplify: x * 2^k -> x << k", IR_MUL, RULE_INT, rule_mul_pow2},
+    {"simplify: x / 1 -> x", IR_DIV, RULE_ANY, rule_div_one},
+    {"simplify: x / 2^k -> x >> k", IR_DIV, RULE_INT, rule_div_pow2},
+    {"simplify: x % 1 -> 0", IR_MOD, RULE_INT, rule_mod_one},
+    {"simplify: x % 2^k -> x & m", IR_MOD, RULE_INT, rule_mod_pow2},
+    {"simplify: x == x -> true", IR_EQ, RULE_INT, rule_compare_self},
+    {"simplify: x != x -> false", IR_NE, RULE_INT, rule_compare_self},
+    {"simplify: x < x -> false", IR_LT, RULE_INT, rule_compare_self},
+    {"simplify: x <= x -> true", IR_LE, RULE_INT, rule_compare_self},
+    {"simplify: x > x -> false", IR_GT, RULE_INT, rule_compare_self},
+    {"simplify: x >= x -> true", IR_GE, RULE_INT, rule_compare_self},
+    {"simplify: b && c", IR_AND, RULE_INT, rule_logic_identity},
+    {"simplify: b || c", IR_OR, RULE_INT, rule_logic_identity},
+    {"simplify: !!b -> b", IR_NOT, RULE_INT, rule_double_not},
+    {"simplify: -(-x) -> x", IR_NEG, RULE_ANY, rule_double_neg},
+};
+
+static void record_def(SimplifyContext *ctx, IROperand *def, size_t index)
+{
+    if (!is_temp(ctx, def))
+        return;
+    size_t *slot = &ctx->defs[def->data.temp_id];
+    *slot = *slot == DEF_NONE ? index + 1 : DEF_MULTIPLE;
+}
+
+/* Sums and products of non-negative values are assumed not to overflow,
+   as signed overflow is undefined in the generated code anyway. */
+static bool computes_non_negative(SimplifyContext *ctx, const IRInstruction *instr)
+{
+    if (is_float_instruction(instr))
+        return false;
+
+    switch (instr->opcode)
+    {
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+    case IR_AND:
+    case IR_OR:
+    case IR_NOT:
+        return true;
+    case IR_MOVE:
+    case IR_MOD:
+    case IR_SHR:
+        return is_non_negative(ctx, instr->arg1);
+    case IR_SHL:
+        return is_non_negative(ctx, instr->arg1);
+    case IR_ADD:
+    case IR_MUL:
+    case IR_DIV:
+        return is_non_negative(ctx, instr->arg1) && is_non_negative(ctx, instr->arg2);
+    case IR_BAND:
+        return is_non_negative(ctx, instr->arg1) || is_non_negative(ctx, instr->arg2);
+    default:
+        return false;
+    }
+}
+
+/* Greatest fixpoint: every temp with a single definition and every local
+   variable starts out non-negative and is demoted once one of its
+   definitions may produce a negative value. Parameters are unknown, and
+   inline assembly may write any variable behind our back. */
+static void analyze_function(SimplifyContext *ctx)
+{
+    IRFunction *func = ctx->func;
+    void *initial_sign = SIGN_NON_NEGATIVE;
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        if (ir_function_instr_at(func, i)->opcode == IR_INLINE_ASM)
+            initial_sign = SIGN_UNKNOWN;
+    }
+    for (size_t i = 0; i < func->params.size; i++)
+    {
+        IROperand *param = (IROperand *)array_get(&func->params, i);
+        if (param && param->type == IR_OP_VAR)
+            hashtable_put(ctx->var_signs, param->data.var_name, SIGN_UNKNOWN);
+    }
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IROperand *def = ir_instruction_def(ir_function_instr_at(func, i));
+        record_def(ctx, def, i);
+        if (def && def->type == IR_OP_VAR && !hashtable_contains(ctx->var_signs, def->data.var_name))
+            hashtable_put(ctx->var_signs, def->data.var_name, initial_sign);
+    }
+    for (size_t t = 0; t < ctx->temp_count; t++)
+    {
+        ctx->non_negative[t] = ctx->defs[t] != DEF_NONE && ctx->defs[t] != DEF_MULTIPLE;
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 0; i < func->instructions.size; i++)
+        {
+            IRInstruction *instr = ir_function_instr_at(func, i);
+            IROperand *def = ir_instruction_def(instr);
+            if (!is_non_negative(ctx, def) || computes_non_negative(ctx, instr))
+                continue;
+
+            if (def->type == IR_OP_VAR)
+                hashtable_put(ctx->var_signs, def->data.var_name, SIGN_UNKNOWN);
+            else
+                ctx->non_negative[def->data.temp_id] = false;
+            changed = true;
+        }
+    }
+}
+
+static bool simplify_function(IRFunction *func)
+{
+    SimplifyContext ctx;
+    ctx.func = func;
+    ctx.temp_count = func->temp_counter > 0 ? (size_t)func->temp_counter : 0;
+    ctx.defs = safe_malloc((ctx.temp_count + 1) * sizeof(size_t));
+    ctx.non_negative = safe_malloc((ctx.temp_count + 1) * sizeof(bool));
+    memset(ctx.defs, 0, (ctx.temp_count + 1) * sizeof(size_t));
+    memset(ctx.non_negative, 0, (ctx.temp_count + 1) * sizeof(bool));
+    ctx.var_signs = hashtable_create(32);
+    analyze_function(&ctx);
+
+    bool changed = false;
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (!instr || !instr->result || instr->result->vector_width > 0)
+            continue;
+
+        ctx.index = i;
+        bool is_float = is_float_instruction(instr);
+        for (size_t r = 0; r < sizeof(simplify_rules) / sizeof(simplify_rules[0]); r++)
+        {
+            const SimplifyRule *rule = &simplify_rules[r];
+            if (rule->opcode != instr->opcode || (rule->types == RULE_INT && is_float))
+                continue;
+            if (rule->apply(&ctx, instr))
+            {
+                if (debug_enabled)
+                {
+                    printf("[DEBUG] Simplify: %s at %zu in %s\n", rule->name + 10, i, func->name);
+                }
+                optimization_stats_add(rule->name, 1);
+                changed = true;
+                break;
+            }
+        }
+    }
+
+    safe_free(ctx.defs);
+    safe_free(ctx.non_negative);
+    hashtable_destroy(ctx.var_signs);
+    return changed;
+}
+
+bool optimization_algebraic_simplification(IRProgram *program)
+{
+    return optimization_run_per_function(program, simplify_function);
+}
@@ -0,0 +1,272 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+#define TAIL_ACC_NAME "__tre_acc"
+
+typedef struct TailSite {
+    size_t call_index;
+    size_t return_index;
+    IRInstruction *accumulate;
+    IROperand *accumulate_operand;
+} TailSite;
+
+static IRInstruction *next_instruction(IRFunction *func, size_t index, size_t *found)
+{
+    for (size_t i = index + 1; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (instr && instr->opcode != IR_NOP)
+        {
+            *found = i;
+            return instr;
+        }
+    }
+    return NULL;
+}
+
+static bool returns_call_result(IRFunction *func, IRInstruction *call, IRInstruction *ret)
+{
+    if (!ret)
+        return !call->result && func->return_type == TYPE_VOID;
+    if (ret->opcode != IR_RETURN)
+        return false;
+    if (!call->result)
+        return !ret->arg1 && func->return_type == TYPE_VOID;
+    return ret->arg1 && ir_operand_same(call->result, ret->arg1);
+}
+
+static bool match_accumulator(IRFunction *func, IRInstruction *call, size_t call_index, TailSite *site, IROpcode *acc_op)
+{
+    size_t op_index = 0;
+    IRInstruction *op = next_instruction(func, call_index, &op_index);
+    if (!op || !call->result || func->return_type != TYPE_INT)
+        return false;
+    if (op->opcode != IR_ADD && op->opcode != IR_MUL)
+        return false;
+    if (!op->result || op->result->data_type != TYPE_INT)
+        return false;
+
+    IROperand *other = NULL;
+    if (ir_operand_same(op->arg1, call->result) && !ir_operand_same(op->arg2, call->result))
+        other = op->arg2;
+    else if (ir_operand_same(op->arg2, call->result) && !ir_operand_same(op->arg1, call->result))
+        other = op->arg1;
+    if (!other || other->is_float_const || other->data_type == TYPE_FLOAT || other->data_type == TYPE_DOUBLE)
+        return false;
+
+    size_t ret_index = 0;
+    IRInstruction *ret = next_instruction(func, op_index, &ret_index);
+    if (!ret || ret->opcode != IR_RETURN || !ir_operand_same(ret->arg1, op->result))
+        return false;
+    if (*acc_op != IR_NOP && *acc_op != op->opcode)
+        return false;
+
+    *acc_op = op->opcode;
+    site->return_index = ret_index;
+    site->accumulate = op;
+    site->accumulate_operand = other;
+    return true;
+}
+
+static void release_instruction(IRInstruction *instr, IROperand *keep)
+{
+    if (instr->result == keep)
+        instr->result = NULL;
+    if (instr->arg1 == keep)
+        instr->arg1 = NULL;
+    if (instr->arg2 == keep)
+        instr->arg2 = NULL;
+    ir_instruction_destroy(instr);
+}
+
+static bool eliminate_self_tail_calls(IRFunction *func)
+{
+    size_t param_count = func->params.size;
+    if (param_count > MAX_PARAMS)
+        return false;
+
+    DynamicArray sites;
+    array_init(&sites, 4);
+    IROpcode acc_op = IR_NOP;
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (!instr || instr->opcode != IR_CALL || !string_equal(instr->label, func->name))
+            continue;
+
+        size_t param_indices[MAX_PARAMS + 1];
+        if (ir_call_collect_params(func, i, param_indices, MAX_PARAMS) != param_count)
+            continue;
+
+        TailSite *site = safe_malloc(sizeof(TailSite));
+        site->call_index = i;
+        site->accumulate = NULL;
+        site->accumulate_operand = NULL;
+
+        size_t ret_index = 0;
+        IRInstruction *ret = next_instruction(func, i, &ret_index);
+        if (returns_call_result(func, instr, ret))
+        {
+            site->return_index = ret ? ret_index : i;
+            array_push(&sites, site);
+        }
+        else if (match_accumulator(func, instr, i, site, &acc_op))
+        {
+            array_push(&sites, site);
+        }
+        else
+        {
+            safe_free(site);
+        }
+    }
+
+    if (sites.size == 0)
+    {
+        array_free(&sites);
+        return false;
+    }
+
+    char *entry_label = ir_function_new_label(func);
+    bool use_accumulator = acc_op != IR_NOP;
+
+    DynamicArray new_instructions;
+    array_init(&new_instructions, func->instructions.size + 8);
+
+    if (use_accumulator)
+    {
+        array_push(&new_instructions, ir_instruction_var_decl(TAIL_ACC_NAME, TYPE_INT));
+        IROperand *acc = ir_operand_var(TAIL_ACC_NAME);
+        array_push(&new_instructions, ir_instruction_move(acc, ir_operand_const(acc_op == IR_MUL ? 1 : 0)));
+    }
+    array_push(&new_instructions, ir_instruction_label(entry_label));
+
+    size_t next_site = 0;
+    size_t param_indices[MAX_PARAMS + 1];
+    IROperand *param_temps[MAX_PARAMS];
+    TailSite *site = (TailSite *)array_get(&sites, 0);
+    ir_call_collect_params(func, site->call_index, param_indices, MAX_PARAMS);
+    size_t param_seen = 0;
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (!instr)
+            continue;
+
+        if (site && param_seen < param_count && i == param_indices[param_seen])
+        {
+            IROperand *formal = (IROperand *)array_get(&func->params, param_seen);
+            IROperand *temp = ir_operand_temp(ir_function_new_temp(func));
+            temp->data_type = formal->data_type;
+            instr->opcode = IR_MOVE;
+            instr->result = temp;
+            param_temps[param_seen++] = temp;
+            array_push(&new_instructions, instr);
+            continue;
+        }
+
+        if (site && i == site->call_index)
+        {
+            if (site->accumulate)
+            {
+                IROperand *acc = ir_operand_var(TAIL_ACC_NAME);
+                IROperand *acc_value = ir_operand_var(TAIL_ACC_NAME);
+                array_push(&new_instructions, ir_instruction_binary(acc_op, acc, acc_value, site->accumulate_operand));
+            }
+            for (size_t p = 0; p < param_count; p++)
+            {
+                IROperand *formal = (IROperand *)array_get(&func->params, p);
+                IROperand *target = ir_operand_copy(formal);
+                array_push(&new_instructions, ir_instruction_move(target, ir_operand_copy(param_temps[p])));
+            }
+            array_push(&new_instructions, ir_instruction_jump(entry_label));
+
+            if (debug_enabled)
+            {
+                printf("[DEBUG] Tail call: rewrote %s self call at %zu into a loop%s\n",
+                       func->name, i, site->accumulate ? " (accumulator)" : "");
+            }
+
+            size_t end = site->return_index;
+            for (size_t j = i; j <= end; j++)
+            {
+                IRInstruction *dead = (IRInstruction *)array_get(&func->instructions, j);
+                if (dead)
+                    release_instruction(dead, dead == site->accumulate ? site->accumulate_operand : NULL);
+            }
+            i = end;
+
+            next_site++;
+            site = next_site < sites.size ? (TailSite *)array_get(&sites, next_site) : NULL;
+            param_seen = 0;
+            if (site)
+                ir_call_collect_params(func, site->call_index, param_indices, MAX_PARAMS);
+            continue;
+        }
+
+        if (use_accumulator && instr->opcode == IR_RETURN && instr->arg1)
+        {
+            IROperand *combined = ir_operand_temp(ir_function_new_temp(func));
+            combined->data_type = TYPE_INT;
+            array_push(&new_instructions, ir_instruction_binary(acc_op, combined, ir_operand_var(TAIL_ACC_NAME), instr->arg1));
+            instr->arg1 = ir_operand_copy(combined);
+        }
+
+        array_push(&new_instructions, instr);
+    }
+
+    safe_free(func->instructions.data);
+    func->instructions = new_instructions;
+
+    for (size_t i = 0; i < sites.size; i++)
+        safe_free(array_get(&sites, i));
+    array_free(&sites);
+    safe_free(entry_label);
+    return true;
+}
+
+static bool mark_tail_calls(IRFunction *func)
+{
+    bool changed = false;
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = (IRInstruction *)array_get(&func->instructions, i);
+        if (!instr || instr->opcode != IR_CALL || instr->is_tail_call)
+            continue;
+        if (strncmp(instr->label, "__tl_", 5) == 0)
+            continue;
+
+        size_t param_indices[MAX_PARAMS + 1];
+        if (ir_call_collect_params(func, i, param_indices, MAX_PARAMS) > 4)
+            continue;
+
+        size_t ret_index = 0;
+        IRInstruction *ret = next_instruction(func, i, &ret_index);
+        if (returns_call_result(func, instr, ret))
+        {
+            instr->is_tail_call = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+static bool optimize_function_tail_calls(IRFunction *func)
+{
+    bool changed = eliminate_self_tail_calls(func);
+    if (mark_tail_calls(func))
+        changed = true;
+    return changed;
+}
+
+bool optimization_tail_call_elimination(IRProgram *program)
+{
+    return optimization_run_per_function(program, optimize_function_tail_calls);
+}
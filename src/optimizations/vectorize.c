@@ -0,0 +1,573 @@
+#include "optimizations/optimizer.h"
+#include "optimizations/cfg.h"
+#include "optimizations/loops.h"
+#include "backend/ir/irCore.h"
+#include "backend/ir/irOps.h"
+#include "backend/ir/irinstructions.h"
+#include "common/common.h"
+
+extern bool debug_enabled;
+
+#define VECTOR_BYTES 16
+#define MAX_VECTOR_BODY_SIZE 256
+
+typedef enum {
+    VECTOR_SKIP,
+    VECTOR_EMIT,
+    VECTOR_REDUCE
+} VectorAction;
+
+typedef struct VectorLoop {
+    CountedLoop loop;
+    DataType element_type;
+    int width;
+    bool lower_check;
+    int64_t upper_limit;
+    IROperand *reduction;
+    VectorAction *actions;
+} VectorLoop;
+
+typedef struct VectorEmitter {
+    IRFunction *func;
+    VectorLoop *vl;
+    DynamicArray *preheader;
+    DynamicArray *body;
+    HashTable *vectors;
+    HashTable *splats;
+    IROperand *index_vector;
+} VectorEmitter;
+
+static int vector_width_for(DataType type)
+{
+    switch (type)
+    {
+    case TYPE_INT:
+    case TYPE_DOUBLE:
+        return VECTOR_BYTES / 8;
+    case TYPE_FLOAT:
+        return optimization_options.vectorize_floats ? VECTOR_BYTES / 4 : 0;
+    default:
+        return 0;
+    }
+}
+
+static void operand_key(const IROperand *operand, char *key, size_t size)
+{
+    switch (operand->type)
+    {
+    case IR_OP_TEMP:
+        snprintf(key, size, "#%d", operand->data.temp_id);
+        break;
+    case IR_OP_VAR:
+        snprintf(key, size, "%s", operand->data.var_name);
+        break;
+    case IR_OP_CONST:
+        if (operand->is_float_const)
+            snprintf(key, size, "=%a", operand->data.float_const_value);
+        else
+            snprintf(key, size, "=%lld", (long long)operand->data.const_value);
+        break;
+    default:
+        key[0] = '\0';
+        break;
+    }
+}
+
+static IROperand *new_vector_temp(IRFunction *func, DataType type, int width)
+{
+    IROperand *operand = ir_operand_temp(ir_function_new_temp(func));
+    operand->data_type = type;
+    operand->vector_width = width;
+    return operand;
+}
+
+static IRInstruction *find_local_array(IRFunction *func, const IROperand *array)
+{
+    if (!array || array->type != IR_OP_VAR)
+        return NULL;
+
+    for (size_t i = 0; i < func->instructions.size; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if ((instr->opcode == IR_ARRAY_DECL || instr->opcode == IR_ARRAY_INIT) && instr->result &&
+            instr->result->array_size > 0 && string_equal(instr->result->data.var_name, array->data.var_name))
+            return instr;
+    }
+    return NULL;
+}
+
+static bool match_array_access(IRFunction *func, VectorLoop *vl, IRInstruction *instr)
+{
+    if (!ir_operand_same(instr->arg2, vl->loop.iv))
+        return false;
+
+    IRInstruction *decl = find_local_array(func, instr->arg1);
+    if (!decl)
+        return false;
+
+    DataType element_type = decl->result->data_type;
+    if (vl->width == 0)
+    {
+        vl->element_type = element_type;
+        vl->width = vector_width_for(element_type);
+    }
+    return vl->width > 0 && element_type == vl->element_type;
+}
+
+static size_t match_bounds_check(IRFunction *func, VectorLoop *vl, size_t index)
+{
+    IRInstruction *compare = ir_function_instr_at(func, index);
+    if (index + 1 >= vl->loop.update_start || !compare->result || compare->result->type != IR_OP_TEMP ||
+        !ir_operand_same(compare->arg1, vl->loop.iv) || !ir_operand_is_int_const(compare->arg2))
+        return 0;
+
+    IRInstruction *jump = ir_function_instr_at(func, index + 1);
+    if (jump->opcode != IR_JUMP_IF || !ir_operand_same(jump->arg1, compare->result))
+        return 0;
+
+    int64_t limit = compare->arg2->data.const_value;
+    if (compare->opcode == IR_LT && limit == 0)
+    {
+        vl->lower_check = true;
+        return 2;
+    }
+    if (compare->opcode == IR_GE && limit > 0)
+    {
+        if (vl->upper_limit < 0 || limit < vl->upper_limit)
+            vl->upper_limit = limit;
+        return 2;
+    }
+    return 0;
+}
+
+static bool is_defined_in(HashTable *defs, const IROperand *operand)
+{
+    char key[64];
+    operand_key(operand, key, sizeof(key));
+    return key[0] && hashtable_contains(defs, key);
+}
+
+/* Invariant operands are splatted with a C-style conversion to the lane type,
+   which only matches the scalar code when that conversion is exact. */
+static bool is_vectorizable_invariant(const VectorLoop *vl, const IROperand *operand, HashTable *defs)
+{
+    if (operand->type == IR_OP_CONST)
+    {
+        if (!operand->is_float_const && operand->data_type != TYPE_FLOAT && operand->data_type != TYPE_DOUBLE)
+            return true;
+        if (vl->element_type == TYPE_DOUBLE)
+            return true;
+        return vl->element_type == TYPE_FLOAT &&
+               (double)(float)operand->data.float_const_value == operand->data.float_const_value;
+    }
+    if (operand->type != IR_OP_VAR && operand->type != IR_OP_TEMP)
+        return false;
+    if (operand->array_size >= 0 || operand->vector_width > 0 || is_defined_in(defs, operand))
+        return false;
+    return operand->data_type == vl->element_type || operand->data_type == TYPE_INT ||
+           (vl->element_type == TYPE_DOUBLE && operand->data_type == TYPE_FLOAT);
+}
+
+static bool is_vectorizable_operand(const VectorLoop *vl, const IROperand *operand, HashTable *defs,
+                                    HashTable *vectors)
+{
+    if (!operand)
+        return false;
+    if (ir_operand_same(operand, vl->loop.iv))
+        return true;
+
+    char key[64];
+    operand_key(operand, key, sizeof(key));
+    if (key[0] && hashtable_contains(vectors, key))
+        return true;
+    return is_vectorizable_invariant(vl, operand, defs);
+}
+
+static size_t count_operand_uses(IRFunction *func, const VectorLoop *vl, const IROperand *operand)
+{
+    size_t count = 0;
+    for (size_t i = vl->loop.body_start; i < vl->loop.latch; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        IROperand **uses[IR_MAX_INSTRUCTION_USES + 16];
+        size_t use_count = ir_instruction_uses(instr, uses, IR_MAX_INSTRUCTION_USES + 16);
+        for (size_t u = 0; u < use_count; u++)
+        {
+            if (ir_operand_same(*uses[u], operand))
+                count++;
+        }
+    }
+    return count;
+}
+
+static bool match_reduction(IRFunction *func, VectorLoop *vl, size_t index, HashTable *vectors)
+{
+    IRInstruction *add = ir_function_instr_at(func, index);
+    if (add->opcode != IR_ADD || vl->reduction || vl->element_type != TYPE_INT || index + 1 >= vl->loop.update_start)
+        return false;
+
+    IRInstruction *move = ir_function_instr_at(func, index + 1);
+    if (move->opcode != IR_MOVE || !ir_operand_same(move->arg1, add->result) || !move->result ||
+        move->result->type != IR_OP_VAR || move->result->data_type != TYPE_INT || move->result->array_size >= 0)
+        return false;
+
+    IROperand *accumulator = move->result;
+    IROperand *value = ir_operand_same(add->arg1, accumulator) ? add->arg2 : add->arg1;
+    if (!ir_operand_same(add->arg1, accumulator) && !ir_operand_same(add->arg2, accumulator))
+        return false;
+
+    char key[64];
+    operand_key(value, key, sizeof(key));
+    if (value->type != IR_OP_TEMP || !hashtable_contains(vectors, key))
+        return false;
+    if (count_operand_uses(func, vl, accumulator) != 1 || count_operand_uses(func, vl, add->result) != 1)
+        return false;
+
+    vl->reduction = accumulator;
+    return true;
+}
+
+static bool analyze_vector_loop(IRFunction *func, VectorLoop *vl)
+{
+    const CountedLoop *loop = &vl->loop;
+    if (loop->compare != IR_LT || loop->step != 1 || loop->update_end != loop->latch)
+        return false;
+    if (loop->latch - loop->body_start > MAX_VECTOR_BODY_SIZE)
+        return false;
+
+    HashTable *defs = hashtable_create(32);
+    HashTable *vectors = hashtable_create(32);
+    char key[64];
+    bool ok = true;
+    bool has_store = false;
+
+    for (size_t i = loop->body_start; ok && i < loop->latch; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        IROperand *def = ir_instruction_def(instr);
+        if (def)
+        {
+            operand_key(def, key, sizeof(key));
+            hashtable_put(defs, key, (void *)1);
+        }
+        if (instr->opcode == IR_ARRAY_LOAD || instr->opcode == IR_ARRAY_STORE)
+        {
+            ok = match_array_access(func, vl, instr);
+        }
+    }
+    ok = ok && vl->width > 0;
+
+    for (size_t i = loop->body_start; ok && i < loop->update_start; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        size_t check = match_bounds_check(func, vl, i);
+        if (check > 0)
+        {
+            vl->actions[i] = VECTOR_SKIP;
+            vl->actions[i + 1] = VECTOR_SKIP;
+            i += check - 1;
+            continue;
+        }
+
+        switch (instr->opcode)
+        {
+        case IR_NOP:
+            vl->actions[i] = VECTOR_SKIP;
+            break;
+        case IR_ARRAY_LOAD:
+            ok = instr->result->type == IR_OP_TEMP && instr->result->data_type == vl->element_type;
+            break;
+        case IR_ARRAY_STORE:
+            ok = is_vectorizable_operand(vl, instr->result, defs, vectors);
+            has_store = true;
+            break;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+            if (match_reduction(func, vl, i, vectors))
+            {
+                vl->actions[i] = VECTOR_REDUCE;
+                vl->actions[i + 1] = VECTOR_SKIP;
+                i++;
+                continue;
+            }
+            ok = instr->result->type == IR_OP_TEMP && instr->result->data_type == vl->element_type &&
+                 is_vectorizable_operand(vl, instr->arg1, defs, vectors) &&
+                 is_vectorizable_operand(vl, instr->arg2, defs, vectors);
+            break;
+        case IR_SHL:
+        case IR_SHR:
+        case IR_BAND:
+            /* Packed shifts take one count for every lane. */
+            ok = vl->element_type == TYPE_INT && instr->result->type == IR_OP_TEMP &&
+                 (instr->opcode == IR_BAND || ir_operand_is_int_const(instr->arg2)) &&
+                 is_vectorizable_operand(vl, instr->arg1, defs, vectors) &&
+                 is_vectorizable_operand(vl, instr->arg2, defs, vectors);
+            break;
+        default:
+            ok = false;
+            break;
+        }
+
+        if (ok && instr->opcode != IR_NOP)
+        {
+            vl->actions[i] = VECTOR_EMIT;
+            IROperand *result = ir_instruction_def(instr);
+            if (result)
+            {
+                operand_key(result, key, sizeof(key));
+                hashtable_put(vectors, key, (void *)1);
+            }
+        }
+    }
+
+    hashtable_destroy(defs);
+    hashtable_destroy(vectors);
+    return ok && (has_store || vl->reduction);
+}
+
+static IROperand *vector_operand(VectorEmitter *e, IROperand *operand)
+{
+    VectorLoop *vl = e->vl;
+    char key[64];
+
+    if (ir_operand_same(operand, vl->loop.iv))
+    {
+        if (!e->index_vector)
+        {
+            e->index_vector = new_vector_temp(e->func, vl->element_type, vl->width);
+            array_push(e->body, ir_instruction_unary(IR_VECTOR_INDEX, e->index_vector, ir_operand_copy(operand)));
+        }
+        return ir_operand_copy(e->index_vector);
+    }
+
+    operand_key(operand, key, sizeof(key));
+    IROperand *vector = (IROperand *)hashtable_get(e->vectors, key);
+    if (vector)
+        return ir_operand_copy(vector);
+
+    IROperand *splat = (IROperand *)hashtable_get(e->splats, key);
+    if (!splat)
+    {
+        splat = new_vector_temp(e->func, vl->element_type, vl->width);
+        array_push(e->preheader, ir_instruction_unary(IR_VECTOR_SPLAT, splat, ir_operand_copy(operand)));
+        hashtable_put(e->splats, key, splat);
+    }
+    return ir_operand_copy(splat);
+}
+
+static void emit_vector_instruction(VectorEmitter *e, IRInstruction *instr)
+{
+    VectorLoop *vl = e->vl;
+    char key[64];
+
+    switch (instr->opcode)
+    {
+    case IR_ARRAY_LOAD:
+    {
+        IROperand *result = new_vector_temp(e->func, vl->element_type, vl->width);
+        array_push(e->body, ir_instruction_array_load(result, ir_operand_copy(instr->arg1),
+                                                      ir_operand_copy(vl->loop.iv)));
+        operand_key(instr->result, key, sizeof(key));
+        hashtable_put(e->vectors, key, result);
+        break;
+    }
+    case IR_ARRAY_STORE:
+        array_push(e->body, ir_instruction_array_store(ir_operand_copy(instr->arg1), ir_operand_copy(vl->loop.iv),
+                                                       vector_operand(e, instr->result)));
+        break;
+    default:
+    {
+        IROperand *arg1 = vector_operand(e, instr->arg1);
+        IROperand *arg2 = vector_operand(e, instr->arg2);
+        IROperand *result = new_vector_temp(e->func, vl->element_type, vl->width);
+        array_push(e->body, ir_instruction_binary(instr->opcode, result, arg1, arg2));
+        operand_key(instr->result, key, sizeof(key));
+        hashtable_put(e->vectors, key, result);
+        break;
+    }
+    }
+}
+
+static void push_guard(IRFunction *func, DynamicArray *out, IROpcode opcode, IROperand *left, IROperand *right,
+                       bool exit_if_true, const char *exit_label)
+{
+    IROperand *condition = ir_operand_temp(ir_function_new_temp(func));
+    condition->data_type = TYPE_BOOL;
+    array_push(out, ir_instruction_binary(opcode, condition, left, right));
+    if (exit_if_true)
+        array_push(out, ir_instruction_jump_if(ir_operand_copy(condition), exit_label));
+    else
+        array_push(out, ir_instruction_jump_if_false(ir_operand_copy(condition), exit_label));
+}
+
+/* A loop from a constant start to a constant bound inside the checked array
+   that runs a multiple of the lane count needs no scalar epilogue. */
+static bool runs_whole_groups(IRFunction *func, const VectorLoop *vl)
+{
+    const CountedLoop *loop = &vl->loop;
+    int64_t start;
+    if (!ir_operand_is_int_const(loop->bound) || !ir_loop_initial_value(func, loop, &start))
+        return false;
+
+    int64_t bound = loop->bound->data.const_value;
+    return start >= 0 && start <= bound && (vl->upper_limit < 0 || bound <= vl->upper_limit) &&
+           (bound - start) % vl->width == 0;
+}
+
+/* The vector loop runs while a whole group of lanes passes the loop condition
+   and the bounds checks; it then falls into the original loop, which finishes
+   the remaining iterations and still reports out-of-bounds accesses. That
+   epilogue is marked so the unroller leaves it alone. */
+static void vectorize_loop(IRFunction *func, VectorLoop *vl)
+{
+    const CountedLoop *loop = &vl->loop;
+    bool whole_groups = runs_whole_groups(func, vl);
+    DynamicArray preheader;
+    DynamicArray body;
+    array_init(&preheader, 8);
+    array_init(&body, loop->latch - loop->body_start + 8);
+
+    VectorEmitter e = {func, vl, &preheader, &body, hashtable_create(32), hashtable_create(16), NULL};
+    IROperand *accumulator = NULL;
+    if (vl->reduction)
+    {
+        accumulator = new_vector_temp(func, vl->element_type, vl->width);
+        array_push(&preheader, ir_instruction_unary(IR_VECTOR_SPLAT, accumulator, ir_operand_const(0)));
+    }
+
+    for (size_t i = loop->body_start; i < loop->update_start; i++)
+    {
+        IRInstruction *instr = ir_function_instr_at(func, i);
+        if (vl->actions[i] == VECTOR_EMIT)
+        {
+            emit_vector_instruction(&e, instr);
+        }
+        else if (vl->actions[i] == VECTOR_REDUCE)
+        {
+            IROperand *value = ir_operand_same(instr->arg1, vl->reduction) ? instr->arg2 : instr->arg1;
+            array_push(&body, ir_instruction_binary(IR_ADD, ir_operand_copy(accumulator), ir_operand_copy(accumulator),
+                                                    vector_operand(&e, value)));
+        }
+    }
+
+    char *vector_label = ir_function_new_label(func);
+    char *done_label = ir_function_new_label(func);
+    DynamicArray out;
+    array_init(&out, func->instructions.size + preheader.size + body.size + 16);
+
+    for (size_t i = 0; i < loop->header; i++)
+    {
+        array_push(&out, ir_function_instr_at(func, i));
+    }
+    for (size_t i = 0; i < preheader.size; i++)
+    {
+        array_push(&out, array_get(&preheader, i));
+    }
+    if (vl->lower_check && !whole_groups)
+    {
+        push_guard(func, &out, IR_LT, ir_operand_copy(loop->iv), ir_operand_const(0), true, done_label);
+    }
+
+    array_push(&out, ir_instruction_label(vector_label));
+    if (ir_operand_is_int_const(loop->bound))
+    {
+        int64_t limit = loop->bound->data.const_value;
+        if (vl->upper_limit > 0 && vl->upper_limit < limit)
+            limit = vl->upper_limit;
+        push_guard(func, &out, IR_LT, ir_operand_copy(loop->iv), ir_operand_const(limit - (vl->width - 1)), false,
+                   done_label);
+    }
+    else
+    {
+        IROperand *last_lane = ir_operand_temp(ir_function_new_temp(func));
+        last_lane->data_type = TYPE_INT;
+        array_push(&out, ir_instruction_binary(IR_ADD, last_lane, ir_operand_copy(loop->iv),
+                                               ir_operand_const(vl->width - 1)));
+        push_guard(func, &out, IR_LT, ir_operand_copy(last_lane), ir_operand_copy(loop->bound), false, done_label);
+        if (vl->upper_limit > 0)
+        {
+            push_guard(func, &out, IR_LT, ir_operand_copy(last_lane), ir_operand_const(vl->upper_limit), false,
+                       done_label);
+        }
+    }
+    for (size_t i = 0; i < body.size; i++)
+    {
+        array_push(&out, array_get(&body, i));
+    }
+    array_push(&out, ir_instruction_binary(IR_ADD, ir_operand_copy(loop->iv), ir_operand_copy(loop->iv),
+                                           ir_operand_const(vl->width)));
+    array_push(&out, ir_instruction_jump(vector_label));
+    array_push(&out, ir_instruction_label(done_label));
+
+    if (vl->reduction)
+    {
+        IROperand *lanes = ir_operand_temp(ir_function_new_temp(func));
+        lanes->data_type = vl->element_type;
+        IROperand *sum = ir_operand_temp(ir_function_new_temp(func));
+        sum->data_type = vl->element_type;
+        array_push(&out, ir_instruction_unary(IR_VECTOR_REDUCE, lanes, ir_operand_copy(accumulator)));
+        array_push(&out, ir_instruction_binary(IR_ADD, sum, ir_operand_copy(vl->reduction), ir_operand_copy(lanes)));
+        array_push(&out, ir_instruction_move(ir_operand_copy(vl->reduction), ir_operand_copy(sum)));
+    }
+
+    size_t rest = loop->header;
+    if (whole_groups)
+    {
+        for (; rest <= loop->latch; rest++)
+        {
+            ir_instruction_destroy(ir_function_instr_at(func, rest));
+        }
+        optimization_stats_add("vector epilogues omitted", 1);
+    }
+    else
+    {
+        ir_function_instr_at(func, loop->header)->is_epilogue = true;
+    }
+    for (size_t i = rest; i < func->instructions.size; i++)
+    {
+        array_push(&out, ir_function_instr_at(func, i));
+    }
+
+    safe_free(vector_label);
+    safe_free(done_label);
+    array_free(&preheader);
+    array_free(&body);
+    hashtable_destroy(e.vectors);
+    hashtable_destroy(e.splats);
+    ir_function_replace_instructions(func, &out);
+}
+
+static bool vectorize_function_loops(IRFunction *func)
+{
+    bool changed = false;
+
+    for (size_t h = func->instructions.size; h-- > 0;)
+    {
+        VectorLoop vl;
+        memset(&vl, 0, sizeof(vl));
+        vl.upper_limit = -1;
+        if (!ir_loop_match_counted(func, h, &vl.loop))
+            continue;
+
+        vl.actions = safe_malloc(func->instructions.size * sizeof(VectorAction));
+        memset(vl.actions, 0, func->instructions.size * sizeof(VectorAction));
+        if (analyze_vector_loop(func, &vl))
+        {
+            if (debug_enabled)
+            {
+                printf("[DEBUG] Vectorize: Vectorizing loop at %zu in %s (%d lanes)\n", h, func->name, vl.width);
+            }
+            vectorize_loop(func, &vl);
+            optimization_stats_add("loops vectorized", 1);
+            changed = true;
+        }
+        safe_free(vl.actions);
+    }
+    return changed;
+}
+
+bool optimization_vectorize(IRProgram *program)
+{
+    return optimization_run_per_function(program, vectorize_function_loops);
+}
@@ -61,3 +61,120 @@ char* __tl_char_at(const char* str, int64_t index) {
     return result;
 }
 
+static uint64_t memo_hash(const int64_t* args, int arity) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < arity; i++) {
+        uint64_t x = (uint64_t)args[i] + hash;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        hash = x ^ (x >> 31);
+    }
+    return hash;
+}
+
+static size_t memo_find(const TLMemoTable* table, const int64_t* args) {
+    size_t mask = table->capacity - 1;
+    size_t slot = (size_t)memo_hash(args, table->arity) & mask;
+    while (table->used[slot] &&
+           memcmp(&table->keys[slot * table->arity], args, table->arity * sizeof(int64_t)) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+int __tl_memo_lookup(TLMemoTable* table, const int64_t* args, int64_t* value) {
+    if (table->capacity == 0) return 0;
+    size_t slot = memo_find(table, args);
+    if (!table->used[slot]) return 0;
+    *value = table->values[slot];
+    return 1;
+}
+
+static void memo_grow(TLMemoTable* table) {
+    TLMemoTable old = *table;
+    table->capacity = old.capacity ? old.capacity * 2 : 64;
+    table->count = 0;
+    table->keys = (int64_t*)malloc(table->capacity * table->arity * sizeof(int64_t));
+    table->values = (int64_t*)malloc(table->capacity * sizeof(int64_t));
+    table->used = (unsigned char*)calloc(table->capacity, 1);
+    if (!table->keys || !table->values || !table->used) { fprintf(stderr, "Out of memory\n"); exit(1); }
+
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.used[i]) __tl_memo_store(table, &old.keys[i * old.arity], old.values[i]);
+    }
+    free(old.keys);
+    free(old.values);
+    free(old.used);
+}
+
+void __tl_memo_store(TLMemoTable* table, const int64_t* args, int64_t value) {
+    if (table->count < TL_MEMO_MAX_ENTRIES && (table->count + 1) * 10 > table->capacity * 7) memo_grow(table);
+    size_t slot = memo_find(table, args);
+    if (!table->used[slot] && table->count >= TL_MEMO_MAX_ENTRIES) {
+        /* Full: evict whatever sits in the home slot. Probe chains that run
+           through it stay intact because the slot remains in use. */
+        slot = (size_t)memo_hash(args, table->arity) & (table->capacity - 1);
+        if (!table->used[slot]) return;
+        memcpy(&table->keys[slot * table->arity], args, table->arity * sizeof(int64_t));
+    }
+    else if (!table->used[slot]) {
+        memcpy(&table->keys[slot * table->arity], args, table->arity * sizeof(int64_t));
+        table->used[slot] = 1;
+        table->count++;
+    }
+    table->values[slot] = value;
+}
+
+TL_COLD void __tl_cold_print(const char* text) {
+    printf("%s\n", text);
+}
+
+TL_COLD TL_NORETURN void __tl_bounds_error(void) {
+    fprintf(stderr, "Array index out of bounds\n");
+    exit(1);
+}
+
+static const char* profile_path;
+static const char* const* profile_names;
+static uint64_t* profile_counters;
+static size_t profile_count;
+
+/* Counts already in the file are added in so that several runs accumulate
+   into one profile. */
+static void profile_merge_existing(void) {
+    FILE* file = fopen(profile_path, "r");
+    if (!file) return;
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* name = NULL;
+        unsigned long long count = strtoull(line, &name, 10);
+        if (line[0] == '#' || name == line || *name != ' ') continue;
+        for (size_t i = 0; i < profile_count; i++) {
+            if (strcmp(profile_names[i], name + 1) == 0) {
+                profile_counters[i] += count;
+                break;
+            }
+        }
+    }
+    fclose(file);
+}
+
+static void profile_dump(void) {
+    profile_merge_existing();
+    FILE* file = fopen(profile_path, "w");
+    if (!file) { fprintf(stderr, "Warning: cannot write profile '%s'\n", profile_path); return; }
+    fprintf(file, "# tlprof 1\n");
+    for (size_t i = 0; i < profile_count; i++) {
+        fprintf(file, "%llu %s\n", (unsigned long long)profile_counters[i], profile_names[i]);
+    }
+    fclose(file);
+}
+
+void __tl_profile_register(const char* path, const char* const* names, uint64_t* counters, size_t count) {
+    profile_path = path;
+    profile_names = names;
+    profile_counters = counters;
+    profile_count = count;
+    atexit(profile_dump);
+}
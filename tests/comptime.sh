@@ -0,0 +1,15 @@
+#!/bin/sh
+# fibonacci(10) is pure and folds to 55 at -O2; loud_square prints and is
+# left as a call. A step limit too small for fibonacci keeps its call.
+compiler=$1
+output=build/tests/comptime_check.c
+mkdir -p build/tests
+rm -f $output
+$compiler tests/comptime.tl -O2 -o $output > /dev/null 2>&1
+[ -f $output ] || exit 1
+grep -q "55LL" $output || exit 1
+grep -q "= loud_square" $output || exit 1
+rm -f $output
+$compiler tests/comptime.tl -O2 --max-comptime-steps=10 -o $output > /dev/null 2>&1
+[ -f $output ] || exit 1
+! grep -q "55LL" $output
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Stores overwritten before they are read disappear at -O2. The calls
+# whose results are overwritten stay for their output, which
+# tests/dead_stores.out checks.
+compiler=$1
+output=build/tests/dead_stores_check.c
+mkdir -p build/tests
+rm -f $output
+$compiler tests/dead_stores.tl -O2 -o $output > /dev/null 2>&1
+[ -f $output ] || exit 1
+! grep -q "123456\|7777" $output
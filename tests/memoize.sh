@@ -0,0 +1,9 @@
+#!/bin/sh
+# At -O3 the assembly backend wraps memoized functions in a table lookup,
+# like the C backend.
+compiler=$1
+output=build/tests/memoize_check.asm
+mkdir -p build/tests
+rm -f $output
+$compiler tests/memoize.tl -O3 --asm -o $output > /dev/null 2>&1
+[ -f $output ] && grep -q "__tl_memo_lookup" $output && grep -q "call paths__impl" $output
@@ -0,0 +1,9 @@
+#!/bin/sh
+# x * 8 with a possibly negative x has to stay a multiply in the C output,
+# since a signed << of a negative value is undefined.
+compiler=$1
+output=build/tests/negative_shift_check.c
+mkdir -p build/tests
+rm -f $output
+$compiler tests/negative_shift.tl -o $output > /dev/null 2>&1
+[ -f $output ] && ! grep -q "<<" $output
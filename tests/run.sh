@@ -0,0 +1,52 @@
+#!/bin/sh
+# Runs every tests/NAME.tl that has a tests/NAME.out through the C backend,
+# the native --run mode and the bytecode interpreter at -O0, -O2 and -O3, and
+# compares the program output. tests/*.sh scripts get the compiler path.
+compiler=${1:-build/compiler}
+cc=${CC:-gcc}
+work=build/tests
+mkdir -p $work
+failed=0
+
+fail()
+{
+    echo "FAIL $1"
+    failed=$((failed + 1))
+}
+
+check()
+{
+    printf '%s\n' "$2" | cmp -s - "$3" || fail "$1"
+}
+
+for test_file in tests/*.tl; do
+    name=$(basename $test_file .tl)
+    expected=tests/$name.out
+    [ -f $expected ] || continue
+    echo "Testing $test_file"
+    for level in -O0 -O2 -O3; do
+        rm -f $work/$name.c $work/$name
+        $compiler $test_file -o $work/$name.c $level > /dev/null 2>&1
+        if [ -f $work/$name.c ] && $cc -w -Iinclude $work/$name.c src/runtime/runtime.c -o $work/$name -lm; then
+            check "$name $level (C)" "$(./$work/$name)" $expected
+        else
+            fail "$name $level (C)"
+        fi
+        for mode in --run --interpret; do
+            output=$($compiler $test_file $mode $level 2>/dev/null | grep -v '^\[DEBUG\] \(Entered\|Exiting\) main$')
+            check "$name $level ($mode)" "$output" $expected
+        done
+    done
+done
+
+for script in tests/*.sh; do
+    [ "$script" = tests/run.sh ] && continue
+    echo "Testing $script"
+    sh $script $compiler || fail $script
+done
+
+if [ $failed -ne 0 ]; then
+    echo "$failed test(s) failed"
+    exit 1
+fi
+echo "All tests passed"
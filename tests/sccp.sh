@@ -0,0 +1,10 @@
+#!/bin/sh
+# mode stays 2 through the loop, so the else branch is folded away even
+# though it sits inside the loop body.
+compiler=$1
+output=build/tests/sccp_check.c
+mkdir -p build/tests
+rm -f $output
+$compiler tests/sccp.tl -O2 -o $output > /dev/null 2>&1
+[ -f $output ] || exit 1
+! grep -q "99900[12]" $output
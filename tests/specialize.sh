@@ -0,0 +1,12 @@
+#!/bin/sh
+# At -O2 scaled gets a clone per constant call site up to the clone
+# limit, and offset loses the parameter every caller passes as 7.
+compiler=$1
+output=build/tests/specialize_check.c
+mkdir -p build/tests
+rm -f $output
+$compiler tests/specialize.tl -O2 -o $output > /dev/null 2>&1
+[ -f $output ] || exit 1
+grep -q "^int64_t scaled__48_18(void) {" $output || exit 1
+[ $(grep -c "^int64_t scaled__.*) {" $output) -le 4 ] || exit 1
+grep -q "^int64_t offset(int64_t x) {" $output
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Bounds-check failures in vector_dot jump to one cold block. It has to
+# stay out of line: a goto from each check, the loops kept shallow.
+compiler=$1
+output=build/tests/structure_check.c
+mkdir -p build/tests
+rm -f $output
+$compiler examples/benchmarks/vector_dot.tl -O3 -o $output > /dev/null 2>&1
+[ -f $output ] || exit 1
+grep -q "^    L2: TL_COLD_LABEL;" $output || exit 1
+grep -q "goto L2;" $output || exit 1
+grep -q "else" $output && exit 1
+# Function body, the round loop, an inner loop and one if at most.
+! grep -q "^                     *[^ ]" $output
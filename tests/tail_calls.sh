@@ -0,0 +1,8 @@
+#!/bin/sh
+# Ten million self tail calls only fit on the stack once tail recursion
+# has become a loop.
+compiler=$1
+for mode in --run --interpret; do
+    output=$($compiler tests/tail_calls_deep.tl $mode -O2 2>/dev/null | grep -v '^\[DEBUG\]')
+    [ "$output" = "50000005000000" ] || exit 1
+done